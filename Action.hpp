@@ -12,8 +12,14 @@
 #define EKF_ACTION_HEADER_GUARD
 
 // C++ Standard Library
+#include <string>
+#include <utility>
 #include <vector>
 
+// ekf Library
+#include <AgentGroup.hpp>
+#include <TaylorJet.hpp>
+
 class Action
 {
  public:
@@ -25,11 +31,115 @@ class Action
   virtual void getAcceleration( std::vector< double > &acceleration,
                                 const std::vector< double > &state ) const = 0;
 
+  // Computes the acceleration at time t and adds it to the passed in
+  // vector "acceleration". Actions that depend on time ( e.g. maneuvers )
+  // override this; by default the time is ignored.
+  virtual void getAccelerationAtTime( std::vector< double > &acceleration,
+                                      const std::vector< double > &state,
+                                      double t ) const
+  {
+    getAcceleration( acceleration, state );
+  };
+
+  // Computes the acceleration at time t in float or long double, and adds
+  // it to acceleration ( see ScalarPropagator ). By default the double
+  // model is evaluated and rounded to the result; actions override these
+  // to carry the precision through.
+  virtual void getScalarAcceleration( std::vector< float > &acceleration,
+                                      const std::vector< float > &state,
+                                      double t ) const
+  {
+    roundedAcceleration( acceleration, state, t );
+  };
+  virtual void getScalarAcceleration(
+    std::vector< long double > &acceleration,
+    const std::vector< long double > &state, double t ) const
+  {
+    roundedAcceleration( acceleration, state, t );
+  };
+
   // Computes the partial derivative of the acceleration terms and owned
-  // parameters
+  // parameters, and adds them to the row major partials over the
+  // activeAgents group ( placed by AgentGroup::getRow )
   virtual void getPartials( std::vector < double > &partials,
                             const std::vector< double > &state,
-                            const std::vector< std::string >  &activeAgents ) = 0;
+                            const AgentGroup &activeAgents ) = 0;
+
+  // Fills pattern with the ( row, column ) agent IDs of every partial
+  // this action can contribute, so callers evaluate and place only
+  // those ( see getPartialValues ). Returns false if the action cannot
+  // say, in which case callers use getPartials.
+  virtual bool getPartialPattern(
+    std::vector< std::pair< int, int > > &pattern ) const
+  {
+    return false;
+  };
+
+  // Computes the partials of getPartialPattern, in its order, into
+  // values
+  virtual void getPartialValues( double *values,
+                                 const std::vector< double > &state ) const
+  {
+  };
+
+  // Computes the order k Taylor coefficient of the acceleration due to
+  // this action and adds it to the jets in "acceleration". Returns
+  // false if the action has no Taylor model.
+  virtual bool getAccelerationJet( std::vector< TaylorJet > &acceleration,
+                                   const std::vector< TaylorJet > &state,
+                                   int k, TaylorWorkspace &workspace ) const
+  {
+    return false;
+  };
+
+  // Fills parameters with every constant the acceleration depends on,
+  // so a propagation can be identified by them ( see PropagationCache ).
+  // Returns false if the action cannot say, which disables caching.
+  virtual bool getParameters( std::vector< double > &parameters ) const
+  {
+    return false;
+  };
+
+  // Binds the owned parameters to live values in parameters, adding
+  // those not yet there with this action's own values. The action then
+  // reads them from the group, which must outlive it. Nothing by default.
+  virtual void bindParameters( AgentGroup &parameters )
+  {
+  };
+
+  // Names the owned parameters for this action alone, in the order the
+  // action documents, so two bodies or atmospheres bind and estimate
+  // separate agents. Must precede bindParameters. Nothing by default.
+  virtual void setParameterNames( const std::vector< std::string > &names )
+  {
+  };
+
+  // Returns the times in ( t0, t1 ] at which this action switches
+  // discontinuously ( e.g. burn start and end ). None by default.
+  virtual std::vector< double > getSwitchTimes( double t0, double t1 ) const
+  {
+    return std::vector< double >();
+  };
+
+  // Computes a switching function whose sign change marks a state
+  // dependent discontinuity ( e.g. shadow entry, a density band edge ).
+  // Returns false if the action has none.
+  virtual bool getSwitchFunction( double &value,
+                                  const std::vector< double > &state,
+                                  double t ) const
+  {
+    return false;
+  };
+
+  // Applies any jump this action makes at switch time t to
+  // stateAndPartials ( the state followed by the row major STM over
+  // activeAgents ), e.g. an impulsive maneuver. Nothing by default.
+  virtual void applySwitch( std::vector< double > &stateAndPartials,
+                            const AgentGroup &activeAgents,
+                            double t ) const
+  {
+  };
+
   // Destructor
   virtual ~Action(){};
 
@@ -37,6 +147,21 @@ class Action
     /// @todo this needs to go eventually
     const bool m_debug = false;
 
+    // The double acceleration at state, rounded and added to acceleration
+    template< typename Scalar >
+    void roundedAcceleration( std::vector< Scalar > &acceleration,
+                              const std::vector< Scalar > &state,
+                              double t ) const
+    {
+      std::vector< double > x( state.begin(), state.end() );
+      std::vector< double > accel( 3, 0.0 );
+      getAccelerationAtTime( accel, x, t );
+      for ( int i = 0; i < 3; ++i )
+      {
+        acceleration[i] += accel[i];
+      }
+    };
+
   private:
 };
 
@@ -0,0 +1,55 @@
+
+#include "Agent.hpp"
+
+using namespace std;
+
+//=============================================================================
+//=============================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default constructor
+Agent::
+Agent()
+   : m_group(),
+     m_id( -1 )
+{
+}
+
+// Construct a handle to the named agent of group, adding it if needed.
+Agent::
+Agent( AgentGroup &group, const string &name )
+   : m_group( &group ),
+     m_id( AgentGroup::intern( name ) )
+{
+   group.add( name );
+}
+
+Agent::
+~Agent()
+{
+}
+
+//=============================================================================
+//=============================================================================
+// PUBLIC MEMBERS
+
+string
+Agent::
+getName() const
+{
+   return AgentGroup::getName( m_id );
+}
+
+double
+Agent::
+getValue() const
+{
+   return m_group->getValue( m_id );
+}
+
+void
+Agent::
+setValue( double value )
+{
+   m_group->setValue( getName(), value );
+}
@@ -1,16 +1,34 @@
 #ifndef EKF_AGENT_INCLUDE_
 #define EKF_AGENT_INCLUDE_
 
+#include <string>
+
+#include "AgentGroup.hpp"
+
+using namespace std;
+
 class Agent
 {
    /*
    An Agent is any named parameter in the universe which has both a
    quantity and a relationship with other Agents.
+
+   The quantity is not held here but in the AgentGroup the Agent belongs
+   to, so every Agent of a group is one slot of its contiguous values. An
+   Agent is a handle to that slot, and the group must outlive it.
    */
    public:
       Agent();
+      Agent( AgentGroup &group, const string &name );
       ~Agent();
+
+      string getName() const;
+      double getValue() const;
+      void setValue( double value );
+
    private:
+      AgentGroup* m_group;
+      int m_id;
 
 };
 
@@ -1,32 +1,278 @@
 
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+
 #include "AgentGroup.hpp"
 
-using namespace std;                                                             
-                                                                                 
-//=============================================================================  
-//=============================================================================  
-// CONSTRUCTORS / DESCTRUCTOR  
+using namespace std;
+
+namespace
+{
+   // The registry: names by ID and IDs by name. Reached through a
+   // function so it is built before any static Action interns its agents.
+   struct agent_registry
+   {
+      mutex lock;
+      vector< string > names;
+      unordered_map< string, int > ids;
+   };
+
+   agent_registry&
+   registry()
+   {
+      static agent_registry theRegistry;
+      return theRegistry;
+   }
+}
+
+//=============================================================================
+//=============================================================================
+// CONSTRUCTORS / DESCTRUCTOR
 
 // Default constructor
 AgentGroup::
 AgentGroup()
-   : m_agentNames(),                                           
-     m_agentPartials()
+   : m_agentNames(),
+     m_ids(),
+     m_rows(),
+     m_values(),
+     m_states()
 {
 }
 
 // Construct with vector of agent names.
 AgentGroup::
 AgentGroup( const vector< string > agentNames )
-   : m_agentNames( agentNames ),
-     m_agentPartials()
+   : m_agentNames(),
+     m_ids(),
+     m_rows(),
+     m_values(),
+     m_states()
+{
+   add( agentNames );
+}
+
+AgentGroup::
+~AgentGroup()
+{
+}
+
+//=============================================================================
+//=============================================================================
+// PUBLIC MEMBERS
+
+// Intern name in the registry, giving it the next ID if it is new.
+int
+AgentGroup::
+intern( const string &name )
+{
+   agent_registry &reg = registry();
+   lock_guard< mutex > guard( reg.lock );
+   unordered_map< string, int >::const_iterator search = reg.ids.find( name );
+   if ( search != reg.ids.end() )
+   {
+      return search->second;
+   }
+   int id = reg.names.size();
+   reg.names.push_back( name );
+   reg.ids[ name ] = id;
+   return id;
+}
+
+// Intern every name, returning their IDs in order.
+vector< int >
+AgentGroup::
+intern( const vector< string > &names )
+{
+   vector< int > ids;
+   for ( const string &name: names )
+   {
+      ids.push_back( intern( name ) );
+   }
+   return ids;
+}
+
+// Name of an interned ID.
+string
+AgentGroup::
+getName( int id )
+{
+   agent_registry &reg = registry();
+   lock_guard< mutex > guard( reg.lock );
+   return reg.names[ id ];
+}
+
+// Append an agent as the next STM row, without a value, unless it is already
+// in the group.
+void
+AgentGroup::
+add( const string &name )
 {
-   // Set partials matrix to correct size.
-   int numAgents = m_agentNames.size();
-   m_agentPartials.resize( numAgents, numAgents );
+   int id = intern( name );
+   if ( getRow( id ) < 0 )
+   {
+      append( id, name, 0.0, unsetSlot );
+   }
 }
 
-AgentGroup::                                                                     
-~AgentGroup()                                                                     
-{                                                                                
-}    
+// Append agents in order.
+void
+AgentGroup::
+add( const vector< string > &names )
+{
+   for ( const string &name: names )
+   {
+      add( name );
+   }
+}
+
+// Append an agent with a value. An agent already in the group takes the
+// value only if it was added without one; a value set or bound is kept.
+void
+AgentGroup::
+add( const string &name, double value )
+{
+   int id = intern( name );
+   int row = getRow( id );
+   if ( row < 0 )
+   {
+      append( id, name, value, setSlot );
+   }
+   else if ( m_states[ row ] == unsetSlot )
+   {
+      m_values[ row ] = value;
+      m_states[ row ] = setSlot;
+   }
+}
+
+// Claim an agent for one Action. An agent added without a value takes the
+// Action's, one set by the user keeps its own, and one already bound fails,
+// since two Actions reading the same agent is never intended.
+void
+AgentGroup::
+bind( const string &name, double value )
+{
+   int id = intern( name );
+   int row = getRow( id );
+   if ( row < 0 )
+   {
+      append( id, name, value, boundSlot );
+      return;
+   }
+   if ( m_states[ row ] == boundSlot )
+   {
+      cout << "Agent " << name << " is already bound to an Action" << endl;
+      throw;
+   }
+   if ( m_states[ row ] == unsetSlot )
+   {
+      m_values[ row ] = value;
+   }
+   m_states[ row ] = boundSlot;
+}
+
+// Set the value of an agent in the group.
+void
+AgentGroup::
+setValue( const string &name, double value )
+{
+   int row = getRow( intern( name ) );
+   if ( row < 0 )
+   {
+      cout << "Agent " << name << " is not in the group" << endl;
+      throw;
+   }
+   m_values[ row ] = value;
+   if ( m_states[ row ] == unsetSlot )
+   {
+      m_states[ row ] = setSlot;
+   }
+}
+
+// Set the values of the first agents, in row order.
+void
+AgentGroup::
+setValues( const vector< double > &values )
+{
+   if ( values.size() > m_values.size() )
+   {
+      cout << values.size() << " values for a group of " << m_values.size()
+           << " agents" << endl;
+      throw;
+   }
+   for ( size_t row = 0; row < values.size(); ++row )
+   {
+      m_values[ row ] = values[ row ];
+      if ( m_states[ row ] == unsetSlot )
+      {
+         m_states[ row ] = setSlot;
+      }
+   }
+}
+
+// Add a correction to the leading values in place, those agents estimated
+// ahead of constants only held for bound Actions. Nothing is reallocated,
+// so Actions bound to the group read the corrected values directly.
+void
+AgentGroup::
+update( const Eigen::VectorXd &correction )
+{
+   if ( correction.size() > (int) m_values.size() )
+   {
+      cout << "Correction of size " << correction.size()
+           << " for a group of " << m_values.size() << " agents" << endl;
+      throw;
+   }
+   Eigen::Map< Eigen::VectorXd >( m_values.data(), correction.size() ) +=
+      correction;
+}
+
+// Number of agents in the group.
+int
+AgentGroup::
+size() const
+{
+   return m_ids.size();
+}
+
+// IDs in STM row order.
+const vector< int >&
+AgentGroup::
+getIds() const
+{
+   return m_ids;
+}
+
+// Names in STM row order.
+const vector< string >&
+AgentGroup::
+getNames() const
+{
+   return m_agentNames;
+}
+
+// Values in STM row order.
+const vector< double >&
+AgentGroup::
+getValues() const
+{
+   return m_values;
+}
+
+//=============================================================================
+//=============================================================================
+// PRIVATE MEMBERS
+
+// Append an agent, known not to be in the group, as the next STM row.
+void
+AgentGroup::
+append( int id, const string &name, double value, slot_state state )
+{
+   pair< int, int > row( id, m_ids.size() );
+   m_rows.insert( lower_bound( m_rows.begin(), m_rows.end(), row ), row );
+   m_ids.push_back( id );
+   m_agentNames.push_back( name );
+   m_values.push_back( value );
+   m_states.push_back( state );
+}
@@ -1,25 +1,98 @@
-#ifndef EKF_AGENTGROUP_INCLUDE_                                                      
-#define EKF_AGENTGROUP_INCLUDE_ 
+#ifndef EKF_AGENTGROUP_INCLUDE_
+#define EKF_AGENTGROUP_INCLUDE_
 
+#include <algorithm>
+#include <string>
+#include <utility>
 #include <vector>
-#include <Eigen/Dense> 
+#include <Eigen/Dense>
 
 using namespace std;
 
-class AgentGroup 
+class AgentGroup
 {
-   /* 
-   An AgentGroup holds the names of nondynamic parameters, and a matrix to 
-   collect their partial derivatives. 
+   /*
+   An AgentGroup holds the names of nondynamic parameters, in the order
+   their partial derivatives are collected.
+
+   Names are interned in a single registry shared by every group, which
+   gives each name one dense integer ID for the life of the program. A
+   group is an ordered set of IDs, and the position of an ID in the group
+   is its row ( and column ) of the STM, looked up by getRow() with a
+   binary search over the group's own IDs. A group's size follows its
+   agents, not the number of names ever interned. Actions intern the
+   agents they own once, so partials are placed by ID without comparing
+   names.
+
+   A group also holds the value of each agent, contiguous in row order.
+   Actions bound to a group ( Action::bindParameters ) read their
+   constants from it, so a filter correction is applied in place with
+   update() and the next propagation sees it without rebuilding them.
+   Each agent is bound once: bind() gives an Action's value to an agent
+   added without one, keeps a value already set, and fails if another
+   Action holds the agent.
    */
    public:
       AgentGroup();
       AgentGroup( const vector< string > agentNames );
       ~AgentGroup();
 
+      // Intern name in the registry, returning its ID
+      static int intern( const string &name );
+      // Intern every name, returning their IDs
+      static vector< int > intern( const vector< string > &names );
+      // Name of an interned ID
+      static string getName( int id );
+
+      // Append agents not already in the group, without a value or with
+      // value
+      void add( const string &name );
+      void add( const vector< string > &names );
+      void add( const string &name, double value );
+      // Claim an agent for one Action, appending it with value or giving
+      // value to it if it was added without one
+      void bind( const string &name, double value );
+
+      // Set the value of an agent in the group
+      void setValue( const string &name, double value );
+      // Set the leading values, in row order
+      void setValues( const vector< double > &values );
+      // Add correction, in row order, to the leading values
+      void update( const Eigen::VectorXd &correction );
+
+      // Number of agents in the group
+      int size() const;
+      // IDs and names in STM row order
+      const vector< int >& getIds() const;
+      const vector< string >& getNames() const;
+      // Values in STM row order
+      const vector< double >& getValues() const;
+      // STM row of an ID, or -1 if it is not in the group
+      int getRow( int id ) const
+      {
+         vector< pair< int, int > >::const_iterator found =
+            lower_bound( m_rows.begin(), m_rows.end(), make_pair( id, -1 ) );
+         return ( ( found != m_rows.end() ) && ( found->first == id ) ) ?
+            found->second : -1;
+      };
+      // Value of an ID in the group
+      double getValue( int id ) const
+      {
+         return m_values[ getRow( id ) ];
+      };
+
    private:
       vector< string > m_agentNames;
-      Eigen::MatrixXd m_agentPartials;       
+      vector< int > m_ids;
+      // ( ID, STM row ) of every agent, sorted by ID
+      vector< pair< int, int > > m_rows;
+      vector< double > m_values;
+      // Whether each agent, in row order, has a value and an Action
+      enum slot_state { unsetSlot, setSlot, boundSlot };
+      vector< slot_state > m_states;
+
+      void append( int id, const string &name, double value,
+                   slot_state state );
 
 };
 
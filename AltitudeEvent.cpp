@@ -0,0 +1,71 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    AltitudeEvent.cpp
+/// @brief   Event function for crossing an altitude threshold above a
+///          spherical body.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <cmath>
+
+// ekf Library
+#include <AltitudeEvent.hpp>
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+AltitudeEvent::
+AltitudeEvent()
+    : m_radius(),
+      m_altitude(),
+      m_direction()
+{
+}
+
+// Constructor for the threshold altitude above a body of radius radius,
+// reporting the sign changes in direction
+AltitudeEvent::
+AltitudeEvent(
+    double radius,
+    double altitude,
+    int direction )
+    : m_radius( radius ),
+      m_altitude( altitude ),
+      m_direction( direction )
+{
+}
+
+// Default Destructor
+AltitudeEvent::
+~AltitudeEvent()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Altitude above the body less the threshold
+double
+AltitudeEvent::
+getValue(
+    const std::vector< double > &state,
+    double t ) const
+{
+  double dist = sqrt( pow( state[0], 2 ) + pow( state[1], 2 ) +
+                      pow( state[2], 2 ) );
+  return dist - m_radius - m_altitude;
+}
+
+// Sign changes to report
+int
+AltitudeEvent::
+getDirection() const
+{
+  return m_direction;
+}
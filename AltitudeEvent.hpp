@@ -0,0 +1,48 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    AltitudeEvent.hpp
+/// @brief   Event function for crossing an altitude threshold above a
+///          spherical body.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_ALTITUDEEVENT_HEADER_GUARD
+#define EKF_ALTITUDEEVENT_HEADER_GUARD
+
+// C++ Standard Library
+#include <vector>
+
+// ekf Library
+#include <Event.hpp>
+
+/// @brief Event function for crossing an altitude threshold.
+///
+/// The value is the altitude above a spherical body less the threshold,
+/// so the event rises when climbing through the threshold and falls when
+/// descending through it.
+///
+class AltitudeEvent : public Event
+{
+ public:
+  AltitudeEvent();
+  AltitudeEvent( double radius, double altitude, int direction );
+
+ ~AltitudeEvent() override;
+
+  // Altitude above the body less the threshold
+  double getValue( const std::vector< double > &state,
+                   double t ) const override;
+
+  // Sign changes to report
+  int getDirection() const override;
+
+ private:
+  double m_radius;
+  double m_altitude;
+  int m_direction;
+};
+
+#endif // EKF_ALTITUDEEVENT_HEADER_GUARD
@@ -0,0 +1,58 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ApsisEvent.cpp
+/// @brief   Event function for periapsis and apoapsis passages.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// ekf Library
+#include <ApsisEvent.hpp>
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+ApsisEvent::
+ApsisEvent()
+    : m_direction()
+{
+}
+
+// Constructor reporting periapsis ( +1 ), apoapsis ( -1 ) or both ( 0 )
+ApsisEvent::
+ApsisEvent(
+    int direction )
+    : m_direction( direction )
+{
+}
+
+// Default Destructor
+ApsisEvent::
+~ApsisEvent()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Radial rate r . v, zero at the apsides
+double
+ApsisEvent::
+getValue(
+    const std::vector< double > &state,
+    double t ) const
+{
+  return state[0] * state[3] + state[1] * state[4] + state[2] * state[5];
+}
+
+// Sign changes to report
+int
+ApsisEvent::
+getDirection() const
+{
+  return m_direction;
+}
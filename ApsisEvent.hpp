@@ -0,0 +1,45 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ApsisEvent.hpp
+/// @brief   Event function for periapsis and apoapsis passages.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_APSISEVENT_HEADER_GUARD
+#define EKF_APSISEVENT_HEADER_GUARD
+
+// C++ Standard Library
+#include <vector>
+
+// ekf Library
+#include <Event.hpp>
+
+/// @brief Event function for apsis passages.
+///
+/// The value is the radial rate r . v, which rises through zero at
+/// periapsis and falls through zero at apoapsis. Construct with +1 for
+/// periapsis only, -1 for apoapsis only, or 0 for both.
+///
+class ApsisEvent : public Event
+{
+ public:
+  ApsisEvent();
+  ApsisEvent( int direction );
+
+ ~ApsisEvent() override;
+
+  // Radial rate r . v
+  double getValue( const std::vector< double > &state,
+                   double t ) const override;
+
+  // Sign changes to report
+  int getDirection() const override;
+
+ private:
+  int m_direction;
+};
+
+#endif // EKF_APSISEVENT_HEADER_GUARD
@@ -0,0 +1,310 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    Associator.cpp
+/// @brief   Gated association of untagged measurements to tracked
+///          objects.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+// ekf Library
+#include <Associator.hpp>
+
+namespace
+{
+  const double pi = 3.14159265358979323846;
+
+  // Objects a leaf holds at most
+  const int leafSize = 8;
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor, gating at the 99.9 % point
+Associator::
+Associator()
+    : m_gate( 16.27 ),
+      m_motions(),
+      m_knowledge(),
+      m_positions(),
+      m_covariances(),
+      m_eigenvalues(),
+      m_order(),
+      m_nodes()
+{
+}
+
+// Constructor with the squared Mahalanobis distance gate
+Associator::
+Associator(
+    double gate )
+    : m_gate( gate ),
+      m_motions(),
+      m_knowledge(),
+      m_positions(),
+      m_covariances(),
+      m_eigenvalues(),
+      m_order(),
+      m_nodes()
+{
+}
+
+// Default Destructor
+Associator::
+~Associator()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Track an object
+int
+Associator::
+addObject(
+    std::shared_ptr< const Motion > motion,
+    std::shared_ptr< const Knowledge > knowledge )
+{
+  m_motions.push_back( motion );
+  m_knowledge.push_back( knowledge );
+  return m_motions.size() - 1;
+}
+
+// Predict the position and position covariance of every object at t
+void
+Associator::
+predict( double t )
+{
+  int numObjects = m_motions.size();
+  std::vector< double > positions( 3 * numObjects );
+  std::vector< double > covariances( 9 * numObjects );
+  for ( int i = 0; i < numObjects; ++i )
+  {
+    std::vector< double > state = m_motions[i]->getState( t );
+    Eigen::MatrixXd covariance = m_knowledge[i]->predictCovariance(
+      m_motions[i]->getStatePartials( t ) );
+    for ( int r = 0; r < 3; ++r )
+    {
+      positions[ 3 * i + r ] = state[r];
+      for ( int c = 0; c < 3; ++c )
+      {
+        covariances[ 9 * i + 3 * r + c ] = covariance( r, c );
+      }
+    }
+  }
+  setPredictions( positions, covariances );
+}
+
+// Index predicted positions and covariances
+void
+Associator::
+setPredictions(
+    const std::vector< double > &positions,
+    const std::vector< double > &covariances )
+{
+  if ( 3 * covariances.size() != 9 * positions.size() )
+  {
+    std::cout << "Associator needs a covariance for each of "
+              << positions.size() / 3 << " positions" << std::endl;
+    throw;
+  }
+  m_positions = positions;
+  m_covariances = covariances;
+
+  int numObjects = positions.size() / 3;
+  m_eigenvalues.resize( numObjects );
+  for ( int i = 0; i < numObjects; ++i )
+  {
+    Eigen::Map< const Eigen::Matrix3d > P( &m_covariances[ 9 * i ] );
+    Eigen::SelfAdjointEigenSolver< Eigen::Matrix3d > solver;
+    solver.computeDirect( P, Eigen::EigenvaluesOnly );
+    m_eigenvalues[i] = std::max( 0.0, solver.eigenvalues().maxCoeff() );
+  }
+  buildTree();
+}
+
+// Gate and score each measurement against the objects within reach
+std::vector< Association >
+Associator::
+associate(
+    const std::vector< Eigen::Vector3d > &measurements,
+    const Eigen::Matrix3d &noise ) const
+{
+  Eigen::SelfAdjointEigenSolver< Eigen::Matrix3d > solver;
+  solver.computeDirect( noise, Eigen::EigenvaluesOnly );
+  double noiseEigenvalue = std::max( 0.0, solver.eigenvalues().maxCoeff() );
+
+  std::vector< Association > associations;
+  std::vector< int > stack;
+  for ( size_t m = 0; m < measurements.size(); ++m )
+  {
+    const Eigen::Vector3d &z = measurements[m];
+    Association best = { (int) m, -1, 0.0,
+                         std::numeric_limits< double >::infinity(), 0 };
+    if ( !m_nodes.empty() )
+    {
+      stack.assign( 1, 0 );
+    }
+    while ( !stack.empty() )
+    {
+      const kd_node &node = m_nodes[ stack.back() ];
+      stack.pop_back();
+
+      // Skip nodes further than any object in them could be gated
+      double reach = m_gate * ( node.largestEigenvalue + noiseEigenvalue );
+      double away = 0.0;
+      for ( int c = 0; c < 3; ++c )
+      {
+        double d = std::max( { node.low[c] - z[c], z[c] - node.high[c],
+                               0.0 } );
+        away += d * d;
+      }
+      if ( away > reach )
+      {
+        continue;
+      }
+      if ( node.left >= 0 )
+      {
+        stack.push_back( node.left );
+        stack.push_back( node.right );
+        continue;
+      }
+
+      for ( int k = node.first; k < node.last; ++k )
+      {
+        int i = m_order[k];
+        Eigen::Vector3d r =
+          z - Eigen::Map< const Eigen::Vector3d >( &m_positions[ 3 * i ] );
+        if ( r.squaredNorm() > m_gate * ( m_eigenvalues[i] + noiseEigenvalue ) )
+        {
+          continue;
+        }
+        Eigen::Matrix3d S =
+          Eigen::Map< const Eigen::Matrix3d >( &m_covariances[ 9 * i ] ) +
+          noise;
+        Eigen::LLT< Eigen::Matrix3d > llt( S );
+        double distance = r.dot( llt.solve( r ) );
+        if ( distance > m_gate )
+        {
+          continue;
+        }
+        ++best.candidates;
+
+        // -2 log likelihood, with ln det( 2 pi S ) from the factor
+        double logDet = 3 * std::log( 2 * pi );
+        for ( int c = 0; c < 3; ++c )
+        {
+          logDet += 2 * std::log( llt.matrixL()( c, c ) );
+        }
+        double score = distance + logDet;
+        if ( score < best.score )
+        {
+          best.object = i;
+          best.distance = distance;
+          best.score = score;
+        }
+      }
+    }
+    associations.push_back( best );
+  }
+  return associations;
+}
+
+// Squared Mahalanobis distance gate
+double
+Associator::
+getGate() const
+{
+  return m_gate;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Index the predicted positions
+void
+Associator::
+buildTree()
+{
+  int numObjects = m_eigenvalues.size();
+  m_order.resize( numObjects );
+  for ( int i = 0; i < numObjects; ++i )
+  {
+    m_order[i] = i;
+  }
+  m_nodes.clear();
+  if ( numObjects > 0 )
+  {
+    m_nodes.reserve( 4 * numObjects / leafSize + 1 );
+    buildNode( 0, numObjects );
+  }
+}
+
+// Node over the objects m_order[ first, last ), split at the median of
+// its widest axis, returning its index
+int
+Associator::
+buildNode(
+    int first,
+    int last )
+{
+  int index = m_nodes.size();
+  m_nodes.push_back( kd_node() );
+  kd_node node;
+  node.first = first;
+  node.last = last;
+  node.left = -1;
+  node.right = -1;
+  node.largestEigenvalue = 0.0;
+  for ( int c = 0; c < 3; ++c )
+  {
+    node.low[c] = std::numeric_limits< double >::infinity();
+    node.high[c] = -std::numeric_limits< double >::infinity();
+  }
+  for ( int k = first; k < last; ++k )
+  {
+    int i = m_order[k];
+    for ( int c = 0; c < 3; ++c )
+    {
+      node.low[c] = std::min( node.low[c], m_positions[ 3 * i + c ] );
+      node.high[c] = std::max( node.high[c], m_positions[ 3 * i + c ] );
+    }
+    node.largestEigenvalue =
+      std::max( node.largestEigenvalue, m_eigenvalues[i] );
+  }
+
+  if ( last - first > leafSize )
+  {
+    int axis = 0;
+    for ( int c = 1; c < 3; ++c )
+    {
+      if ( node.high[c] - node.low[c] > node.high[ axis ] - node.low[ axis ] )
+      {
+        axis = c;
+      }
+    }
+    int middle = ( first + last ) / 2;
+    std::nth_element( m_order.begin() + first, m_order.begin() + middle,
+                      m_order.begin() + last,
+                      [&]( int a, int b )
+                      {
+                        return m_positions[ 3 * a + axis ] <
+                               m_positions[ 3 * b + axis ];
+                      } );
+    node.left = buildNode( first, middle );
+    node.right = buildNode( middle, last );
+  }
+  m_nodes[ index ] = node;
+  return index;
+}
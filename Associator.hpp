@@ -0,0 +1,118 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    Associator.hpp
+/// @brief   Gated association of untagged measurements to tracked
+///          objects.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_ASSOCIATOR_HEADER_GUARD
+#define EKF_ASSOCIATOR_HEADER_GUARD
+
+// C++ Standard Library
+#include <memory>
+#include <vector>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <Knowledge.hpp>
+#include <Motion.hpp>
+
+/// @brief The object a measurement is associated with.
+///
+/// object is -1 when no object passes the gate. distance is the squared
+/// Mahalanobis distance of the measurement from the predicted position,
+/// score its -2 log likelihood, and candidates the number of objects
+/// that passed the gate.
+///
+struct Association
+{
+  int measurement;
+  int object;
+  double distance;
+  double score;
+  int candidates;
+};
+
+/// @brief Associate position measurements with tracked objects.
+///
+/// At each measurement epoch the objects are predicted, position and
+/// position covariance ( the Knowledge covariance mapped through the
+/// Motion STM ), and the positions indexed in a k-d tree. Each node of
+/// the tree holds the largest covariance eigenvalue below it, which
+/// bounds how far away a gated object can be: the squared Mahalanobis
+/// distance d^2 = r^T ( P + R )^-1 r is at most the gate only within
+/// | r |^2 <= gate ( lambda( P ) + lambda( R ) ). A measurement visits
+/// only the nodes within that radius, so associating M measurements
+/// with N objects costs O( N log N ) to index and about O( M log N )
+/// to query, instead of O( M N ) pairs.
+///
+/// Candidates inside the gate are scored by their Gaussian likelihood,
+/// d^2 + ln det( 2 pi ( P + R ) ), and each measurement takes the best
+/// independently; resolving two measurements taking one object is left
+/// to the caller.
+///
+class Associator
+{
+ public:
+  Associator();
+  Associator( double gate );
+ ~Associator();
+
+  // Track an object by its motion and its covariance at the epoch of
+  // the STM, returning its index
+  int addObject( std::shared_ptr< const Motion > motion,
+                 std::shared_ptr< const Knowledge > knowledge );
+
+  // Predict every object at time t, which each Motion must have logged,
+  // and index them
+  void predict( double t );
+  // Index predicted positions, X, Y, Z for each object in turn, and
+  // their row major 3x3 covariances
+  void setPredictions( const std::vector< double > &positions,
+                       const std::vector< double > &covariances );
+
+  // Associate position measurements with noise covariance to the
+  // indexed objects, in measurement order
+  std::vector< Association > associate(
+    const std::vector< Eigen::Vector3d > &measurements,
+    const Eigen::Matrix3d &noise ) const;
+
+  // Squared Mahalanobis distance gate ( default 16.27, the 99.9 %
+  // point for three degrees of freedom )
+  double getGate() const;
+
+ private:
+  struct kd_node
+  {
+    int first;
+    int last;
+    int left;
+    int right;
+    double low[3];
+    double high[3];
+    double largestEigenvalue;
+  };
+
+  double m_gate;
+  std::vector< std::shared_ptr< const Motion > > m_motions;
+  std::vector< std::shared_ptr< const Knowledge > > m_knowledge;
+
+  // Predictions, by object
+  std::vector< double > m_positions;
+  std::vector< double > m_covariances;
+  std::vector< double > m_eigenvalues;
+  // Objects in tree order, and the nodes over them
+  std::vector< int > m_order;
+  std::vector< kd_node > m_nodes;
+
+  void buildTree();
+  int buildNode( int first, int last );
+};
+
+#endif // EKF_ASSOCIATOR_HEADER_GUARD
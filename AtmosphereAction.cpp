@@ -11,10 +11,42 @@
 // C++ Standard Library
 #include <cmath>
 #include <iostream>
+#include <limits>
+#include <memory>
 
 // ekf Library
 #include <AtmosphereAction.hpp>
 
+// Owned agent indices
+namespace
+{
+  enum { iX, iY, iZ, idX, idY, idZ, iRefHeight, iRefDensity, iStep, iRot,
+         iCd, numOwned };
+
+  // Owned partials evalPartials computes, as ( row, column ) indices
+  const int partialPattern[][2] = {
+    { iX, idX }, { iY, idY }, { iZ, idZ },
+    { idX, iX }, { idX, iY }, { idX, iZ },
+    { idX, idX }, { idX, idY }, { idX, idZ },
+    { idY, iX }, { idY, iY }, { idY, iZ },
+    { idY, idX }, { idY, idY }, { idY, idZ },
+    { idZ, iX }, { idZ, iY }, { idZ, iZ },
+    { idZ, idX }, { idZ, idY }, { idZ, idZ } };
+  const int numPattern = sizeof( partialPattern ) / sizeof( partialPattern[0] );
+
+  // Registry IDs of the owned agents under their default names, shared by
+  // every instance until it is given its own ( setParameterNames )
+  std::shared_ptr< const std::vector< int > >
+  defaultIds()
+  {
+    static std::shared_ptr< const std::vector< int > > ids(
+      new std::vector< int >( AgentGroup::intern(
+        { "X", "Y", "Z", "dX", "dY", "dZ", "h_ref", "rho_ref", "step", "rot",
+          "Cd" } ) ) );
+    return ids;
+  }
+}
+
 //=====================================================================
 //=====================================================================
 // CONSTRUCTORS / DESCTRUCTOR
@@ -22,17 +54,20 @@
 // Default Constructor
 AtmosphereAction::
 AtmosphereAction()
-    : m_name(),
-      m_refHeight(),
-      m_refDensity(),
-      m_stepHeight(),
-      m_rotation(),
-      m_bodyDragTerm(),
-      m_evaledPartials()
+    : m_atmosphere( new AtmosphereModel() ),
+      m_objects(),
+      m_object(),
+      m_ceiling( std::numeric_limits< double >::infinity() ),
+      m_ownedIds( defaultIds() ),
+      m_bound()
 {
+  std::shared_ptr< ObjectTable > objects( new ObjectTable() );
+  m_object = objects->addObject( 0.0 );
+  m_objects = objects;
 }
 
-// Constructor for standard planetary atmosphere
+// Constructor for standard planetary atmosphere, with its own model and a
+// table of one object
 AtmosphereAction::
 AtmosphereAction(
     const std::string name,
@@ -41,13 +76,31 @@ AtmosphereAction(
     double stepHeight,
     double rotation,
     double bodyDragTerm )
-    : m_name( name ),
-      m_refHeight( refHeight ),
-      m_refDensity( refDensity ),
-      m_stepHeight( stepHeight ),
-      m_rotation( rotation ),
-      m_bodyDragTerm( bodyDragTerm ),
-      m_evaledPartials()
+    : m_atmosphere( new AtmosphereModel( name, refHeight, refDensity,
+                                         stepHeight, rotation ) ),
+      m_objects(),
+      m_object(),
+      m_ceiling( std::numeric_limits< double >::infinity() ),
+      m_ownedIds( defaultIds() ),
+      m_bound()
+{
+  std::shared_ptr< ObjectTable > objects( new ObjectTable() );
+  m_object = objects->addObject( bodyDragTerm );
+  m_objects = objects;
+}
+
+// Constructor for object of a catalog, in a shared atmosphere
+AtmosphereAction::
+AtmosphereAction(
+    std::shared_ptr< const AtmosphereModel > atmosphere,
+    std::shared_ptr< const ObjectTable > objects,
+    int object )
+    : m_atmosphere( atmosphere ),
+      m_objects( objects ),
+      m_object( object ),
+      m_ceiling( std::numeric_limits< double >::infinity() ),
+      m_ownedIds( defaultIds() ),
+      m_bound()
 {
 }
 
@@ -69,12 +122,29 @@ getAcceleration(
     std::vector< double >& acceleration,
     const std::vector< double >& state ) const
 {
-  double dragPrefix =  - m_bodyDragTerm * adjustedDensity( state )
-                       * adjustedVelocity( state );
+  addAcceleration( acceleration, state );
+}
 
-  acceleration[0] += dragPrefix * ( state[3] + state[1] * m_rotation );
-  acceleration[1] += dragPrefix * ( state[4] - state[0] * m_rotation );
-  acceleration[2] += dragPrefix * ( state[5] );
+// Computes the drag acceleration in float, throughout
+void
+AtmosphereAction::
+getScalarAcceleration(
+    std::vector< float > &acceleration,
+    const std::vector< float > &state,
+    double t ) const
+{
+  addAcceleration( acceleration, state );
+}
+
+// Computes the drag acceleration in long double, throughout
+void
+AtmosphereAction::
+getScalarAcceleration(
+    std::vector< long double > &acceleration,
+    const std::vector< long double > &state,
+    double t ) const
+{
+  addAcceleration( acceleration, state );
 }
 
 // Computes the partial derivative of the acceleration terms and owned
@@ -84,78 +154,357 @@ AtmosphereAction::
 getPartials(
     std::vector< double > &partials,
     const std::vector< double > &state,
-    const std::vector< std::string >  &activeAgents )
+    const AgentGroup &activeAgents )
 {
-  // Evaluate the class partial for this state
-  evalPartials( state );
+  // Evaluate the class partial for this state, by owned agent. The
+  // partials are kept local so several integrations may share this action
+  // concurrently.
+  double evaledPartials[ numOwned * numOwned ] = {};
+  evalPartials( state, evaledPartials );
 
-  // Loop over active agents and get partial values
+  // Place each owned partial at the STM rows of its agents, skipping
+  // agents that are not active
   int numAgents = activeAgents.size();
-  for ( int i = 0; i < numAgents; ++i )
+  int rows[ numOwned ];
+  for ( int k = 0; k < numOwned; ++k )
+  {
+    rows[k] = activeAgents.getRow( ( *m_ownedIds )[k] );
+  }
+  for ( int i = 0; i < numOwned; ++i )
   {
-    // Request the partial from the i loop with respect to all the
-    // active agents in j loop
-    for ( int j = 0; j < numAgents; ++j )
+    for ( int j = 0; j < numOwned; ++j )
     {
+      if ( ( rows[i] < 0 ) || ( rows[j] < 0 ) )
+      {
+        continue;
+      }
       if (m_debug)
       {
         std::cout << "\nAtmosphereAction::getPartials()" << std::endl
-                  << "Requested Partials: " << activeAgents[i] <<  " wrt "
-                  << activeAgents[j] << std::endl
+                  << "Requested Partials: "
+                  << AgentGroup::getName( ( *m_ownedIds )[i] ) << " wrt "
+                  << AgentGroup::getName( ( *m_ownedIds )[j] ) << std::endl
                   << "Value of partials: "
-                  << getAgentPartial( activeAgents[i], activeAgents[j] );
+                  << evaledPartials[ i * numOwned + j ];
       }
-      partials[ i * numAgents + j ] += getAgentPartial( activeAgents[i],
-                                                        activeAgents[j] );
+      partials[ rows[i] * numAgents + rows[j] ] +=
+        evaledPartials[ i * numOwned + j ];
     }
   }
 }
 
-//=====================================================================
-//=====================================================================
-// PRIVATE MEMBERS
+// The owned partials evalPartials computes, by agent ID
+bool
+AtmosphereAction::
+getPartialPattern( std::vector< std::pair< int, int > > &pattern ) const
+{
+  pattern.clear();
+  for ( int p = 0; p < numPattern; ++p )
+  {
+    pattern.push_back(
+      std::make_pair( ( *m_ownedIds )[ partialPattern[p][0] ],
+                      ( *m_ownedIds )[ partialPattern[p][1] ] ) );
+  }
+  return true;
+}
 
-// Get the atmospheric density at current state
+// Values of the partial pattern for this state
+void
+AtmosphereAction::
+getPartialValues(
+    double *values,
+    const std::vector< double > &state ) const
+{
+  double evaledPartials[ numOwned * numOwned ] = {};
+  evalPartials( state, evaledPartials );
+  for ( int p = 0; p < numPattern; ++p )
+  {
+    values[p] =
+      evaledPartials[ partialPattern[p][0] * numOwned + partialPattern[p][1] ];
+  }
+}
+
+// Computes the order k Taylor coefficient of the drag acceleration by
+// recursive differentiation of the same expressions used in
+// getAcceleration.
+bool
+AtmosphereAction::
+getAccelerationJet(
+    std::vector< TaylorJet > &acceleration,
+    const std::vector< TaylorJet > &state,
+    int k,
+    TaylorWorkspace &workspace ) const
+{
+  // No drag above the ceiling, judged at the expansion point
+  double r0 = std::sqrt( std::pow( state[0].value( 0 ), 2 ) +
+                         std::pow( state[1].value( 0 ), 2 ) +
+                         std::pow( state[2].value( 0 ), 2 ) );
+  if ( r0 > m_ceiling )
+  {
+    return true;
+  }
+
+  // Constants, seeded where they are active agents
+  TaylorJet &h_ref = workspace.next();
+  h_ref.constant( k, getRefHeight(),
+                  workspace.seed( ( *m_ownedIds )[ iRefHeight ] ) );
+  TaylorJet &rho_ref = workspace.next();
+  rho_ref.constant( k, getRefDensity(),
+                    workspace.seed( ( *m_ownedIds )[ iRefDensity ] ) );
+  TaylorJet &step = workspace.next();
+  step.constant( k, getStepHeight(),
+                 workspace.seed( ( *m_ownedIds )[ iStep ] ) );
+  TaylorJet &rot = workspace.next();
+  rot.constant( k, getRotation(), workspace.seed( ( *m_ownedIds )[ iRot ] ) );
+  TaylorJet &Cd = workspace.next();
+  Cd.constant( k, getBodyDragTerm(),
+               workspace.seed( ( *m_ownedIds )[ iCd ] ) );
+
+  // Density rho_ref exp( - ( r - h_ref ) / step )
+  TaylorJet &XX = workspace.next();
+  XX.product( k, state[0], state[0] );
+  TaylorJet &YY = workspace.next();
+  YY.product( k, state[1], state[1] );
+  TaylorJet &ZZ = workspace.next();
+  ZZ.product( k, state[2], state[2] );
+  TaylorJet &XXYY = workspace.next();
+  XXYY.sum( k, XX, YY );
+  TaylorJet &r2 = workspace.next();
+  r2.sum( k, XXYY, ZZ );
+  TaylorJet &r = workspace.next();
+  r.squareRoot( k, r2 );
+  TaylorJet &height = workspace.next();
+  height.difference( k, h_ref, r );
+  TaylorJet &exponent = workspace.next();
+  exponent.quotient( k, height, step );
+  TaylorJet &decay = workspace.next();
+  decay.exponential( k, exponent );
+  TaylorJet &rho = workspace.next();
+  rho.product( k, rho_ref, decay );
+
+  // Velocity relative to the rotating atmosphere
+  TaylorJet &Yrot = workspace.next();
+  Yrot.product( k, state[1], rot );
+  TaylorJet &Xrot = workspace.next();
+  Xrot.product( k, state[0], rot );
+  TaylorJet &relX = workspace.next();
+  relX.sum( k, state[3], Yrot );
+  TaylorJet &relY = workspace.next();
+  relY.difference( k, state[4], Xrot );
+  const TaylorJet &relZ = state[5];
+  TaylorJet &relXX = workspace.next();
+  relXX.product( k, relX, relX );
+  TaylorJet &relYY = workspace.next();
+  relYY.product( k, relY, relY );
+  TaylorJet &relZZ = workspace.next();
+  relZZ.product( k, relZ, relZ );
+  TaylorJet &relXXYY = workspace.next();
+  relXXYY.sum( k, relXX, relYY );
+  TaylorJet &vel2 = workspace.next();
+  vel2.sum( k, relXXYY, relZZ );
+  TaylorJet &vel = workspace.next();
+  vel.squareRoot( k, vel2 );
+
+  // - Cd rho |v_rel| v_rel
+  TaylorJet &Cd_rho = workspace.next();
+  Cd_rho.product( k, Cd, rho );
+  TaylorJet &dragPrefix = workspace.next();
+  dragPrefix.product( k, Cd_rho, vel );
+
+  const TaylorJet *rel[3] = { &relX, &relY, &relZ };
+  for ( int i = 0; i < 3; ++i )
+  {
+    TaylorJet &accel = workspace.next();
+    accel.product( k, dragPrefix, *rel[i] );
+    acceleration[i][k] -= accel[k];
+  }
+  return true;
+}
+
+// Exponential atmosphere reference height
 double
 AtmosphereAction::
-adjustedDensity( const std::vector< double > state ) const
+getRefHeight() const
 {
-  double dist = sqrt( pow( state[0], 2 ) + pow( state[1], 2 ) +
-                pow( state[2], 2 ) );
+  return m_bound ? m_bound->getValue( ( *m_ownedIds )[ iRefHeight ] )
+                 : m_atmosphere->getRefHeight();
+}
 
-  return m_refDensity * exp( - ( dist - m_refHeight ) / m_stepHeight );
+// Exponential atmosphere reference density
+double
+AtmosphereAction::
+getRefDensity() const
+{
+  return m_bound ? m_bound->getValue( ( *m_ownedIds )[ iRefDensity ] )
+                 : m_atmosphere->getRefDensity();
 }
 
-// Get the atmospheric relative velocity at current state
+// Exponential atmosphere step height
+double
+AtmosphereAction::
+getStepHeight() const
+{
+  return m_bound ? m_bound->getValue( ( *m_ownedIds )[ iStep ] )
+                 : m_atmosphere->getStepHeight();
+}
+
+// Planetary rotation rate
+double
+AtmosphereAction::
+getRotation() const
+{
+  return m_bound ? m_bound->getValue( ( *m_ownedIds )[ iRot ] )
+                 : m_atmosphere->getRotation();
+}
+
+// Agent body drag term
 double
 AtmosphereAction::
-adjustedVelocity( const std::vector< double > state ) const
+getBodyDragTerm() const
+{
+  return m_bound ? m_bound->getValue( ( *m_ownedIds )[ iCd ] )
+                 : m_objects->getBodyDragTerm( m_object );
+}
+
+// Radius above which there is no drag
+void
+AtmosphereAction::
+setCeiling( double radius )
 {
-  return sqrt( pow( state[3] + state[1] * m_rotation, 2 ) +
-               pow( state[4] - state[0] * m_rotation, 2 ) +
-               pow( state[5], 2 ) );
+  m_ceiling = radius;
 }
 
 double
 AtmosphereAction::
-getAgentPartial(
-    const std::string &top,
-    const std::string &bottom )
+getCeiling() const
+{
+  return m_ceiling;
+}
+
+// Positive below the ceiling, where there is drag, and negative above
+bool
+AtmosphereAction::
+getSwitchFunction(
+    double &value,
+    const std::vector< double > &state,
+    double t ) const
+{
+  if ( std::isinf( m_ceiling ) )
+  {
+    return false;
+  }
+  value = m_ceiling - std::sqrt( state[0] * state[0] + state[1] * state[1] +
+                                 state[2] * state[2] );
+  return true;
+}
+
+// Reference height and density, step height, rotation and body drag term,
+// and the ceiling if there is one
+bool
+AtmosphereAction::
+getParameters( std::vector< double > &parameters ) const
+{
+  parameters = { getRefHeight(), getRefDensity(), getStepHeight(),
+                 getRotation(), getBodyDragTerm() };
+  if ( !std::isinf( m_ceiling ) )
+  {
+    parameters.push_back( m_ceiling );
+  }
+  return true;
+}
+
+// Read the atmosphere constants and body drag term from parameters,
+// claiming their agents with the current values
+void
+AtmosphereAction::
+bindParameters( AgentGroup &parameters )
+{
+  std::vector< double > values;
+  getParameters( values );
+  for ( int k = iRefHeight; k < numOwned; ++k )
+  {
+    parameters.bind( AgentGroup::getName( ( *m_ownedIds )[k] ),
+                     values[ k - iRefHeight ] );
+  }
+  m_bound = &parameters;
+}
+
+// Agent names of h_ref, rho_ref, step, rot and Cd for this action
+void
+AtmosphereAction::
+setParameterNames( const std::vector< std::string > &names )
+{
+  if ( ( (int) names.size() != numOwned - iRefHeight ) || m_bound )
+  {
+    std::cout << "AtmosphereAction needs five parameter names, before "
+              << "binding" << std::endl;
+    throw;
+  }
+  std::vector< int > ids( *m_ownedIds );
+  for ( int k = iRefHeight; k < numOwned; ++k )
+  {
+    ids[k] = AgentGroup::intern( names[ k - iRefHeight ] );
+  }
+  m_ownedIds.reset( new std::vector< int >( ids ) );
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Drag acceleration in Scalar arithmetic
+template< typename Scalar >
+void
+AtmosphereAction::
+addAcceleration(
+    std::vector< Scalar > &acceleration,
+    const std::vector< Scalar > &state ) const
 {
-  // Form param search string
-  std::string partialRequest = top + " wrt " + bottom;
+  Scalar dragPrefix =  - Scalar( getBodyDragTerm() ) * adjustedDensity( state )
+                       * adjustedVelocity( state );
+
+  Scalar rot = getRotation();
+  acceleration[0] += dragPrefix * ( state[3] + state[1] * rot );
+  acceleration[1] += dragPrefix * ( state[4] - state[0] * rot );
+  acceleration[2] += dragPrefix * ( state[5] );
+}
 
-  if( m_evaledPartials.find( partialRequest ) == m_evaledPartials.end() )
+// Get the atmospheric density at current state
+template< typename Scalar >
+Scalar
+AtmosphereAction::
+adjustedDensity( const std::vector< Scalar > &state ) const
+{
+  Scalar dist = std::sqrt( std::pow( state[0], Scalar( 2 ) ) +
+                           std::pow( state[1], Scalar( 2 ) ) +
+                           std::pow( state[2], Scalar( 2 ) ) );
+  if ( dist > m_ceiling )
   {
-    // If requested partial is not supported by this action, return 0
-    return 0.0;
+    return Scalar( 0 );
   }
-  return m_evaledPartials[ partialRequest ];
+
+  return Scalar( getRefDensity() ) *
+         std::exp( - ( dist - Scalar( getRefHeight() ) ) /
+                   Scalar( getStepHeight() ) );
+}
+
+// Get the atmospheric relative velocity at current state
+template< typename Scalar >
+Scalar
+AtmosphereAction::
+adjustedVelocity( const std::vector< Scalar > &state ) const
+{
+  Scalar rot = getRotation();
+  return std::sqrt( std::pow( state[3] + state[1] * rot, Scalar( 2 ) ) +
+                    std::pow( state[4] - state[0] * rot, Scalar( 2 ) ) +
+                    std::pow( state[5], Scalar( 2 ) ) );
 }
 
 void
 AtmosphereAction::
-evalPartials( const std::vector< double > &state )
+evalPartials(
+    const std::vector< double > &state,
+    double *evaledPartials ) const
 {
   // Condense variable names to make following equations more legible
   double r = sqrt( pow( state[0], 2 ) + pow( state[1], 2 ) +
@@ -166,11 +515,11 @@ evalPartials( const std::vector< double > &state )
   double dX = state[3];
   double dY = state[4];
   double dZ = state[5];
-  double step = m_stepHeight;
-  double rot =  m_rotation;
+  double step = getStepHeight();
+  double rot =  getRotation();
   double rho = adjustedDensity( state );
   double vel = adjustedVelocity( state );
-  double Cd = m_bodyDragTerm;
+  double Cd = getBodyDragTerm();
 
   if (m_debug)
   {
@@ -180,58 +529,58 @@ evalPartials( const std::vector< double > &state )
               << "Val of cd: " << Cd << std::endl;
   }
 
-  m_evaledPartials[ "X wrt dX" ] = 1;
-  m_evaledPartials[ "Y wrt dY" ] = 1;
-  m_evaledPartials[ "Z wrt dZ" ] = 1;
+  evaledPartials[ iX * numOwned + idX ] = 1;
+  evaledPartials[ iY * numOwned + idY ] = 1;
+  evaledPartials[ iZ * numOwned + idZ ] = 1;
 
   // Partials of acceleration X component wrt state.
-  m_evaledPartials[ "dX wrt X" ] = (
+  evaledPartials[ idX * numOwned + iX ] = (
     Cd * rho * vel * X * ( dX + rot * Y ) / ( r * step ) +
    -Cd * rho * ( -rot * dY + pow( rot, 2 ) * X ) * ( dX + rot * Y ) / vel );
-  m_evaledPartials[ "dX wrt Y" ] = (
+  evaledPartials[ idX * numOwned + iY ] = (
     Cd * rho * vel * Y * ( dX + rot * Y ) / ( r * step ) +
    -Cd * rho * ( rot * dX + pow( rot, 2 ) * Y ) * ( dX + rot * Y ) / vel +
    -Cd * rho * vel * rot );
-  m_evaledPartials[ "dX wrt Z" ] =
+  evaledPartials[ idX * numOwned + iZ ] =
     Cd * rho * vel * Z * ( dX + rot * Y ) / ( r * step );
-  m_evaledPartials[ "dX wrt dX" ] =
+  evaledPartials[ idX * numOwned + idX ] =
    -Cd * rho * pow( dX + rot * Y, 2 ) / vel - Cd * rho * vel ;
-  m_evaledPartials[ "dX wrt dY" ] =
+  evaledPartials[ idX * numOwned + idY ] =
    -Cd * rho * ( dY - rot * X ) * ( dX + rot * Y ) / vel;
-  m_evaledPartials[ "dX wrt dZ" ] =
+  evaledPartials[ idX * numOwned + idZ ] =
    -Cd * rho * dZ * ( dX + rot * Y ) / vel;
 
   // Partials of acceleration Y component wrt state.
-  m_evaledPartials[ "dY wrt X" ] = (
+  evaledPartials[ idY * numOwned + iX ] = (
     Cd * rho * vel * X * ( dY - rot * X ) / ( r * step ) +
    -Cd * rho * ( pow( rot, 2 ) * X - rot * dY ) * ( dY - rot * X ) / vel +
     Cd * rho * vel * rot );
-  m_evaledPartials[ "dY wrt Y" ] = (
+  evaledPartials[ idY * numOwned + iY ] = (
     Cd * rho * vel * Y * ( dY - rot * X ) / ( r * step) +
    -Cd * rho * ( rot * dX + pow( rot, 2 ) * Y ) * ( dY - rot * X ) / vel );
-  m_evaledPartials[ "dY wrt Z" ] =
+  evaledPartials[ idY * numOwned + iZ ] =
     Cd * rho * vel * Z * ( dY - rot * X ) / ( r * step );
-  m_evaledPartials[ "dY wrt dX" ] =
+  evaledPartials[ idY * numOwned + idX ] =
    -Cd * rho * ( dY - rot * X ) * ( dX + rot * Y ) / vel;
-  m_evaledPartials[ "dY wrt dY" ] =
+  evaledPartials[ idY * numOwned + idY ] =
    -Cd * rho * pow( dY - rot * X, 2 ) / vel - Cd * rho * vel;
-  m_evaledPartials[ "dY wrt dZ" ] =
+  evaledPartials[ idY * numOwned + idZ ] =
    -Cd * rho * dZ * ( dY - rot * X ) / vel;
 
   // Partials of acceleration Z component wrt state.
-  m_evaledPartials[ "dZ wrt X" ] = (
+  evaledPartials[ idZ * numOwned + iX ] = (
     Cd * rho * vel * dZ * X / (r * step) +
    -Cd * rho * dZ * ( pow( rot, 2 ) * X - rot * dY ) / vel );
-  m_evaledPartials[ "dZ wrt Y" ] = (
+  evaledPartials[ idZ * numOwned + iY ] = (
     Cd * rho * vel * dZ * Y / ( r * step ) +
    -Cd * rho * dZ * ( rot * dX + pow( rot, 2 ) * Y) / vel );
-  m_evaledPartials[ "dZ wrt Z" ] =
+  evaledPartials[ idZ * numOwned + iZ ] =
     Cd * rho * vel * Z * dZ / ( r * step );
-  m_evaledPartials[ "dZ wrt dX" ] =
+  evaledPartials[ idZ * numOwned + idX ] =
    -Cd * rho * dZ * ( dX + rot * Y ) / vel;
-  m_evaledPartials[ "dZ wrt dY" ] =
+  evaledPartials[ idZ * numOwned + idY ] =
    -Cd * rho * dZ * ( dY - rot * X ) / vel;
-  m_evaledPartials[ "dZ wrt dZ" ] = (
+  evaledPartials[ idZ * numOwned + idZ ] = (
    -Cd * rho * pow( dZ, 2 ) / vel ) + ( -Cd * rho * vel );
 
 /// @todo implement remaining partials:
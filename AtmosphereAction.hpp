@@ -13,12 +13,14 @@
 #define EKF_ATMOSPHEREACTION_HEADER_GUARD
 
 // C++ Standard Library
+#include <memory>
 #include <string>
 #include <vector>
-#include <map>
 
 // ekf Library
 #include <Action.hpp>
+#include <AtmosphereModel.hpp>
+#include <ObjectTable.hpp>
 
 /// @brief Compute state accelerations and partial derivates due to
 /// the interaction of an agent and planetary atmosphere.
@@ -36,12 +38,24 @@
 ///   - Planetary rotation
 ///   - Agent body drag term
 ///
+/// The atmosphere constants come from an AtmosphereModel shared by every
+/// object, and the body drag term from the object's row of an
+/// ObjectTable, so an instance holds two pointers and an index.
+///
+/// Drag can be cut off above a ceiling, such as the top of the density
+/// model's validity. Crossing it is a state dependent switch: Motion
+/// stops a segment on it and maps the STM across it with the saltation
+/// matrix.
+///
 class AtmosphereAction : public Action
 {
  public:
   AtmosphereAction();
   AtmosphereAction( const std::string name, double refHeight, double refDensity,
                     double stepHeight, double rotation, double bodyDragTerm );
+  AtmosphereAction( std::shared_ptr< const AtmosphereModel > atmosphere,
+                    std::shared_ptr< const ObjectTable > objects,
+                    int object );
 
  ~AtmosphereAction() override;
 
@@ -49,32 +63,80 @@ class AtmosphereAction : public Action
   // the passed in vector "acceleration".
   void getAcceleration( std::vector< double > &acceleration,
                         const std::vector< double > &state ) const override;
+  // The same in float and long double
+  void getScalarAcceleration( std::vector< float > &acceleration,
+                              const std::vector< float > &state,
+                              double t ) const override;
+  void getScalarAcceleration( std::vector< long double > &acceleration,
+                              const std::vector< long double > &state,
+                              double t ) const override;
 
   // Computes the partial derivative of the acceleration terms and
   // owned parameters
   void getPartials( std::vector< double > &partials,
                     const std::vector< double > &state,
-                    const std::vector< std::string >  &activeAgents ) override;
+                    const AgentGroup &activeAgents ) override;
+
+  // The acceleration partials wrt position and velocity, and their
+  // values
+  bool getPartialPattern(
+    std::vector< std::pair< int, int > > &pattern ) const override;
+  void getPartialValues( double *values,
+                         const std::vector< double > &state ) const override;
+
+  // Computes the order k Taylor coefficient of the acceleration, with
+  // gradients wrt the state and any active atmosphere and Cd agents
+  bool getAccelerationJet( std::vector< TaylorJet > &acceleration,
+                           const std::vector< TaylorJet > &state,
+                           int k, TaylorWorkspace &workspace ) const override;
+
+  // Reads the atmosphere constants and body drag term from parameters
+  // from now on
+  void bindParameters( AgentGroup &parameters ) override;
+  // Agent names of h_ref, rho_ref, step, rot and Cd for this action
+  // ( those names by default )
+  void setParameterNames( const std::vector< std::string > &names ) override;
+
+  // Cut drag off above radius ( from the body center, as the reference
+  // height ), a switch Motion segments at; none by default
+  void setCeiling( double radius );
+  double getCeiling() const;
+  // The ceiling less the radius of state, if there is a ceiling
+  bool getSwitchFunction( double &value, const std::vector< double > &state,
+                          double t ) const override;
+
+  // Reference height and density, step height, rotation and body drag
+  // term, and the ceiling if set
+  bool getParameters( std::vector< double > &parameters ) const override;
+
+  // Atmosphere and body constants, bound or own
+  double getRefHeight() const;
+  double getRefDensity() const;
+  double getStepHeight() const;
+  double getRotation() const;
+  double getBodyDragTerm() const;
  private:
-  std::string m_name;
-  double m_refHeight;
-  double m_refDensity;
-  double m_stepHeight;
-  double m_rotation;
-  double m_bodyDragTerm;
-  std::map< std::string, double > m_evaledPartials;
-
-  /// @todo need some way of identifying h_ref, rho_ref, step, rot, Cd
-  /// for a particular planetary atmosphere.
-  std::vector< std::string > m_agentsOwned = { "X", "Y", "Z", "dX", "dY", "dZ",
-                                             "h_ref", "rho_ref", "step", "rot",
-                                             "Cd" };
-
-  double adjustedDensity( const std::vector< double > state ) const;
-  double adjustedVelocity( const std::vector< double > state ) const;
-
-  double getAgentPartial( const std::string &top, const std::string &bottom );
-  void evalPartials( const std::vector< double > &state );
+  std::shared_ptr< const AtmosphereModel > m_atmosphere;
+  std::shared_ptr< const ObjectTable > m_objects;
+  int m_object;
+  double m_ceiling;
+
+  // Registry IDs of the owned agents, state first, then h_ref, rho_ref,
+  // step, rot and Cd; shared with every instance under the default names
+  std::shared_ptr< const std::vector< int > > m_ownedIds;
+  // Parameter values bound by bindParameters, or null
+  const AgentGroup* m_bound;
+
+  template< typename Scalar >
+  void addAcceleration( std::vector< Scalar > &acceleration,
+                        const std::vector< Scalar > &state ) const;
+  template< typename Scalar >
+  Scalar adjustedDensity( const std::vector< Scalar > &state ) const;
+  template< typename Scalar >
+  Scalar adjustedVelocity( const std::vector< Scalar > &state ) const;
+
+  void evalPartials( const std::vector< double > &state,
+                     double *evaledPartials ) const;
 };
 
 #endif // EKF_ATMOSPHEREACTION_HEADER_GUARD
@@ -0,0 +1,93 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    AtmosphereModel.cpp
+/// @brief   Constants of an exponential planetary atmosphere, shared by
+///          every object flying through it.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// ekf Library
+#include <AtmosphereModel.hpp>
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+AtmosphereModel::
+AtmosphereModel()
+    : m_name(),
+      m_refHeight(),
+      m_refDensity(),
+      m_stepHeight(),
+      m_rotation()
+{
+}
+
+// Constructor for standard planetary atmosphere
+AtmosphereModel::
+AtmosphereModel(
+    const std::string name,
+    double refHeight,
+    double refDensity,
+    double stepHeight,
+    double rotation )
+    : m_name( name ),
+      m_refHeight( refHeight ),
+      m_refDensity( refDensity ),
+      m_stepHeight( stepHeight ),
+      m_rotation( rotation )
+{
+}
+
+// Default Destructor
+AtmosphereModel::
+~AtmosphereModel()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Atmosphere name
+std::string
+AtmosphereModel::
+getName() const
+{
+  return m_name;
+}
+
+// Reference height
+double
+AtmosphereModel::
+getRefHeight() const
+{
+  return m_refHeight;
+}
+
+// Reference density
+double
+AtmosphereModel::
+getRefDensity() const
+{
+  return m_refDensity;
+}
+
+// Step ( scale ) height
+double
+AtmosphereModel::
+getStepHeight() const
+{
+  return m_stepHeight;
+}
+
+// Planetary rotation rate
+double
+AtmosphereModel::
+getRotation() const
+{
+  return m_rotation;
+}
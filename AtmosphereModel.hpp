@@ -0,0 +1,50 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    AtmosphereModel.hpp
+/// @brief   Constants of an exponential planetary atmosphere, shared by
+///          every object flying through it.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_ATMOSPHEREMODEL_HEADER_GUARD
+#define EKF_ATMOSPHEREMODEL_HEADER_GUARD
+
+// C++ Standard Library
+#include <string>
+
+/// @brief Constants of an exponential planetary atmosphere.
+///
+/// The density at radius r is refDensity exp( - ( r - refHeight ) /
+/// stepHeight ), and the atmosphere rotates with the planet at rotation.
+/// A model is immutable once built, so one instance is held by
+/// shared_ptr< const AtmosphereModel > and shared by the AtmosphereAction
+/// of every object in a catalog. Properties of the objects themselves
+/// live in an ObjectTable.
+///
+class AtmosphereModel
+{
+ public:
+  AtmosphereModel();
+  AtmosphereModel( const std::string name, double refHeight,
+                   double refDensity, double stepHeight, double rotation );
+ ~AtmosphereModel();
+
+  // Atmosphere constants
+  std::string getName() const;
+  double getRefHeight() const;
+  double getRefDensity() const;
+  double getStepHeight() const;
+  double getRotation() const;
+
+ private:
+  std::string m_name;
+  double m_refHeight;
+  double m_refDensity;
+  double m_stepHeight;
+  double m_rotation;
+};
+
+#endif // EKF_ATMOSPHEREMODEL_HEADER_GUARD
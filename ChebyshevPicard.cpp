@@ -0,0 +1,502 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ChebyshevPicard.cpp
+/// @brief   Modified Chebyshev-Picard iteration (MCPI) propagator.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+
+// ekf Library
+#include <ChebyshevPicard.hpp>
+#include <OdeintHelper.hpp>
+
+namespace
+{
+  // Halvings of a segment tried before the iteration is given up on
+  const int maxHalvings = 10;
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+ChebyshevPicard::
+ChebyshevPicard()
+    : m_order( 64 ),
+      m_segment( 1200. ),
+      m_numThreads( 1 ),
+      m_team(),
+      m_tolerance( 1.E-13 ),
+      m_maxIterations( 200 ),
+      m_iterations(),
+      m_evaluations(),
+      m_nodes(),
+      m_picard(),
+      m_integral(),
+      m_maxWarmStartBytes( 64 << 20 ),
+      m_warmStartBytes( 0 ),
+      m_warmStarts(),
+      m_warmStartUses()
+{
+  buildOperators();
+}
+
+// Constructor with polynomial order and segment length
+ChebyshevPicard::
+ChebyshevPicard(
+    int order,
+    double segment,
+    unsigned int numThreads )
+    : m_order( order ),
+      m_segment( segment ),
+      m_numThreads( std::min( resolveThreads( numThreads ),
+                              resolveThreads( 0 ) ) ),
+      m_team(),
+      m_tolerance( 1.E-13 ),
+      m_maxIterations( 200 ),
+      m_iterations(),
+      m_evaluations(),
+      m_nodes(),
+      m_picard(),
+      m_integral(),
+      m_maxWarmStartBytes( 64 << 20 ),
+      m_warmStartBytes( 0 ),
+      m_warmStarts(),
+      m_warmStartUses()
+{
+  // The team is started once, rather than threads on every iteration,
+  // and spins, so it is kept within the cores there are
+  if ( m_numThreads > 1 )
+  {
+    m_team.reset( new ThreadTeam( m_numThreads ) );
+  }
+  buildOperators();
+}
+
+// Default Destructor
+ChebyshevPicard::
+~ChebyshevPicard()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Propagate the state and partials from t0 to t1 segment by segment
+std::map< double, std::vector< double > >
+ChebyshevPicard::
+propagate(
+    const std::vector< std::shared_ptr< Action > > &actions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0,
+    double t1,
+    double step )
+{
+  std::vector< std::shared_ptr< Action > > segmentActions( actions );
+  AgentGroup agents( activeAgents );
+  m_iterations = 0;
+  m_evaluations = 0;
+
+  int dim = stateAndPartials.size();
+  int numSegments = std::max( 1, int( std::ceil( ( t1 - t0 ) / m_segment ) ) );
+  std::vector< double > times = outputTimes( t0, t1, step );
+  int numSteps = times.size() - 1;
+  Eigen::VectorXd y0 = Eigen::Map< const Eigen::VectorXd >(
+    stateAndPartials.data(), dim );
+
+  double shortest = std::ldexp( ( t1 - t0 ) / numSegments, -maxHalvings );
+
+  std::map< double, std::vector< double > > pastStates;
+  int i = 0;
+  for ( int s = 0; s < numSegments; ++s )
+  {
+    double ta = t0 + ( t1 - t0 ) * s / numSegments;
+    std::vector< double > ends( 1,
+                                t0 + ( t1 - t0 ) * ( s + 1 ) / numSegments );
+
+    // Solve the segment, halving what is left of it until the iteration
+    // converges
+    while ( !ends.empty() )
+    {
+      double tb = ends.back();
+      double w2 = ( tb - ta ) / 2;
+      Eigen::MatrixXd F;
+      if ( !solveSegment( segmentActions, agents, y0, ta, tb, F ) )
+      {
+        if ( tb - ta < shortest )
+        {
+          std::cout << "Picard iteration does not converge from t = " << ta
+                    << " to " << tb << std::endl;
+          throw;
+        }
+        ends.push_back( ta + w2 );
+        continue;
+      }
+      ends.pop_back();
+      bool last = ( s == numSegments - 1 ) && ends.empty();
+      Eigen::MatrixXd B = m_integral * F;
+
+      // Dense output of every step grid time within this segment
+      for ( ; i <= numSteps; ++i )
+      {
+        double t = times[i];
+        if ( ( t > tb ) && !last )
+        {
+          break;
+        }
+
+        double tau = std::min( 1.0, ( t - ta ) / w2 - 1 );
+        Eigen::VectorXd y = y0;
+        double Tprev = 1;
+        double T = tau;
+        y += B.row( 0 ).transpose();
+        for ( int k = 1; k < B.rows(); ++k )
+        {
+          y += T * B.row( k ).transpose();
+          double Tnext = 2 * tau * T - Tprev;
+          Tprev = T;
+          T = Tnext;
+        }
+        pastStates.insert( std::make_pair(
+          t, std::vector< double >( y.data(), y.data() + dim ) ) );
+      }
+
+      // The segment end value seeds the next segment
+      y0 += ( m_picard.row( m_order ) * F ).transpose();
+      ta = tb;
+    }
+  }
+
+  return pastStates;
+}
+
+// Set the relative node correction at which iteration stops
+void
+ChebyshevPicard::
+setTolerance( double tolerance )
+{
+  m_tolerance = tolerance;
+}
+
+// Forget all stored segment solutions
+void
+ChebyshevPicard::
+clearWarmStarts()
+{
+  m_warmStarts.clear();
+  m_warmStartUses.clear();
+  m_warmStartBytes = 0;
+}
+
+// Keep at most about maxBytes of segment solutions, dropping the least
+// recently used now if they are over
+void
+ChebyshevPicard::
+setMaxWarmStartBytes( std::size_t maxBytes )
+{
+  m_maxWarmStartBytes = maxBytes;
+  while ( ( m_warmStartBytes > m_maxWarmStartBytes ) &&
+          !m_warmStartUses.empty() )
+  {
+    dropWarmStart( m_warmStartUses.back() );
+  }
+}
+
+// Picard iterations used by the last propagation
+int
+ChebyshevPicard::
+getIterations() const
+{
+  return m_iterations;
+}
+
+// Force evaluations used by the last propagation
+int
+ChebyshevPicard::
+getEvaluations() const
+{
+  return m_evaluations;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Build the operators mapping derivative values at the nodes to the
+// integral from tau = -1, both at the nodes ( m_picard ) and as
+// Chebyshev coefficients for dense output ( m_integral ).
+void
+ChebyshevPicard::
+buildOperators()
+{
+  int N = m_order;
+  m_nodes.resize( N + 1 );
+  for ( int j = 0; j <= N; ++j )
+  {
+    m_nodes( j ) = -cos( M_PI * j / N );
+  }
+
+  // Chebyshev polynomials at the nodes, T( j, k ) = T_k( tau_j )
+  Eigen::MatrixXd T( N + 1, N + 2 );
+  for ( int j = 0; j <= N; ++j )
+  {
+    T( j, 0 ) = 1;
+    T( j, 1 ) = m_nodes( j );
+    for ( int k = 2; k <= N + 1; ++k )
+    {
+      T( j, k ) = 2 * m_nodes( j ) * T( j, k - 1 ) - T( j, k - 2 );
+    }
+  }
+
+  // Least squares fit of node values, exact for Gauss-Lobatto nodes
+  Eigen::MatrixXd fit( N + 1, N + 1 );
+  for ( int k = 0; k <= N; ++k )
+  {
+    for ( int j = 0; j <= N; ++j )
+    {
+      double w = ( ( j == 0 ) || ( j == N ) ) ? 0.5 : 1.0;
+      fit( k, j ) = 2.0 / N * w * T( j, k );
+    }
+  }
+  fit.row( 0 ) *= 0.5;
+  fit.row( N ) *= 0.5;
+
+  // Integrate the series term by term, then fix the constant so the
+  // integral vanishes at tau = -1
+  Eigen::MatrixXd integrate = Eigen::MatrixXd::Zero( N + 2, N + 1 );
+  integrate( 1, 0 ) = 1;
+  for ( int k = 1; k <= N; ++k )
+  {
+    integrate( k + 1, k ) = 1.0 / ( 2 * ( k + 1 ) );
+    if ( k > 1 )
+    {
+      integrate( k - 1, k ) = -1.0 / ( 2 * ( k - 1 ) );
+    }
+  }
+  for ( int k = 1; k <= N + 1; ++k )
+  {
+    integrate.row( 0 ) -= ( k % 2 ? -1.0 : 1.0 ) * integrate.row( k );
+  }
+
+  m_integral = integrate * fit;
+  m_picard = T * m_integral;
+}
+
+// Picard iteration on one segment. Sets F to the scaled derivatives at
+// the nodes, from which the node values and dense output follow, and
+// returns false if the iteration does not converge.
+bool
+ChebyshevPicard::
+solveSegment(
+    std::vector< std::shared_ptr< Action > > &actions,
+    AgentGroup &activeAgents,
+    const Eigen::VectorXd &y0,
+    double ta,
+    double tb,
+    Eigen::MatrixXd &F )
+{
+  int N = m_order;
+  int dim = y0.size();
+  double w2 = ( tb - ta ) / 2;
+  OdeintHelper helper( actions, activeAgents );
+
+  // Seed with the stored solution mapped onto y0, or a constant
+  Eigen::MatrixXd Y = y0.transpose().replicate( N + 1, 1 );
+  std::map< double, warm_start >::iterator warm = m_warmStarts.find( ta );
+  if ( ( warm != m_warmStarts.end() ) && ( warm->second.end == tb ) &&
+       ( warm->second.nodes.rows() == N + 1 ) &&
+       ( warm->second.nodes.cols() == dim ) )
+  {
+    Y = warmStart( warm->second.nodes, y0 );
+  }
+
+  F.resize( N + 1, dim );
+  bool converged = false;
+  for ( int k = 0; k < m_maxIterations; ++k )
+  {
+    // Force evaluations at the nodes are independent of each other
+    std::function< void( int ) > evaluate = [&]( int j )
+    {
+      std::vector< double > x( dim );
+      for ( int i = 0; i < dim; ++i )
+      {
+        x[i] = Y( j, i );
+      }
+      std::vector< double > dxdt( dim, 0.0 );
+      helper( x, dxdt, ta + w2 * ( m_nodes( j ) + 1 ) );
+      for ( int i = 0; i < dim; ++i )
+      {
+        F( j, i ) = w2 * dxdt[i];
+      }
+    };
+    if ( m_team )
+    {
+      m_team->run( N + 1, evaluate );
+    }
+    else
+    {
+      for ( int j = 0; j <= N; ++j )
+      {
+        evaluate( j );
+      }
+    }
+    m_evaluations += N + 1;
+    ++m_iterations;
+
+    Eigen::MatrixXd Ynew = ( m_picard * F ).rowwise() + y0.transpose();
+    double err = correction( Y, Ynew );
+    Y = Ynew;
+    if ( err < m_tolerance )
+    {
+      converged = true;
+      break;
+    }
+  }
+
+  // Keep converged node values for warm starting this segment, as the
+  // most recently used, and drop any that failed to seed it
+  dropWarmStart( ta );
+  if ( converged )
+  {
+    keepWarmStart( ta, tb, Y );
+  }
+  return converged;
+}
+
+// Store the node values of the segment from ta to tb as the most recently
+// used, dropping the least recently used to stay within the bound
+void
+ChebyshevPicard::
+keepWarmStart(
+    double ta,
+    double tb,
+    const Eigen::MatrixXd &Y )
+{
+  std::size_t bytes = warmStartBytes( Y );
+  if ( bytes > m_maxWarmStartBytes )
+  {
+    return;
+  }
+  while ( m_warmStartBytes + bytes > m_maxWarmStartBytes )
+  {
+    dropWarmStart( m_warmStartUses.back() );
+  }
+
+  m_warmStartUses.push_front( ta );
+  warm_start &warm = m_warmStarts[ ta ];
+  warm.end = tb;
+  warm.nodes = Y;
+  warm.use = m_warmStartUses.begin();
+  m_warmStartBytes += bytes;
+}
+
+// Forget the segment starting at ta, if it is stored
+void
+ChebyshevPicard::
+dropWarmStart( double ta )
+{
+  std::map< double, warm_start >::iterator warm = m_warmStarts.find( ta );
+  if ( warm != m_warmStarts.end() )
+  {
+    m_warmStartBytes -= warmStartBytes( warm->second.nodes );
+    m_warmStartUses.erase( warm->second.use );
+    m_warmStarts.erase( warm );
+  }
+}
+
+// Estimated memory of a stored segment with node values Y
+std::size_t
+ChebyshevPicard::
+warmStartBytes( const Eigen::MatrixXd &Y ) const
+{
+  return sizeof( warm_start ) + 6 * sizeof( void* ) + sizeof( double ) +
+         Y.size() * sizeof( double );
+}
+
+// Map the node values of a stored solution onto a new initial value.
+// With an STM, the segment transition matrix L_j = STM_j * STM_0^-1 of
+// the stored solution carries the state offset to every node and
+// restarts the STM from the new value; without one, shift by the
+// offset.
+Eigen::MatrixXd
+ChebyshevPicard::
+warmStart(
+    const Eigen::MatrixXd &Yprev,
+    const Eigen::VectorXd &y0 ) const
+{
+  int dim = y0.size();
+  int numAgents = std::round( std::sqrt( dim - 6 ) );
+  Eigen::RowVectorXd offset = y0.transpose() - Yprev.row( 0 );
+  if ( numAgents < 6 )
+  {
+    return Yprev.rowwise() + offset;
+  }
+
+  typedef Eigen::Matrix< double, Eigen::Dynamic, Eigen::Dynamic,
+                         Eigen::RowMajor > RowMatrix;
+  Eigen::MatrixXd Y( Yprev );
+  RowMatrix stm0 = Eigen::Map< const RowMatrix >( y0.data() + 6, numAgents,
+                                                  numAgents );
+  RowMatrix stmPrev0( numAgents, numAgents );
+  for ( int i = 0; i < numAgents * numAgents; ++i )
+  {
+    stmPrev0( i / numAgents, i % numAgents ) = Yprev( 0, 6 + i );
+  }
+  Eigen::PartialPivLU< RowMatrix > lu( stmPrev0 );
+
+  for ( int j = 0; j < Y.rows(); ++j )
+  {
+    RowMatrix stmPrev( numAgents, numAgents );
+    for ( int i = 0; i < numAgents * numAgents; ++i )
+    {
+      stmPrev( i / numAgents, i % numAgents ) = Yprev( j, 6 + i );
+    }
+    RowMatrix L = lu.solve( stmPrev.transpose() ).transpose();
+    Y.row( j ).head( 6 ) += ( L.topLeftCorner( 6, 6 ) *
+                              offset.head( 6 ).transpose() ).transpose();
+    RowMatrix stm = L * stm0;
+    for ( int i = 0; i < numAgents * numAgents; ++i )
+    {
+      Y( j, 6 + i ) = stm( i / numAgents, i % numAgents );
+    }
+  }
+  return Y;
+}
+
+// Largest change of the node values between two iterations, relative
+// to the position and velocity magnitudes for the state and to unity
+// for the STM.
+double
+ChebyshevPicard::
+correction(
+    const Eigen::MatrixXd &Y,
+    const Eigen::MatrixXd &Ynew ) const
+{
+  double err = 0.0;
+  for ( int j = 0; j < Y.rows(); ++j )
+  {
+    double r = Ynew.row( j ).head( 3 ).norm();
+    double v = Ynew.row( j ).segment( 3, 3 ).norm();
+    err = std::max( err,
+      ( Ynew.row( j ).head( 3 ) - Y.row( j ).head( 3 ) ).norm() / r );
+    err = std::max( err,
+      ( Ynew.row( j ).segment( 3, 3 ) -
+        Y.row( j ).segment( 3, 3 ) ).norm() / v );
+    for ( int i = 6; i < Y.cols(); ++i )
+    {
+      err = std::max( err, std::abs( Ynew( j, i ) - Y( j, i ) ) /
+                           ( 1 + std::abs( Ynew( j, i ) ) ) );
+    }
+  }
+  return err;
+}
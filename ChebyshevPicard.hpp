@@ -0,0 +1,123 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ChebyshevPicard.hpp
+/// @brief   Modified Chebyshev-Picard iteration (MCPI) propagator.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_CHEBYSHEVPICARD_HEADER_GUARD
+#define EKF_CHEBYSHEVPICARD_HEADER_GUARD
+
+// C++ Standard Library
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <Action.hpp>
+#include <Parallel.hpp>
+#include <Propagator.hpp>
+
+/// @brief Modified Chebyshev-Picard iteration (MCPI) propagator.
+///
+/// The arc is cut into segments of fixed length. On each segment the
+/// state and STM are approximated by a Chebyshev series sampled at
+/// order + 1 Chebyshev-Gauss-Lobatto nodes, and refined by Picard
+/// iteration until the node values stop moving. Every force evaluation
+/// within an iteration is independent, so they are spread over
+/// numThreads threads ( at most one per core ). An iteration takes only
+/// tens of microseconds, so they run on a persistent ThreadTeam held by
+/// the propagator rather than on threads started for each.
+///
+/// A segment whose iteration does not converge within the iteration
+/// limit ( typically one longer than about a third of an orbit ) is
+/// halved until it does, and propagation fails if that takes more than
+/// ten halvings.
+///
+/// The converged node values of segments are kept. When the same
+/// segment is propagated again from a slightly different state (e.g.
+/// the next iteration of a filter), the old solution, shifted onto the
+/// new initial condition, seeds the iteration instead of a constant.
+/// A segment holds ( order + 1 ) x ( 6 + agents^2 ) doubles, about 4 MB
+/// at order 48 with 99 agents, so they are dropped least recently used
+/// first once they pass maxWarmStartBytes ( 64 MB by default ). An arc
+/// longer than the bound is warm started from none of its segments, as
+/// each is dropped before it is reached again.
+///
+class ChebyshevPicard : public Propagator
+{
+ public:
+  ChebyshevPicard();
+  ChebyshevPicard( int order, double segment, unsigned int numThreads );
+ ~ChebyshevPicard() override;
+
+  // Propagate stateAndPartials from t0 to t1, logging every step in
+  // the returned map as Motion::stepTo would.
+  std::map< double, std::vector< double > > propagate(
+    const std::vector< std::shared_ptr< Action > > &actions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0, double t1, double step ) override;
+
+  // Set the relative node correction at which iteration stops
+  void setTolerance( double tolerance );
+  // Forget all stored segment solutions
+  void clearWarmStarts();
+  // Keep at most about maxBytes of segment solutions
+  void setMaxWarmStartBytes( std::size_t maxBytes );
+
+  // Picard iterations used by the last propagation
+  int getIterations() const;
+  // Force evaluations used by the last propagation
+  int getEvaluations() const;
+
+ private:
+  int m_order;
+  double m_segment;
+  unsigned int m_numThreads;
+  // Evaluates the nodes when there is more than one thread
+  std::shared_ptr< ThreadTeam > m_team;
+  double m_tolerance;
+  int m_maxIterations;
+  int m_iterations;
+  int m_evaluations;
+  Eigen::VectorXd m_nodes;
+  Eigen::MatrixXd m_picard;
+  Eigen::MatrixXd m_integral;
+  struct warm_start
+  {
+    double end;
+    Eigen::MatrixXd nodes;
+    std::list< double >::iterator use;
+  };
+
+  std::size_t m_maxWarmStartBytes;
+  std::size_t m_warmStartBytes;
+  // Keyed by segment start
+  std::map< double, warm_start > m_warmStarts;
+  // Segment starts, most recently used first
+  std::list< double > m_warmStartUses;
+
+  void buildOperators();
+  bool solveSegment( std::vector< std::shared_ptr< Action > > &actions,
+                     AgentGroup &activeAgents, const Eigen::VectorXd &y0,
+                     double ta, double tb, Eigen::MatrixXd &F );
+  Eigen::MatrixXd warmStart( const Eigen::MatrixXd &Yprev,
+                             const Eigen::VectorXd &y0 ) const;
+  void keepWarmStart( double ta, double tb, const Eigen::MatrixXd &Y );
+  void dropWarmStart( double ta );
+  std::size_t warmStartBytes( const Eigen::MatrixXd &Y ) const;
+  double correction( const Eigen::MatrixXd &Y,
+                     const Eigen::MatrixXd &Ynew ) const;
+};
+
+#endif // EKF_CHEBYSHEVPICARD_HEADER_GUARD
@@ -0,0 +1,570 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ConjunctionScreen.cpp
+/// @brief   Close approach screening across a catalog of propagated
+///          trajectories.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+
+// ekf Library
+#include <ConjunctionScreen.hpp>
+#include <Parallel.hpp>
+
+namespace
+{
+  const double pi = 3.14159265358979323846;
+
+  // Cubic Hermite basis on [0, 1] and its derivative
+  void
+  hermite(
+      double s,
+      double *basis,
+      double *slope )
+  {
+    double s2 = s * s;
+    double s3 = s2 * s;
+    basis[0] = 2 * s3 - 3 * s2 + 1;
+    basis[1] = s3 - 2 * s2 + s;
+    basis[2] = -2 * s3 + 3 * s2;
+    basis[3] = s3 - s2;
+    slope[0] = 6 * s2 - 6 * s;
+    slope[1] = 3 * s2 - 4 * s + 1;
+    slope[2] = -6 * s2 + 6 * s;
+    slope[3] = 3 * s2 - 2 * s;
+  }
+
+  // Cell key of integer cell coordinates
+  std::int64_t
+  cellKey(
+      std::int64_t ix,
+      std::int64_t iy,
+      std::int64_t iz )
+  {
+    const std::int64_t mask = ( 1 << 21 ) - 1;
+    return ( ( ix & mask ) << 42 ) | ( ( iy & mask ) << 21 ) | ( iz & mask );
+  }
+
+  // Range of the conic radius p / ( 1 + E cos( theta - phi ) ) over
+  // theta in [ -w, w ]
+  void
+  radiusRange(
+      double p,
+      double E,
+      double phi,
+      double w,
+      double &low,
+      double &high )
+  {
+    double r0 = p / ( 1 + E * std::cos( -w - phi ) );
+    double r1 = p / ( 1 + E * std::cos( w - phi ) );
+    low = std::min( r0, r1 );
+    high = std::max( r0, r1 );
+
+    // Perigee and apogee, where they fall in the window
+    double toPerigee = std::remainder( phi, 2 * pi );
+    double toApogee = std::remainder( phi + pi, 2 * pi );
+    if ( std::abs( toPerigee ) <= w )
+    {
+      low = p / ( 1 + E );
+    }
+    if ( std::abs( toApogee ) <= w )
+    {
+      high = ( E < 1 ) ? p / ( 1 - E ) : INFINITY;
+    }
+  }
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+ConjunctionScreen::
+ConjunctionScreen()
+    : m_mu(),
+      m_pathMargin( 1000.0 ),
+      m_times(),
+      m_numObjects( 0 ),
+      m_samples(),
+      m_report()
+{
+}
+
+// Constructor with the sample times t0 + k * step up to t1, and the
+// central body GM for the orbit filters
+ConjunctionScreen::
+ConjunctionScreen(
+    double t0,
+    double t1,
+    double step,
+    double mu )
+    : m_mu( mu ),
+      m_pathMargin( 1000.0 ),
+      m_times(),
+      m_numObjects( 0 ),
+      m_samples(),
+      m_report()
+{
+  int numSteps = std::floor( ( t1 - t0 ) / step + 0.5 );
+  for ( int k = 0; k <= numSteps; ++k )
+  {
+    m_times.push_back( t0 + k * step );
+  }
+}
+
+// Default Destructor
+ConjunctionScreen::
+~ConjunctionScreen()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Add an object by its states at the sample times
+int
+ConjunctionScreen::
+addObject( const std::vector< double > &states )
+{
+  if ( states.size() != 6 * m_times.size() )
+  {
+    std::cout << "ConjunctionScreen needs " << 6 * m_times.size()
+              << " state elements, not " << states.size() << std::endl;
+    throw;
+  }
+  m_samples.insert( m_samples.end(), states.begin(), states.end() );
+  return m_numObjects++;
+}
+
+// Add an object by the states motion logged at the sample times
+int
+ConjunctionScreen::
+addObject( const Motion &motion )
+{
+  std::vector< double > states;
+  states.reserve( 6 * m_times.size() );
+  for ( double t: m_times )
+  {
+    std::vector< double > state = motion.getState( t );
+    states.insert( states.end(), state.begin(), state.end() );
+  }
+  return addObject( states );
+}
+
+// Add every object of catalog, sampled by its mean elements
+int
+ConjunctionScreen::
+addObjects( const SecularPropagator &catalog )
+{
+  int first = m_numObjects;
+  int numObjects = catalog.getNumObjects();
+  int numTimes = m_times.size();
+  m_samples.resize( m_samples.size() + 6 * numTimes * numObjects );
+  for ( int k = 0; k < numTimes; ++k )
+  {
+    Eigen::ArrayXXd states = catalog.getStates( m_times[k] );
+    for ( int i = 0; i < numObjects; ++i )
+    {
+      double *s = &m_samples[ 6 * ( ( first + i ) * numTimes + k ) ];
+      for ( int c = 0; c < 6; ++c )
+      {
+        s[c] = states( i, c );
+      }
+    }
+  }
+  m_numObjects += numObjects;
+  return first;
+}
+
+// Margin for the orbit path filter
+void
+ConjunctionScreen::
+setPathMargin( double margin )
+{
+  m_pathMargin = margin;
+}
+
+// Number of objects added
+int
+ConjunctionScreen::
+getNumObjects() const
+{
+  return m_numObjects;
+}
+
+// Sample times
+const std::vector< double >&
+ConjunctionScreen::
+getTimes() const
+{
+  return m_times;
+}
+
+// Screen every bucket, then gather the close approaches in time order
+std::vector< Conjunction >
+ConjunctionScreen::
+screen(
+    double threshold,
+    unsigned int numThreads )
+{
+  m_report = ScreenReport();
+  std::vector< Conjunction > conjunctions;
+  int numTimes = m_times.size();
+  if ( ( numTimes < 2 ) || ( m_numObjects < 2 ) )
+  {
+    return conjunctions;
+  }
+
+  // Radial band each object sweeps, from its osculating perigee and
+  // apogee at every sample
+  std::vector< double > perigee( m_numObjects );
+  std::vector< double > apogee( m_numObjects );
+  parallelFor( 0, m_numObjects, numThreads, [&]( int i )
+  {
+    perigee[i] = INFINITY;
+    apogee[i] = 0.0;
+    for ( int k = 0; k < numTimes; ++k )
+    {
+      Eigen::Map< const Eigen::Vector3d > r( sample( i, k ) );
+      Eigen::Map< const Eigen::Vector3d > v( sample( i, k ) + 3 );
+      double energy = 0.5 * v.squaredNorm() - m_mu / r.norm();
+      double p = r.cross( v ).squaredNorm() / m_mu;
+      double e = std::sqrt( std::max( 0.0, 1 + 2 * energy * p / m_mu ) );
+      perigee[i] = std::min( perigee[i], p / ( 1 + e ) );
+      apogee[i] = std::max( apogee[i],
+                            ( e < 1 ) ? p / ( 1 - e ) : INFINITY );
+    }
+  } );
+
+  int numBuckets = numTimes - 1;
+  std::vector< std::vector< Conjunction > > found( numBuckets );
+  std::vector< ScreenReport > reports( numBuckets, ScreenReport() );
+  parallelFor( 0, numBuckets, numThreads, [&]( int k )
+  {
+    screenBucket( k, threshold, perigee, apogee, found[k], reports[k] );
+  } );
+
+  for ( int k = 0; k < numBuckets; ++k )
+  {
+    m_report.hashPairs += reports[k].hashPairs;
+    m_report.apsisPairs += reports[k].apsisPairs;
+    m_report.pathPairs += reports[k].pathPairs;
+    std::sort( found[k].begin(), found[k].end(),
+               []( const Conjunction &a, const Conjunction &b )
+               {
+                 return a.time < b.time;
+               } );
+    conjunctions.insert( conjunctions.end(), found[k].begin(),
+                         found[k].end() );
+  }
+  m_report.conjunctions = conjunctions.size();
+  return conjunctions;
+}
+
+// Pair counts of the last screen
+ScreenReport
+ConjunctionScreen::
+getReport() const
+{
+  return m_report;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// State of object at sample k
+const double*
+ConjunctionScreen::
+sample(
+    int object,
+    int k ) const
+{
+  return &m_samples[ 6 * ( object * m_times.size() + k ) ];
+}
+
+// Hash the paths of every object over bucket k, and pass the pairs that
+// share a cell through the filters to the refinement
+void
+ConjunctionScreen::
+screenBucket(
+    int k,
+    double threshold,
+    const std::vector< double > &perigee,
+    const std::vector< double > &apogee,
+    std::vector< Conjunction > &found,
+    ScreenReport &report ) const
+{
+  double h = m_times[ k + 1 ] - m_times[k];
+
+  // Box each path: the end samples, grown by the furthest the cubic
+  // strays from its chord ( h / 4 times the largest difference of the
+  // end velocities from the chord velocity ) and by half the threshold
+  std::vector< double > low( 3 * m_numObjects );
+  std::vector< double > high( 3 * m_numObjects );
+  double cell = 0.0;
+  for ( int i = 0; i < m_numObjects; ++i )
+  {
+    const double *s0 = sample( i, k );
+    const double *s1 = sample( i, k + 1 );
+    double bow0 = 0.0;
+    double bow1 = 0.0;
+    for ( int c = 0; c < 3; ++c )
+    {
+      double chord = ( s1[c] - s0[c] ) / h;
+      bow0 += ( s0[ c + 3 ] - chord ) * ( s0[ c + 3 ] - chord );
+      bow1 += ( s1[ c + 3 ] - chord ) * ( s1[ c + 3 ] - chord );
+    }
+    double grow = 0.25 * h * std::sqrt( std::max( bow0, bow1 ) ) +
+                  0.5 * threshold;
+    for ( int c = 0; c < 3; ++c )
+    {
+      low[ 3 * i + c ] = std::min( s0[c], s1[c] ) - grow;
+      high[ 3 * i + c ] = std::max( s0[c], s1[c] ) + grow;
+      cell = std::max( cell, high[ 3 * i + c ] - low[ 3 * i + c ] );
+    }
+  }
+
+  // Every cell each box touches, sorted by cell
+  std::vector< std::pair< std::int64_t, int > > entries;
+  entries.reserve( 8 * m_numObjects );
+  for ( int i = 0; i < m_numObjects; ++i )
+  {
+    std::int64_t first[3];
+    std::int64_t last[3];
+    for ( int c = 0; c < 3; ++c )
+    {
+      first[c] = std::floor( low[ 3 * i + c ] / cell );
+      last[c] = std::floor( high[ 3 * i + c ] / cell );
+    }
+    for ( std::int64_t ix = first[0]; ix <= last[0]; ++ix )
+    {
+      for ( std::int64_t iy = first[1]; iy <= last[1]; ++iy )
+      {
+        for ( std::int64_t iz = first[2]; iz <= last[2]; ++iz )
+        {
+          entries.push_back( std::make_pair( cellKey( ix, iy, iz ), i ) );
+        }
+      }
+    }
+  }
+  std::sort( entries.begin(), entries.end() );
+
+  // Pairs within each cell
+  size_t begin = 0;
+  while ( begin < entries.size() )
+  {
+    size_t end = begin + 1;
+    while ( ( end < entries.size() ) &&
+            ( entries[ end ].first == entries[ begin ].first ) )
+    {
+      ++end;
+    }
+    for ( size_t a = begin; a < end; ++a )
+    {
+      for ( size_t b = a + 1; b < end; ++b )
+      {
+        int i = entries[a].second;
+        int j = entries[b].second;
+
+        // Boxes must overlap, and the corner of the overlap decides
+        // the one cell the pair is taken in
+        bool overlap = true;
+        std::int64_t corner[3];
+        for ( int c = 0; c < 3; ++c )
+        {
+          double from = std::max( low[ 3 * i + c ], low[ 3 * j + c ] );
+          double to = std::min( high[ 3 * i + c ], high[ 3 * j + c ] );
+          overlap = overlap && ( from <= to );
+          corner[c] = std::floor( from / cell );
+        }
+        if ( !overlap ||
+             ( cellKey( corner[0], corner[1], corner[2] ) !=
+               entries[ begin ].first ) )
+        {
+          continue;
+        }
+        ++report.hashPairs;
+
+        if ( std::max( perigee[i], perigee[j] ) -
+             std::min( apogee[i], apogee[j] ) > threshold )
+        {
+          continue;
+        }
+        ++report.apsisPairs;
+
+        if ( !orbitPathsMeet( i, j, k, threshold + m_pathMargin ) )
+        {
+          continue;
+        }
+        ++report.pathPairs;
+
+        refine( std::min( i, j ), std::max( i, j ), k, threshold, found );
+      }
+    }
+    begin = end;
+  }
+}
+
+// Whether the osculating orbits at sample k come within distance near
+// a mutual node. A point within distance of the other orbit is within
+// distance of its plane, which confines it to a window either side of
+// the node line; the radii of both orbits over their windows must then
+// come within distance. Orbits too close to coplanar, or with windows
+// a quarter turn or wider, are passed.
+bool
+ConjunctionScreen::
+orbitPathsMeet(
+    int first,
+    int second,
+    int k,
+    double distance ) const
+{
+  int objects[2] = { first, second };
+  Eigen::Vector3d normal[2];
+  Eigen::Vector3d eccentricity[2];
+  double p[2];
+  double q[2];
+  for ( int o = 0; o < 2; ++o )
+  {
+    Eigen::Map< const Eigen::Vector3d > r( sample( objects[o], k ) );
+    Eigen::Map< const Eigen::Vector3d > v( sample( objects[o], k ) + 3 );
+    Eigen::Vector3d h = r.cross( v );
+    normal[o] = h.normalized();
+    eccentricity[o] = v.cross( h ) / m_mu - r.normalized();
+    p[o] = h.squaredNorm() / m_mu;
+    q[o] = p[o] / ( 1 + eccentricity[o].norm() );
+  }
+
+  Eigen::Vector3d nodes = normal[0].cross( normal[1] );
+  double sinInclination = nodes.norm();
+  if ( sinInclination * std::min( q[0], q[1] ) <= distance )
+  {
+    return true;
+  }
+  nodes /= sinInclination;
+
+  // Half width of each window, from the perigee radius
+  double w[2];
+  for ( int o = 0; o < 2; ++o )
+  {
+    w[o] = std::asin( std::min( 1.0, distance /
+                                     ( q[o] * sinInclination ) ) );
+    if ( w[o] >= 0.5 * pi )
+    {
+      return true;
+    }
+  }
+
+  for ( double side: { 1.0, -1.0 } )
+  {
+    double low[2];
+    double high[2];
+    for ( int o = 0; o < 2; ++o )
+    {
+      Eigen::Vector3d node = side * nodes;
+      Eigen::Vector3d across = normal[o].cross( node );
+      double E = eccentricity[o].norm();
+      double phi = std::atan2( eccentricity[o].dot( across ),
+                               eccentricity[o].dot( node ) );
+      radiusRange( p[o], E, phi, w[o], low[o], high[o] );
+    }
+    if ( ( low[0] <= high[1] + distance ) &&
+         ( low[1] <= high[0] + distance ) )
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Find the closest approach of a pair over bucket k on the relative
+// Hermite cubic. Minima are the roots of the range rate r . dr/ds going
+// from negative to positive, bracketed on a few subintervals and
+// bisected. A root at the end of a bucket is taken by one bucket only,
+// and minima at the ends of the span are kept.
+void
+ConjunctionScreen::
+refine(
+    int first,
+    int second,
+    int k,
+    double threshold,
+    std::vector< Conjunction > &found ) const
+{
+  double h = m_times[ k + 1 ] - m_times[k];
+  const double *a0 = sample( first, k );
+  const double *a1 = sample( first, k + 1 );
+  const double *b0 = sample( second, k );
+  const double *b1 = sample( second, k + 1 );
+  Eigen::Vector3d p0, v0, p1, v1;
+  for ( int c = 0; c < 3; ++c )
+  {
+    p0[c] = a0[c] - b0[c];
+    v0[c] = h * ( a0[ c + 3 ] - b0[ c + 3 ] );
+    p1[c] = a1[c] - b1[c];
+    v1[c] = h * ( a1[ c + 3 ] - b1[ c + 3 ] );
+  }
+
+  auto relative = [&]( double s, Eigen::Vector3d &d, Eigen::Vector3d &dd )
+  {
+    double basis[4];
+    double slope[4];
+    hermite( s, basis, slope );
+    d = basis[0] * p0 + basis[1] * v0 + basis[2] * p1 + basis[3] * v1;
+    dd = slope[0] * p0 + slope[1] * v0 + slope[2] * p1 + slope[3] * v1;
+    return d.dot( dd );
+  };
+  auto keep = [&]( double s )
+  {
+    Eigen::Vector3d d, dd;
+    relative( s, d, dd );
+    if ( d.norm() <= threshold )
+    {
+      Conjunction c = { first, second, m_times[k] + s * h, d.norm(),
+                        dd.norm() / h };
+      found.push_back( c );
+    }
+  };
+
+  const int numBrackets = 8;
+  Eigen::Vector3d d, dd;
+  double sLow = 0.0;
+  double fLow = relative( sLow, d, dd );
+  if ( ( k == 0 ) && ( fLow >= 0 ) )
+  {
+    keep( 0.0 );
+  }
+  for ( int m = 1; m <= numBrackets; ++m )
+  {
+    double sHigh = double( m ) / numBrackets;
+    double fHigh = relative( sHigh, d, dd );
+    if ( ( fLow < 0 ) && ( fHigh >= 0 ) )
+    {
+      double from = sLow;
+      double to = sHigh;
+      for ( int n = 0; n < 50; ++n )
+      {
+        double mid = 0.5 * ( from + to );
+        ( ( relative( mid, d, dd ) < 0 ) ? from : to ) = mid;
+      }
+      keep( to );
+    }
+    sLow = sHigh;
+    fLow = fHigh;
+  }
+  if ( ( k + 2 == (int) m_times.size() ) && ( fLow < 0 ) )
+  {
+    keep( 1.0 );
+  }
+}
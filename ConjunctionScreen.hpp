@@ -0,0 +1,128 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ConjunctionScreen.hpp
+/// @brief   Close approach screening across a catalog of propagated
+///          trajectories.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_CONJUNCTIONSCREEN_HEADER_GUARD
+#define EKF_CONJUNCTIONSCREEN_HEADER_GUARD
+
+// C++ Standard Library
+#include <vector>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <Motion.hpp>
+#include <SecularPropagator.hpp>
+
+/// @brief A close approach found by ConjunctionScreen.
+///
+/// first < second are object indices, time the time of closest
+/// approach, and distance and speed the relative distance and speed
+/// there.
+///
+struct Conjunction
+{
+  int first;
+  int second;
+  double time;
+  double distance;
+  double speed;
+};
+
+/// @brief Pair counts of the last ConjunctionScreen::screen, by stage.
+///
+struct ScreenReport
+{
+  long long hashPairs;
+  long long apsisPairs;
+  long long pathPairs;
+  int conjunctions;
+};
+
+/// @brief Screen a catalog for close approaches.
+///
+/// Every object is sampled on a common grid of times ( position and
+/// velocity ), and each interval between samples is screened as a time
+/// bucket:
+///   - The path of each object over the bucket, the cubic Hermite
+///     through its end samples, is bounded by a box grown by half the
+///     threshold, and the boxes are hashed into cells as large as the
+///     largest box. Only pairs whose boxes overlap go on, each counted
+///     in the one cell holding the corner of the overlap.
+///   - Apogee / perigee filter: the pair is dropped if the radial bands
+///     the objects sweep over the whole span are further apart than the
+///     threshold.
+///   - Orbit path filter: the osculating orbits at the start of the
+///     bucket are compared near their mutual nodes, where the objects
+///     must be to come within the threshold of each other. The pair is
+///     dropped if their radii there differ by more than the threshold
+///     and a margin for the perturbations over the bucket.
+///   - The time of closest approach is refined on the relative Hermite
+///     cubic, and kept if the distance is within the threshold.
+/// Listing every pair would be the O( N^2 ) cost screening avoids, so
+/// the filters are applied to the pairs the hash puts forward, before
+/// the refinement. Buckets are screened in parallel.
+///
+/// The samples should be close enough to follow the motion with cubics,
+/// a minute or so in LEO.
+///
+class ConjunctionScreen
+{
+ public:
+  ConjunctionScreen();
+  ConjunctionScreen( double t0, double t1, double step, double mu );
+ ~ConjunctionScreen();
+
+  // Add an object by its states at the sample times, X, Y, Z, dX, dY,
+  // dZ for each in turn, returning its index
+  int addObject( const std::vector< double > &states );
+  // Add an object by the states motion logged at the sample times
+  int addObject( const Motion &motion );
+  // Add every object of catalog, returning the index of the first
+  int addObjects( const SecularPropagator &catalog );
+
+  // Margin for the orbit path filter ( default 1 km )
+  void setPathMargin( double margin );
+
+  // Number of objects added
+  int getNumObjects() const;
+  // Sample times
+  const std::vector< double >& getTimes() const;
+
+  // Close approaches within threshold, in time order, screening the
+  // buckets on numThreads threads ( 0 means one per core )
+  std::vector< Conjunction > screen( double threshold,
+                                     unsigned int numThreads );
+  // Pair counts of the last screen
+  ScreenReport getReport() const;
+
+ private:
+  double m_mu;
+  double m_pathMargin;
+  std::vector< double > m_times;
+  int m_numObjects;
+  // States at the sample times, by object then time
+  std::vector< double > m_samples;
+  ScreenReport m_report;
+
+  const double* sample( int object, int k ) const;
+  void screenBucket( int k, double threshold,
+                     const std::vector< double > &perigee,
+                     const std::vector< double > &apogee,
+                     std::vector< Conjunction > &found,
+                     ScreenReport &report ) const;
+  bool orbitPathsMeet( int first, int second, int k,
+                       double distance ) const;
+  void refine( int first, int second, int k, double threshold,
+               std::vector< Conjunction > &found ) const;
+};
+
+#endif // EKF_CONJUNCTIONSCREEN_HEADER_GUARD
@@ -0,0 +1,380 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    EnckePropagator.cpp
+/// @brief   Encke propagation of the deviation from a Keplerian
+///          reference orbit.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// boost Library
+#include <boost/numeric/odeint.hpp>
+
+// ekf Library
+#include <EnckePropagator.hpp>
+#include <GravityAction.hpp>
+#include <OdeintHelper.hpp>
+
+//=====================================================================
+//=====================================================================
+// This struct gives the equations of motion of the scaled deviation
+// from the reference orbit, followed by the STM.
+struct encke_system
+{
+  OdeintHelper* m_helper;
+  const std::vector< std::shared_ptr< Action > >* m_actions;
+  const GravityAction* m_gravity;
+  std::vector< double > m_reference;
+  double m_mu;
+  double m_epoch;
+  double m_length;
+  double m_speed;
+
+  // Constructor
+  encke_system( OdeintHelper& helper,
+                const std::vector< std::shared_ptr< Action > >& actions,
+                const GravityAction& gravity,
+                const std::vector< double >& reference, double mu,
+                double epoch )
+      : m_helper( &helper ), m_actions( &actions ), m_gravity( &gravity ),
+        m_reference( reference ), m_mu( mu ), m_epoch( epoch ),
+        m_length( sqrt( reference[0] * reference[0] +
+                        reference[1] * reference[1] +
+                        reference[2] * reference[2] ) ),
+        m_speed( sqrt( reference[3] * reference[3] +
+                       reference[4] * reference[4] +
+                       reference[5] * reference[5] ) ) { }
+
+  // Full state and STM from the scaled deviation and STM in y
+  std::vector< double > full( const std::vector< double >& y, double t ) const
+  {
+    std::vector< double > rho =
+      EnckePropagator::kepler( m_reference, m_mu, t - m_epoch );
+    std::vector< double > x( y );
+    for ( int i = 0; i < 3; ++i )
+    {
+      x[i] = rho[i] + m_length * y[i];
+      x[i + 3] = rho[i + 3] + m_speed * y[i + 3];
+    }
+    return x;
+  }
+
+  // The deviation obeys d2( delta ) / dt2 = ap - mu / |rho|^3 ( delta +
+  // f( q ) r ) ( Battin ), with ap every acceleration but the reference
+  // point mass, q = delta . ( delta - 2 r ) / |r|^2 and f( q ) = q ( 3 +
+  // 3 q + q^2 ) / ( 1 + ( 1 + q )^1.5 ). Nothing of the size of the point
+  // mass acceleration cancels. The STM obeys its usual equation at the
+  // full state.
+  void operator()( const std::vector< double >& y,
+                   std::vector< double >& dydt, double t )
+  {
+    std::vector< double > rho =
+      EnckePropagator::kepler( m_reference, m_mu, t - m_epoch );
+    std::vector< double > x = full( y, t );
+    if ( x.size() > 6 )
+    {
+      ( *m_helper )( x, dydt, t );
+    }
+
+    std::vector< double > accel( 3, 0.0 );
+    for ( const auto &action: *m_actions )
+    {
+      if ( action.get() == m_gravity )
+      {
+        m_gravity->getPerturbingAcceleration( accel, x );
+      }
+      else
+      {
+        action->getAccelerationAtTime( accel, x, t );
+      }
+    }
+
+    double delta[3];
+    double rr = 0.0;
+    double deltaDelta = 0.0;
+    double deltaR = 0.0;
+    for ( int i = 0; i < 3; ++i )
+    {
+      delta[i] = m_length * y[i];
+      rr += x[i] * x[i];
+      deltaDelta += delta[i] * delta[i];
+      deltaR += delta[i] * x[i];
+    }
+    double q = ( deltaDelta - 2 * deltaR ) / rr;
+    double fq = q * ( 3 + 3 * q + q * q ) / ( 1 + pow( 1 + q, 1.5 ) );
+    double rhoDist = sqrt( rho[0] * rho[0] + rho[1] * rho[1] +
+                           rho[2] * rho[2] );
+    double muRho3 = m_mu / ( rhoDist * rhoDist * rhoDist );
+    for ( int i = 0; i < 3; ++i )
+    {
+      dydt[i] = y[i + 3] * m_speed / m_length;
+      dydt[i + 3] =
+        ( accel[i] - muRho3 * ( delta[i] + fq * x[i] ) ) / m_speed;
+    }
+  }
+};
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+EnckePropagator::
+EnckePropagator()
+    : m_rectification( 1.E-2 ),
+      m_tolerance( 1.E-9 ),
+      m_steps(),
+      m_rectifications()
+{
+}
+
+// Constructor with the rectification ratio and error tolerance
+EnckePropagator::
+EnckePropagator(
+    double rectification,
+    double tolerance )
+    : m_rectification( rectification ),
+      m_tolerance( tolerance ),
+      m_steps(),
+      m_rectifications()
+{
+}
+
+// Default Destructor
+EnckePropagator::
+~EnckePropagator()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Propagate the state and partials from t0 to t1 as a deviation from
+// the osculating two-body orbit.
+std::map< double, std::vector< double > >
+EnckePropagator::
+propagate(
+    const std::vector< std::shared_ptr< Action > > &actions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0,
+    double t1,
+    double step )
+{
+  using namespace boost::numeric::odeint;
+
+  typedef runge_kutta_dopri5< std::vector< double > > rkStepper;
+
+  std::vector< std::shared_ptr< Action > > stepActions( actions );
+  AgentGroup agents( activeAgents );
+  OdeintHelper helper( stepActions, agents );
+
+  // The reference orbits the body of the first GravityAction, with its
+  // current ( possibly bound ) GM
+  std::shared_ptr< GravityAction > gravity;
+  for ( const auto &action: actions )
+  {
+    gravity = std::dynamic_pointer_cast< GravityAction >( action );
+    if ( gravity )
+    {
+      break;
+    }
+  }
+  double mu = gravity ? gravity->getMu() : 0.0;
+  if ( !( mu > 0.0 ) )
+  {
+    std::cout << "Encke propagation needs a GravityAction with positive GM"
+              << std::endl;
+    throw;
+  }
+
+  std::map< double, std::vector< double > > pastStates;
+  pastStates.insert( std::make_pair( t0, stateAndPartials ) );
+  m_steps = 0;
+  m_rectifications = 0;
+
+  // Zero deviation from the reference osculating at t0
+  encke_system system( helper, stepActions, *gravity, stateAndPartials, mu,
+                       t0 );
+  std::vector< double > y( stateAndPartials );
+  std::fill( y.begin(), y.begin() + 6, 0.0 );
+
+  // The deviation is scaled to the orbit, so the absolute tolerance
+  // acts relative to the orbit rather than to the deviation. The step
+  // the controller settles on is carried from one output interval to
+  // the next, rather than restarting from the output step, and a step
+  // cut short by an output time does not shrink it.
+  auto stepper = make_controlled( m_tolerance, m_tolerance, rkStepper() );
+  std::vector< double > times = outputTimes( t0, t1, step );
+  int numSteps = times.size() - 1;
+  double dt = step;
+  for ( int i = 1; i <= numSteps; ++i )
+  {
+    double time = times[ i - 1 ];
+    double tb = times[i];
+    while ( time < tb )
+    {
+      double h = std::min( dt, tb - time );
+      bool last = ( h == tb - time );
+      if ( stepper.try_step( system, y, time, h ) == fail )
+      {
+        dt = h;
+        continue;
+      }
+      ++m_steps;
+      dt = last ? std::max( dt, h ) : h;
+      if ( last )
+      {
+        time = tb;
+      }
+    }
+
+    std::vector< double > x = system.full( y, tb );
+    pastStates.insert( std::make_pair( tb, x ) );
+
+    // Rectify once the deviation is no longer small
+    double deviation = sqrt( y[0] * y[0] + y[1] * y[1] + y[2] * y[2] );
+    if ( deviation > m_rectification )
+    {
+      system = encke_system( helper, stepActions, *gravity, x, mu, tb );
+      std::fill( y.begin(), y.begin() + 6, 0.0 );
+      stepper.reset();
+      ++m_rectifications;
+    }
+  }
+
+  return pastStates;
+}
+
+// Integration steps taken by the last propagation
+int
+EnckePropagator::
+getSteps() const
+{
+  return m_steps;
+}
+
+// Rectifications made by the last propagation
+int
+EnckePropagator::
+getRectifications() const
+{
+  return m_rectifications;
+}
+
+// Two-body propagation with f and g functions in the eccentric anomaly
+// difference, or the hyperbolic one for hyperbolic orbits, solving
+// Kepler's equation by Newton iteration. Parabolic orbits, with no
+// semi-major axis, are not supported.
+std::vector< double >
+EnckePropagator::
+kepler(
+    const std::vector< double > &state,
+    double mu,
+    double dt )
+{
+  double r0 = sqrt( state[0] * state[0] + state[1] * state[1] +
+                    state[2] * state[2] );
+  double v02 = state[3] * state[3] + state[4] * state[4] +
+               state[5] * state[5];
+  double alpha = 2.0 / r0 - v02 / mu;
+  if ( alpha == 0 )
+  {
+    std::cout << "Encke reference orbit must not be parabolic." << std::endl;
+    throw;
+  }
+  double a = 1.0 / alpha;
+  bool elliptic = ( a > 0 );
+
+  double sqrtMu = sqrt( mu );
+  double sigma0 = ( state[0] * state[3] + state[1] * state[4] +
+                    state[2] * state[5] ) / sqrtMu;
+  double sqrtA = sqrt( std::abs( a ) );
+  double n = sqrtMu / ( std::abs( a ) * sqrtA );
+
+  // Elliptic: n dt = dE - ( 1 - r0 / a ) sin dE
+  //                  + sigma0 / sqrt( a ) ( 1 - cos dE )
+  // Hyperbolic: n dt = ( 1 - r0 / a ) sinh dH - dH
+  //                    + sigma0 / sqrt( -a ) ( cosh dH - 1 )
+  // Either side grows monotonically with dE, at r / |a|, so the root is
+  // bracketed from zero outwards and Newton steps leaving the bracket
+  // fall back to bisection.
+  double M = n * dt;
+  double eCos = 1 - r0 / a;
+  auto equation = [&]( double x, double &dF )
+  {
+    if ( elliptic )
+    {
+      dF = 1 - eCos * cos( x ) + sigma0 / sqrtA * sin( x );
+      return x - eCos * sin( x ) + sigma0 / sqrtA * ( 1 - cos( x ) ) - M;
+    }
+    dF = eCos * cosh( x ) + sigma0 / sqrtA * sinh( x ) - 1;
+    return eCos * sinh( x ) + sigma0 / sqrtA * ( cosh( x ) - 1 ) - x - M;
+  };
+  double dF;
+  double sign = ( M < 0 ) ? -1.0 : 1.0;
+  double lo = 0.0;
+  double hi = elliptic ? M : std::asinh( M / eCos );
+  hi = sign * std::max( std::abs( hi ), 1.E-3 );
+  while ( sign * equation( hi, dF ) < 0 )
+  {
+    lo = hi;
+    hi *= 2;
+  }
+  double dE = elliptic ? M : std::asinh( M / eCos );
+  for ( int i = 0; i < 100; ++i )
+  {
+    double F = equation( dE, dF );
+    if ( F == 0 )
+    {
+      break;
+    }
+    if ( sign * F < 0 )
+    {
+      lo = dE;
+    }
+    else
+    {
+      hi = dE;
+    }
+    double next = dE - F / dF;
+    if ( !( ( next - lo ) * ( next - hi ) < 0 ) )
+    {
+      next = 0.5 * ( lo + hi );
+    }
+    double delta = next - dE;
+    dE = next;
+    if ( std::abs( delta ) < 1.E-15 * std::max( 1.0, std::abs( dE ) ) )
+    {
+      break;
+    }
+  }
+
+  // With s and c the sine and cosine of dE, or their hyperbolic
+  // counterparts, the f and g functions take the same form in a, and
+  // 1 - c is formed from the half angle to keep it for small dE.
+  double half = elliptic ? sin( 0.5 * dE ) : sinh( 0.5 * dE );
+  double s = elliptic ? sin( dE ) : sinh( dE );
+  double c = elliptic ? cos( dE ) : cosh( dE );
+  double oneMinusC = elliptic ? 2 * half * half : -2 * half * half;
+  double r = r0 * c + a * oneMinusC + sigma0 * sqrtA * s;
+  double f = 1 - a / r0 * oneMinusC;
+  double g = a * sigma0 / sqrtMu * oneMinusC + r0 * sqrtA / sqrtMu * s;
+  double fDot = -sqrtMu * sqrtA / ( r * r0 ) * s;
+  double gDot = 1 - a / r * oneMinusC;
+
+  std::vector< double > x( 6 );
+  for ( int i = 0; i < 3; ++i )
+  {
+    x[i] = f * state[i] + g * state[i + 3];
+    x[i + 3] = fDot * state[i] + gDot * state[i + 3];
+  }
+  return x;
+}
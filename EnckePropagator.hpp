@@ -0,0 +1,81 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    EnckePropagator.hpp
+/// @brief   Encke propagation of the deviation from a Keplerian
+///          reference orbit.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_ENCKEPROPAGATOR_HEADER_GUARD
+#define EKF_ENCKEPROPAGATOR_HEADER_GUARD
+
+// C++ Standard Library
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <Propagator.hpp>
+
+/// @brief Encke propagation of the deviation from a Keplerian reference.
+///
+/// The reference is the two-body orbit through the state at the last
+/// rectification epoch, about the body of the first GravityAction of the
+/// Motion and with its GM, known analytically; it may be elliptic or
+/// hyperbolic, but not parabolic. Only the deviation from it is
+/// integrated, scaled by the reference radius and speed so the error
+/// control works relative to the orbit rather than to the small
+/// deviation. Its acceleration takes Battin's f( q ) form, with the
+/// perturbing part of the reference gravity from
+/// GravityAction::getPerturbingAcceleration, so nothing of the size of
+/// the point mass acceleration cancels. Once the position deviation
+/// exceeds the rectification ratio of the reference radius, the
+/// reference is re-osculated to the current state and the deviation
+/// restarts from zero.
+///
+/// The tolerance bounds the local error relative to the orbit size for
+/// the state, and applies as in Motion::stepTo to the STM. That
+/// truncation error is what limits the accuracy: it falls with the
+/// tolerance, while the cancellation Battin's form avoids is below it
+/// even at 1e-13.
+///
+/// The STM is integrated as usual through OdeintHelper, evaluated at
+/// the full ( reference + deviation ) state.
+///
+class EnckePropagator : public Propagator
+{
+ public:
+  EnckePropagator();
+  EnckePropagator( double rectification, double tolerance );
+ ~EnckePropagator() override;
+
+  // Propagate stateAndPartials from t0 to t1, logging every step in
+  // the returned map as Motion::stepTo would.
+  std::map< double, std::vector< double > > propagate(
+    const std::vector< std::shared_ptr< Action > > &actions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0, double t1, double step ) override;
+
+  // Integration steps taken by the last propagation
+  int getSteps() const;
+  // Rectifications made by the last propagation
+  int getRectifications() const;
+
+  // Two-body state at time dt after state, for gravitational parameter mu
+  static std::vector< double > kepler( const std::vector< double > &state,
+                                       double mu, double dt );
+
+ private:
+  double m_rectification;
+  double m_tolerance;
+  int m_steps;
+  int m_rectifications;
+};
+
+#endif // EKF_ENCKEPROPAGATOR_HEADER_GUARD
@@ -0,0 +1,39 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    Event.hpp
+/// @brief   Base class for defining event functions whose roots Motion
+///          locates during integration.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#ifndef EKF_EVENT_HEADER_GUARD
+#define EKF_EVENT_HEADER_GUARD
+
+// C++ Standard Library
+#include <vector>
+
+class Event
+{
+ public:
+  // Constructor
+  Event(){};
+
+  // Computes the event function for the state ( X, Y, Z, dX, dY, dZ )
+  // at time t. An event happens where it changes sign.
+  virtual double getValue( const std::vector< double > &state,
+                           double t ) const = 0;
+
+  // Returns the sign changes to report: +1 rising only, -1 falling only,
+  // or 0 both.
+  virtual int getDirection() const
+  {
+    return 0;
+  };
+
+  // Destructor
+  virtual ~Event(){};
+};
+
+#endif // EKF_EVENT_HEADER_GUARD
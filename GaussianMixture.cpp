@@ -0,0 +1,511 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    GaussianMixture.cpp
+/// @brief   Gaussian mixture propagation of state uncertainty.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numeric>
+
+// ekf Library
+#include <GaussianMixture.hpp>
+#include <Parallel.hpp>
+
+namespace
+{
+  const double pi = 3.14159265358979323846;
+
+  // Three component split of a unit Gaussian: weights, means and the
+  // common standard deviation. The tabulated sigma, 0.6715662886, is
+  // fitted in L2 and leaves 95.5 % of the variance; the one taken here
+  // makes up the rest, so a split keeps the mixture covariance.
+  const double splitWeights[3] = { 0.2252246249, 0.5495507502,
+                                   0.2252246249 };
+  const double splitMeans[3] = { -1.0575154615, 0.0, 1.0575154615 };
+  const double splitSigma = std::sqrt( 1 - 2 * splitWeights[0] *
+                                       splitMeans[2] * splitMeans[2] );
+
+  // Row major STM of a Motion at t as a matrix
+  Eigen::MatrixXd
+  stmAt(
+      const Motion &motion,
+      double t )
+  {
+    std::vector< double > partials = motion.getStatePartials( t );
+    int numAgents = std::sqrt( partials.size() );
+    return Eigen::Map< const Eigen::Matrix< double, Eigen::Dynamic,
+      Eigen::Dynamic, Eigen::RowMajor > >( partials.data(), numAgents,
+                                           numAgents ).topLeftCorner( 6, 6 );
+  }
+
+  // Eigen vector of a logged state
+  Eigen::VectorXd
+  stateAt(
+      const Motion &motion,
+      double t )
+  {
+    std::vector< double > state = motion.getState( t );
+    return Eigen::Map< const Eigen::VectorXd >( state.data(), 6 );
+  }
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+GaussianMixture::
+GaussianMixture()
+    : m_actions(),
+      m_components(),
+      m_time(),
+      m_step(),
+      m_maxComponents( 16 ),
+      m_maxBytes( 64 << 20 ),
+      m_splitThreshold( 0.005 ),
+      m_minWeight( 1.E-4 ),
+      m_mergeCost( 0.01 ),
+      m_numThreads( 0 )
+{
+}
+
+// Constructor with a single Gaussian at epoch, propagated under actions
+// with output step
+GaussianMixture::
+GaussianMixture(
+    const std::vector< std::shared_ptr< Action > > &actions,
+    const Eigen::VectorXd &mean,
+    const Eigen::MatrixXd &covariance,
+    double epoch,
+    double step )
+    : m_actions( actions ),
+      m_components(),
+      m_time( epoch ),
+      m_step( step ),
+      m_maxComponents( 16 ),
+      m_maxBytes( 64 << 20 ),
+      m_splitThreshold( 0.005 ),
+      m_minWeight( 1.E-4 ),
+      m_mergeCost( 0.01 ),
+      m_numThreads( 0 )
+{
+  if ( ( mean.size() != 6 ) || ( covariance.rows() != 6 ) ||
+       ( covariance.cols() != 6 ) )
+  {
+    std::cout << "GaussianMixture needs a six element state and a 6x6 "
+              << "covariance" << std::endl;
+    throw;
+  }
+  MixtureComponent component = { 1.0, mean, covariance,
+                                 std::shared_ptr< Motion >() };
+  m_components.push_back( component );
+}
+
+// Default Destructor
+GaussianMixture::
+~GaussianMixture()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Cap the components and the size of their logs
+void
+GaussianMixture::
+setBudget(
+    int maxComponents,
+    std::size_t maxBytes )
+{
+  m_maxComponents = std::max( 1, maxComponents );
+  m_maxBytes = maxBytes;
+}
+
+// Nonlinearity above which a component is split
+void
+GaussianMixture::
+setSplitting( double threshold )
+{
+  m_splitThreshold = threshold;
+}
+
+// Weight floor and merge cost of the reduction after updates
+void
+GaussianMixture::
+setReduction(
+    double minWeight,
+    double mergeCost )
+{
+  m_minWeight = minWeight;
+  m_mergeCost = mergeCost;
+}
+
+// Threads propagating components
+void
+GaussianMixture::
+setThreads( unsigned int numThreads )
+{
+  m_numThreads = numThreads;
+}
+
+// Propagate every component to t. The means and the ends of their
+// 1 sigma axes are integrated together, and components found too
+// nonlinear are split, heaviest first within the budget. The children
+// are tested in turn, the middle one keeping its parent's integrated
+// mean, until none is split. Every Motion steps to t exactly, so t need
+// not fall on the step grid, but it cannot be before the mixture time.
+void
+GaussianMixture::
+propagate( double t )
+{
+  if ( t < m_time )
+  {
+    std::cout << "Cannot propagate a mixture back from " << m_time
+              << " to " << t << "." << std::endl;
+    throw;
+  }
+
+  std::vector< MixtureComponent > pending( m_components );
+  for ( auto &component: pending )
+  {
+    component.motion.reset();
+  }
+  std::vector< MixtureComponent > components;
+  int count = pending.size();
+  while ( !pending.empty() )
+  {
+    int numPending = pending.size();
+    bool splitting = ( m_splitThreshold > 0 ) &&
+                     ( count + 2 <= m_maxComponents );
+    int runs = splitting ? 13 : 1;
+
+    // Principal axes, scaled to 1 sigma
+    std::vector< Eigen::MatrixXd > axes( numPending );
+    for ( int k = 0; splitting && ( k < numPending ); ++k )
+    {
+      Eigen::SelfAdjointEigenSolver< Eigen::MatrixXd > solver(
+        pending[k].covariance );
+      axes[k] = solver.eigenvectors() *
+        solver.eigenvalues().cwiseMax( 0.0 ).cwiseSqrt().asDiagonal();
+    }
+
+    std::vector< Eigen::VectorXd > ends( numPending * 12 );
+    parallelFor( 0, numPending * runs, m_numThreads, [&]( int job )
+    {
+      int k = job / runs;
+      int run = job % runs;
+      if ( run == 0 )
+      {
+        if ( !pending[k].motion )
+        {
+          pending[k].motion = propagateState( pending[k].mean, t );
+        }
+        return;
+      }
+      double side = ( run % 2 ) ? 1.0 : -1.0;
+      Eigen::VectorXd start = pending[k].mean +
+                              side * axes[k].col( ( run - 1 ) / 2 );
+      ends[ 12 * k + run - 1 ] = stateAt( *propagateState( start, t ), t );
+    } );
+
+    std::vector< int > order( numPending );
+    std::iota( order.begin(), order.end(), 0 );
+    std::sort( order.begin(), order.end(), [&]( int a, int b )
+    {
+      return pending[a].weight > pending[b].weight;
+    } );
+    std::size_t bytesEach = pending[0].motion->getLogBytes();
+    std::vector< MixtureComponent > children;
+    for ( int k: order )
+    {
+      MixtureComponent &component = pending[k];
+      if ( !splitting || ( count + 2 > m_maxComponents ) ||
+           ( ( count + 2 ) * bytesEach > m_maxBytes ) )
+      {
+        components.push_back( component );
+        continue;
+      }
+
+      // Curvature of the mapping along each axis: how far the midpoint
+      // of the propagated ends falls from the propagated mean, against
+      // the axis carried by the STM ( positions )
+      Eigen::VectorXd mean = stateAt( *component.motion, t );
+      Eigen::MatrixXd stm = stmAt( *component.motion, t );
+      int worst = 0;
+      double worstRatio = 0.0;
+      for ( int a = 0; a < 6; ++a )
+      {
+        Eigen::VectorXd midpoint =
+          0.5 * ( ends[ 12 * k + 2 * a ] + ends[ 12 * k + 2 * a + 1 ] );
+        double linear = ( stm * axes[k].col( a ) ).head( 3 ).norm();
+        double ratio = ( midpoint - mean ).head( 3 ).norm() /
+          std::max( linear, std::numeric_limits< double >::min() );
+        if ( ratio > worstRatio )
+        {
+          worstRatio = ratio;
+          worst = a;
+        }
+      }
+      if ( worstRatio <= m_splitThreshold )
+      {
+        components.push_back( component );
+        continue;
+      }
+
+      Eigen::VectorXd axis = axes[k].col( worst );
+      for ( int c = 0; c < 3; ++c )
+      {
+        MixtureComponent child = component;
+        child.weight = component.weight * splitWeights[c];
+        child.mean = component.mean + splitMeans[c] * axis;
+        child.covariance = component.covariance -
+          ( 1 - splitSigma * splitSigma ) * axis * axis.transpose();
+        if ( c != 1 )
+        {
+          child.motion.reset();
+        }
+        children.push_back( child );
+      }
+      count += 2;
+    }
+    pending.swap( children );
+  }
+
+  // Map every component to t with its own STM
+  for ( auto &component: components )
+  {
+    Eigen::MatrixXd stm = stmAt( *component.motion, t );
+    component.mean = stateAt( *component.motion, t );
+    component.covariance = stm * component.covariance * stm.transpose();
+  }
+  m_components.swap( components );
+  m_time = t;
+}
+
+// Kalman update of every component on a position measurement, with the
+// weights multiplied by its likelihood under each
+void
+GaussianMixture::
+update(
+    const Eigen::Vector3d &position,
+    const Eigen::Matrix3d &noise )
+{
+  std::vector< double > logWeights;
+  for ( auto &component: m_components )
+  {
+    Eigen::MatrixXd &P = component.covariance;
+    Eigen::Matrix3d S = P.topLeftCorner( 3, 3 ) + noise;
+    Eigen::LLT< Eigen::Matrix3d > llt( S );
+    Eigen::Vector3d innovation = position - component.mean.head( 3 );
+    Eigen::MatrixXd gain =
+      llt.solve( P.topRows( 3 ) ).transpose();
+    component.mean += gain * innovation;
+    P -= gain * P.topRows( 3 );
+    P = 0.5 * ( P + P.transpose() ).eval();
+
+    double logDet = 3 * std::log( 2 * pi );
+    for ( int c = 0; c < 3; ++c )
+    {
+      logDet += 2 * std::log( llt.matrixL()( c, c ) );
+    }
+    logWeights.push_back( std::log( component.weight ) -
+      0.5 * ( innovation.dot( llt.solve( innovation ) ) + logDet ) );
+  }
+
+  double largest = *std::max_element( logWeights.begin(), logWeights.end() );
+  double total = 0.0;
+  for ( size_t k = 0; k < m_components.size(); ++k )
+  {
+    m_components[k].weight = std::exp( logWeights[k] - largest );
+    total += m_components[k].weight;
+  }
+  for ( auto &component: m_components )
+  {
+    component.weight /= total;
+  }
+  reduce();
+}
+
+// Current time
+double
+GaussianMixture::
+getTime() const
+{
+  return m_time;
+}
+
+// Number of components
+int
+GaussianMixture::
+getNumComponents() const
+{
+  return m_components.size();
+}
+
+// Component k
+const MixtureComponent&
+GaussianMixture::
+getComponent( int k ) const
+{
+  return m_components[k];
+}
+
+// Mean of the mixture
+Eigen::VectorXd
+GaussianMixture::
+getMean() const
+{
+  Eigen::VectorXd mean = Eigen::VectorXd::Zero( 6 );
+  for ( const auto &component: m_components )
+  {
+    mean += component.weight * component.mean;
+  }
+  return mean;
+}
+
+// Covariance of the mixture, spread of the means included
+Eigen::MatrixXd
+GaussianMixture::
+getCovariance() const
+{
+  Eigen::VectorXd mean = getMean();
+  Eigen::MatrixXd covariance = Eigen::MatrixXd::Zero( 6, 6 );
+  for ( const auto &component: m_components )
+  {
+    Eigen::VectorXd offset = component.mean - mean;
+    covariance += component.weight *
+      ( component.covariance + offset * offset.transpose() );
+  }
+  return covariance;
+}
+
+// Estimated size of the component Motion logs
+std::size_t
+GaussianMixture::
+getBytes() const
+{
+  std::size_t bytes = 0;
+  for ( const auto &component: m_components )
+  {
+    if ( component.motion )
+    {
+      bytes += component.motion->getLogBytes();
+    }
+  }
+  return bytes;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Integrate state from the current time to t on a Motion of its own,
+// sharing the actions
+std::shared_ptr< Motion >
+GaussianMixture::
+propagateState(
+    const Eigen::VectorXd &state,
+    double t ) const
+{
+  std::shared_ptr< Motion > motion( new Motion(
+    std::vector< double >( state.data(), state.data() + 6 ), m_step,
+    m_time ) );
+  for ( auto action: m_actions )
+  {
+    motion->addAction( action );
+  }
+  motion->stepTo( t );
+  return motion;
+}
+
+// Prune light components, then merge pairs by Runnalls' cost
+//   B = ( w log det P - wi log det Pi - wj log det Pj ) / 2
+// of the moment matched merge, while it is small or over budget
+void
+GaussianMixture::
+reduce()
+{
+  std::vector< MixtureComponent > kept;
+  for ( const auto &component: m_components )
+  {
+    if ( component.weight >= m_minWeight )
+    {
+      kept.push_back( component );
+    }
+  }
+  if ( kept.empty() )
+  {
+    kept.push_back( *std::max_element( m_components.begin(),
+      m_components.end(),
+      []( const MixtureComponent &a, const MixtureComponent &b )
+      {
+        return a.weight < b.weight;
+      } ) );
+  }
+  double total = 0.0;
+  for ( const auto &component: kept )
+  {
+    total += component.weight;
+  }
+  for ( auto &component: kept )
+  {
+    component.weight /= total;
+  }
+
+  auto merge = []( const MixtureComponent &a, const MixtureComponent &b )
+  {
+    MixtureComponent merged = ( a.weight >= b.weight ) ? a : b;
+    merged.weight = a.weight + b.weight;
+    merged.mean = ( a.weight * a.mean + b.weight * b.mean ) / merged.weight;
+    Eigen::VectorXd offset = a.mean - b.mean;
+    merged.covariance = ( a.weight * a.covariance +
+                          b.weight * b.covariance ) / merged.weight +
+      a.weight * b.weight / ( merged.weight * merged.weight ) *
+      offset * offset.transpose();
+    return merged;
+  };
+  auto logDet = []( const Eigen::MatrixXd &P )
+  {
+    return 2 * Eigen::LLT< Eigen::MatrixXd >( P ).matrixL().toDenseMatrix()
+             .diagonal().array().log().sum();
+  };
+
+  while ( kept.size() > 1 )
+  {
+    double cheapest = std::numeric_limits< double >::infinity();
+    size_t first = 0;
+    size_t second = 0;
+    for ( size_t i = 0; i < kept.size(); ++i )
+    {
+      for ( size_t j = i + 1; j < kept.size(); ++j )
+      {
+        MixtureComponent merged = merge( kept[i], kept[j] );
+        double cost = 0.5 * ( merged.weight * logDet( merged.covariance ) -
+                              kept[i].weight * logDet( kept[i].covariance ) -
+                              kept[j].weight * logDet( kept[j].covariance ) );
+        if ( cost < cheapest )
+        {
+          cheapest = cost;
+          first = i;
+          second = j;
+        }
+      }
+    }
+    if ( ( cheapest >= m_mergeCost ) &&
+         ( (int) kept.size() <= m_maxComponents ) )
+    {
+      break;
+    }
+    kept[ first ] = merge( kept[ first ], kept[ second ] );
+    kept.erase( kept.begin() + second );
+  }
+  m_components.swap( kept );
+}
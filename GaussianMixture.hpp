@@ -0,0 +1,128 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    GaussianMixture.hpp
+/// @brief   Gaussian mixture propagation of state uncertainty.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_GAUSSIANMIXTURE_HEADER_GUARD
+#define EKF_GAUSSIANMIXTURE_HEADER_GUARD
+
+// C++ Standard Library
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <Action.hpp>
+#include <Motion.hpp>
+
+/// @brief A weighted Gaussian of a GaussianMixture, with the Motion that
+/// last propagated its mean.
+///
+struct MixtureComponent
+{
+  double weight;
+  Eigen::VectorXd mean;
+  Eigen::MatrixXd covariance;
+  std::shared_ptr< Motion > motion;
+};
+
+/// @brief Propagate state uncertainty as a mixture of Gaussians.
+///
+/// Over a long gap a single covariance mapped through the STM no longer
+/// describes the spread ( it stays an ellipsoid while the samples bend
+/// along track ). A mixture keeps each component small enough for its
+/// own STM to hold:
+///   - Each propagate() integrates every component mean with its own
+///     Motion from the current time, in parallel, and maps its
+///     covariance with that Motion's STM. The Motions share the Action
+///     objects, so the force models exist once.
+///   - Before committing, each component is tested for nonlinearity
+///     along its principal axes: the ends of every 1 sigma axis are
+///     integrated too, and the curvature of the mapping is the
+///     distance of their midpoint from the propagated mean, relative
+///     to the axis as propagated by the STM. A component above the
+///     threshold is split in three along its most nonlinear axis ( the
+///     univariate split of Huber et al., weights 0.2252, 0.5496,
+///     0.2252 at -1.0575, 0, 1.0575 sigma, with sigma widened from
+///     0.6715 to 0.7044 so the split keeps the variance ) and the
+///     children tested in turn.
+///   - update() applies a position measurement to every component and
+///     reweights them by its likelihood. Components below the weight
+///     floor are pruned, and pairs are merged, least costly first by
+///     Runnalls' bound, while the cost is below the merge threshold
+///     or there are more components than the budget.
+/// Splitting stops at the budget: the number of components ( CPU ) and
+/// the estimated size of their Motion logs ( memory ).
+///
+/// The mixture is over the six element state, in meters and seconds.
+/// Actions that need more active agents than the state are not
+/// supported.
+///
+class GaussianMixture
+{
+ public:
+  GaussianMixture();
+  GaussianMixture( const std::vector< std::shared_ptr< Action > > &actions,
+                   const Eigen::VectorXd &mean,
+                   const Eigen::MatrixXd &covariance,
+                   double epoch, double step );
+ ~GaussianMixture();
+
+  // Cap the components at maxComponents and their logs at about
+  // maxBytes ( defaults 16 and 64 MB )
+  void setBudget( int maxComponents, std::size_t maxBytes );
+  // Split components whose nonlinearity passes threshold ( default
+  // 0.005 ), or never with 0
+  void setSplitting( double threshold );
+  // Prune components below minWeight ( default 1e-4 ) and merge pairs
+  // costing less than mergeCost ( default 0.01 )
+  void setReduction( double minWeight, double mergeCost );
+  // Propagate components on numThreads threads ( 0, the default, means
+  // one per core )
+  void setThreads( unsigned int numThreads );
+
+  // Propagate every component to time t, on the step grid or not and no
+  // earlier than the mixture time, splitting as needed
+  void propagate( double t );
+  // Apply a position measurement with noise covariance, then prune and
+  // merge
+  void update( const Eigen::Vector3d &position,
+               const Eigen::Matrix3d &noise );
+
+  // Current time
+  double getTime() const;
+  // Components, and their number
+  int getNumComponents() const;
+  const MixtureComponent& getComponent( int k ) const;
+  // Moments of the whole mixture
+  Eigen::VectorXd getMean() const;
+  Eigen::MatrixXd getCovariance() const;
+  // Estimated size of the component Motion logs
+  std::size_t getBytes() const;
+
+ private:
+  std::vector< std::shared_ptr< Action > > m_actions;
+  std::vector< MixtureComponent > m_components;
+  double m_time;
+  double m_step;
+  int m_maxComponents;
+  std::size_t m_maxBytes;
+  double m_splitThreshold;
+  double m_minWeight;
+  double m_mergeCost;
+  unsigned int m_numThreads;
+
+  std::shared_ptr< Motion > propagateState( const Eigen::VectorXd &state,
+                                            double t ) const;
+  void reduce();
+};
+
+#endif // EKF_GAUSSIANMIXTURE_HEADER_GUARD
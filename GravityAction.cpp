@@ -11,10 +11,35 @@
 // C++ Standard Library
 #include <iostream>
 #include <cmath>
+#include <memory>
 
 // ekf Library
 #include <GravityAction.hpp>
 
+// Owned agent indices
+namespace
+{
+  enum { iX, iY, iZ, idX, idY, idZ, iRadius, iMu, iJ2, numOwned };
+
+  // Owned partials evalPartials computes, as ( row, column ) indices
+  const int partialPattern[][2] = {
+    { idX, iX }, { idX, iY }, { idX, iZ },
+    { idY, iX }, { idY, iY }, { idY, iZ },
+    { idZ, iX }, { idZ, iY }, { idZ, iZ } };
+  const int numPattern = sizeof( partialPattern ) / sizeof( partialPattern[0] );
+
+  // Registry IDs of the owned agents under their default names, shared by
+  // every instance until it is given its own ( setParameterNames )
+  std::shared_ptr< const std::vector< int > >
+  defaultIds()
+  {
+    static std::shared_ptr< const std::vector< int > > ids(
+      new std::vector< int >( AgentGroup::intern(
+        { "X", "Y", "Z", "dX", "dY", "dZ", "radius", "mu", "J2" } ) ) );
+    return ids;
+  }
+}
+
 //=====================================================================
 //=====================================================================
 // CONSTRUCTORS / DESCTRUCTOR
@@ -26,7 +51,8 @@ GravityAction()
       m_radius(),
       m_mu(),
       m_J2(),
-      m_evaledPartials()
+      m_ownedIds( defaultIds() ),
+      m_bound()
 {
 }
 
@@ -41,7 +67,8 @@ GravityAction(
       m_radius( radius ),
       m_mu( mu ),
       m_J2( J2 ),
-      m_evaledPartials()
+      m_ownedIds( defaultIds() ),
+      m_bound()
 {
 }
 
@@ -63,11 +90,47 @@ getAcceleration(
     std::vector< double > &acceleration,
     const std::vector< double > &state ) const
 {
-  double dist = sqrt( pow( state[0], 2 ) + pow( state[1], 2 ) +
-                pow( state[2], 2 ) );
-  acceleration[0] += -m_mu * state[0] / pow( dist, 3 ) * accJ2( state, 'x' );
-  acceleration[1] += -m_mu * state[1] / pow( dist, 3 ) * accJ2( state, 'y' );
-  acceleration[2] += -m_mu * state[2] / pow( dist, 3 ) * accJ2( state, 'z' );
+  addAcceleration( acceleration, state );
+}
+
+// Computes the J2 perturbation alone, -mu r / |r|^3 times the J2 part
+// of accJ2 without its leading one.
+void
+GravityAction::
+getPerturbingAcceleration(
+    std::vector< double > &acceleration,
+    const std::vector< double > &state ) const
+{
+  double dist = std::sqrt( state[0] * state[0] + state[1] * state[1] +
+                           state[2] * state[2] );
+  double scale = getMu() / ( dist * dist * dist ) * 1.5 * getJ2() *
+                 std::pow( getRadius() / dist, 2 );
+  double zz = 5 * std::pow( state[2] / dist, 2 );
+  acceleration[0] += scale * state[0] * ( zz - 1 );
+  acceleration[1] += scale * state[1] * ( zz - 1 );
+  acceleration[2] += scale * state[2] * ( zz - 3 );
+}
+
+// Computes the acceleration in float, throughout
+void
+GravityAction::
+getScalarAcceleration(
+    std::vector< float > &acceleration,
+    const std::vector< float > &state,
+    double t ) const
+{
+  addAcceleration( acceleration, state );
+}
+
+// Computes the acceleration in long double, throughout
+void
+GravityAction::
+getScalarAcceleration(
+    std::vector< long double > &acceleration,
+    const std::vector< long double > &state,
+    double t ) const
+{
+  addAcceleration( acceleration, state );
 }
 
 // Computes the partial derivative of the acceleration terms and owned
@@ -77,57 +140,278 @@ GravityAction::
 getPartials(
     std::vector< double > &partials,
     const std::vector< double > &state,
-    const std::vector< std::string >  &activeAgents )
+    const AgentGroup &activeAgents )
 {
-  // Evaluate the class partial for this state
-  evalPartials( state );
+  // Evaluate the class partial for this state, by owned agent. The
+  // partials are kept local so several integrations may share this action
+  // concurrently.
+  double evaledPartials[ numOwned * numOwned ] = {};
+  evalPartials( state, evaledPartials );
 
-  // Loop over active agents and get partial values
+  // Place each owned partial at the STM rows of its agents, skipping
+  // agents that are not active
   int numAgents = activeAgents.size();
-  for ( int i = 0; i < numAgents; ++i )
+  int rows[ numOwned ];
+  for ( int k = 0; k < numOwned; ++k )
+  {
+    rows[k] = activeAgents.getRow( ( *m_ownedIds )[k] );
+  }
+  for ( int i = 0; i < numOwned; ++i )
   {
-    // Request the partial from the i loop with respect to all the active
-    // agents ( j loop )
-    for ( int j = 0; j < numAgents; ++j )
+    for ( int j = 0; j < numOwned; ++j )
     {
+      if ( ( rows[i] < 0 ) || ( rows[j] < 0 ) )
+      {
+        continue;
+      }
       if (m_debug)
       {
         std::cout << "\nGravityAction::getPartials()" << std::endl
-                  << "Requested Partials: " << activeAgents[i] <<  " wrt "
-                  << activeAgents[j] << std::endl
+                  << "Requested Partials: "
+                  << AgentGroup::getName( ( *m_ownedIds )[i] ) << " wrt "
+                  << AgentGroup::getName( ( *m_ownedIds )[j] ) << std::endl
                   << "Value of partials: "
-                  << getAgentPartial( activeAgents[i], activeAgents[j] );
+                  << evaledPartials[ i * numOwned + j ];
       }
-      partials[ i * numAgents + j ] += getAgentPartial( activeAgents[i],
-                                                        activeAgents[j] );
+      partials[ rows[i] * numAgents + rows[j] ] +=
+        evaledPartials[ i * numOwned + j ];
     }
   }
 }
 
+// The owned partials evalPartials computes, by agent ID
+bool
+GravityAction::
+getPartialPattern( std::vector< std::pair< int, int > > &pattern ) const
+{
+  pattern.clear();
+  for ( int p = 0; p < numPattern; ++p )
+  {
+    pattern.push_back(
+      std::make_pair( ( *m_ownedIds )[ partialPattern[p][0] ],
+                      ( *m_ownedIds )[ partialPattern[p][1] ] ) );
+  }
+  return true;
+}
+
+// Values of the partial pattern for this state
+void
+GravityAction::
+getPartialValues(
+    double *values,
+    const std::vector< double > &state ) const
+{
+  double evaledPartials[ numOwned * numOwned ] = {};
+  evalPartials( state, evaledPartials );
+  for ( int p = 0; p < numPattern; ++p )
+  {
+    values[p] =
+      evaledPartials[ partialPattern[p][0] * numOwned + partialPattern[p][1] ];
+  }
+}
+
+// Computes the order k Taylor coefficient of the central body and J2
+// acceleration by recursive differentiation of the same expressions
+// used in getAcceleration.
+bool
+GravityAction::
+getAccelerationJet(
+    std::vector< TaylorJet > &acceleration,
+    const std::vector< TaylorJet > &state,
+    int k,
+    TaylorWorkspace &workspace ) const
+{
+  // Constants, seeded where they are active agents
+  TaylorJet &one = workspace.next();
+  one.constant( k, 1 );
+  TaylorJet &three = workspace.next();
+  three.constant( k, 3 );
+  TaylorJet &mu = workspace.next();
+  mu.constant( k, getMu(), workspace.seed( ( *m_ownedIds )[ iMu ] ) );
+  TaylorJet &J2 = workspace.next();
+  J2.constant( k, getJ2(), workspace.seed( ( *m_ownedIds )[ iJ2 ] ) );
+  TaylorJet &R = workspace.next();
+  R.constant( k, getRadius(), workspace.seed( ( *m_ownedIds )[ iRadius ] ) );
+
+  // Distance terms r, 1 / r^2 and 1 / r^3
+  TaylorJet &XX = workspace.next();
+  XX.product( k, state[0], state[0] );
+  TaylorJet &YY = workspace.next();
+  YY.product( k, state[1], state[1] );
+  TaylorJet &ZZ = workspace.next();
+  ZZ.product( k, state[2], state[2] );
+  TaylorJet &XXYY = workspace.next();
+  XXYY.sum( k, XX, YY );
+  TaylorJet &r2 = workspace.next();
+  r2.sum( k, XXYY, ZZ );
+  TaylorJet &r = workspace.next();
+  r.squareRoot( k, r2 );
+  TaylorJet &inv_r2 = workspace.next();
+  inv_r2.quotient( k, one, r2 );
+  TaylorJet &inv_r3 = workspace.next();
+  inv_r3.quotient( k, inv_r2, r );
+
+  // J2 factors 1 - 1.5 J2 ( R / r )^2 ( 5 ( Z / r )^2 - 1 or 3 )
+  TaylorJet &RR = workspace.next();
+  RR.product( k, R, R );
+  TaylorJet &R_r2 = workspace.next();
+  R_r2.product( k, RR, inv_r2 );
+  TaylorJet &Z_r2 = workspace.next();
+  Z_r2.product( k, ZZ, inv_r2 );
+  TaylorJet &J2_R_r2 = workspace.next();
+  J2_R_r2.product( k, J2, R_r2 );
+  TaylorJet &five_Z_r2 = workspace.next();
+  five_Z_r2.scale( k, 5, Z_r2 );
+  TaylorJet &termXY = workspace.next();
+  termXY.difference( k, five_Z_r2, one );
+  TaylorJet &termZ = workspace.next();
+  termZ.difference( k, five_Z_r2, three );
+  TaylorJet &pertXY = workspace.next();
+  pertXY.product( k, J2_R_r2, termXY );
+  TaylorJet &pertZ = workspace.next();
+  pertZ.product( k, J2_R_r2, termZ );
+  TaylorJet &scaledXY = workspace.next();
+  scaledXY.scale( k, -1.5, pertXY );
+  TaylorJet &scaledZ = workspace.next();
+  scaledZ.scale( k, -1.5, pertZ );
+  TaylorJet &factorXY = workspace.next();
+  factorXY.sum( k, one, scaledXY );
+  TaylorJet &factorZ = workspace.next();
+  factorZ.sum( k, one, scaledZ );
+
+  // - mu / r^3 times the J2 factors
+  TaylorJet &mu_r3 = workspace.next();
+  mu_r3.product( k, mu, inv_r3 );
+  TaylorJet &prefixXY = workspace.next();
+  prefixXY.product( k, mu_r3, factorXY );
+  TaylorJet &prefixZ = workspace.next();
+  prefixZ.product( k, mu_r3, factorZ );
+
+  for ( int i = 0; i < 3; ++i )
+  {
+    TaylorJet &accel = workspace.next();
+    accel.product( k, ( i < 2 ) ? prefixXY : prefixZ, state[i] );
+    acceleration[i][k] -= accel[k];
+  }
+  return true;
+}
+
+// Body equatorial radius
+double
+GravityAction::
+getRadius() const
+{
+  return m_bound ? m_bound->getValue( ( *m_ownedIds )[ iRadius ] )
+                 : m_radius;
+}
+
+// Body GM
+double
+GravityAction::
+getMu() const
+{
+  return m_bound ? m_bound->getValue( ( *m_ownedIds )[ iMu ] ) : m_mu;
+}
+
+// Body J2 term
+double
+GravityAction::
+getJ2() const
+{
+  return m_bound ? m_bound->getValue( ( *m_ownedIds )[ iJ2 ] ) : m_J2;
+}
+
+// Radius, mu and J2
+bool
+GravityAction::
+getParameters( std::vector< double > &parameters ) const
+{
+  parameters = { getRadius(), getMu(), getJ2() };
+  return true;
+}
+
+// Read radius, mu and J2 from parameters, claiming their agents with the
+// current values
+void
+GravityAction::
+bindParameters( AgentGroup &parameters )
+{
+  const std::vector< int > &ids = *m_ownedIds;
+  parameters.bind( AgentGroup::getName( ids[ iRadius ] ), getRadius() );
+  parameters.bind( AgentGroup::getName( ids[ iMu ] ), getMu() );
+  parameters.bind( AgentGroup::getName( ids[ iJ2 ] ), getJ2() );
+  m_bound = &parameters;
+}
+
+// Agent names of radius, mu and J2 for this body
+void
+GravityAction::
+setParameterNames( const std::vector< std::string > &names )
+{
+  if ( ( (int) names.size() != numOwned - iRadius ) || m_bound )
+  {
+    std::cout << "GravityAction needs three parameter names, before binding"
+              << std::endl;
+    throw;
+  }
+  std::vector< int > ids( *m_ownedIds );
+  for ( int k = iRadius; k < numOwned; ++k )
+  {
+    ids[k] = AgentGroup::intern( names[ k - iRadius ] );
+  }
+  m_ownedIds.reset( new std::vector< int >( ids ) );
+}
+
 //=====================================================================
 //=====================================================================
 // PRIVATE MEMBERS
 
+// Central body and J2 acceleration in Scalar arithmetic
+template< typename Scalar >
+void
+GravityAction::
+addAcceleration(
+    std::vector< Scalar > &acceleration,
+    const std::vector< Scalar > &state ) const
+{
+  Scalar dist = std::sqrt( std::pow( state[0], Scalar( 2 ) ) +
+                           std::pow( state[1], Scalar( 2 ) ) +
+                           std::pow( state[2], Scalar( 2 ) ) );
+  Scalar mu = getMu();
+  acceleration[0] += -mu * state[0] / std::pow( dist, Scalar( 3 ) ) *
+                     accJ2( state, 'x' );
+  acceleration[1] += -mu * state[1] / std::pow( dist, Scalar( 3 ) ) *
+                     accJ2( state, 'y' );
+  acceleration[2] += -mu * state[2] / std::pow( dist, Scalar( 3 ) ) *
+                     accJ2( state, 'z' );
+}
+
 // Computes the J2 gravitational perturbation, by state component.
-double
+template< typename Scalar >
+Scalar
 GravityAction::
 accJ2(
-    const std::vector< double > &state,
+    const std::vector< Scalar > &state,
     const char component ) const
 {
-  double dist = sqrt( pow( state[0], 2 ) + pow( state[1], 2 ) +
-                      pow( state[2], 2 ) );
+  Scalar dist = std::sqrt( std::pow( state[0], Scalar( 2 ) ) +
+                           std::pow( state[1], Scalar( 2 ) ) +
+                           std::pow( state[2], Scalar( 2 ) ) );
+  Scalar J2 = getJ2();
+  Scalar radius = getRadius();
 
   // This function augments the two-body EOMs with a J2 term.
   if ( ( component == 'x' ) || ( component == 'y' ) )
   {
-    return ( 1.0 - 1.5 * m_J2 * pow( ( m_radius / dist ), 2.0 ) *
-           ( 5 * pow( ( state[2] / dist ), 2) - 1 ) );
+    return ( Scalar( 1 ) - Scalar( 1.5 ) * J2 *
+             std::pow( ( radius / dist ), Scalar( 2 ) ) *
+           ( 5 * std::pow( ( state[2] / dist ), Scalar( 2 ) ) - 1 ) );
   }
   else if ( component == 'z' )
   {
-    return ( 1.0 - 1.5 * m_J2 * pow( ( m_radius / dist ), 2 ) *
-           ( 5 * pow( ( state[2] / dist ), 2 ) - 3 ) );
+    return ( Scalar( 1 ) - Scalar( 1.5 ) * J2 *
+             std::pow( ( radius / dist ), Scalar( 2 ) ) *
+           ( 5 * std::pow( ( state[2] / dist ), Scalar( 2 ) ) - 3 ) );
   }
   else
   {
@@ -137,33 +421,18 @@ accJ2(
   }
 }
 
-double
-GravityAction::
-getAgentPartial(
-    const std::string &top,
-    const std::string &bottom )
-{
-  // Form param search string
-  std::string partialRequest = top + " wrt " + bottom;
-
-  if( m_evaledPartials.find( partialRequest ) == m_evaledPartials.end() )
-  {
-    // If requested partial is not supported by this action, return 0
-    return 0.0;
-  }
-  return m_evaledPartials[ partialRequest ];
-}
-
 void
 GravityAction::
-evalPartials( const std::vector< double > &state )
+evalPartials(
+    const std::vector< double > &state,
+    double *evaledPartials ) const
 {
   // Condense variable names to make following equations more legible
   double r = sqrt( pow( state[0], 2 ) + pow( state[1], 2 ) +
                    pow( state[2], 2 ) );
-  double R = m_radius;
-  double mu = m_mu;
-  double J2 = m_J2;
+  double R = getRadius();
+  double mu = getMu();
+  double J2 = getJ2();
   double X = state[0];
   double Y = state[1];
   double Z = state[2];
@@ -173,31 +442,31 @@ evalPartials( const std::vector< double > &state )
   double Z_r2 = pow( Z / r, 2 );
 
   // Partials of acceleration X component wrt state.
-  m_evaledPartials[ "dX wrt X" ] = (
+  evaledPartials[ idX * numOwned + iX ] = (
     - mu / r3 * ( 1 - ( 3 / 2 ) * J2 * R_r2 * ( 5 * Z_r2 - 1.) ) +
     3 * mu * pow( X, 2 ) / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 *
     ( 7 * Z_r2 - 1 ) ) );
-  m_evaledPartials[ "dX wrt Y" ] =
+  evaledPartials[ idX * numOwned + iY ] =
     3 * mu * X * Y / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 * ( 7 * Z_r2 - 1 ) );
-  m_evaledPartials[ "dX wrt Z" ] =
+  evaledPartials[ idX * numOwned + iZ ] =
     3 * mu * X * Z / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 * ( 7 * Z_r2 - 3 ) );
 
   // Partials of acceleration Y component wrt state.
-  m_evaledPartials[ "dY wrt X" ] =
+  evaledPartials[ idY * numOwned + iX ] =
     3 * mu * X * Y / r5 * ( 1 - ( 5  / 2 ) * J2 * R_r2 * ( 7 * Z_r2 - 1 ) );
-  m_evaledPartials[ "dY wrt Y" ] =
+  evaledPartials[ idY * numOwned + iY ] =
     ( - mu / r3 * ( 1 - ( 3 / 2 ) * J2 * R_r2 * ( 5 * Z_r2 - 1 ) ) +
     3 * mu * pow( Y, 2 ) / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 *
     ( 7 * Z_r2 - 1 ) ) );
-  m_evaledPartials[ "dY wrt Z" ] =
+  evaledPartials[ idY * numOwned + iZ ] =
     3 * mu * Y * Z / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 * ( 7 * Z_r2 - 3 ) );
 
   // Partials of acceleration Z component wrt state.
-  m_evaledPartials[ "dZ wrt X" ] =
+  evaledPartials[ idZ * numOwned + iX ] =
     3 * mu * X * Z / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 * ( 7 * Z_r2 - 3 ) );
-  m_evaledPartials[ "dZ wrt Y" ] =
+  evaledPartials[ idZ * numOwned + iY ] =
     3 * mu * Y * Z / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 * ( 7 * Z_r2 - 3 ) );
-  m_evaledPartials[ "dZ wrt Z" ] =
+  evaledPartials[ idZ * numOwned + iZ ] =
     ( - mu / r3 * ( 1 - ( 3 / 2 ) * J2 * R_r2 * ( 5 * Z_r2 - 3 ) ) +
     3 * mu * pow( Z, 2 ) / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 *
     ( 7 * Z_r2 - 5 ) ) );
@@ -13,9 +13,10 @@
 #define EKF_GRAVITYACTION_HEADER_GUARD
 
 // C++ Standard Library
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
-#include <map>
 
 // ekf Library
 #include <Action.hpp>
@@ -47,28 +48,69 @@ class GravityAction : public Action
   // passed in vector "acceleration".
   void getAcceleration( std::vector< double > &acceleration,
                         const std::vector< double > &state ) const override;
+  // Adds the acceleration beyond the point mass term, i.e. the J2
+  // perturbation alone, without cancelling it against the point mass
+  void getPerturbingAcceleration( std::vector< double > &acceleration,
+                                  const std::vector< double > &state ) const;
+  // The same in float and long double
+  void getScalarAcceleration( std::vector< float > &acceleration,
+                              const std::vector< float > &state,
+                              double t ) const override;
+  void getScalarAcceleration( std::vector< long double > &acceleration,
+                              const std::vector< long double > &state,
+                              double t ) const override;
 
   // Computes the partial derivative of the acceleration terms and
   // owned parameters
   void getPartials( std::vector< double > &partials,
                     const std::vector< double > &state,
-                    const std::vector< std::string >  &activeAgents ) override;
+                    const AgentGroup &activeAgents ) override;
+
+  // The acceleration partials wrt position, and their values
+  bool getPartialPattern(
+    std::vector< std::pair< int, int > > &pattern ) const override;
+  void getPartialValues( double *values,
+                         const std::vector< double > &state ) const override;
+
+  // Computes the order k Taylor coefficient of the acceleration, with
+  // gradients wrt the state and any active radius, mu and J2 agents
+  bool getAccelerationJet( std::vector< TaylorJet > &acceleration,
+                           const std::vector< TaylorJet > &state,
+                           int k, TaylorWorkspace &workspace ) const override;
+
+  // Reads radius, mu and J2 from parameters from now on
+  void bindParameters( AgentGroup &parameters ) override;
+  // Agent names of radius, mu and J2 for this body ( "radius", "mu" and
+  // "J2" by default )
+  void setParameterNames( const std::vector< std::string > &names ) override;
+
+  // Radius, mu and J2
+  bool getParameters( std::vector< double > &parameters ) const override;
+
+  // Body constants, bound or own
+  double getRadius() const;
+  double getMu() const;
+  double getJ2() const;
  private:
   std::string m_name;
   double m_radius;
   double m_mu;
   double m_J2;
-  /// @todo need some way of identifying radius, mu, J2 for a
-  /// particular gravitational body
-  std::vector< std::string > m_agentsOwned = { "X", "Y", "Z", "dX", "dY", "dZ",
-                                               "radius", "mu", "J2" };
-  std::map< std::string, double > m_evaledPartials;
+  // Registry IDs of the owned agents, state first, then radius, mu and
+  // J2; shared with every instance under the default names
+  std::shared_ptr< const std::vector< int > > m_ownedIds;
+  // Parameter values bound by bindParameters, or null
+  const AgentGroup* m_bound;
 
-  double accJ2( const std::vector< double > &state,
+  template< typename Scalar >
+  void addAcceleration( std::vector< Scalar > &acceleration,
+                        const std::vector< Scalar > &state ) const;
+  template< typename Scalar >
+  Scalar accJ2( const std::vector< Scalar > &state,
                 const char component ) const;
 
-  double getAgentPartial( const std::string &top, const std::string &bottom );
-  void evalPartials( const std::vector< double > &state );
+  void evalPartials( const std::vector< double > &state,
+                     double *evaledPartials ) const;
 };
 
 #endif // EKF_GRAVITYACTION_HEADER_GUARD
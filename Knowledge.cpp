@@ -1,15 +1,33 @@
 
+#include <iostream>
+
 #include <Knowledge.hpp>
 
 //=============================================================================  
 //=============================================================================  
 // CONSTRUCTORS / DESCTRUCTOR   
 
-// Default Constructor
+// Default Constructor, over the state
 Knowledge::
 Knowledge()
-   : m_agentCovariance() 
+   : m_agents( { "X", "Y", "Z", "dX", "dY", "dZ" } ),
+     m_numEstimated( 6 ),
+     m_agentCovariance()
+{
+}
+
+// Constructor over agents, in their order
+Knowledge::
+Knowledge( const AgentGroup &agents )
+   : m_agents( agents ),
+     m_numEstimated( agents.size() ),
+     m_agentCovariance()
 {
+   if ( ( agents.size() < 6 ) || ( agents.getNames()[0] != "X" ) )
+   {
+      std::cout << "Knowledge agents must begin with the state" << std::endl;
+      throw;
+   }
 }
 
 Knowledge::
@@ -26,6 +44,123 @@ step( double t )
 
 }
 
+AgentGroup&
+Knowledge::
+getAgents()
+{
+   return m_agents;
+}
+
+int
+Knowledge::
+getNumEstimated() const
+{
+   return m_numEstimated;
+}
+
+// Correct the estimates, the state and the parameters bound Actions read.
+void
+Knowledge::
+update( const Eigen::VectorXd &correction )
+{
+   if ( correction.size() != m_numEstimated )
+   {
+      std::cout << "Correction of size " << correction.size() << " for "
+                << m_numEstimated << " estimated agents" << std::endl;
+      throw;
+   }
+   m_agents.update( correction );
+}
+
+void
+Knowledge::
+setState( const std::vector< double > &state )
+{
+   if ( state.size() != 6 )
+   {
+      std::cout << "State of " << state.size() << " components" << std::endl;
+      throw;
+   }
+   m_agents.setValues( state );
+}
+
+std::vector< double >
+Knowledge::
+getState() const
+{
+   const std::vector< double > &values = m_agents.getValues();
+   return std::vector< double >( values.begin(), values.begin() + 6 );
+}
+
+void
+Knowledge::
+setCovariance( const Eigen::MatrixXd &covariance )
+{
+   if ( ( covariance.rows() != m_numEstimated ) ||
+        ( covariance.cols() != m_numEstimated ) )
+   {
+      std::cout << "Covariance of " << covariance.rows() << " x "
+                << covariance.cols() << " for " << m_numEstimated
+                << " agents" << std::endl;
+      throw;
+   }
+   m_agentCovariance = covariance;
+}
+
+const Eigen::MatrixXd&
+Knowledge::
+getCovariance() const
+{
+   return m_agentCovariance;
+}
+
+// P( t ) = Phi P( t0 ) Phi^T
+Eigen::MatrixXd
+Knowledge::
+predictCovariance( const std::vector< double > &partials ) const
+{
+   int numAgents = m_agentCovariance.rows();
+   if ( (int) partials.size() != numAgents * numAgents )
+   {
+      std::cout << "STM of " << partials.size() << " partials for a "
+                << numAgents << " agent covariance" << std::endl;
+      throw;
+   }
+   Eigen::Map< const Eigen::Matrix< double, Eigen::Dynamic, Eigen::Dynamic,
+                                    Eigen::RowMajor > >
+      stm( partials.data(), numAgents, numAgents );
+   return stm * m_agentCovariance * stm.transpose();
+}
+
+// K = P H^T ( H P H^T + R )^-1, and the Joseph form
+// P = ( I - K H ) P ( I - K H )^T + K R K^T, which stays symmetric
+// positive definite under roundoff
+Eigen::VectorXd
+Knowledge::
+measurementUpdate( const Eigen::VectorXd &residual,
+                   const Eigen::MatrixXd &partials,
+                   const Eigen::MatrixXd &noise )
+{
+   int numAgents = m_agentCovariance.rows();
+   if ( partials.cols() != numAgents || partials.rows() != residual.size() )
+   {
+      std::cout << "Measurement partials of " << partials.rows() << " x "
+                << partials.cols() << " for " << residual.size()
+                << " residuals and " << numAgents << " agents" << std::endl;
+      throw;
+   }
+   Eigen::MatrixXd ph = m_agentCovariance * partials.transpose();
+   Eigen::MatrixXd innovation = partials * ph + noise;
+   Eigen::MatrixXd gain =
+      innovation.ldlt().solve( ph.transpose() ).transpose();
+
+   Eigen::MatrixXd reduction =
+      Eigen::MatrixXd::Identity( numAgents, numAgents ) - gain * partials;
+   m_agentCovariance = reduction * m_agentCovariance * reduction.transpose() +
+                       gain * noise * gain.transpose();
+   return gain * residual;
+}
+
 //=============================================================================  
 //=============================================================================  
 // PRIVATE MEMBERS      
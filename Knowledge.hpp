@@ -1,21 +1,65 @@
+#ifndef EKF_KNOWLEDGE_INCLUDE_
+#define EKF_KNOWLEDGE_INCLUDE_
 
+#include <vector>
 #include <Eigen/Dense>
 #include <AgentGroup.hpp>
 
 class Knowledge
 {
+   /*
+   Knowledge holds the estimated agents and their covariance. Actions
+   bound to getAgents() read the estimates directly, so update() corrects
+   the next propagation in place.
 
+   The estimated agents are those of the Motion ( its active agents ),
+   in its STM row order, which the covariance, the measurement partials
+   and the corrections all share. The first six are the state, whose
+   estimate is set from the Motion and restarts it after an update.
+   Constants of bound Actions that are not active follow them in the
+   group, held but not estimated.
+   */
    public:
+      // Knowledge of the state alone, as a default Motion tracks it
       Knowledge();
+      // Knowledge of agents, a Motion's active agents
+      Knowledge( const AgentGroup &agents );
       ~Knowledge();
 
       void step( double t );
 
+      // The agents, to bind Actions to
+      AgentGroup& getAgents();
+      // Number of estimated agents, leading the group
+      int getNumEstimated() const;
+      // Add a filter correction, in agent row order, to the estimates
+      void update( const Eigen::VectorXd &correction );
+      // The state estimate, the first six agents
+      void setState( const std::vector< double > &state );
+      std::vector< double > getState() const;
+
+      // Covariance at the epoch of the STM, over the estimated agents
+      void setCovariance( const Eigen::MatrixXd &covariance );
+      const Eigen::MatrixXd& getCovariance() const;
+      // Covariance mapped through partials, a row major STM
+      // ( Motion::getStatePartials )
+      Eigen::MatrixXd predictCovariance(
+         const std::vector< double > &partials ) const;
+      // Kalman update of the covariance by a measurement residual, with
+      // its partials wrt the agents and its noise covariance, returning
+      // the correction
+      Eigen::VectorXd measurementUpdate( const Eigen::VectorXd &residual,
+                                         const Eigen::MatrixXd &partials,
+                                         const Eigen::MatrixXd &noise );
+
    private:
 
       AgentGroup m_agents;
+      int m_numEstimated;
       Eigen::MatrixXd m_agentCovariance;
       
 
 
 };
+
+#endif // Include guard
@@ -0,0 +1,125 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ManeuverAction.cpp
+/// @brief   Computes state accelerations due to a finite burn with
+///          constant inertial thrust acceleration.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// ekf Library
+#include <ManeuverAction.hpp>
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+ManeuverAction::
+ManeuverAction()
+    : m_name(),
+      m_start(),
+      m_duration(),
+      m_acceleration( 3, 0.0 )
+{
+}
+
+// Constructor for a burn starting at start, lasting duration, with the
+// inertial acceleration acceleration
+ManeuverAction::
+ManeuverAction(
+    const std::string name,
+    double start,
+    double duration,
+    const std::vector< double > &acceleration )
+    : m_name( name ),
+      m_start( start ),
+      m_duration( duration ),
+      m_acceleration( acceleration )
+{
+}
+
+// Default Destructor
+ManeuverAction::
+~ManeuverAction()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Without a time the burn cannot be placed, so it adds nothing
+void
+ManeuverAction::
+getAcceleration(
+    std::vector< double > &acceleration,
+    const std::vector< double > &state ) const
+{
+}
+
+// Computes the acceleration due to the burn, if it is on at time t. The
+// burn is on over [ start, start + duration ).
+void
+ManeuverAction::
+getAccelerationAtTime(
+    std::vector< double > &acceleration,
+    const std::vector< double > &state,
+    double t ) const
+{
+  if ( ( t >= m_start ) && ( t < m_start + m_duration ) )
+  {
+    acceleration[0] += m_acceleration[0];
+    acceleration[1] += m_acceleration[1];
+    acceleration[2] += m_acceleration[2];
+  }
+}
+
+// The burn acceleration does not depend on the state
+void
+ManeuverAction::
+getPartials(
+    std::vector< double > &partials,
+    const std::vector< double > &state,
+    const AgentGroup &activeAgents )
+{
+}
+
+// An empty pattern
+bool
+ManeuverAction::
+getPartialPattern( std::vector< std::pair< int, int > > &pattern ) const
+{
+  pattern.clear();
+  return true;
+}
+
+// Start, duration and acceleration
+bool
+ManeuverAction::
+getParameters( std::vector< double > &parameters ) const
+{
+  parameters = { m_start, m_duration };
+  parameters.insert( parameters.end(), m_acceleration.begin(),
+                     m_acceleration.end() );
+  return true;
+}
+
+// Burn start and end, where they fall in ( t0, t1 ]
+std::vector< double >
+ManeuverAction::
+getSwitchTimes(
+    double t0,
+    double t1 ) const
+{
+  std::vector< double > times;
+  for ( double t: { m_start, m_start + m_duration } )
+  {
+    if ( ( t > t0 ) && ( t <= t1 ) )
+    {
+      times.push_back( t );
+    }
+  }
+  return times;
+}
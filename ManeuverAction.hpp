@@ -0,0 +1,76 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ManeuverAction.hpp
+/// @brief   Computes state accelerations due to a finite burn with
+///          constant inertial thrust acceleration.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_MANEUVERACTION_HEADER_GUARD
+#define EKF_MANEUVERACTION_HEADER_GUARD
+
+// C++ Standard Library
+#include <map>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+
+/// @brief Compute state accelerations due to a finite burn.
+///
+/// The burn applies a constant acceleration, fixed in the inertial
+/// frame, from its start time for its duration. The acceleration is
+/// discontinuous at both ends, so the burn declares them as switch
+/// times and Motion integrates each side as its own segment. The burn
+/// is known in time only; getAcceleration() without a time adds
+/// nothing.
+///
+/// The acceleration does not depend on the state, so the burn adds no
+/// state partials.
+///
+class ManeuverAction : public Action
+{
+ public:
+  ManeuverAction();
+  ManeuverAction( const std::string name, double start, double duration,
+                  const std::vector< double > &acceleration );
+
+ ~ManeuverAction() override;
+
+  // Adds nothing, the burn needs the time
+  void getAcceleration( std::vector< double > &acceleration,
+                        const std::vector< double > &state ) const override;
+
+  // Computes the acceleration due to this action at time t and adds it
+  // to the passed in vector "acceleration".
+  void getAccelerationAtTime( std::vector< double > &acceleration,
+                              const std::vector< double > &state,
+                              double t ) const override;
+
+  // Computes the partial derivative of the acceleration terms and
+  // owned parameters ( none )
+  void getPartials( std::vector< double > &partials,
+                    const std::vector< double > &state,
+                    const AgentGroup &activeAgents ) override;
+  // No partials, so none to evaluate
+  bool getPartialPattern(
+    std::vector< std::pair< int, int > > &pattern ) const override;
+
+  // Start, duration and acceleration
+  bool getParameters( std::vector< double > &parameters ) const override;
+
+  // Burn start and end, where they fall in ( t0, t1 ]
+  std::vector< double > getSwitchTimes( double t0, double t1 ) const override;
+
+ private:
+  std::string m_name;
+  double m_start;
+  double m_duration;
+  std::vector< double > m_acceleration;
+};
+
+#endif // EKF_MANEUVERACTION_HEADER_GUARD
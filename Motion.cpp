@@ -8,7 +8,11 @@
 ///
 
 // C++ Standard Library
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <sstream>
+#include <typeinfo>
 
 // boost Library
 #include <boost/numeric/odeint.hpp>
@@ -16,25 +20,6 @@
 // ekf Library
 #include <Motion.hpp>
 
-//=====================================================================
-//=====================================================================
-// This struct is used to "observe" the integrator and log states.
-struct log_state
-{
-  std::map< double, std::vector< double > >* m_pastStates;
-
-  // Constructor
-  log_state(  std::map< double, std::vector< double > >& pastStates )
-      : m_pastStates( &pastStates ) { }
-
-  // Takes in state and time from odeint integrate function and logs
-  // them in the m_pastStates map.
-  void operator()( const std::vector< double >& x, double t )
-  {
-    m_pastStates->insert( std::pair<double, std::vector< double > >(t,x) );
-  }
-};
-
 //=====================================================================
 //=====================================================================
 // CONSTRUCTORS / DESCTRUCTOR
@@ -49,7 +34,15 @@ Motion()
       m_step(),
       m_actions(),
       m_helper( m_actions, m_activeAgents ),
-      m_pastStates()
+      m_pastStates(),
+      m_propagator(),
+      m_segmenting( true ),
+      m_report(),
+      m_events(),
+      m_eventRecords(),
+      m_cache(),
+      m_mixed( false ),
+      m_pastPartials()
 {
 }
 
@@ -65,7 +58,41 @@ Motion(
       m_step( step ),
       m_actions(),
       m_helper( m_actions, m_activeAgents ),
-      m_pastStates()
+      m_pastStates(),
+      m_propagator(),
+      m_segmenting( true ),
+      m_report(),
+      m_events(),
+      m_eventRecords(),
+      m_cache(),
+      m_mixed( false ),
+      m_pastPartials()
+{
+  initializePartials( m_activeAgents );
+}
+
+// Constructor with set of initial conditions at epoch
+Motion::
+Motion(
+    const std::vector< double >& ic,
+    double step,
+    double epoch )
+    : m_time( epoch ),
+      m_state( ic ),
+      m_partials(),
+      m_activeAgents( { "X", "Y", "Z", "dX", "dY", "dZ" } ),
+      m_step( step ),
+      m_actions(),
+      m_helper( m_actions, m_activeAgents ),
+      m_pastStates(),
+      m_propagator(),
+      m_segmenting( true ),
+      m_report(),
+      m_events(),
+      m_eventRecords(),
+      m_cache(),
+      m_mixed( false ),
+      m_pastPartials()
 {
   initializePartials( m_activeAgents );
 }
@@ -84,21 +111,90 @@ Motion::
 addAction( std::shared_ptr< Action > a )
 {
   m_actions.push_back( a );
-  m_helper.howManyActions();
+  m_helper.preparePartials();
 }
 
-// Activate partials tracking for named agents
+// Activate partials tracking for named agents. Partials already tracked
+// are kept, so agents can be added mid-arc without re-integrating it.
 void
 Motion::
 activateAgents( const std::vector< std::string > agentNames )
 {
-  for ( std::string a: agentNames )
+  int oldAgents = m_activeAgents.size();
+  m_activeAgents.add( agentNames );
+
+  // Extend the partials to make room for new agents, or start them if
+  // they were never set up
+  if ( (int) m_partials.size() == oldAgents * oldAgents )
   {
-    m_activeAgents.push_back( a );
+    extendPartials( oldAgents );
+  }
+  else
+  {
+    initializePartials( m_activeAgents );
   }
 
-  // Re-initialize the partials to make room for new agents
-  initializePartials( m_activeAgents );
+  // Work out the partials the actions contribute over the new agents
+  m_helper.preparePartials();
+}
+
+// Replace the default dopri5 integration with another propagator, or
+// restore it by passing an empty pointer
+void
+Motion::
+setPropagator( std::shared_ptr< Propagator > propagator )
+{
+  m_propagator = propagator;
+}
+
+// Evaluate the Actions of the default integration on a persistent team
+// of threads, or in turn. The team spins, so it is kept within the
+// cores there are.
+void
+Motion::
+setActionThreads( unsigned int numThreads )
+{
+  numThreads = std::min( resolveThreads( numThreads ), resolveThreads( 0 ) );
+  std::shared_ptr< ThreadTeam > team;
+  if ( numThreads > 1 )
+  {
+    team.reset( new ThreadTeam( numThreads ) );
+  }
+  m_helper.setTeam( team );
+}
+
+// Split integration at Action switches, or step straight through them
+// ( to compare against )
+void
+Motion::
+setSegmenting( bool segmenting )
+{
+  m_segmenting = segmenting;
+}
+
+// Locate the roots of event during integration, from the next stepTo
+void
+Motion::
+addEvent( std::shared_ptr< Event > event )
+{
+  m_events.push_back( event );
+}
+
+// Look stepTo up in cache first, and store what is integrated ( an
+// empty pointer stops caching )
+void
+Motion::
+setCache( std::shared_ptr< PropagationCache > cache )
+{
+  m_cache = cache;
+}
+
+// Carry the STM in float from the next stepTo, or back in double
+void
+Motion::
+setMixedPrecision( bool mixed )
+{
+  m_mixed = mixed;
 }
 
 // Step the integration of Motion object to time t
@@ -122,10 +218,73 @@ stepTo( double t )
 
   typedef runge_kutta_dopri5< std::vector< double > > rkStepper;
 
+  // Serve a repeated arc from the cache
+  std::string structure;
+  std::vector< double > values;
+  bool cached = m_cache && !m_mixed && m_events.empty() &&
+                cacheKey( stateAndPartials, t, structure, values );
+  std::map< double, std::vector< double > > visitedStates;
+  bool hit = cached && m_cache->find( structure, values, visitedStates );
+  if ( hit )
+  {
+    m_report = StepReport();
+    m_pastStates.insert( visitedStates.begin(), visitedStates.end() );
+    stateAndPartials = visitedStates.rbegin()->second;
+  }
   // Integrate from current time to time t
-  integrate_const( make_controlled( 1.E-10, 1.E-9, rkStepper() ),
-                   m_helper, stateAndPartials, m_time, t, m_step,
-                   log_state( m_pastStates ) );
+  else if ( m_propagator )
+  {
+    // A propagator integrates straight through, with no event, switch or
+    // mixed precision handling
+    if ( !m_events.empty() || m_mixed ||
+         hasSwitches( stateAndPartials, t ) )
+    {
+      std::cout << "A Propagator cannot locate events or switches, or "
+                << "carry a mixed precision STM." << std::endl;
+      throw;
+    }
+    visitedStates =
+      m_propagator->propagate( m_actions, stateAndPartials, m_activeAgents,
+                               m_time, t, m_step );
+    m_pastStates.insert( visitedStates.begin(), visitedStates.end() );
+    stateAndPartials = visitedStates.rbegin()->second;
+  }
+  else if ( !m_events.empty() || hasSwitches( stateAndPartials, t ) )
+  {
+    integrateSegments( stateAndPartials, t );
+  }
+  else if ( m_mixed )
+  {
+    integrateMixed( stateAndPartials, t );
+  }
+  else
+  {
+    m_report = StepReport();
+    integrate_const( make_controlled( 1.E-10, 1.E-9, rkStepper() ),
+                     m_helper, stateAndPartials, m_time, t, m_step,
+                     log_state( m_pastStates ) );
+
+    // integrate_const stops at the last output time before t, so an
+    // epoch off the grid is reached by one shorter interval
+    double last = m_pastStates.rbegin()->first;
+    if ( last < t )
+    {
+      integrate_adaptive( make_controlled( 1.E-10, 1.E-9, rkStepper() ),
+                          m_helper, stateAndPartials, last, t, t - last );
+      m_pastStates[t] = stateAndPartials;
+    }
+  }
+
+  // Keep an integrated arc for next time
+  if ( cached && !hit )
+  {
+    if ( !m_propagator )
+    {
+      visitedStates.insert( m_pastStates.lower_bound( m_time ),
+                            m_pastStates.upper_bound( t ) );
+    }
+    m_cache->insert( structure, values, visitedStates );
+  }
 
   // Update state, partials, and time
   for ( int i = 0; i < 6 ; ++i )
@@ -139,6 +298,28 @@ stepTo( double t )
   m_time = t;
 }
 
+// Restart from a corrected state. The STM starts over at the current
+// time, which is logged so it can be read back like any stepTo, and the
+// events of the dropped arc are forgotten.
+void
+Motion::
+restart( const std::vector< double > &state )
+{
+  for ( int i = 0; i < 6 ; ++i )
+  {
+    m_state[i] = state[i];
+  }
+  initializePartials( m_activeAgents );
+  m_pastStates.clear();
+  m_pastPartials.clear();
+  m_eventRecords.clear();
+
+  std::vector< double > stateAndPartials( m_state );
+  stateAndPartials.insert( stateAndPartials.end(), m_partials.begin(),
+                           m_partials.end() );
+  m_pastStates[ m_time ] = stateAndPartials;
+}
+
 // Return the current time step.
 double
 Motion::
@@ -147,6 +328,14 @@ getTime() const
   return m_time;
 }
 
+// Return the active agents, the state first, in STM row order.
+const AgentGroup&
+Motion::
+getActiveAgents() const
+{
+  return m_activeAgents;
+}
+
 // Return the state of the motion at  time step.
 std::vector< double >
 Motion::
@@ -181,6 +370,12 @@ getStatePartials( double t ) const
     std::vector< double > stateAndPartials = search->second;
     std::vector< double > partials( stateAndPartials.begin() + 6,
                                stateAndPartials.end() );
+    std::map< double, std::vector< float > >::const_iterator single =
+      m_pastPartials.find( t );
+    if ( partials.empty() && ( single != m_pastPartials.end() ) )
+    {
+      partials.assign( single->second.begin(), single->second.end() );
+    }
     return partials;
   }
   else
@@ -190,6 +385,59 @@ getStatePartials( double t ) const
   }
 }
 
+// Return the step counts of the last stepTo
+StepReport
+Motion::
+getStepReport() const
+{
+  return m_report;
+}
+
+// Return the estimated size of the logged states, from the vectors held
+// and the map nodes holding them ( as PropagationCache counts arcs )
+std::size_t
+Motion::
+getLogBytes() const
+{
+  std::size_t bytes = 0;
+  for ( const auto &s: m_pastStates )
+  {
+    bytes += 4 * sizeof( void* ) + sizeof( s ) +
+             s.second.size() * sizeof( double );
+  }
+  for ( const auto &s: m_pastPartials )
+  {
+    bytes += 4 * sizeof( void* ) + sizeof( s ) +
+             s.second.size() * sizeof( float );
+  }
+  return bytes;
+}
+
+// Return the events located so far, in time order
+std::vector< EventRecord >
+Motion::
+getEventRecords() const
+{
+  return m_eventRecords;
+}
+
+// Return the cached arc closest to what stepTo( t ) would integrate
+bool
+Motion::
+getNearestArc(
+    double t,
+    std::map< double, std::vector< double > > &states,
+    double &distance ) const
+{
+  std::vector< double > stateAndPartials( m_state );
+  stateAndPartials.insert( stateAndPartials.end(), m_partials.begin(),
+                           m_partials.end() );
+  std::string structure;
+  std::vector< double > values;
+  return m_cache && cacheKey( stateAndPartials, t, structure, values ) &&
+         m_cache->findNearest( structure, values, states, distance );
+}
+
 // Pretty print the state at time t ( must either be current time, or a
 // valid logged past time.
 void
@@ -201,6 +449,11 @@ printStateAndPartials( double t ) const
   if ( search != m_pastStates.end() )
   {
     std::vector< double > state = search->second;
+    if ( state.size() == 6 )
+    {
+      std::vector< double > partials = getStatePartials( t );
+      state.insert( state.end(), partials.begin(), partials.end() );
+    }
 
     std::cout << "\n### State at time " << t << std::endl
               << "X: " << setprecision(18) << state[0] << std::endl
@@ -245,7 +498,7 @@ printAllStates() const
 // PRIVATE MEMBERS
 void
 Motion::
-initializePartials( std::vector< std::string > &activeAgents )
+initializePartials( AgentGroup &activeAgents )
 {
   // Reset the partials vector to all zeros
   fill( m_partials.begin(), m_partials.end(), 0.0 );
@@ -258,3 +511,609 @@ initializePartials( std::vector< std::string > &activeAgents )
     m_partials[ numAgents * i + i ] = 1;
   }
 }
+
+// Grow the partials from oldAgents to the active agents in place. The
+// existing block is kept at its new stride, and each new agent starts
+// from the current time with a unit partial wrt itself and none wrt or
+// from any other agent.
+void
+Motion::
+extendPartials( int oldAgents )
+{
+  int numAgents = m_activeAgents.size();
+  m_partials.resize( numAgents * numAgents, 0.0 );
+
+  // Move entries last to first, so none is overwritten before it moves
+  for ( int i = oldAgents - 1; i >= 0; --i )
+  {
+    for ( int j = oldAgents - 1; j >= 0; --j )
+    {
+      double partial = m_partials[ oldAgents * i + j ];
+      m_partials[ oldAgents * i + j ] = 0.0;
+      m_partials[ numAgents * i + j ] = partial;
+    }
+  }
+  for ( int i = oldAgents; i < numAgents; ++i )
+  {
+    m_partials[ numAgents * i + i ] = 1;
+  }
+}
+
+// True if any Action declares a switch time up to t, or a switching
+// function
+bool
+Motion::
+hasSwitches(
+    const std::vector< double > &stateAndPartials,
+    double t ) const
+{
+  for ( auto ap: m_actions )
+  {
+    double value;
+    if ( !ap->getSwitchTimes( m_time, t ).empty() ||
+         ap->getSwitchFunction( value, stateAndPartials, m_time ) )
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Build the cache key of the arc from m_time to t: the structure names
+// the Action types, active agents and integrator, and the values hold the
+// initial state and STM, the span and every Action parameter. False if
+// an Action does not give its parameters.
+bool
+Motion::
+cacheKey(
+    const std::vector< double > &stateAndPartials,
+    double t,
+    std::string &structure,
+    std::vector< double > &values ) const
+{
+  std::ostringstream names;
+  values = stateAndPartials;
+  values.push_back( m_time );
+  values.push_back( t );
+  values.push_back( m_step );
+  for ( auto ap: m_actions )
+  {
+    std::vector< double > parameters;
+    if ( !ap->getParameters( parameters ) )
+    {
+      return false;
+    }
+    names << typeid( *ap ).name() << "(" << parameters.size() << ") ";
+    values.insert( values.end(), parameters.begin(), parameters.end() );
+  }
+  for ( const std::string &a: m_activeAgents.getNames() )
+  {
+    names << a << " ";
+  }
+  if ( m_propagator )
+  {
+    // A propagator's own settings are not known, so arcs are only shared
+    // by the same instance
+    names << typeid( *m_propagator ).name() << "@" << m_propagator.get();
+  }
+  else
+  {
+    names << "dopri5 " << m_segmenting;
+  }
+  structure = names.str();
+  return true;
+}
+
+// Integrate from m_time to t in segments ending at every switch time and
+// located switching event, logging on the m_step grid as integrate_const
+// would, and at t. With segmenting off, step straight through the
+// switches. The roots of any Events are located on every accepted step.
+void
+Motion::
+integrateSegments(
+    std::vector< double > &stateAndPartials,
+    double t )
+{
+  using namespace boost::numeric::odeint;
+
+  typedef runge_kutta_dopri5< std::vector< double > > rkStepper;
+
+  auto stepper = make_controlled( 1.E-10, 1.E-9, rkStepper() );
+  log_state observer( m_pastStates );
+  m_report = StepReport();
+
+  // Switch times, and the side of every switching function
+  int numActions = m_actions.size();
+  std::vector< double > switchTimes;
+  std::vector< int > sides( numActions, 0 );
+  if ( m_segmenting )
+  {
+    for ( int a = 0; a < numActions; ++a )
+    {
+      std::vector< double > times = m_actions[a]->getSwitchTimes( m_time, t );
+      switchTimes.insert( switchTimes.end(), times.begin(), times.end() );
+      double g;
+      if ( m_actions[a]->getSwitchFunction( g, stateAndPartials, m_time ) )
+      {
+        sides[a] = ( g < 0 ) ? -1 : 1;
+      }
+    }
+    std::sort( switchTimes.begin(), switchTimes.end() );
+    switchTimes.erase( std::unique( switchTimes.begin(), switchTimes.end() ),
+                       switchTimes.end() );
+  }
+
+  std::vector< double > &x = stateAndPartials;
+  std::vector< double > values( m_events.size() );
+  for ( size_t e = 0; e < m_events.size(); ++e )
+  {
+    values[e] = m_events[e]->getValue( x, m_time );
+  }
+
+  // The derivative is carried from step to step ( dopri5 is FSAL ), and
+  // with the previous state and derivative gives the dense output
+  std::vector< double > dxdt( x.size() );
+  std::vector< double > xPrev;
+  std::vector< double > dxdtPrev;
+  std::vector< double > xLeft;
+  std::vector< double > xRight;
+  bool restart = true;
+  size_t nextSwitch = 0;
+  double time = m_time;
+  double dt = m_step;
+  observer( x, time );
+
+  // Output times m_time + i * m_step up to t, as integrate_const, and t
+  // itself when it is off the grid
+  int numSteps = std::floor( ( t - m_time ) / m_step * ( 1 + 1.E-12 ) );
+  int numOutputs = numSteps + ( ( m_time + numSteps * m_step < t ) ? 1 : 0 );
+  for ( int i = 1; i <= numOutputs; ++i )
+  {
+    double tOut = std::min( m_time + i * m_step, t );
+    bool reached = false;
+    while ( !reached )
+    {
+      // Step towards the output time, stopping at a switch on the way
+      bool toSwitch = ( nextSwitch < switchTimes.size() ) &&
+                      ( switchTimes[nextSwitch] <= tOut );
+      double target = toSwitch ? switchTimes[nextSwitch] : tOut;
+      m_helper.setSegmentEnd( ( nextSwitch < switchTimes.size() ) ?
+        switchTimes[nextSwitch] : std::numeric_limits< double >::infinity() );
+      if ( restart )
+      {
+        m_helper( x, dxdt, time );
+        restart = false;
+      }
+
+      double h = std::min( dt, target - time );
+      bool last = ( h == target - time );
+      xPrev = x;
+      dxdtPrev = dxdt;
+      double tPrev = time;
+      if ( stepper.try_step( m_helper, x, dxdt, time, h ) == fail )
+      {
+        ++m_report.rejectedSteps;
+        dt = h;
+        continue;
+      }
+      ++m_report.acceptedSteps;
+      dt = last ? std::max( dt, h ) : h;
+
+      // Find the earliest switching event within the step, if any
+      int event = -1;
+      double tauBefore = 0.0;
+      double tauEvent = 0.0;
+      for ( int a = 0; a < numActions; ++a )
+      {
+        double g;
+        if ( ( sides[a] != 0 ) &&
+             m_actions[a]->getSwitchFunction( g, x, time ) &&
+             ( ( g < 0 ) ? -1 : 1 ) != sides[a] )
+        {
+          double tauLeft;
+          double tauRight;
+          std::vector< double > left;
+          std::vector< double > right;
+          locateSwitch( a, xPrev, tPrev, time - tPrev, tauLeft, left,
+                        tauRight, right );
+          if ( ( event < 0 ) || ( tauRight < tauEvent ) )
+          {
+            event = a;
+            tauBefore = tauLeft;
+            tauEvent = tauRight;
+            xLeft = left;
+            xRight = right;
+          }
+        }
+      }
+
+      // Restart just past the event, with the STM mapped across it. The
+      // step is cut short, so any Events before the switch are found on
+      // re-taken steps rather than on the dense output.
+      if ( event >= 0 )
+      {
+        x = xRight;
+        time = tPrev + tauEvent;
+        if ( !m_events.empty() )
+        {
+          rkStepper rk;
+          std::vector< double > dxdtTry( x.size() );
+          findEvents(
+            [&]( double tau, std::vector< double > &xOut )
+            {
+              rk.do_step( m_helper, xPrev, dxdtPrev, tPrev, xOut, dxdtTry,
+                          tau );
+            }, tPrev, tauEvent, x, time, values );
+        }
+        applySaltation( event, xLeft, tPrev + tauBefore, x, time );
+        sides[event] = -sides[event];
+        restart = true;
+        ++m_report.events;
+        ++m_report.segments;
+        continue;
+      }
+
+      if ( !m_events.empty() )
+      {
+        findEvents(
+          [&]( double tau, std::vector< double > &xOut )
+          {
+            stepper.stepper().calc_state( tPrev + tau, xOut, xPrev, dxdtPrev,
+                                          tPrev, x, dxdt, time );
+          }, tPrev, time - tPrev, x, time, values );
+      }
+
+      if ( last )
+      {
+        time = target;
+        if ( toSwitch )
+        {
+          // Apply any jumps and restart on the far side of the switch
+          for ( auto ap: m_actions )
+          {
+            ap->applySwitch( x, m_activeAgents, time );
+          }
+          while ( ( nextSwitch < switchTimes.size() ) &&
+                  ( switchTimes[nextSwitch] <= time ) )
+          {
+            ++nextSwitch;
+          }
+          for ( int a = 0; a < numActions; ++a )
+          {
+            double g;
+            if ( ( sides[a] != 0 ) &&
+                 m_actions[a]->getSwitchFunction( g, x, time ) )
+            {
+              sides[a] = ( g < 0 ) ? -1 : 1;
+            }
+          }
+          for ( size_t e = 0; e < m_events.size(); ++e )
+          {
+            values[e] = m_events[e]->getValue( x, time );
+          }
+          restart = true;
+          ++m_report.segments;
+        }
+        reached = ( target == tOut );
+      }
+    }
+    observer( x, tOut );
+  }
+  m_helper.setSegmentEnd( std::numeric_limits< double >::infinity() );
+}
+
+// Bracket the root of the switching function of action a within the step
+// of length h from ( xPrev, tPrev ) by the Illinois method. Each trial
+// re-takes a single dopri5 step from xPrev, so the state at the near end
+// of the bracket is integrated, not interpolated.
+void
+Motion::
+locateSwitch(
+    int action,
+    const std::vector< double > &xPrev,
+    double tPrev,
+    double h,
+    double &tauLeft,
+    std::vector< double > &xLeft,
+    double &tauRight,
+    std::vector< double > &xRight )
+{
+  using namespace boost::numeric::odeint;
+
+  runge_kutta_dopri5< std::vector< double > > stepper;
+  std::vector< double > dxdtPrev( xPrev.size() );
+  std::vector< double > dxdtTry( xPrev.size() );
+  std::vector< double > xTry( xPrev.size() );
+  m_helper( xPrev, dxdtPrev, tPrev );
+
+  tauLeft = 0.0;
+  xLeft = xPrev;
+  double gLeft;
+  m_actions[action]->getSwitchFunction( gLeft, xPrev, tPrev );
+  tauRight = h;
+  xRight.resize( xPrev.size() );
+  stepper.do_step( m_helper, xPrev, dxdtPrev, tPrev, xRight, dxdtTry, h );
+  double gRight;
+  m_actions[action]->getSwitchFunction( gRight, xRight, tPrev + h );
+
+  int kept = 0;
+  for ( int iter = 0; ( iter < 100 ) && ( tauRight - tauLeft > 1.E-7 );
+        ++iter )
+  {
+    double tau = ( tauLeft * gRight - tauRight * gLeft ) / ( gRight - gLeft );
+    if ( !( tau > tauLeft && tau < tauRight ) )
+    {
+      tau = 0.5 * ( tauLeft + tauRight );
+    }
+    stepper.do_step( m_helper, xPrev, dxdtPrev, tPrev, xTry, dxdtTry, tau );
+    double g;
+    m_actions[action]->getSwitchFunction( g, xTry, tPrev + tau );
+
+    // Halve the retained end's value when it is kept twice running
+    if ( ( g < 0 ) == ( gLeft < 0 ) )
+    {
+      tauLeft = tau;
+      xLeft = xTry;
+      gLeft = g;
+      gRight *= ( kept == 1 ) ? 0.5 : 1.0;
+      kept = 1;
+    }
+    else
+    {
+      tauRight = tau;
+      gRight = g;
+      gLeft *= ( kept == -1 ) ? 0.5 : 1.0;
+      kept = -1;
+    }
+  }
+
+  // The last stage of a step that ends past the root already feels the
+  // far side, so the right end is carried over from the left end instead
+  m_helper( xLeft, dxdtTry, tPrev + tauLeft );
+  for ( size_t k = 0; k < xLeft.size(); ++k )
+  {
+    xRight[k] = xLeft[k] + ( tauRight - tauLeft ) * dxdtTry[k];
+  }
+}
+
+// Map the STM across the switching event of action a with the saltation
+// matrix S = I + ( f+ - f- ) dg/dx / ( dg/dx f- + dg/dt ), which accounts
+// for the event time moving with the initial state. f- is taken at
+// xLeft, f+ and the gradient of g at x.
+void
+Motion::
+applySaltation(
+    int action,
+    const std::vector< double > &xLeft,
+    double tLeft,
+    std::vector< double > &x,
+    double t )
+{
+  int numAgents = ( x.size() > 6 ) ? m_activeAgents.size() : 0;
+  if ( numAgents == 0 )
+  {
+    return;
+  }
+
+  std::vector< double > fLeft( x.size() );
+  std::vector< double > fRight( x.size() );
+  m_helper( xLeft, fLeft, tLeft );
+  m_helper( x, fRight, t );
+
+  // Gradient of the switching function by central differences
+  std::shared_ptr< Action > ap = m_actions[action];
+  double gradient[6];
+  std::vector< double > xPlus( x.begin(), x.begin() + 6 );
+  std::vector< double > xMinus( xPlus );
+  double rate = 0.0;
+  for ( int k = 0; k < 6; ++k )
+  {
+    double dk = 1.E-7 * std::max( 1.0, std::abs( x[k] ) );
+    xPlus[k] += dk;
+    xMinus[k] -= dk;
+    double gPlus;
+    double gMinus;
+    ap->getSwitchFunction( gPlus, xPlus, t );
+    ap->getSwitchFunction( gMinus, xMinus, t );
+    gradient[k] = ( gPlus - gMinus ) / ( 2 * dk );
+    rate += gradient[k] * fLeft[k];
+    xPlus[k] = x[k];
+    xMinus[k] = x[k];
+  }
+  double dtg = 1.E-7 * std::max( 1.0, std::abs( t ) );
+  double gPlus;
+  double gMinus;
+  ap->getSwitchFunction( gPlus, xPlus, t + dtg );
+  ap->getSwitchFunction( gMinus, xMinus, t - dtg );
+  rate += ( gPlus - gMinus ) / ( 2 * dtg );
+
+  // A grazing event has no well defined map; leave the STM alone
+  if ( std::abs( rate ) < std::numeric_limits< double >::min() )
+  {
+    return;
+  }
+
+  for ( int j = 0; j < numAgents; ++j )
+  {
+    double c = 0.0;
+    for ( int k = 0; k < 6; ++k )
+    {
+      c += gradient[k] * x[ 6 + k * numAgents + j ];
+    }
+    for ( int i = 0; i < 6; ++i )
+    {
+      x[ 6 + i * numAgents + j ] += ( fRight[i] - fLeft[i] ) * c / rate;
+    }
+  }
+}
+
+// Compare every Event at the end of the step of length h from tPrev
+// against its value at the start, and refine each sign change to a root
+// by the Illinois method on stateAt( tau ), the state tau into the step.
+// New records are added in time order; values is updated to x at t.
+void
+Motion::
+findEvents(
+    const std::function< void( double, std::vector< double > & ) > &stateAt,
+    double tPrev,
+    double h,
+    const std::vector< double > &x,
+    double t,
+    std::vector< double > &values )
+{
+  std::vector< EventRecord > found;
+  std::vector< double > xTry;
+  for ( size_t e = 0; e < m_events.size(); ++e )
+  {
+    std::shared_ptr< Event > ep = m_events[e];
+    double gLeft = values[e];
+    double gRight = ep->getValue( x, t );
+    values[e] = gRight;
+    if ( ( gLeft < 0 ) == ( gRight < 0 ) )
+    {
+      continue;
+    }
+    int direction = ( gRight < 0 ) ? -1 : 1;
+    if ( ep->getDirection() * direction < 0 )
+    {
+      continue;
+    }
+
+    double tauLeft = 0.0;
+    double tauRight = h;
+    double tau = h;
+    xTry = x;
+    int kept = 0;
+    for ( int iter = 0; ( iter < 100 ) && ( tauRight - tauLeft > 1.E-9 );
+          ++iter )
+    {
+      tau = ( tauLeft * gRight - tauRight * gLeft ) / ( gRight - gLeft );
+      if ( !( tau > tauLeft && tau < tauRight ) )
+      {
+        tau = 0.5 * ( tauLeft + tauRight );
+      }
+      stateAt( tau, xTry );
+      double g = ep->getValue( xTry, tPrev + tau );
+      if ( g == 0.0 )
+      {
+        break;
+      }
+
+      // Halve the retained end's value when it is kept twice running
+      if ( ( g < 0 ) == ( gLeft < 0 ) )
+      {
+        tauLeft = tau;
+        gLeft = g;
+        gRight *= ( kept == 1 ) ? 0.5 : 1.0;
+        kept = 1;
+      }
+      else
+      {
+        tauRight = tau;
+        gRight = g;
+        gLeft *= ( kept == -1 ) ? 0.5 : 1.0;
+        kept = -1;
+      }
+    }
+
+    EventRecord record;
+    record.event = e;
+    record.direction = direction;
+    record.time = tPrev + tau;
+    record.state.assign( xTry.begin(), xTry.begin() + 6 );
+    found.push_back( record );
+  }
+
+  std::sort( found.begin(), found.end(),
+             []( const EventRecord &a, const EventRecord &b )
+             {
+               return a.time < b.time;
+             } );
+  m_eventRecords.insert( m_eventRecords.end(), found.begin(), found.end() );
+}
+
+// Integrate the state in double and the STM in float to time t, logging
+// at the output step as integrate_const does. The controlled dense output
+// dopri5 steps the state alone, so the STM has no say in the step size.
+// Between the ends of accepted steps and output times, the STM takes
+// one classical RK4 step, with A at the interpolated state.
+void
+Motion::
+integrateMixed(
+    std::vector< double > &stateAndPartials,
+    double t )
+{
+  using namespace boost::numeric::odeint;
+
+  typedef runge_kutta_dopri5< std::vector< double > > rkStepper;
+
+  m_report = StepReport();
+  int numAgents = m_activeAgents.size();
+  int stmSize = numAgents * numAgents;
+  std::vector< double > state( stateAndPartials.begin(),
+                               stateAndPartials.begin() + 6 );
+  std::vector< float > stm( stateAndPartials.begin() + 6,
+                            stateAndPartials.end() );
+  m_pastStates[ m_time ] = state;
+  m_pastPartials[ m_time ] = stm;
+
+  auto stepper = make_dense_output( 1.E-10, 1.E-9, rkStepper() );
+  stepper.initialize( state, m_time, m_step );
+
+  // Output times m_time + k * m_step up to t, as integrate_const, and t
+  // itself when it is off the grid
+  int numSteps = std::floor( ( t - m_time ) / m_step * ( 1 + 1.E-12 ) );
+  int numOutputs = numSteps + ( ( m_time + numSteps * m_step < t ) ? 1 : 0 );
+  std::vector< double > xStart( 6 ), xMid( 6 ), xEnd( 6 );
+  std::vector< float > k1( stmSize ), k2( stmSize ), k3( stmSize ),
+    k4( stmSize ), stage( stmSize );
+  double tStm = m_time;
+  for ( int k = 1; k <= numOutputs; ++k )
+  {
+    double tOut = std::min( m_time + k * m_step, t );
+    while ( tStm < tOut )
+    {
+      // Take a state step once the STM has caught up with the last one
+      if ( stepper.current_time() <= tStm )
+      {
+        stepper.do_step( m_helper );
+        ++m_report.acceptedSteps;
+      }
+      double tNext = std::min( stepper.current_time(), tOut );
+      float h = tNext - tStm;
+      stepper.calc_state( tStm, xStart );
+      stepper.calc_state( 0.5 * ( tStm + tNext ), xMid );
+      stepper.calc_state( tNext, xEnd );
+
+      m_helper.singlePrecisionProduct( xStart, tStm, stm.data(), k1.data() );
+      for ( int i = 0; i < stmSize; ++i )
+      {
+        stage[i] = stm[i] + 0.5f * h * k1[i];
+      }
+      m_helper.singlePrecisionProduct( xMid, 0.5 * ( tStm + tNext ),
+                                       stage.data(), k2.data() );
+      for ( int i = 0; i < stmSize; ++i )
+      {
+        stage[i] = stm[i] + 0.5f * h * k2[i];
+      }
+      m_helper.singlePrecisionProduct( xMid, 0.5 * ( tStm + tNext ),
+                                       stage.data(), k3.data() );
+      for ( int i = 0; i < stmSize; ++i )
+      {
+        stage[i] = stm[i] + h * k3[i];
+      }
+      m_helper.singlePrecisionProduct( xEnd, tNext, stage.data(), k4.data() );
+      for ( int i = 0; i < stmSize; ++i )
+      {
+        stm[i] += h / 6.0f * ( k1[i] + 2.0f * ( k2[i] + k3[i] ) + k4[i] );
+      }
+      tStm = tNext;
+    }
+    stepper.calc_state( tOut, state );
+    m_pastStates[ tOut ] = state;
+    m_pastPartials[ tOut ] = stm;
+  }
+
+  std::copy( state.begin(), state.end(), stateAndPartials.begin() );
+  std::copy( stm.begin(), stm.end(), stateAndPartials.begin() + 6 );
+}
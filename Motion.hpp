@@ -12,8 +12,10 @@
 #define EKF_MOTION_HEADER_GUARD
 
 // C++ Standard Library
+#include <functional>
 #include <vector>
 #include <map>
+#include <memory>
 #include <string>
 
 // Eigen Library
@@ -22,7 +24,37 @@
 // ekf Library
 #include <Action.hpp>
 #include <AgentGroup.hpp>
+#include <Event.hpp>
 #include <OdeintHelper.hpp>
+#include <PropagationCache.hpp>
+#include <Propagator.hpp>
+
+/// @brief Step counts of the last Motion::stepTo.
+///
+/// Filled in when an Action declares switches. segments counts the
+/// restarts at switch times and at located switching events.
+///
+struct StepReport
+{
+  int acceptedSteps;
+  int rejectedSteps;
+  int segments;
+  int events;
+};
+
+/// @brief A located root of an Event.
+///
+/// event is the index of the Event in the order added, direction is +1
+/// for a rising and -1 for a falling sign change, and state is the
+/// agent state ( X, Y, Z, dX, dY, dZ ) at the root.
+///
+struct EventRecord
+{
+  int event;
+  int direction;
+  double time;
+  std::vector< double > state;
+};
 
 /// @brief Manage the motion of an agent through space.
 ///
@@ -30,27 +62,91 @@
 /// and allow querying the state of the agent at any time it has
 /// previously visited.
 ///
+/// When an Action declares switch times or a switching function, the
+/// integration is split into segments at the switches and the stepper
+/// restarted, rather than stepping through the discontinuity. Events
+/// are located by root finding on re-taken steps, and the STM is mapped
+/// across them with the saltation matrix.
+///
+/// Added Events are checked at the end of every accepted step, all
+/// together. A sign change is refined to its root on the dense output of
+/// the dopri5 step, which needs no further force evaluations. Events are
+/// found with the default integration only, not with a Propagator.
+///
+/// With a PropagationCache set, stepTo is served from the cache when the
+/// same arc has been integrated before. Motions with Events, or with an
+/// Action that does not give its parameters, always integrate.
+///
+/// With mixed precision set, the state is integrated in double and the
+/// STM is carried, multiplied and logged in float. The state alone sets
+/// the dopri5 step, and the STM follows it by RK4 substeps taken on the
+/// dense output between accepted steps and output times. The STM then
+/// agrees with the all double integration to about 1e-6 relative, which
+/// is well inside what a filter covariance needs, for half the memory
+/// in the log. It applies to the default integration only; with a
+/// Propagator, Events or switches stepTo integrates in double.
+///
 class Motion {
 
  public:
   Motion();
   Motion( const std::vector< double > &ic, double step );
+  Motion( const std::vector< double > &ic, double step, double epoch );
  ~Motion();
 
-  // Step to time t
+  // Step to time t, logging every step from the current time, and t
   void stepTo( double t );
+  // Restart from state at the current time with unit partials, as after
+  // a filter update, dropping the logged states and event records
+  void restart( const std::vector< double > &state );
 
   // Add effect of action to motion
   void addAction( std::shared_ptr<Action> a );
-  // Activate agents for partials computations
+  // Activate agents for partials computations. Tracked partials are
+  // kept; new agents start from the current time with a unit diagonal,
+  // and zero partials against the agents already tracked ( past states
+  // keep the partials they were logged with ).
   void activateAgents( const std::vector< std::string > agentNames );
+  // Replace the default dopri5 integration with another propagator.
+  // Propagators step straight through, so stepTo fails if there are
+  // Events, Action switches ( getSwitchTimes, getSwitchFunction ) or
+  // mixed precision.
+  void setPropagator( std::shared_ptr< Propagator > propagator );
+  // Evaluate the Actions concurrently on a team of numThreads threads
+  // ( 0 means one per core, and no more are used ), or in turn with 1
+  // ( the default ). Worth it only for several expensive Actions.
+  void setActionThreads( unsigned int numThreads );
+  // Split integration at Action switches ( default ), or step through
+  void setSegmenting( bool segmenting );
+  // Locate the roots of event during integration ( by the default dopri5
+  // integration only, not a Propagator )
+  void addEvent( std::shared_ptr< Event > event );
+  // Look stepTo up in cache first, and store what is integrated
+  void setCache( std::shared_ptr< PropagationCache > cache );
+  // Carry the STM in float and the state in double, or all in double
+  // ( the default ). Not with a Propagator.
+  void setMixedPrecision( bool mixed );
 
   // Get current time step
   double getTime() const;
+  // Get the active agents, in STM row order
+  const AgentGroup& getActiveAgents() const;
   // Get value of state at step t ( defaults to current time )
   std::vector< double > getState( double t ) const;
   // Get the partials of state at step t
   std::vector< double > getStatePartials( double t ) const;
+  // Get the step counts of the last stepTo
+  StepReport getStepReport() const;
+  // Get the estimated size of the logged states
+  std::size_t getLogBytes() const;
+  // Get the events located so far, in time order
+  std::vector< EventRecord > getEventRecords() const;
+  // Get the cached arc closest to what stepTo( t ) would integrate, to
+  // seed an iterative integrator, and its distance ( see
+  // PropagationCache::findNearest )
+  bool getNearestArc( double t,
+                      std::map< double, std::vector< double > > &states,
+                      double &distance ) const;
 
   // Print the current state to cout
   void printStateAndPartials( double t ) const;
@@ -61,13 +157,39 @@ class Motion {
   double m_time;
   std::vector< double > m_state;
   std::vector< double > m_partials;
-  std::vector< std::string > m_activeAgents;
+  AgentGroup m_activeAgents;
   double m_step;
   std::vector< std::shared_ptr< Action > > m_actions;
   OdeintHelper m_helper;
   map< double, std::vector< double > > m_pastStates;
+  std::shared_ptr< Propagator > m_propagator;
+  bool m_segmenting;
+  StepReport m_report;
+  std::vector< std::shared_ptr< Event > > m_events;
+  std::vector< EventRecord > m_eventRecords;
+  std::shared_ptr< PropagationCache > m_cache;
+  bool m_mixed;
+  // STM logged in float by mixed precision, with the state in m_pastStates
+  map< double, std::vector< float > > m_pastPartials;
 
-  void initializePartials( std::vector< std::string >& activeAgents );
+  void initializePartials( AgentGroup& activeAgents );
+  void extendPartials( int oldAgents );
+  bool hasSwitches( const std::vector< double > &stateAndPartials,
+                    double t ) const;
+  bool cacheKey( const std::vector< double > &stateAndPartials, double t,
+                 std::string &structure, std::vector< double > &values ) const;
+  void integrateSegments( std::vector< double > &stateAndPartials, double t );
+  void integrateMixed( std::vector< double > &stateAndPartials, double t );
+  void locateSwitch( int action, const std::vector< double > &xPrev,
+                     double tPrev, double h, double &tauLeft,
+                     std::vector< double > &xLeft, double &tauRight,
+                     std::vector< double > &xRight );
+  void applySaltation( int action, const std::vector< double > &xLeft,
+                       double tLeft, std::vector< double > &x, double t );
+  void findEvents(
+    const std::function< void( double, std::vector< double > & ) > &stateAt,
+    double tPrev, double h, const std::vector< double > &x, double t,
+    std::vector< double > &values );
 };
 
 #endif // EKF_MOTION_HEADER_GUARD
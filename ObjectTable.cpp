@@ -0,0 +1,76 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ObjectTable.cpp
+/// @brief   Force model properties of the objects of a catalog, stored
+///          as parallel arrays indexed by object.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// ekf Library
+#include <ObjectTable.hpp>
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+ObjectTable::
+ObjectTable()
+    : m_bodyDragTerm()
+{
+}
+
+// Default Destructor
+ObjectTable::
+~ObjectTable()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Add an object, returning its index
+int
+ObjectTable::
+addObject( double bodyDragTerm )
+{
+  m_bodyDragTerm.push_back( bodyDragTerm );
+  return m_bodyDragTerm.size() - 1;
+}
+
+// Make room for numObjects
+void
+ObjectTable::
+reserve( int numObjects )
+{
+  m_bodyDragTerm.reserve( numObjects );
+}
+
+// Number of objects added
+int
+ObjectTable::
+getNumObjects() const
+{
+  return m_bodyDragTerm.size();
+}
+
+// Body drag term of object
+double
+ObjectTable::
+getBodyDragTerm( int object ) const
+{
+  return m_bodyDragTerm[ object ];
+}
+
+// Set the body drag term of object
+void
+ObjectTable::
+setBodyDragTerm(
+    int object,
+    double bodyDragTerm )
+{
+  m_bodyDragTerm[ object ] = bodyDragTerm;
+}
@@ -0,0 +1,52 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ObjectTable.hpp
+/// @brief   Force model properties of the objects of a catalog, stored
+///          as parallel arrays indexed by object.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_OBJECTTABLE_HEADER_GUARD
+#define EKF_OBJECTTABLE_HEADER_GUARD
+
+// C++ Standard Library
+#include <vector>
+
+/// @brief Per-object force model properties of a catalog.
+///
+/// Shared environment models ( GravityAction, AtmosphereModel ) are
+/// held once. What differs between objects is kept here, one array per
+/// property, so an object costs one double per property and a catalog
+/// of any size a handful of allocations. The Actions of an object hold
+/// the table and the object index ( see AtmosphereAction ).
+///
+/// Properties:
+///   - Body drag term, Cd A / 2 m
+///
+class ObjectTable
+{
+ public:
+  ObjectTable();
+ ~ObjectTable();
+
+  // Add an object, returning its index
+  int addObject( double bodyDragTerm );
+  // Make room for numObjects without reallocating
+  void reserve( int numObjects );
+
+  // Number of objects added
+  int getNumObjects() const;
+
+  // Properties of one object
+  double getBodyDragTerm( int object ) const;
+  void setBodyDragTerm( int object, double bodyDragTerm );
+
+ private:
+  // One entry per object
+  std::vector< double > m_bodyDragTerm;
+};
+
+#endif // EKF_OBJECTTABLE_HEADER_GUARD
@@ -8,7 +8,10 @@
 ///
 
 // C++ Standard Library
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <map>
 
 // Eigien Library
 #include <eigen/dense>
@@ -23,17 +26,34 @@
 OdeintHelper::
 OdeintHelper()
     : m_actions(),
-      m_activeAgents()
+      m_activeAgents(),
+      m_segmentEnd( std::numeric_limits< double >::infinity() ),
+      m_sparse( false ),
+      m_preparedAgents( -1 ),
+      m_preparedActions( -1 ),
+      m_entries(),
+      m_scatter(),
+      m_patternSizes(),
+      m_team()
 {
 }
 
 OdeintHelper::
 OdeintHelper(
     std::vector< std::shared_ptr< Action > >& actions,
-    std::vector< std::string >& activeAgents )
+    AgentGroup& activeAgents )
     : m_actions( &actions ),
-      m_activeAgents( &activeAgents )
+      m_activeAgents( &activeAgents ),
+      m_segmentEnd( std::numeric_limits< double >::infinity() ),
+      m_sparse( false ),
+      m_preparedAgents( -1 ),
+      m_preparedActions( -1 ),
+      m_entries(),
+      m_scatter(),
+      m_patternSizes(),
+      m_team()
 {
+  preparePartials();
 }
 
 OdeintHelper::
@@ -55,21 +75,354 @@ operator() (
     const double t  )
 {
   // Accumulate accelerations from the different actions.
+  double tAction = ( t < m_segmentEnd ) ? t :
+    std::nextafter( m_segmentEnd, -std::numeric_limits< double >::infinity() );
+  if ( m_team )
+  {
+    teamEvaluate( x, dxdt, tAction, t );
+    return;
+  }
   std::vector< double > accel( 3, 0.0 );
   for ( auto ap: *m_actions )
   {
-    ap->getAcceleration( accel, x );
+    ap->getAccelerationAtTime( accel, x, tAction );
   }
 
-  // Accumulate partials from the different actions.
+  // State elements
+  dxdt[0] = x[3]; // X_dot
+  dxdt[1] = x[4]; // Y_dot
+  dxdt[2] = x[5]; // Z_dot
+  dxdt[3] = accel[0]; // DX_dot
+  dxdt[4] = accel[1]; // DY_dot
+  dxdt[5] = accel[2]; // DY_dot
+
+  // A bare six element state carries no STM, so skip the partials
+  // entirely
+  if ( x.size() <= 6 )
+  {
+    return;
+  }
   int numAgents = m_activeAgents->size();
+  if ( ( m_preparedAgents != numAgents ) ||
+       ( m_preparedActions != (int) m_actions->size() ) )
+  {
+    preparePartials();
+  }
+  if ( m_sparse )
+  {
+    sparsePartials( x, dxdt, numAgents );
+    return;
+  }
+
+  // Accumulate partials from the different actions.
   int numPartials = numAgents * numAgents;
   std::vector< double > partials( numPartials, 0.0 );
   for ( auto ap: *m_actions )
   {
-    ap->getPartials( partials, x, *m_activeAgents );
+    if ( numAgents > 0 )
+    {
+      ap->getPartials( partials, x, *m_activeAgents );
+    }
+  }
+  denseProduct( partials, x, dxdt, numAgents, t );
+}
+
+// Set the end of the current integration segment
+void
+OdeintHelper::
+setSegmentEnd( double t )
+{
+  m_segmentEnd = t;
+}
+
+// Place the partial pattern of every action among the distinct entries
+// of A, keeping only partials between active agents. Actions left with
+// none are skipped when evaluating. If any action gives no pattern, the
+// dense getPartials path is used instead.
+void
+OdeintHelper::
+preparePartials()
+{
+  m_sparse = false;
+  m_entries.clear();
+  m_scatter.clear();
+  m_patternSizes.clear();
+  if ( !m_actions || !m_activeAgents )
+  {
+    return;
+  }
+  m_preparedAgents = m_activeAgents->size();
+  m_preparedActions = m_actions->size();
+
+  // Active partials of each action, by ( pattern index, ( row, column ) ).
+  // The map orders the entries by row then column.
+  std::map< std::pair< int, int >, int > entries;
+  std::vector< std::vector< std::pair< int, std::pair< int, int > > > >
+    placed( m_actions->size() );
+  std::vector< std::pair< int, int > > pattern;
+  for ( size_t a = 0; a < m_actions->size(); ++a )
+  {
+    if ( !(*m_actions)[a]->getPartialPattern( pattern ) )
+    {
+      m_patternSizes.clear();
+      return;
+    }
+    m_patternSizes.push_back( pattern.size() );
+    for ( size_t p = 0; p < pattern.size(); ++p )
+    {
+      int row = m_activeAgents->getRow( pattern[p].first );
+      int column = m_activeAgents->getRow( pattern[p].second );
+      if ( ( row >= 0 ) && ( column >= 0 ) )
+      {
+        entries[ std::make_pair( row, column ) ] = 0;
+        placed[a].push_back( std::make_pair( p, std::make_pair( row,
+                                                                column ) ) );
+      }
+    }
+  }
+
+  for ( auto &entry: entries )
+  {
+    entry.second = m_entries.size();
+    m_entries.push_back( entry.first );
   }
+  m_scatter.resize( m_actions->size() );
+  for ( size_t a = 0; a < placed.size(); ++a )
+  {
+    for ( const auto &p: placed[a] )
+    {
+      m_scatter[a].push_back( std::make_pair( p.first, entries[ p.second ] ) );
+    }
+  }
+  m_sparse = true;
+}
 
+// STM derivative in single precision. A is evaluated in double, as in
+// the default integration, and rounded; the product runs on Eigen's
+// vectorized float kernels, a row at a time over the sparse entries of
+// A, or as one product when an action gives no pattern.
+void
+OdeintHelper::
+singlePrecisionProduct(
+    const std::vector< double > &state,
+    double t,
+    const float *stm,
+    float *dStm )
+{
+  typedef Eigen::Matrix< float, Eigen::Dynamic, Eigen::Dynamic,
+                         Eigen::RowMajor > RowMajorMatrixXf;
+
+  int numAgents = m_activeAgents->size();
+  if ( ( m_preparedAgents != numAgents ) ||
+       ( m_preparedActions != (int) m_actions->size() ) )
+  {
+    preparePartials();
+  }
+  if ( m_sparse )
+  {
+    std::vector< double > entries;
+    gatherEntries( state, entries );
+    Eigen::Map< RowMajorMatrixXf > dPhi( dStm, numAgents, numAgents );
+    Eigen::Map< const RowMajorMatrixXf > phi( stm, numAgents, numAgents );
+    dPhi.setZero();
+    for ( size_t e = 0; e < m_entries.size(); ++e )
+    {
+      dPhi.row( m_entries[e].first ) +=
+        float( entries[e] ) * phi.row( m_entries[e].second );
+    }
+  }
+  else
+  {
+    std::vector< double > partials( numAgents * numAgents, 0.0 );
+    for ( auto ap: *m_actions )
+    {
+      ap->getPartials( partials, state, *m_activeAgents );
+    }
+    RowMajorMatrixXf A = Eigen::Map< const Eigen::Matrix< double,
+      Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor > >(
+        partials.data(), numAgents, numAgents ).cast< float >();
+    Eigen::Map< RowMajorMatrixXf >( dStm, numAgents, numAgents ).noalias() =
+      A * Eigen::Map< const RowMajorMatrixXf >( stm, numAgents, numAgents );
+  }
+}
+
+// Evaluate the actions on team from now on
+void
+OdeintHelper::
+setTeam( std::shared_ptr< ThreadTeam > team )
+{
+  m_team = team;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Evaluate the actions concurrently on the team. Each action writes
+// slots of its own, which are then summed in list order, so the result
+// is that of evaluating the actions in turn.
+void
+OdeintHelper::
+teamEvaluate(
+    const std::vector< double > &x,
+    std::vector< double > &dxdt,
+    double tAction,
+    double t )
+{
+  int numActions = m_actions->size();
+  int numAgents = ( x.size() > 6 ) ? m_activeAgents->size() : 0;
+  if ( ( numAgents > 0 ) && ( ( m_preparedAgents != numAgents ) ||
+                              ( m_preparedActions != numActions ) ) )
+  {
+    preparePartials();
+  }
+
+  // Accelerations, and pattern values or dense partials, by action
+  std::vector< std::vector< double > > accels(
+    numActions, std::vector< double >( 3, 0.0 ) );
+  std::vector< std::vector< double > > partials( numActions );
+  m_team->run( numActions, [&]( int a )
+  {
+    const std::shared_ptr< Action > &ap = ( *m_actions )[a];
+    ap->getAccelerationAtTime( accels[a], x, tAction );
+    if ( numAgents == 0 )
+    {
+      return;
+    }
+    if ( m_sparse )
+    {
+      if ( !m_scatter[a].empty() )
+      {
+        partials[a].resize( m_patternSizes[a] );
+        ap->getPartialValues( partials[a].data(), x );
+      }
+    }
+    else
+    {
+      partials[a].assign( numAgents * numAgents, 0.0 );
+      ap->getPartials( partials[a], x, *m_activeAgents );
+    }
+  } );
+
+  // State elements
+  std::vector< double > accel( 3, 0.0 );
+  for ( int a = 0; a < numActions; ++a )
+  {
+    for ( int k = 0; k < 3; ++k )
+    {
+      accel[k] += accels[a][k];
+    }
+  }
+  dxdt[0] = x[3]; // X_dot
+  dxdt[1] = x[4]; // Y_dot
+  dxdt[2] = x[5]; // Z_dot
+  dxdt[3] = accel[0]; // DX_dot
+  dxdt[4] = accel[1]; // DY_dot
+  dxdt[5] = accel[2]; // DY_dot
+  if ( numAgents == 0 )
+  {
+    return;
+  }
+
+  // State partials
+  if ( m_sparse )
+  {
+    std::vector< double > entries( m_entries.size(), 0.0 );
+    for ( int a = 0; a < numActions; ++a )
+    {
+      for ( const auto &s: m_scatter[a] )
+      {
+        entries[ s.second ] += partials[a][ s.first ];
+      }
+    }
+    sparseProduct( entries, x, dxdt, numAgents );
+  }
+  else
+  {
+    std::vector< double > summed( numAgents * numAgents, 0.0 );
+    for ( int a = 0; a < numActions; ++a )
+    {
+      for ( int i = 0; i < numAgents * numAgents; ++i )
+      {
+        summed[i] += partials[a][i];
+      }
+    }
+    denseProduct( summed, x, dxdt, numAgents, t );
+  }
+}
+
+// STM derivative A * STM, evaluating and multiplying only the entries
+// of A the actions contribute
+void
+OdeintHelper::
+sparsePartials(
+    const std::vector< double > &x,
+    std::vector< double > &dxdt,
+    int numAgents ) const
+{
+  std::vector< double > entries;
+  gatherEntries( x, entries );
+  sparseProduct( entries, x, dxdt, numAgents );
+}
+
+// Sum the partials of the actions into the entries of A
+void
+OdeintHelper::
+gatherEntries(
+    const std::vector< double > &x,
+    std::vector< double > &entries ) const
+{
+  entries.assign( m_entries.size(), 0.0 );
+  std::vector< double > values;
+  for ( size_t a = 0; a < m_scatter.size(); ++a )
+  {
+    if ( m_scatter[a].empty() )
+    {
+      continue;
+    }
+    values.resize( m_patternSizes[a] );
+    (*m_actions)[a]->getPartialValues( values.data(), x );
+    for ( const auto &s: m_scatter[a] )
+    {
+      entries[ s.second ] += values[ s.first ];
+    }
+  }
+}
+
+// STM derivative A * STM over the entries of A only
+void
+OdeintHelper::
+sparseProduct(
+    const std::vector< double > &entries,
+    const std::vector< double > &x,
+    std::vector< double > &dxdt,
+    int numAgents ) const
+{
+  // Row i of A * STM sums row k of the STM over the entries ( i, k )
+  std::fill( dxdt.begin() + 6, dxdt.begin() + 6 + numAgents * numAgents,
+             0.0 );
+  for ( size_t e = 0; e < m_entries.size(); ++e )
+  {
+    const double *stmRow = &x[ 6 + m_entries[e].second * numAgents ];
+    double *dStmRow = &dxdt[ 6 + m_entries[e].first * numAgents ];
+    double a = entries[e];
+    for ( int j = 0; j < numAgents; ++j )
+    {
+      dStmRow[j] += a * stmRow[j];
+    }
+  }
+}
+
+// STM derivative A * STM, from A in row major partials
+void
+OdeintHelper::
+denseProduct(
+    const std::vector< double > &partials,
+    const std::vector< double > &x,
+    std::vector< double > &dxdt,
+    int numAgents,
+    double t ) const
+{
   // Write the paramter partials into a matrix
   Eigen::MatrixXd A( numAgents, numAgents );
   A = Eigen::MatrixXd::Zero( numAgents, numAgents );
@@ -133,14 +486,6 @@ operator() (
     }
   }
 
-  // State elements
-  dxdt[0] = x[3]; // X_dot
-  dxdt[1] = x[4]; // Y_dot
-  dxdt[2] = x[5]; // Z_dot
-  dxdt[3] = accel[0]; // DX_dot
-  dxdt[4] = accel[1]; // DY_dot
-  dxdt[5] = accel[2]; // DY_dot
-
   // State partials
   for ( int i = 0; i < numAgents; ++i )
   {
@@ -148,12 +493,3 @@ operator() (
     dxdt[ 6 + j + i * numAgents ] = dStm(i,j);
   }
 }
-
-/// @todo remove this
-void
-OdeintHelper::
-howManyActions()
-{
-  std::cout << "There are " << m_actions->size()
-       << " Actions in the helper" << std::endl;
-}
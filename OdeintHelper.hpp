@@ -12,11 +12,14 @@
 #define EKF_ODEINTHELPER_HEADER_GUARD
 
 // C++ Standard Library
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 // ekf Library
 #include <Action.hpp>
+#include <Parallel.hpp>
 
 /// @brief Interface class between ekf and boost::odeint.
 ///
@@ -28,20 +31,83 @@ class OdeintHelper{
 
   OdeintHelper();
   OdeintHelper( std::vector< std::shared_ptr< Action > >& actions,
-                std::vector< std::string >& activeAgents );
+                AgentGroup& activeAgents );
  ~OdeintHelper();
 
   // Allows this class to be called by the odeint solver
   void operator() ( const std::vector< double >& x,
                     std::vector< double >& dxdt,
                     const double t );
-  void howManyActions();
+
+  // Work out which partials the actions contribute over the active
+  // agents. Called again whenever agents or actions are added.
+  void preparePartials();
+
+  // Evaluate the actions concurrently on team, or in turn if it is
+  // empty ( the default )
+  void setTeam( std::shared_ptr< ThreadTeam > team );
+
+  // STM derivative A * STM in single precision, with A evaluated at the
+  // six element state at time t. stm and dStm are row major over the
+  // active agents.
+  void singlePrecisionProduct( const std::vector< double > &state,
+                               double t, const float *stm, float *dStm );
+
+  // Set the end of the current integration segment. Actions see times
+  // at the end as just inside it, so a switch there takes effect only
+  // in the next segment.
+  void setSegmentEnd( double t );
 
  private:
   std::vector< std::shared_ptr< Action > >* m_actions;
-  std::vector< std::string >* m_activeAgents;
+  AgentGroup* m_activeAgents;
+  double m_segmentEnd;
+
+  // Sparse partials, used when every action gives a partial pattern:
+  // the distinct ( row, column ) entries of A, and for each action the
+  // ( pattern index, entry ) pairs its active partials add to
+  bool m_sparse;
+  int m_preparedAgents;
+  int m_preparedActions;
+  std::vector< std::pair< int, int > > m_entries;
+  std::vector< std::vector< std::pair< int, int > > > m_scatter;
+  std::vector< int > m_patternSizes;
+  std::shared_ptr< ThreadTeam > m_team;
+
+  void sparsePartials( const std::vector< double > &x,
+                       std::vector< double > &dxdt, int numAgents ) const;
+  void gatherEntries( const std::vector< double > &x,
+                      std::vector< double > &entries ) const;
+  void sparseProduct( const std::vector< double > &entries,
+                      const std::vector< double > &x,
+                      std::vector< double > &dxdt, int numAgents ) const;
+  void denseProduct( const std::vector< double > &partials,
+                     const std::vector< double > &x,
+                     std::vector< double > &dxdt, int numAgents,
+                     double t ) const;
+  void teamEvaluate( const std::vector< double > &x,
+                     std::vector< double > &dxdt, double tAction, double t );
   /// @todo this needs to go eventually
   const bool m_debug = false;
 };
 
+/// @brief Observer used to log the states visited by the integrator.
+///
+/// Takes in state and time from the odeint integrate functions and
+/// logs them in the pastStates map.
+///
+struct log_state
+{
+  std::map< double, std::vector< double > >* m_pastStates;
+
+  // Constructor
+  log_state(  std::map< double, std::vector< double > >& pastStates )
+      : m_pastStates( &pastStates ) { }
+
+  void operator()( const std::vector< double >& x, double t )
+  {
+    m_pastStates->insert( std::pair<double, std::vector< double > >(t,x) );
+  }
+};
+
 #endif // EKF_ODEINTHELPER_HEADER_GUARD
@@ -0,0 +1,233 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    Parallel.cpp
+/// @brief   Fork-join helpers for spreading independent work over
+///          a team of threads.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ekf Library
+#include <Parallel.hpp>
+
+namespace
+{
+  // How long an idle ThreadTeam worker polls before it blocks
+  const std::chrono::microseconds spinTime( 200 );
+}
+
+// Run work( i ) for every i in [first, last) on the thread team
+void
+parallelFor(
+    int first,
+    int last,
+    unsigned int numThreads,
+    const std::function< void( int ) > &work )
+{
+  if ( last <= first )
+  {
+    return;
+  }
+
+  std::atomic< int > next( first );
+  auto worker = [&]()
+  {
+    for ( int i = next++; i < last; i = next++ )
+    {
+      work( i );
+    }
+  };
+
+  numThreads = std::min( resolveThreads( numThreads ),
+                         static_cast< unsigned int >( last - first ) );
+  std::vector< std::thread > team;
+  for ( unsigned int i = 1; i < numThreads; ++i )
+  {
+    team.push_back( std::thread( worker ) );
+  }
+  worker();
+  for ( auto &t: team )
+  {
+    t.join();
+  }
+}
+
+// Resolve a requested thread count, where 0 means one per core
+unsigned int
+resolveThreads( unsigned int numThreads )
+{
+  if ( numThreads == 0 )
+  {
+    numThreads = std::max( 1u, std::thread::hardware_concurrency() );
+  }
+  return numThreads;
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Constructor starting numThreads - 1 threads ( 0 means one per core )
+ThreadTeam::
+ThreadTeam( unsigned int numThreads )
+    : m_threads(),
+      m_generation( 0 ),
+      m_next( 0 ),
+      m_finished( 0 ),
+      m_stop( false ),
+      m_work( nullptr ),
+      m_count( 0 ),
+      m_sleepers( 0 ),
+      m_lock(),
+      m_wake()
+{
+  numThreads = resolveThreads( numThreads );
+  for ( unsigned int i = 1; i < numThreads; ++i )
+  {
+    m_threads.push_back( std::thread( &ThreadTeam::worker, this ) );
+  }
+}
+
+// Destructor, stopping the threads
+ThreadTeam::
+~ThreadTeam()
+{
+  m_stop.store( true, std::memory_order_release );
+  m_generation.fetch_add( 1 );
+  wake();
+  for ( auto &t: m_threads )
+  {
+    t.join();
+  }
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Hand out [0, count) to the team and take part until it is done. Waits
+// for every thread to leave the job, so none can take an index of the
+// next one.
+void
+ThreadTeam::
+run(
+    int count,
+    const std::function< void( int ) > &work )
+{
+  if ( m_threads.empty() )
+  {
+    for ( int i = 0; i < count; ++i )
+    {
+      work( i );
+    }
+    return;
+  }
+
+  m_work = &work;
+  m_count = count;
+  m_next.store( 0, std::memory_order_relaxed );
+  m_finished.store( 0, std::memory_order_relaxed );
+  m_generation.fetch_add( 1 );
+  wake();
+
+  for ( int i = m_next++; i < count; i = m_next++ )
+  {
+    work( i );
+  }
+  int numWorkers = m_threads.size();
+  int spins = 0;
+  while ( m_finished.load( std::memory_order_acquire ) < numWorkers )
+  {
+    if ( ++spins > 4096 )
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+// Threads in the team, the calling thread included
+unsigned int
+ThreadTeam::
+getNumThreads() const
+{
+  return m_threads.size() + 1;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Spin until a job is posted, blocking once it has spun for spinTime,
+// work on it, and report back
+void
+ThreadTeam::
+worker()
+{
+  unsigned int seen = 0;
+  while ( true )
+  {
+    int spins = 0;
+    std::chrono::steady_clock::time_point idle;
+    while ( m_generation.load( std::memory_order_acquire ) == seen )
+    {
+      if ( ++spins < 4096 )
+      {
+        continue;
+      }
+      if ( spins == 4096 )
+      {
+        idle = std::chrono::steady_clock::now();
+      }
+      else if ( std::chrono::steady_clock::now() - idle > spinTime )
+      {
+        // Counted as a sleeper before the last look at the generation,
+        // so run() either sees the count or this sees its job
+        std::unique_lock< std::mutex > lock( m_lock );
+        m_sleepers.fetch_add( 1 );
+        m_wake.wait( lock, [&]()
+        {
+          return m_generation.load() != seen;
+        } );
+        m_sleepers.fetch_sub( 1 );
+        break;
+      }
+      std::this_thread::yield();
+    }
+    seen = m_generation.load( std::memory_order_acquire );
+    if ( m_stop.load( std::memory_order_acquire ) )
+    {
+      return;
+    }
+
+    for ( int i = m_next++; i < m_count; i = m_next++ )
+    {
+      ( *m_work )( i );
+    }
+    m_finished.fetch_add( 1, std::memory_order_release );
+  }
+}
+
+// Wake blocked workers after the generation is bumped. The lock orders
+// the notify after any worker still between its check and its wait.
+void
+ThreadTeam::
+wake()
+{
+  if ( m_sleepers.load() > 0 )
+  {
+    {
+      std::lock_guard< std::mutex > guard( m_lock );
+    }
+    m_wake.notify_all();
+  }
+}
@@ -0,0 +1,75 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    Parallel.hpp
+/// @brief   Fork-join helpers for spreading independent work over
+///          a team of threads.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_PARALLEL_HEADER_GUARD
+#define EKF_PARALLEL_HEADER_GUARD
+
+// C++ Standard Library
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Run work( i ) for every i in [first, last) on up to numThreads
+// threads ( 0 means one per core ). The calling thread takes part in
+// the work, and the call returns once every index is done.
+void parallelFor( int first, int last, unsigned int numThreads,
+                  const std::function< void( int ) > &work );
+
+// Resolve a requested thread count, where 0 means one per core
+unsigned int resolveThreads( unsigned int numThreads );
+
+/// @brief Persistent team of threads for fine grained fork-join.
+///
+/// parallelFor starts and joins its threads on every call, which costs
+/// tens of microseconds. A ThreadTeam starts its threads once and keeps
+/// them spinning on an atomic job counter between calls to run(), so a
+/// job of a few items is handed out and collected in about a
+/// microsecond. Idle threads spin for about a fifth of a millisecond,
+/// then block until run() or the destructor wakes them, so an idle team
+/// costs no CPU; jobs posted more often than that stay on the fast
+/// path. Keep it no larger than the free cores.
+///
+class ThreadTeam
+{
+ public:
+  ThreadTeam( unsigned int numThreads );
+ ~ThreadTeam();
+
+  // Run work( i ) for every i in [0, count) on the team, the calling
+  // thread included, returning once every index is done. Not to be
+  // called from several threads at once.
+  void run( int count, const std::function< void( int ) > &work );
+
+  // Threads in the team, the calling thread included
+  unsigned int getNumThreads() const;
+
+ private:
+  std::vector< std::thread > m_threads;
+  // Bumped to start each job, and to stop
+  std::atomic< unsigned int > m_generation;
+  std::atomic< int > m_next;
+  std::atomic< int > m_finished;
+  std::atomic< bool > m_stop;
+  const std::function< void( int ) >* m_work;
+  int m_count;
+  // Workers blocked waiting for the next job, and what wakes them
+  std::atomic< int > m_sleepers;
+  std::mutex m_lock;
+  std::condition_variable m_wake;
+
+  void worker();
+  void wake();
+};
+
+#endif // EKF_PARALLEL_HEADER_GUARD
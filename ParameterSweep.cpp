@@ -0,0 +1,501 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ParameterSweep.cpp
+/// @brief   Lockstep propagation of one state over a grid of force
+///          model constants.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <Parallel.hpp>
+#include <ParameterSweep.hpp>
+
+namespace
+{
+  // Swept constants, in getParameters order
+  const std::vector< std::string > parameterNames =
+    { "radius", "mu", "J2", "h_ref", "rho_ref", "step", "rot", "Cd" };
+  enum { iRadius, iMu, iJ2, iRefHeight, iRefDensity, iStep, iRot, iCd,
+         numParameters };
+
+  // Model constants of a distinct dynamics
+  enum { kMu, kJ2R2, kCdRho, kRefHeight, kStep, kRot, numConstants };
+
+  // Motion's tolerances
+  const double absTolerance = 1.E-10;
+  const double relTolerance = 1.E-9;
+
+  typedef Eigen::Array< double, ParameterSweep::numLanes, 1 > Lanes;
+
+  // Model constants of a block, by lane
+  struct lane_model
+  {
+    Lanes constants[ numConstants ];
+    bool drag;
+  };
+
+  // Two-body, J2 and drag accelerations of every lane, as in
+  // GravityAction and AtmosphereAction
+  void
+  derivative(
+      const lane_model &model,
+      const Lanes x[6],
+      Lanes dx[6] )
+  {
+    Lanes r2 = x[0] * x[0] + x[1] * x[1] + x[2] * x[2];
+    Lanes r = r2.sqrt();
+    Lanes gravity = -model.constants[ kMu ] / ( r2 * r );
+    Lanes J2 = 1.5 * model.constants[ kJ2R2 ] / r2 *
+               ( 5 * x[2] * x[2] / r2 );
+    Lanes J2Equator = 1.5 * model.constants[ kJ2R2 ] / r2;
+    dx[0] = x[3];
+    dx[1] = x[4];
+    dx[2] = x[5];
+    dx[3] = gravity * x[0] * ( 1 - J2 + J2Equator );
+    dx[4] = gravity * x[1] * ( 1 - J2 + J2Equator );
+    dx[5] = gravity * x[2] * ( 1 - J2 + 3 * J2Equator );
+    if ( !model.drag )
+    {
+      return;
+    }
+
+    const Lanes &rot = model.constants[ kRot ];
+    Lanes vX = x[3] + x[1] * rot;
+    Lanes vY = x[4] - x[0] * rot;
+    Lanes v = ( vX * vX + vY * vY + x[5] * x[5] ).sqrt();
+    Lanes drag = -model.constants[ kCdRho ] * v *
+      ( -( r - model.constants[ kRefHeight ] ) /
+        model.constants[ kStep ] ).exp();
+    dx[3] += drag * vX;
+    dx[4] += drag * vY;
+    dx[5] += drag * x[5];
+  }
+
+  // Dormand-Prince 5(4) tableau
+  const double a21 = 1.0 / 5;
+  const double a31 = 3.0 / 40, a32 = 9.0 / 40;
+  const double a41 = 44.0 / 45, a42 = -56.0 / 15, a43 = 32.0 / 9;
+  const double a51 = 19372.0 / 6561, a52 = -25360.0 / 2187,
+               a53 = 64448.0 / 6561, a54 = -212.0 / 729;
+  const double a61 = 9017.0 / 3168, a62 = -355.0 / 33,
+               a63 = 46732.0 / 5247, a64 = 49.0 / 176,
+               a65 = -5103.0 / 18656;
+  const double b1 = 35.0 / 384, b3 = 500.0 / 1113, b4 = 125.0 / 192,
+               b5 = -2187.0 / 6784, b6 = 11.0 / 84;
+  const double e1 = 71.0 / 57600, e3 = -71.0 / 16695, e4 = 71.0 / 1920,
+               e5 = -17253.0 / 339200, e6 = 22.0 / 525, e7 = -1.0 / 40;
+}
+
+const int ParameterSweep::numLanes;
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+ParameterSweep::
+ParameterSweep()
+    : m_nominal( numParameters, 0.0 ),
+      m_axes(),
+      m_ic( 6, 0.0 ),
+      m_step( 1.0 ),
+      m_epoch(),
+      m_time(),
+      m_numThreads( 0 ),
+      m_distinct(),
+      m_constants(),
+      m_states(),
+      m_logs(),
+      m_times(),
+      m_blockSteps()
+{
+  m_nominal[ iStep ] = 1.0;
+}
+
+// Constructor with the nominal constants of gravity and atmosphere ( or
+// none ), and the state at epoch logged every step
+ParameterSweep::
+ParameterSweep(
+    std::shared_ptr< GravityAction > gravity,
+    std::shared_ptr< AtmosphereAction > atmosphere,
+    const std::vector< double > &ic,
+    double step,
+    double epoch )
+    : m_nominal( numParameters, 0.0 ),
+      m_axes(),
+      m_ic( ic ),
+      m_step( step ),
+      m_epoch( epoch ),
+      m_time( epoch ),
+      m_numThreads( 0 ),
+      m_distinct(),
+      m_constants(),
+      m_states(),
+      m_logs(),
+      m_times(),
+      m_blockSteps()
+{
+  m_nominal[ iRadius ] = gravity->getRadius();
+  m_nominal[ iMu ] = gravity->getMu();
+  m_nominal[ iJ2 ] = gravity->getJ2();
+  m_nominal[ iStep ] = 1.0;
+  if ( atmosphere )
+  {
+    if ( !std::isinf( atmosphere->getCeiling() ) )
+    {
+      std::cout << "ParameterSweep has no drag ceiling" << std::endl;
+      throw;
+    }
+    m_nominal[ iRefHeight ] = atmosphere->getRefHeight();
+    m_nominal[ iRefDensity ] = atmosphere->getRefDensity();
+    m_nominal[ iStep ] = atmosphere->getStepHeight();
+    m_nominal[ iRot ] = atmosphere->getRotation();
+    m_nominal[ iCd ] = atmosphere->getBodyDragTerm();
+  }
+}
+
+// Default Destructor
+ParameterSweep::
+~ParameterSweep()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Add an axis setting agent to each of values
+void
+ParameterSweep::
+addValues(
+    const std::string &agent,
+    const std::vector< double > &values )
+{
+  std::vector< std::string >::const_iterator name =
+    std::find( parameterNames.begin(), parameterNames.end(), agent );
+  if ( ( name == parameterNames.end() ) || values.empty() ||
+       !m_distinct.empty() )
+  {
+    std::cout << "Cannot sweep " << agent << " over " << values.size()
+              << " values" << std::endl;
+    throw;
+  }
+  sweep_axis axis = { (int) ( name - parameterNames.begin() ), false,
+                      values };
+  m_axes.push_back( axis );
+}
+
+// Add an axis scaling agent by each of factors
+void
+ParameterSweep::
+addScales(
+    const std::string &agent,
+    const std::vector< double > &factors )
+{
+  addValues( agent, factors );
+  m_axes.back().scale = true;
+}
+
+// Threads propagating blocks
+void
+ParameterSweep::
+setThreads( unsigned int numThreads )
+{
+  m_numThreads = numThreads;
+}
+
+// Log every step from the last logged state to t, block by block
+void
+ParameterSweep::
+stepTo( double t )
+{
+  if ( m_distinct.empty() )
+  {
+    buildVariants();
+  }
+  int firstOutput = m_times.size();
+  for ( int k = firstOutput;
+        m_epoch + k * m_step <= t + 1.E-9 * std::max( 1.0, std::abs( t ) );
+        ++k )
+  {
+    m_times.push_back( m_epoch + k * m_step );
+  }
+  if ( (int) m_times.size() == firstOutput )
+  {
+    return;
+  }
+
+  parallelFor( 0, m_blockSteps.size(), m_numThreads, [&]( int block )
+  {
+    stepBlock( block, firstOutput );
+  } );
+  m_time = m_times.back();
+}
+
+// Number of variants
+int
+ParameterSweep::
+getNumVariants() const
+{
+  int numVariants = 1;
+  for ( const auto &axis: m_axes )
+  {
+    numVariants *= axis.values.size();
+  }
+  return numVariants;
+}
+
+// Number of distinct dynamics, once built
+int
+ParameterSweep::
+getNumDistinct() const
+{
+  return m_constants.size();
+}
+
+// Constants of a variant, nominal values set and then scaled by its
+// point on each axis, last axis fastest
+std::vector< double >
+ParameterSweep::
+getParameters( int variant ) const
+{
+  std::vector< double > p = m_nominal;
+  for ( int pass = 0; pass < 2; ++pass )
+  {
+    int index = variant;
+    for ( int a = m_axes.size() - 1; a >= 0; --a )
+    {
+      const sweep_axis &axis = m_axes[a];
+      double value = axis.values[ index % axis.values.size() ];
+      index /= axis.values.size();
+      if ( axis.scale && ( pass == 1 ) )
+      {
+        p[ axis.parameter ] *= value;
+      }
+      else if ( !axis.scale && ( pass == 0 ) )
+      {
+        p[ axis.parameter ] = value;
+      }
+    }
+  }
+  return p;
+}
+
+// State of a variant at a logged time
+std::vector< double >
+ParameterSweep::
+getState(
+    int variant,
+    double t ) const
+{
+  std::vector< double >::const_iterator search =
+    std::lower_bound( m_times.begin(), m_times.end(), t );
+  if ( ( search == m_times.end() ) || ( *search != t ) )
+  {
+    std::cout << "No state at time " << t << "." << std::endl;
+    throw;
+  }
+  const std::vector< double > &log = m_logs[ m_distinct[ variant ] ];
+  int k = search - m_times.begin();
+  return std::vector< double >( log.begin() + 6 * k,
+                                log.begin() + 6 * k + 6 );
+}
+
+// Time of the last logged state
+double
+ParameterSweep::
+getTime() const
+{
+  return m_time;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Merge the variants of the grid whose model constants are equal.
+// Distinct dynamics are numbered in order of their constants, so each
+// block of lanes holds neighbours.
+void
+ParameterSweep::
+buildVariants()
+{
+  int numVariants = getNumVariants();
+  std::vector< std::vector< double > > constants( numVariants );
+  for ( int v = 0; v < numVariants; ++v )
+  {
+    std::vector< double > p = getParameters( v );
+    std::vector< double > &c = constants[v];
+    c.assign( numConstants, 0.0 );
+    c[ kMu ] = p[ iMu ];
+    c[ kJ2R2 ] = p[ iJ2 ] * p[ iRadius ] * p[ iRadius ];
+    c[ kCdRho ] = p[ iCd ] * p[ iRefDensity ];
+    c[ kStep ] = 1.0;
+    if ( c[ kCdRho ] != 0 )
+    {
+      c[ kRefHeight ] = p[ iRefHeight ];
+      c[ kStep ] = p[ iStep ];
+      c[ kRot ] = p[ iRot ];
+    }
+  }
+
+  std::vector< int > order( numVariants );
+  std::iota( order.begin(), order.end(), 0 );
+  std::sort( order.begin(), order.end(), [&]( int a, int b )
+  {
+    return constants[a] < constants[b];
+  } );
+  m_distinct.assign( numVariants, 0 );
+  m_constants.clear();
+  for ( int v: order )
+  {
+    if ( m_constants.empty() || ( m_constants.back() != constants[v] ) )
+    {
+      m_constants.push_back( constants[v] );
+    }
+    m_distinct[v] = m_constants.size() - 1;
+  }
+
+  int numDistinct = m_constants.size();
+  m_states.assign( numDistinct, m_ic );
+  m_logs.assign( numDistinct, m_ic );
+  m_times.assign( 1, m_epoch );
+  m_time = m_epoch;
+  m_blockSteps.assign( ( numDistinct + numLanes - 1 ) / numLanes, m_step );
+}
+
+// Step the lanes of one block from the last logged time through
+// m_times from firstOutput, with a step sized by the worst lane and
+// adapted as in odeint's controlled stepper. Lanes past the last
+// distinct dynamics repeat it.
+void
+ParameterSweep::
+stepBlock(
+    int block,
+    int firstOutput )
+{
+  int first = block * numLanes;
+  int count = std::min( numLanes, (int) m_constants.size() - first );
+  lane_model model;
+  Lanes x[6];
+  for ( int l = 0; l < numLanes; ++l )
+  {
+    int d = first + std::min( l, count - 1 );
+    for ( int c = 0; c < numConstants; ++c )
+    {
+      model.constants[c][l] = m_constants[d][c];
+    }
+    for ( int i = 0; i < 6; ++i )
+    {
+      x[i][l] = m_states[d][i];
+    }
+  }
+  model.drag = ( model.constants[ kCdRho ] != 0 ).any();
+
+  Lanes k1[6], k2[6], k3[6], k4[6], k5[6], k6[6], k7[6], y[6], next[6];
+  derivative( model, x, k1 );
+  double time = m_times[ firstOutput - 1 ];
+  double dt = m_blockSteps[ block ];
+  for ( size_t o = firstOutput; o < m_times.size(); ++o )
+  {
+    double target = m_times[o];
+    while ( time < target )
+    {
+      bool last = ( dt >= target - time );
+      double h = last ? target - time : dt;
+      for ( int i = 0; i < 6; ++i )
+      {
+        y[i] = x[i] + h * a21 * k1[i];
+      }
+      derivative( model, y, k2 );
+      for ( int i = 0; i < 6; ++i )
+      {
+        y[i] = x[i] + h * ( a31 * k1[i] + a32 * k2[i] );
+      }
+      derivative( model, y, k3 );
+      for ( int i = 0; i < 6; ++i )
+      {
+        y[i] = x[i] + h * ( a41 * k1[i] + a42 * k2[i] + a43 * k3[i] );
+      }
+      derivative( model, y, k4 );
+      for ( int i = 0; i < 6; ++i )
+      {
+        y[i] = x[i] + h * ( a51 * k1[i] + a52 * k2[i] + a53 * k3[i] +
+                            a54 * k4[i] );
+      }
+      derivative( model, y, k5 );
+      for ( int i = 0; i < 6; ++i )
+      {
+        y[i] = x[i] + h * ( a61 * k1[i] + a62 * k2[i] + a63 * k3[i] +
+                            a64 * k4[i] + a65 * k5[i] );
+      }
+      derivative( model, y, k6 );
+      for ( int i = 0; i < 6; ++i )
+      {
+        next[i] = x[i] + h * ( b1 * k1[i] + b3 * k3[i] + b4 * k4[i] +
+                               b5 * k5[i] + b6 * k6[i] );
+      }
+      derivative( model, next, k7 );
+
+      // Error relative to the tolerance, worst over lanes and components
+      double error = 0.0;
+      for ( int i = 0; i < 6; ++i )
+      {
+        Lanes estimate = h * ( e1 * k1[i] + e3 * k3[i] + e4 * k4[i] +
+                               e5 * k5[i] + e6 * k6[i] + e7 * k7[i] );
+        Lanes scale = absTolerance + relTolerance *
+                      ( x[i].abs() + h * k1[i].abs() );
+        error = std::max( error, ( estimate.abs() / scale ).maxCoeff() );
+      }
+      if ( error > 1 )
+      {
+        dt = h * std::max( 0.9 * std::pow( error, -1.0 / 3 ), 0.2 );
+        continue;
+      }
+
+      for ( int i = 0; i < 6; ++i )
+      {
+        x[i] = next[i];
+        k1[i] = k7[i];
+      }
+      time = last ? target : time + h;
+      if ( error < 0.5 )
+      {
+        error = std::max( std::pow( 5.0, -5.0 ), error );
+        h *= 0.9 * std::pow( error, -1.0 / 5 );
+      }
+      if ( !last || ( h > dt ) )
+      {
+        dt = h;
+      }
+    }
+
+    for ( int l = 0; l < count; ++l )
+    {
+      for ( int i = 0; i < 6; ++i )
+      {
+        m_logs[ first + l ].push_back( x[i][l] );
+      }
+    }
+  }
+
+  for ( int l = 0; l < count; ++l )
+  {
+    for ( int i = 0; i < 6; ++i )
+    {
+      m_states[ first + l ][i] = x[i][l];
+    }
+  }
+  m_blockSteps[ block ] = dt;
+}
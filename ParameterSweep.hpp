@@ -0,0 +1,125 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ParameterSweep.hpp
+/// @brief   Lockstep propagation of one state over a grid of force
+///          model constants.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_PARAMETERSWEEP_HEADER_GUARD
+#define EKF_PARAMETERSWEEP_HEADER_GUARD
+
+// C++ Standard Library
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <AtmosphereAction.hpp>
+#include <GravityAction.hpp>
+
+/// @brief Propagate a state under every combination of a grid of force
+/// model constants.
+///
+/// The constants are those of a GravityAction and AtmosphereAction,
+/// named by their agents: radius, mu, J2, h_ref, rho_ref, step, rot and
+/// Cd ( the body drag term ). Each axis of the grid either sets one of
+/// them to a list of values, or scales it by a list of factors, so a
+/// Cd sweep and an area to mass sweep are two scale axes of Cd, and a
+/// density scale a scale axis of rho_ref. Every combination of the axes
+/// is a variant.
+///
+/// Variants are propagated in lockstep, numLanes to a block, with the
+/// state of each block held as one array per component and every
+/// operation of the force model applied to all lanes at once, which the
+/// compiler vectorizes. Each block takes a Dormand-Prince 5(4) step
+/// sized by its worst lane, with Motion's tolerances and controller, so
+/// every lane lands on the same output epochs. Blocks are spread over
+/// threads. Variants are sorted by their constants before being grouped,
+/// so the lanes of a block stay close and share similar steps.
+///
+/// Work is shared across variants with the same dynamics: the force
+/// model depends on the constants only through mu, J2 R^2, Cd rho_ref,
+/// h_ref, step and rot ( and not at all on the last three without
+/// drag ), so variants equal in those, such as Cd and density scales
+/// with equal products, are propagated once.
+///
+/// Only the state is propagated, not the STM, with the force model of
+/// GravityAction and AtmosphereAction written out for lanes.
+///
+class ParameterSweep
+{
+ public:
+  ParameterSweep();
+  ParameterSweep( std::shared_ptr< GravityAction > gravity,
+                  std::shared_ptr< AtmosphereAction > atmosphere,
+                  const std::vector< double > &ic, double step,
+                  double epoch );
+ ~ParameterSweep();
+
+  // Add an axis setting agent to each of values, or scaling it by each
+  // of factors. Values are set before any scale applies, and the axes
+  // are fixed by the first stepTo.
+  void addValues( const std::string &agent,
+                  const std::vector< double > &values );
+  void addScales( const std::string &agent,
+                  const std::vector< double > &factors );
+  // Propagate blocks on numThreads threads ( 0, the default, means one
+  // per core )
+  void setThreads( unsigned int numThreads );
+
+  // Propagate every variant to time t, logging the states every step
+  // from the epoch
+  void stepTo( double t );
+
+  // Number of variants, the product of the axis lengths
+  int getNumVariants() const;
+  // Number of variants with distinct dynamics, each propagated once
+  int getNumDistinct() const;
+  // Constants of a variant: radius, mu, J2, h_ref, rho_ref, step, rot
+  // and Cd
+  std::vector< double > getParameters( int variant ) const;
+  // State of a variant at a logged time t
+  std::vector< double > getState( int variant, double t ) const;
+  // Time of the last logged state
+  double getTime() const;
+
+  // Variants propagated together
+  static const int numLanes = 8;
+
+ private:
+  struct sweep_axis
+  {
+    int parameter;
+    bool scale;
+    std::vector< double > values;
+  };
+
+  // Nominal constants, in getParameters order
+  std::vector< double > m_nominal;
+  std::vector< sweep_axis > m_axes;
+  std::vector< double > m_ic;
+  double m_step;
+  double m_epoch;
+  double m_time;
+  unsigned int m_numThreads;
+
+  // Distinct dynamics of every variant
+  std::vector< int > m_distinct;
+  // Per distinct dynamics: its model constants ( mu, J2 R^2, Cd rho_ref,
+  // h_ref, step, rot ), state and states logged at m_times
+  std::vector< std::vector< double > > m_constants;
+  std::vector< std::vector< double > > m_states;
+  std::vector< std::vector< double > > m_logs;
+  std::vector< double > m_times;
+  // Last step size of each block
+  std::vector< double > m_blockSteps;
+
+  void buildVariants();
+  void stepBlock( int block, int firstOutput );
+};
+
+#endif // EKF_PARAMETERSWEEP_HEADER_GUARD
@@ -0,0 +1,366 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    Parareal.cpp
+/// @brief   Parallel-in-time propagation of Motion over long arcs.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+// POSIX
+#include <time.h>
+
+// boost Library
+#include <boost/numeric/odeint.hpp>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <OdeintHelper.hpp>
+#include <Parallel.hpp>
+#include <Parareal.hpp>
+
+namespace
+{
+  // CPU time of the calling thread
+  double
+  threadSeconds()
+  {
+    timespec now;
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &now );
+    return now.tv_sec + 1.E-9 * now.tv_nsec;
+  }
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+Parareal::
+Parareal()
+    : m_fineActions(),
+      m_coarseActions(),
+      m_coarseStep(),
+      m_numSlices(),
+      m_numThreads(),
+      m_tolerance( 1.E-9 ),
+      m_report()
+{
+}
+
+// Constructor with coarse action and slicing of the arc
+Parareal::
+Parareal(
+    std::shared_ptr< Action > coarseAction,
+    double coarseStep,
+    int numSlices,
+    unsigned int numThreads )
+    : m_fineActions(),
+      m_coarseActions( 1, coarseAction ),
+      m_coarseStep( coarseStep ),
+      m_numSlices( numSlices ),
+      m_numThreads( resolveThreads( numThreads ) ),
+      m_tolerance( 1.E-9 ),
+      m_report()
+{
+}
+
+// Default Destructor
+Parareal::
+~Parareal()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Propagate the state and partials from t0 to t1
+std::map< double, std::vector< double > >
+Parareal::
+propagate(
+    const std::vector< std::shared_ptr< Action > > &fineActions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0,
+    double t1,
+    double step )
+{
+  typedef std::chrono::steady_clock clock;
+  clock::time_point wallStart = clock::now();
+
+  m_fineActions = fineActions;
+
+  std::vector< double > bounds = sliceBoundaries( t0, t1, step );
+  int numSlices = bounds.size() - 1;
+
+  // Seed the slice boundaries with a serial coarse sweep
+  double coarseStart = threadSeconds();
+  std::vector< double > ic( stateAndPartials.begin(),
+                            stateAndPartials.begin() + 6 );
+  std::vector< std::vector< double > > U( numSlices + 1, ic );
+  std::vector< std::vector< double > > G( numSlices );
+  for ( int n = 0; n < numSlices; ++n )
+  {
+    G[n] = coarse( U[n], bounds[n], bounds[n + 1] );
+    U[n + 1] = G[n];
+  }
+  double coarseSeconds = threadSeconds() - coarseStart;
+
+  // Correct the boundaries until they no longer move. After iteration
+  // k the first k slices are exact, so only the rest are re-run.
+  std::vector< std::vector< double > > F( numSlices );
+  std::vector< double > fineSeconds( numSlices, 0.0 );
+  int k = 0;
+  double maxCorrection = 0.0;
+  for ( k = 0; k < numSlices; ++k )
+  {
+    parallelFor( k, numSlices, m_numThreads, [&]( int n )
+    {
+      double sliceStart = threadSeconds();
+      F[n] = fine( U[n], bounds[n], bounds[n + 1], step );
+      fineSeconds[n] += threadSeconds() - sliceStart;
+    } );
+
+    coarseStart = threadSeconds();
+    maxCorrection = 0.0;
+    for ( int n = k; n < numSlices; ++n )
+    {
+      std::vector< double > Gn = coarse( U[n], bounds[n], bounds[n + 1] );
+      double diff = 0.0;
+      double norm = 0.0;
+      for ( int i = 0; i < 6; ++i )
+      {
+        double corrected = Gn[i] + F[n][i] - G[n][i];
+        diff += pow( corrected - U[n + 1][i], 2 );
+        norm += pow( corrected, 2 );
+        U[n + 1][i] = corrected;
+      }
+      G[n] = Gn;
+      maxCorrection = std::max( maxCorrection, sqrt( diff / norm ) );
+    }
+    coarseSeconds += threadSeconds() - coarseStart;
+
+    if ( maxCorrection < m_tolerance )
+    {
+      ++k;
+      break;
+    }
+  }
+
+  // Final sweep from the converged boundaries, carrying the partials
+  int numAgents = activeAgents.size();
+  std::vector< std::map< double, std::vector< double > > > logs( numSlices );
+  std::vector< double > sliceSeconds( numSlices, 0.0 );
+  parallelFor( 0, numSlices, m_numThreads, [&]( int n )
+  {
+    double sliceStart = threadSeconds();
+    fineWithPartials( U[n], activeAgents, bounds[n], bounds[n + 1], step,
+                      logs[n] );
+    sliceSeconds[n] = threadSeconds() - sliceStart;
+  } );
+
+  // Chain the slice STMs onto the incoming partials, and put the log
+  // times back on the serial step grid t0 + i * step, but for t1.
+  typedef Eigen::Matrix< double, Eigen::Dynamic, Eigen::Dynamic,
+                         Eigen::RowMajor > RowMatrix;
+  RowMatrix stmIn = Eigen::Map< const RowMatrix >(
+    stateAndPartials.data() + 6, numAgents, numAgents );
+  std::map< double, std::vector< double > > pastStates;
+  for ( int n = 0; n < numSlices; ++n )
+  {
+    RowMatrix stmOut = stmIn;
+    for ( auto entry: logs[n] )
+    {
+      std::vector< double > x = entry.second;
+      Eigen::Map< RowMatrix > stm( x.data() + 6, numAgents, numAgents );
+      stmOut = stm * stmIn;
+      stm = stmOut;
+
+      double i = std::round( ( entry.first - t0 ) / step );
+      double time = std::min( t0 + i * step, t1 );
+      if ( entry.first == bounds.back() )
+      {
+        time = t1;
+      }
+      pastStates.insert( std::make_pair( time, x ) );
+    }
+    stmIn = stmOut;
+  }
+
+  m_report.iterations = k;
+  m_report.numSlices = numSlices;
+  m_report.numThreads = m_numThreads;
+  m_report.numCores = std::thread::hardware_concurrency();
+  m_report.maxCorrection = maxCorrection;
+  m_report.wallSeconds =
+    std::chrono::duration< double >( clock::now() - wallStart ).count();
+  m_report.serialSeconds = 0.0;
+  m_report.cpuSeconds = coarseSeconds;
+  for ( int n = 0; n < numSlices; ++n )
+  {
+    m_report.serialSeconds += sliceSeconds[n];
+    m_report.cpuSeconds += sliceSeconds[n] + fineSeconds[n];
+  }
+  m_report.speedup = m_report.serialSeconds / m_report.wallSeconds;
+
+  return pastStates;
+}
+
+// Set the relative boundary correction at which iteration stops
+void
+Parareal::
+setTolerance( double tolerance )
+{
+  m_tolerance = tolerance;
+}
+
+// Get the summary of the last propagation
+const PararealReport&
+Parareal::
+getReport() const
+{
+  return m_report;
+}
+
+// Pretty print the summary of the last propagation
+void
+Parareal::
+printReport() const
+{
+  std::cout << "\n### Parareal propagation" << std::endl
+            << "Slices: " << m_report.numSlices << std::endl
+            << "Iterations: " << m_report.iterations << std::endl
+            << "Max correction: " << m_report.maxCorrection << std::endl
+            << "Threads / cores: " << m_report.numThreads << " / "
+            << m_report.numCores << std::endl
+            << "Wall time [s]: " << m_report.wallSeconds << std::endl
+            << "Serial fine CPU time [s]: " << m_report.serialSeconds
+            << std::endl
+            << "Total CPU time [s]: " << m_report.cpuSeconds << std::endl
+            << "Speedup: " << m_report.speedup << std::endl;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Split [t0, t1] into slices whose boundaries lie on the step grid. An
+// epoch off the grid gets a last slice of its own, shorter than a step.
+std::vector< double >
+Parareal::
+sliceBoundaries(
+    double t0,
+    double t1,
+    double step ) const
+{
+  int numSteps = std::floor( ( t1 - t0 ) / step + 1.E-9 );
+  int numSlices = std::min( std::max( 1, m_numSlices ), numSteps );
+
+  std::vector< double > bounds( numSlices + 1, t0 );
+  for ( int n = 1; n <= numSlices; ++n )
+  {
+    bounds[n] = t0 + ( numSteps * n / numSlices ) * step;
+  }
+  if ( ( numSlices == 0 ) || ( t1 - bounds.back() > 1.E-9 * step ) )
+  {
+    bounds.push_back( t1 );
+  }
+  bounds.back() = t1;
+  return bounds;
+}
+
+// Coarse propagator: fixed RKF78 steps of about m_coarseStep. A high
+// order fixed stepper keeps the coarse phase error small enough for
+// the corrections to contract on orbital arcs.
+std::vector< double >
+Parareal::
+coarse(
+    const std::vector< double > &state,
+    double t0,
+    double t1 )
+{
+  using namespace boost::numeric::odeint;
+
+  AgentGroup noAgents;
+  OdeintHelper helper( m_coarseActions, noAgents );
+
+  int numSteps = std::max( 1, int( std::ceil( ( t1 - t0 ) / m_coarseStep ) ) );
+  std::vector< double > x( state );
+  integrate_n_steps( runge_kutta_fehlberg78< std::vector< double > >(),
+                     helper, x, t0, ( t1 - t0 ) / numSteps, numSteps );
+  return x;
+}
+
+// Fine propagator: the full action set under dopri5, state only
+std::vector< double >
+Parareal::
+fine(
+    const std::vector< double > &state,
+    double t0,
+    double t1,
+    double step )
+{
+  using namespace boost::numeric::odeint;
+
+  typedef runge_kutta_dopri5< std::vector< double > > rkStepper;
+
+  AgentGroup noAgents;
+  OdeintHelper helper( m_fineActions, noAgents );
+
+  std::vector< double > x( state );
+  double last = t0 + std::floor( ( t1 - t0 ) / step + 1.E-9 ) * step;
+  integrate_const( make_controlled( 1.E-10, 1.E-9, rkStepper() ), helper, x,
+                   t0, last, step );
+  if ( last < t1 )
+  {
+    integrate_adaptive( make_controlled( 1.E-10, 1.E-9, rkStepper() ),
+                        helper, x, last, t1, t1 - last );
+  }
+  return x;
+}
+
+// Fine propagator carrying an identity STM from t0, logging each step
+void
+Parareal::
+fineWithPartials(
+    const std::vector< double > &state,
+    const AgentGroup &activeAgents,
+    double t0,
+    double t1,
+    double step,
+    std::map< double, std::vector< double > > &log )
+{
+  using namespace boost::numeric::odeint;
+
+  typedef runge_kutta_dopri5< std::vector< double > > rkStepper;
+
+  AgentGroup agents( activeAgents );
+  OdeintHelper helper( m_fineActions, agents );
+
+  int numAgents = agents.size();
+  std::vector< double > x( 6 + numAgents * numAgents, 0.0 );
+  std::copy( state.begin(), state.begin() + 6, x.begin() );
+  for ( int i = 0; i < numAgents; ++i )
+  {
+    x[ 6 + numAgents * i + i ] = 1;
+  }
+
+  double last = t0 + std::floor( ( t1 - t0 ) / step + 1.E-9 ) * step;
+  integrate_const( make_controlled( 1.E-10, 1.E-9, rkStepper() ), helper, x,
+                   t0, last, step, log_state( log ) );
+  if ( last < t1 )
+  {
+    integrate_adaptive( make_controlled( 1.E-10, 1.E-9, rkStepper() ),
+                        helper, x, last, t1, t1 - last );
+    log[ t1 ] = x;
+  }
+}
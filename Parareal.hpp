@@ -0,0 +1,104 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    Parareal.hpp
+/// @brief   Parallel-in-time propagation of Motion over long arcs.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_PARAREAL_HEADER_GUARD
+#define EKF_PARAREAL_HEADER_GUARD
+
+// C++ Standard Library
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <Propagator.hpp>
+
+/// @brief Timing and convergence summary of a Parareal propagation.
+///
+/// Times are CPU time of the threads that did the work, so a thread
+/// waiting for a core is not counted. serialSeconds is that of the
+/// final sweep, the fine integration with partials of every slice,
+/// which is about what a serial propagation of the arc costs; speedup
+/// is it over wallSeconds, and below 1 when the iterations cost more
+/// than the threads gain. cpuSeconds is the work of every sweep, coarse
+/// and fine, over all threads.
+///
+struct PararealReport
+{
+  int iterations;
+  int numSlices;
+  unsigned int numThreads;
+  unsigned int numCores;
+  double maxCorrection;
+  double wallSeconds;
+  double serialSeconds;
+  double cpuSeconds;
+  double speedup;
+};
+
+/// @brief Parallel-in-time propagation of a state over a long arc.
+///
+/// The arc is cut into time slices. A cheap coarse propagator (a
+/// single Action, typically two-body + J2, integrated with large fixed
+/// RKF78 steps) seeds the slice boundaries, then the fine propagator
+/// (the full Action set under dopri5) is run concurrently on every
+/// slice and the boundaries are corrected until they stop moving.
+///
+/// Once converged, a final concurrent sweep integrates each slice with
+/// an identity STM; the slice STMs are chained so the logged partials
+/// match those of a serial propagation.
+///
+class Parareal : public Propagator
+{
+ public:
+  Parareal();
+  Parareal( std::shared_ptr< Action > coarseAction, double coarseStep,
+            int numSlices, unsigned int numThreads );
+ ~Parareal() override;
+
+  // Propagate stateAndPartials from t0 to t1 under the fine action
+  // set, logging every step in the returned map as Motion::stepTo would.
+  std::map< double, std::vector< double > > propagate(
+    const std::vector< std::shared_ptr< Action > > &fineActions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0, double t1, double step ) override;
+
+  // Set the relative boundary correction at which iteration stops
+  void setTolerance( double tolerance );
+
+  // Get the summary of the last propagation
+  const PararealReport& getReport() const;
+  // Print the summary of the last propagation to cout
+  void printReport() const;
+
+ private:
+  std::vector< std::shared_ptr< Action > > m_fineActions;
+  std::vector< std::shared_ptr< Action > > m_coarseActions;
+  double m_coarseStep;
+  int m_numSlices;
+  unsigned int m_numThreads;
+  double m_tolerance;
+  PararealReport m_report;
+
+  std::vector< double > sliceBoundaries( double t0, double t1,
+                                         double step ) const;
+  std::vector< double > coarse( const std::vector< double > &state,
+                                double t0, double t1 );
+  std::vector< double > fine( const std::vector< double > &state,
+                              double t0, double t1, double step );
+  void fineWithPartials( const std::vector< double > &state,
+                         const AgentGroup &activeAgents,
+                         double t0, double t1, double step,
+                         std::map< double, std::vector< double > > &log );
+};
+
+#endif // EKF_PARAREAL_HEADER_GUARD
@@ -0,0 +1,292 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    PropagationCache.cpp
+/// @brief   Memory bounded cache of propagated arcs, keyed by initial
+///          state, Action parameters and span.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
+
+// ekf Library
+#include <PropagationCache.hpp>
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor ( 64 MB )
+PropagationCache::
+PropagationCache()
+    : m_maxBytes( 64 << 20 ),
+      m_bytes( 0 ),
+      m_hits( 0 ),
+      m_misses( 0 ),
+      m_evictions( 0 ),
+      m_entries(),
+      m_index(),
+      m_mutex()
+{
+}
+
+// Constructor holding at most about maxBytes of arcs
+PropagationCache::
+PropagationCache(
+    std::size_t maxBytes )
+    : m_maxBytes( maxBytes ),
+      m_bytes( 0 ),
+      m_hits( 0 ),
+      m_misses( 0 ),
+      m_evictions( 0 ),
+      m_entries(),
+      m_index(),
+      m_mutex()
+{
+}
+
+// Default Destructor
+PropagationCache::
+~PropagationCache()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Serve the arc stored under ( structure, values ), marking it most
+// recently used
+bool
+PropagationCache::
+find(
+    const std::string &structure,
+    const std::vector< double > &values,
+    std::map< double, std::vector< double > > &states )
+{
+  std::lock_guard< std::mutex > lock( m_mutex );
+  std::list< cache_entry >::iterator entry =
+    lookup( structure, values, hashKey( structure, values ) );
+  if ( entry == m_entries.end() )
+  {
+    ++m_misses;
+    return false;
+  }
+  m_entries.splice( m_entries.begin(), m_entries, entry );
+  states = entry->states;
+  ++m_hits;
+  return true;
+}
+
+// Store an arc as the most recently used. Its size is estimated from
+// the vectors held and the map nodes holding them.
+void
+PropagationCache::
+insert(
+    const std::string &structure,
+    const std::vector< double > &values,
+    const std::map< double, std::vector< double > > &states )
+{
+  std::lock_guard< std::mutex > lock( m_mutex );
+  std::size_t hash = hashKey( structure, values );
+  if ( lookup( structure, values, hash ) != m_entries.end() )
+  {
+    return;
+  }
+
+  std::size_t bytes = sizeof( cache_entry ) + structure.size() +
+                      values.size() * sizeof( double );
+  for ( const auto &s: states )
+  {
+    bytes += 4 * sizeof( void* ) + sizeof( s ) +
+             s.second.size() * sizeof( double );
+  }
+  if ( bytes > m_maxBytes )
+  {
+    return;
+  }
+
+  cache_entry entry;
+  entry.structure = structure;
+  entry.values = values;
+  entry.states = states;
+  entry.hash = hash;
+  entry.bytes = bytes;
+  m_entries.push_front( entry );
+  m_index.insert( std::make_pair( hash, m_entries.begin() ) );
+  m_bytes += bytes;
+  evict();
+}
+
+// The stored arc of the same structure and number of values closest to
+// values
+bool
+PropagationCache::
+findNearest(
+    const std::string &structure,
+    const std::vector< double > &values,
+    std::map< double, std::vector< double > > &states,
+    double &distance ) const
+{
+  std::lock_guard< std::mutex > lock( m_mutex );
+  std::list< cache_entry >::const_iterator nearest = m_entries.end();
+  distance = std::numeric_limits< double >::infinity();
+  for ( auto entry = m_entries.begin(); entry != m_entries.end(); ++entry )
+  {
+    if ( ( entry->structure != structure ) ||
+         ( entry->values.size() != values.size() ) )
+    {
+      continue;
+    }
+    double d = 0.0;
+    for ( size_t i = 0; i < values.size(); ++i )
+    {
+      d = std::max( d, std::abs( entry->values[i] - values[i] ) /
+                       ( 1.0 + std::abs( values[i] ) ) );
+    }
+    if ( d < distance )
+    {
+      distance = d;
+      nearest = entry;
+    }
+  }
+  if ( nearest == m_entries.end() )
+  {
+    return false;
+  }
+  states = nearest->states;
+  return true;
+}
+
+// Drop every entry
+void
+PropagationCache::
+clear()
+{
+  std::lock_guard< std::mutex > lock( m_mutex );
+  m_entries.clear();
+  m_index.clear();
+  m_bytes = 0;
+}
+
+// Lookups served from the cache
+int
+PropagationCache::
+getHits() const
+{
+  std::lock_guard< std::mutex > lock( m_mutex );
+  return m_hits;
+}
+
+// Lookups not found
+int
+PropagationCache::
+getMisses() const
+{
+  std::lock_guard< std::mutex > lock( m_mutex );
+  return m_misses;
+}
+
+// Entries dropped to stay within the memory bound
+int
+PropagationCache::
+getEvictions() const
+{
+  std::lock_guard< std::mutex > lock( m_mutex );
+  return m_evictions;
+}
+
+// Entries held
+int
+PropagationCache::
+getEntries() const
+{
+  std::lock_guard< std::mutex > lock( m_mutex );
+  return m_entries.size();
+}
+
+// Estimated size of the entries held
+std::size_t
+PropagationCache::
+getBytes() const
+{
+  std::lock_guard< std::mutex > lock( m_mutex );
+  return m_bytes;
+}
+
+// Memory bound
+std::size_t
+PropagationCache::
+getMaxBytes() const
+{
+  return m_maxBytes;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Hash of the structure string and the bit patterns of the values
+std::size_t
+PropagationCache::
+hashKey(
+    const std::string &structure,
+    const std::vector< double > &values ) const
+{
+  std::size_t hash = std::hash< std::string >()( structure );
+  std::hash< double > hasher;
+  for ( double v: values )
+  {
+    hash ^= hasher( v ) + 0x9e3779b9 + ( hash << 6 ) + ( hash >> 2 );
+  }
+  return hash;
+}
+
+// The entry stored under exactly ( structure, values ), or end()
+std::list< PropagationCache::cache_entry >::iterator
+PropagationCache::
+lookup(
+    const std::string &structure,
+    const std::vector< double > &values,
+    std::size_t hash )
+{
+  auto range = m_index.equal_range( hash );
+  for ( auto it = range.first; it != range.second; ++it )
+  {
+    if ( ( it->second->structure == structure ) &&
+         ( it->second->values == values ) )
+    {
+      return it->second;
+    }
+  }
+  return m_entries.end();
+}
+
+// Drop least recently used entries until within the memory bound
+void
+PropagationCache::
+evict()
+{
+  while ( ( m_bytes > m_maxBytes ) && !m_entries.empty() )
+  {
+    std::list< cache_entry >::iterator last = std::prev( m_entries.end() );
+    auto range = m_index.equal_range( last->hash );
+    for ( auto it = range.first; it != range.second; ++it )
+    {
+      if ( it->second == last )
+      {
+        m_index.erase( it );
+        break;
+      }
+    }
+    m_bytes -= last->bytes;
+    m_entries.pop_back();
+    ++m_evictions;
+  }
+}
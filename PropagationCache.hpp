@@ -0,0 +1,106 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    PropagationCache.hpp
+/// @brief   Memory bounded cache of propagated arcs, keyed by initial
+///          state, Action parameters and span.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_PROPAGATIONCACHE_HEADER_GUARD
+#define EKF_PROPAGATIONCACHE_HEADER_GUARD
+
+// C++ Standard Library
+#include <cstddef>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// @brief Memory bounded cache of propagated arcs.
+///
+/// Batch least squares and iterated filters propagate the same arc again
+/// and again. A Motion given a cache ( Motion::setCache ) looks every
+/// stepTo up first, and stores what it integrates on a miss.
+///
+/// An arc is keyed by two parts:
+///   - structure: everything that must match exactly and is not a
+///     number ( Action types, active agents, the integrator )
+///   - values: the initial state and STM, the span and output step, and
+///     the parameters of every Action ( Action::getParameters )
+/// A hit needs both to match exactly, so a served arc is the arc that
+/// would have been integrated. findNearest() returns the stored arc of
+/// the same structure closest in values, to seed an iterative
+/// integrator for a near repeat.
+///
+/// Entries are dropped least recently used first once their estimated
+/// size passes maxBytes. The cache may be shared by Motions on several
+/// threads.
+///
+class PropagationCache
+{
+ public:
+  PropagationCache();
+  PropagationCache( std::size_t maxBytes );
+ ~PropagationCache();
+
+  // Fills states with the arc stored under ( structure, values ) and
+  // returns true, or returns false ( a miss )
+  bool find( const std::string &structure, const std::vector< double > &values,
+             std::map< double, std::vector< double > > &states );
+  // Stores an arc, evicting the least recently used as needed
+  void insert( const std::string &structure,
+               const std::vector< double > &values,
+               const std::map< double, std::vector< double > > &states );
+  // Fills states with the stored arc of the same structure closest to
+  // values ( largest difference relative to 1 + | value | ), and its
+  // distance. Returns false if there is none.
+  bool findNearest( const std::string &structure,
+                    const std::vector< double > &values,
+                    std::map< double, std::vector< double > > &states,
+                    double &distance ) const;
+  // Drop every entry ( statistics are kept )
+  void clear();
+
+  // Statistics
+  int getHits() const;
+  int getMisses() const;
+  int getEvictions() const;
+  int getEntries() const;
+  std::size_t getBytes() const;
+  std::size_t getMaxBytes() const;
+
+ private:
+  struct cache_entry
+  {
+    std::string structure;
+    std::vector< double > values;
+    std::map< double, std::vector< double > > states;
+    std::size_t hash;
+    std::size_t bytes;
+  };
+
+  std::size_t m_maxBytes;
+  std::size_t m_bytes;
+  int m_hits;
+  int m_misses;
+  int m_evictions;
+  // Most recently used first
+  std::list< cache_entry > m_entries;
+  std::unordered_multimap< std::size_t,
+                           std::list< cache_entry >::iterator > m_index;
+  mutable std::mutex m_mutex;
+
+  std::size_t hashKey( const std::string &structure,
+                       const std::vector< double > &values ) const;
+  std::list< cache_entry >::iterator lookup(
+    const std::string &structure, const std::vector< double > &values,
+    std::size_t hash );
+  void evict();
+};
+
+#endif // EKF_PROPAGATIONCACHE_HEADER_GUARD
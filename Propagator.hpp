@@ -0,0 +1,66 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    Propagator.hpp
+/// @brief   Base class for integration schemes that can replace the
+///          default dopri5 integration in Motion::stepTo.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#ifndef EKF_PROPAGATOR_HEADER_GUARD
+#define EKF_PROPAGATOR_HEADER_GUARD
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+
+class Propagator
+{
+ public:
+  // Constructor
+  Propagator(){};
+
+  // Propagates stateAndPartials ( state followed by the row major STM
+  // over activeAgents ) from t0 to t1 under the passed in actions, and
+  // returns the state at every time of outputTimes: the grid
+  // t0 + i * step up to t1, and t1 itself, logged at t1 exactly.
+  virtual std::map< double, std::vector< double > > propagate(
+    const std::vector< std::shared_ptr< Action > > &actions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0, double t1, double step ) = 0;
+
+  // Destructor
+  virtual ~Propagator(){};
+
+ protected:
+  // The output times of propagate, from t0. An epoch t1 off the grid
+  // follows the last grid time short of it, as in Motion::stepTo, and
+  // one within roundoff of the grid replaces that grid time.
+  std::vector< double > outputTimes( double t0, double t1,
+                                     double step ) const
+  {
+    int numSteps = std::floor( ( t1 - t0 ) / step + 1.E-9 );
+    std::vector< double > times( 1, t0 );
+    for ( int i = 1; i <= numSteps; ++i )
+    {
+      times.push_back( t0 + i * step );
+    }
+    if ( t1 - times.back() > 1.E-9 * step )
+    {
+      times.push_back( t1 );
+    }
+    times.back() = std::max( t0, t1 );
+    return times;
+  };
+};
+
+#endif // EKF_PROPAGATOR_HEADER_GUARD
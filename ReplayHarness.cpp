@@ -0,0 +1,384 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ReplayHarness.cpp
+/// @brief   Replay of recorded measurements through the filter, timed.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <ReplayHarness.hpp>
+
+namespace
+{
+  const double pi = 3.14159265358979323846;
+
+  typedef std::chrono::steady_clock replay_clock;
+
+  // A measurement file mapped read only for the life of the object
+  class mapped_file
+  {
+   public:
+    mapped_file( const std::string &path )
+        : m_data( 0 ),
+          m_size( 0 ),
+          m_count( 0 )
+    {
+      int fd = open( path.c_str(), O_RDONLY );
+      struct stat status;
+      if ( ( fd < 0 ) || ( fstat( fd, &status ) != 0 ) )
+      {
+        std::cout << "Cannot open " << path << std::endl;
+        throw;
+      }
+      m_size = status.st_size;
+      if ( m_size > 0 )
+      {
+        void *data = mmap( 0, m_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        m_data = ( data == MAP_FAILED ) ? 0 : data;
+      }
+      close( fd );
+      m_count = MeasurementFile::countRecords(
+        static_cast< const char* >( m_data ), m_size, path );
+    }
+
+   ~mapped_file()
+    {
+      munmap( m_data, m_size );
+    }
+
+    const Measurement*
+    measurements() const
+    {
+      return reinterpret_cast< const Measurement* >(
+        static_cast< const char* >( m_data ) + MeasurementFile::headerSize );
+    }
+
+    std::size_t
+    count() const
+    {
+      return m_count;
+    }
+
+   private:
+    void *m_data;
+    std::size_t m_size;
+    std::size_t m_count;
+
+    mapped_file( const mapped_file& );
+    mapped_file& operator=( const mapped_file& );
+  };
+
+  // Nearest rank percentile of latencies, reordering them
+  double
+  percentile(
+      std::vector< double > &latencies,
+      double fraction )
+  {
+    std::size_t rank = std::ceil( fraction * latencies.size() );
+    std::vector< double >::iterator nth =
+      latencies.begin() + std::max( rank, (std::size_t) 1 ) - 1;
+    std::nth_element( latencies.begin(), nth, latencies.end() );
+    return *nth;
+  }
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor, on a body of unit radius at rest
+ReplayHarness::
+ReplayHarness()
+    : m_radius( 1.0 ),
+      m_rotation( 0.0 ),
+      m_speed( 0.0 ),
+      m_latitude(),
+      m_longitude(),
+      m_rangeNoise(),
+      m_rangeRateNoise(),
+      m_angleNoise(),
+      m_motions(),
+      m_knowledge()
+{
+}
+
+// Constructor with the radius and rotation rate of the body the
+// stations sit on
+ReplayHarness::
+ReplayHarness(
+    double radius,
+    double rotation )
+    : m_radius( radius ),
+      m_rotation( rotation ),
+      m_speed( 0.0 ),
+      m_latitude(),
+      m_longitude(),
+      m_rangeNoise(),
+      m_rangeRateNoise(),
+      m_angleNoise(),
+      m_motions(),
+      m_knowledge()
+{
+}
+
+// Default Destructor
+ReplayHarness::
+~ReplayHarness()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Add a station with unit noise
+int
+ReplayHarness::
+addStation(
+    double latitude,
+    double longitude )
+{
+  m_latitude.push_back( latitude );
+  m_longitude.push_back( longitude );
+  m_rangeNoise.push_back( 1.0 );
+  m_rangeRateNoise.push_back( 1.0 );
+  m_angleNoise.push_back( 1.0 );
+  return m_latitude.size() - 1;
+}
+
+// Noise standard deviations of a station
+void
+ReplayHarness::
+setNoise(
+    int station,
+    double range,
+    double rangeRate,
+    double angle )
+{
+  m_rangeNoise[ station ] = range;
+  m_rangeRateNoise[ station ] = rangeRate;
+  m_angleNoise[ station ] = angle;
+}
+
+// Add an object, whose Knowledge must be over the Motion's active
+// agents in their order
+int
+ReplayHarness::
+addObject(
+    std::shared_ptr< Motion > motion,
+    std::shared_ptr< Knowledge > knowledge )
+{
+  const std::vector< int > &estimated = knowledge->getAgents().getIds();
+  const std::vector< int > &active = motion->getActiveAgents().getIds();
+  if ( ( knowledge->getNumEstimated() != (int) active.size() ) ||
+       !std::equal( active.begin(), active.end(), estimated.begin() ) )
+  {
+    std::cout << "Knowledge of object " << m_motions.size()
+              << " is not over its Motion's active agents" << std::endl;
+    throw;
+  }
+  // Log the state at the Motion's epoch, which a new Motion has not, so
+  // a measurement there finds it
+  motion->stepTo( motion->getTime() );
+  m_motions.push_back( motion );
+  m_knowledge.push_back( knowledge );
+  return m_motions.size() - 1;
+}
+
+// Replay speed, as a multiple of real time
+void
+ReplayHarness::
+setSpeed( double factor )
+{
+  m_speed = factor;
+}
+
+// Map the file, put its measurements in time order, then time each
+// update through the filter
+ReplayReport
+ReplayHarness::
+replay( const std::string &path )
+{
+  mapped_file file( path );
+  const Measurement *measurements = file.measurements();
+  std::size_t count = file.count();
+
+  int numObjects = m_motions.size();
+  int numStations = m_latitude.size();
+  std::vector< std::size_t > order( count );
+  for ( std::size_t k = 0; k < count; ++k )
+  {
+    if ( ( measurements[k].object < 0 ) ||
+         ( measurements[k].object >= numObjects ) ||
+         ( measurements[k].station < 0 ) ||
+         ( measurements[k].station >= numStations ) )
+    {
+      std::cout << "Measurement " << k << " of object "
+                << measurements[k].object << " from station "
+                << measurements[k].station << " is not replayed"
+                << std::endl;
+      throw;
+    }
+    order[k] = k;
+  }
+  std::stable_sort( order.begin(), order.end(),
+                    [&]( std::size_t a, std::size_t b )
+  {
+    return measurements[a].time < measurements[b].time;
+  } );
+
+  ReplayReport report = ReplayReport();
+  report.measurements = count;
+  if ( count == 0 )
+  {
+    return report;
+  }
+
+  std::vector< double > latencies( count );
+  double firstTime = measurements[ order[0] ].time;
+  replay_clock::time_point start = replay_clock::now();
+  replay_clock::time_point last = start;
+  for ( std::size_t k = 0; k < count; ++k )
+  {
+    const Measurement &measurement = measurements[ order[k] ];
+    replay_clock::time_point scheduled = start;
+    if ( m_speed > 0.0 )
+    {
+      scheduled += std::chrono::duration_cast< replay_clock::duration >(
+        std::chrono::duration< double >(
+          ( measurement.time - firstTime ) / m_speed ) );
+      std::this_thread::sleep_until( scheduled );
+    }
+
+    replay_clock::time_point begin = replay_clock::now();
+    process( measurement );
+    last = replay_clock::now();
+
+    latencies[k] = std::chrono::duration< double >( last - begin ).count();
+    if ( m_speed > 0.0 )
+    {
+      report.lag = std::max(
+        report.lag,
+        std::chrono::duration< double >( last - scheduled ).count() );
+    }
+  }
+
+  report.seconds = std::chrono::duration< double >( last - start ).count();
+  report.rate = count / report.seconds;
+  report.p50 = percentile( latencies, 0.5 );
+  report.p99 = percentile( latencies, 0.99 );
+  report.p999 = percentile( latencies, 0.999 );
+  report.worst = *std::max_element( latencies.begin(), latencies.end() );
+  return report;
+}
+
+// Number of stations
+int
+ReplayHarness::
+getNumStations() const
+{
+  return m_latitude.size();
+}
+
+// Number of objects
+int
+ReplayHarness::
+getNumObjects() const
+{
+  return m_motions.size();
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Propagate an object to a measurement, predict the measurement and
+// its partials, update the Knowledge and restart the Motion from its
+// corrected state
+void
+ReplayHarness::
+process( const Measurement &measurement )
+{
+  Motion &motion = *m_motions[ measurement.object ];
+  Knowledge &knowledge = *m_knowledge[ measurement.object ];
+  double t = measurement.time;
+  if ( t != motion.getTime() )
+  {
+    motion.stepTo( t );
+  }
+  std::vector< double > state = motion.getState( t );
+  knowledge.setCovariance(
+    knowledge.predictCovariance( motion.getStatePartials( t ) ) );
+
+  // Station position and velocity, and its local frame
+  int station = measurement.station;
+  double angle = m_longitude[ station ] + m_rotation * t;
+  double cosLat = std::cos( m_latitude[ station ] );
+  double sinLat = std::sin( m_latitude[ station ] );
+  Eigen::Vector3d up( cosLat * std::cos( angle ),
+                      cosLat * std::sin( angle ), sinLat );
+  Eigen::Vector3d east( -std::sin( angle ), std::cos( angle ), 0.0 );
+  Eigen::Vector3d north( -sinLat * std::cos( angle ),
+                         -sinLat * std::sin( angle ), cosLat );
+
+  Eigen::Vector3d range( state[0], state[1], state[2] );
+  range -= m_radius * up;
+  Eigen::Vector3d rate( state[3] + m_rotation * m_radius * up[1],
+                        state[4] - m_rotation * m_radius * up[0],
+                        state[5] );
+  double dist = range.norm();
+  Eigen::Vector3d line = range / dist;
+  double rangeRate = line.dot( rate );
+  double sinElevation = line.dot( up );
+  double cosElevation = std::sqrt( 1.0 - sinElevation * sinElevation );
+  double e = range.dot( east );
+  double n = range.dot( north );
+
+  // Residuals, with the azimuth one wrapped to within half a turn
+  Eigen::VectorXd residual( 4 );
+  residual[0] = measurement.range - dist;
+  residual[1] = measurement.rangeRate - rangeRate;
+  residual[2] = std::remainder( measurement.azimuth - std::atan2( e, n ),
+                                2 * pi );
+  residual[3] = measurement.elevation - std::asin( sinElevation );
+
+  // Partials wrt the state, and none wrt the parameters
+  Eigen::MatrixXd partials =
+    Eigen::MatrixXd::Zero( 4, knowledge.getCovariance().cols() );
+  partials.block< 1, 3 >( 0, 0 ) = line.transpose();
+  partials.block< 1, 3 >( 1, 0 ) =
+    ( ( rate - rangeRate * line ) / dist ).transpose();
+  partials.block< 1, 3 >( 1, 3 ) = line.transpose();
+  partials.block< 1, 3 >( 2, 0 ) =
+    ( ( n * east - e * north ) / ( e * e + n * n ) ).transpose();
+  partials.block< 1, 3 >( 3, 0 ) =
+    ( ( up - sinElevation * line ) / ( dist * cosElevation ) ).transpose();
+
+  Eigen::MatrixXd noise = Eigen::MatrixXd::Zero( 4, 4 );
+  noise( 0, 0 ) = m_rangeNoise[ station ] * m_rangeNoise[ station ];
+  noise( 1, 1 ) = m_rangeRateNoise[ station ] * m_rangeRateNoise[ station ];
+  noise( 2, 2 ) = m_angleNoise[ station ] * m_angleNoise[ station ];
+  noise( 3, 3 ) = noise( 2, 2 );
+
+  knowledge.setState( state );
+  knowledge.update( knowledge.measurementUpdate( residual, partials, noise ) );
+  motion.restart( knowledge.getState() );
+}
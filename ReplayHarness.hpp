@@ -0,0 +1,119 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ReplayHarness.hpp
+/// @brief   Replay of recorded measurements through the filter, timed.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_REPLAYHARNESS_HEADER_GUARD
+#define EKF_REPLAYHARNESS_HEADER_GUARD
+
+// C++ Standard Library
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Knowledge.hpp>
+#include <Motion.hpp>
+#include <TrackingSimulator.hpp>
+
+/// @brief Throughput and latency of a replay.
+///
+/// seconds is the wall time from the first update to the last, rate the
+/// measurements processed per second of it, and the latencies, in
+/// seconds, the percentiles of the time each update took ( propagation
+/// to the measurement and the Kalman update ). lag is how far past its
+/// scheduled wall time the latest update finished when paced, and zero
+/// at full speed.
+///
+struct ReplayReport
+{
+  std::size_t measurements;
+  double seconds;
+  double rate;
+  double p50;
+  double p99;
+  double p999;
+  double worst;
+  double lag;
+};
+
+/// @brief Drive the filter with a measurement file, as fast as it goes or
+/// at a multiple of real time, and time it.
+///
+/// Each object is estimated by a Motion and a Knowledge over its active
+/// agents, holding their covariance at the epoch of the Motion's STM. A
+/// measurement is processed by stepping its object's Motion to the
+/// measurement time, mapping the covariance through the STM, and
+/// updating the Knowledge with the range, range rate, azimuth and
+/// elevation together, after which the Motion restarts from the
+/// corrected state ( parameters the Actions are bound to are corrected
+/// in place ). Active parameters have no direct measurement partials;
+/// they are corrected through their covariance with the state. The
+/// Motion steps to the exact measurement time, on its output grid or
+/// not.
+///
+/// The measurement file, as TrackingSimulator writes it, is mapped into
+/// memory rather than read, and replayed in time order ( objects and
+/// stations in file order at equal times ). Stations are placed as the
+/// TrackingSimulator placed them, and their noise is the measurement
+/// noise of the update; biases are not estimated.
+///
+/// With a speed factor, an update waits until its measurement time, run
+/// from the first measurement at that multiple of real time, so the lag
+/// tells whether the filter keeps up.
+///
+class ReplayHarness
+{
+ public:
+  ReplayHarness();
+  ReplayHarness( double radius, double rotation );
+ ~ReplayHarness();
+
+  // Add a station, returning its index
+  int addStation( double latitude, double longitude );
+  // Noise standard deviations of a station
+  void setNoise( int station, double range, double rangeRate,
+                 double angle );
+
+  // Add an object by the Motion and Knowledge estimating it, returning
+  // its index. The Knowledge must be over the Motion's active agents.
+  int addObject( std::shared_ptr< Motion > motion,
+                 std::shared_ptr< Knowledge > knowledge );
+
+  // Replay at factor times real time, or as fast as possible with 0
+  // ( the default )
+  void setSpeed( double factor );
+
+  // Replay a measurement file through the filter
+  ReplayReport replay( const std::string &path );
+
+  // Numbers of stations and objects
+  int getNumStations() const;
+  int getNumObjects() const;
+
+ private:
+  double m_radius;
+  double m_rotation;
+  double m_speed;
+
+  // One entry per station
+  std::vector< double > m_latitude;
+  std::vector< double > m_longitude;
+  std::vector< double > m_rangeNoise;
+  std::vector< double > m_rangeRateNoise;
+  std::vector< double > m_angleNoise;
+
+  // One entry per object
+  std::vector< std::shared_ptr< Motion > > m_motions;
+  std::vector< std::shared_ptr< Knowledge > > m_knowledge;
+
+  void process( const Measurement &measurement );
+};
+
+#endif // EKF_REPLAYHARNESS_HEADER_GUARD
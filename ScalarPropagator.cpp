@@ -0,0 +1,200 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ScalarPropagator.cpp
+/// @brief   dopri5 propagation carried out in float, double or long
+///          double.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <cmath>
+
+// boost Library
+#include <boost/numeric/odeint.hpp>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <ScalarPropagator.hpp>
+
+namespace
+{
+  // Accelerations of the actions in each scalar type; double goes
+  // through the usual entry point
+  void
+  addAccelerations(
+      const std::vector< std::shared_ptr< Action > > &actions,
+      std::vector< double > &acceleration,
+      const std::vector< double > &state,
+      double t )
+  {
+    for ( auto ap: actions )
+    {
+      ap->getAccelerationAtTime( acceleration, state, t );
+    }
+  }
+
+  template< typename Scalar >
+  void
+  addAccelerations(
+      const std::vector< std::shared_ptr< Action > > &actions,
+      std::vector< Scalar > &acceleration,
+      const std::vector< Scalar > &state,
+      double t )
+  {
+    for ( auto ap: actions )
+    {
+      ap->getScalarAcceleration( acceleration, state, t );
+    }
+  }
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor, with the tolerances for Scalar
+template< typename Scalar >
+ScalarPropagator< Scalar >::
+ScalarPropagator()
+    : m_absTolerance( 0.1 * defaultTolerance() ),
+      m_relTolerance( defaultTolerance() )
+{
+}
+
+// Constructor with the dopri5 error tolerances
+template< typename Scalar >
+ScalarPropagator< Scalar >::
+ScalarPropagator(
+    double absTolerance,
+    double relTolerance )
+    : m_absTolerance( absTolerance ),
+      m_relTolerance( relTolerance )
+{
+}
+
+// Default Destructor
+template< typename Scalar >
+ScalarPropagator< Scalar >::
+~ScalarPropagator()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Propagate the state and partials from t0 to t1, as the default
+// integration does but in Scalar
+template< typename Scalar >
+std::map< double, std::vector< double > >
+ScalarPropagator< Scalar >::
+propagate(
+    const std::vector< std::shared_ptr< Action > > &actions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0,
+    double t1,
+    double step )
+{
+  using namespace boost::numeric::odeint;
+
+  typedef std::vector< Scalar > scalarState;
+  typedef runge_kutta_dopri5< scalarState, Scalar, scalarState,
+                              double > rkStepper;
+  typedef Eigen::Matrix< Scalar, Eigen::Dynamic, Eigen::Dynamic,
+                         Eigen::RowMajor > scalarMatrix;
+
+  int numAgents = ( stateAndPartials.size() > 6 ) ? activeAgents.size() : 0;
+  std::vector< double > partials( numAgents * numAgents );
+  std::vector< double > state( 6 );
+
+  // State derivative from the Scalar accelerations, STM derivative from
+  // the rounded double partials
+  auto system = [&]( const scalarState &x, scalarState &dxdt, double t )
+  {
+    scalarState accel( 3, Scalar( 0 ) );
+    addAccelerations( actions, accel, x, t );
+    for ( int i = 0; i < 3; ++i )
+    {
+      dxdt[i] = x[i + 3];
+      dxdt[i + 3] = accel[i];
+    }
+    if ( numAgents == 0 )
+    {
+      return;
+    }
+
+    std::copy( x.begin(), x.begin() + 6, state.begin() );
+    std::fill( partials.begin(), partials.end(), 0.0 );
+    for ( auto ap: actions )
+    {
+      ap->getPartials( partials, state, activeAgents );
+    }
+    scalarMatrix A = Eigen::Map< const Eigen::Matrix< double,
+      Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor > >(
+        partials.data(), numAgents, numAgents ).template cast< Scalar >();
+    Eigen::Map< scalarMatrix >( dxdt.data() + 6, numAgents,
+                                numAgents ).noalias() =
+      A * Eigen::Map< const scalarMatrix >( x.data() + 6, numAgents,
+                                            numAgents );
+  };
+
+  std::map< double, std::vector< double > > pastStates;
+  auto observer = [&]( const scalarState &x, double t )
+  {
+    pastStates[t] = std::vector< double >( x.begin(), x.end() );
+  };
+
+  scalarState x( stateAndPartials.begin(), stateAndPartials.end() );
+  integrate_const( make_controlled( Scalar( m_absTolerance ),
+                                    Scalar( m_relTolerance ), rkStepper() ),
+                   system, x, t0, t1, step, observer );
+
+  // An epoch off the grid is reached by one shorter interval
+  double last = pastStates.rbegin()->first;
+  if ( last < t1 )
+  {
+    integrate_adaptive( make_controlled( Scalar( m_absTolerance ),
+                                         Scalar( m_relTolerance ),
+                                         rkStepper() ),
+                        system, x, last, t1, t1 - last );
+    observer( x, t1 );
+  }
+  return pastStates;
+}
+
+//=====================================================================
+//=====================================================================
+// EXPLICIT INSTANTIATIONS
+
+template<>
+double
+ScalarPropagator< float >::
+defaultTolerance()
+{
+  return 1.E-5;
+}
+
+template<>
+double
+ScalarPropagator< double >::
+defaultTolerance()
+{
+  return 1.E-9;
+}
+
+template<>
+double
+ScalarPropagator< long double >::
+defaultTolerance()
+{
+  return 1.E-13;
+}
+
+template class ScalarPropagator< float >;
+template class ScalarPropagator< double >;
+template class ScalarPropagator< long double >;
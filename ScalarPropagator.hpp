@@ -0,0 +1,67 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ScalarPropagator.hpp
+/// @brief   dopri5 propagation carried out in float, double or long
+///          double.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_SCALARPROPAGATOR_HEADER_GUARD
+#define EKF_SCALARPROPAGATOR_HEADER_GUARD
+
+// C++ Standard Library
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <Propagator.hpp>
+
+/// @brief The default dopri5 integration in another scalar type.
+///
+/// The state, STM and stepper all hold Scalar, and the accelerations
+/// come from Action::getScalarAcceleration, which GravityAction and
+/// AtmosphereAction evaluate in Scalar throughout. float halves the
+/// memory and doubles the SIMD width for screening many objects; long
+/// double ( 64 bit significand on x86 ) gives reference solutions to
+/// check double runs against. Instantiated for float, double and long
+/// double.
+///
+/// The acceleration partials are evaluated by the double model and
+/// rounded, then multiplied into the STM in Scalar. Times stay double,
+/// and the returned states are widened to double, as Motion logs them.
+///
+/// The default tolerances follow the precision: 1e-5 relative for
+/// float, 1e-9 for double ( as the default integration ) and 1e-13 for
+/// long double, with absolute tolerances a tenth of those.
+///
+template< typename Scalar >
+class ScalarPropagator : public Propagator
+{
+ public:
+  ScalarPropagator();
+  ScalarPropagator( double absTolerance, double relTolerance );
+ ~ScalarPropagator() override;
+
+  // Propagate stateAndPartials from t0 to t1 in Scalar, logging every
+  // step in the returned map as Motion::stepTo would.
+  std::map< double, std::vector< double > > propagate(
+    const std::vector< std::shared_ptr< Action > > &actions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0, double t1, double step ) override;
+
+  // Default relative tolerance for Scalar
+  static double defaultTolerance();
+
+ private:
+  double m_absTolerance;
+  double m_relTolerance;
+};
+
+#endif // EKF_SCALARPROPAGATOR_HEADER_GUARD
@@ -0,0 +1,492 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ScenarioRunner.cpp
+/// @brief   Batch propagation of scenarios read from a file.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// ekf Library
+#include <AtmosphereAction.hpp>
+#include <GravityAction.hpp>
+#include <ManeuverAction.hpp>
+#include <Motion.hpp>
+#include <Parallel.hpp>
+#include <ScenarioRunner.hpp>
+
+namespace
+{
+  const char magic[8] = { 'E', 'K', 'F', 'S', 'C', 'N', '1', '\0' };
+
+  // Parse a whole token as a number
+  bool
+  toNumber(
+      const std::string &token,
+      double &value )
+  {
+    const char *begin = token.c_str();
+    char *end = nullptr;
+    value = std::strtod( begin, &end );
+    return ( end != begin ) && ( *end == '\0' );
+  }
+
+  // Report a bad scenario file line
+  void
+  fail(
+      int line,
+      const std::string &message )
+  {
+    std::cout << "Scenario file line " << line << ": " << message
+              << std::endl;
+    throw;
+  }
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+ScenarioRunner::
+ScenarioRunner()
+    : m_scenarios(),
+      m_directory(),
+      m_numThreads( 0 )
+{
+}
+
+// Default Destructor
+ScenarioRunner::
+~ScenarioRunner()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Parse scenarios from the file at path
+int
+ScenarioRunner::
+readFile( const std::string &path )
+{
+  std::ifstream in( path.c_str() );
+  if ( !in )
+  {
+    std::cout << "Cannot open scenario file " << path << std::endl;
+    throw;
+  }
+  return read( in );
+}
+
+// Parse scenarios from a stream. Lines are gathered into statements,
+// a keyword and its arguments, and each statement is applied to the
+// open scenario, or to the defaults outside one.
+int
+ScenarioRunner::
+read( std::istream &in )
+{
+  Scenario defaults = { "", {}, 0.0, 1.0, {}, {}, {}, "" };
+  Scenario current = defaults;
+  bool open = false;
+  int numRead = 0;
+
+  // outputs_every spacing and end, resolved when the scenario closes
+  double defaultEvery[2] = { 0.0, 0.0 };
+  double currentEvery[2] = { 0.0, 0.0 };
+
+  std::vector< std::string > statement;
+  int statementLine = 0;
+  auto apply = [&]()
+  {
+    if ( statement.empty() )
+    {
+      return;
+    }
+    const std::string &keyword = statement[0];
+    int numArgs = statement.size() - 1;
+    Scenario &target = open ? current : defaults;
+    double *every = open ? currentEvery : defaultEvery;
+
+    // Numeric arguments from first on
+    auto numbers = [&]( int first )
+    {
+      std::vector< double > values;
+      for ( size_t i = first; i < statement.size(); ++i )
+      {
+        double value;
+        if ( !toNumber( statement[i], value ) )
+        {
+          fail( statementLine, "'" + statement[i] + "' is not a number" );
+        }
+        values.push_back( value );
+      }
+      return values;
+    };
+    auto expect = [&]( int count )
+    {
+      if ( numArgs != count )
+      {
+        std::ostringstream message;
+        message << keyword << " takes " << count << " arguments, not "
+                << numArgs;
+        fail( statementLine, message.str() );
+      }
+    };
+
+    if ( keyword == "scenario" )
+    {
+      expect( 1 );
+      if ( open )
+      {
+        fail( statementLine, "scenario " + current.name + " has no end" );
+      }
+      current = defaults;
+      current.name = statement[1];
+      currentEvery[0] = defaultEvery[0];
+      currentEvery[1] = defaultEvery[1];
+      open = true;
+    }
+    else if ( keyword == "end" )
+    {
+      expect( 0 );
+      if ( !open )
+      {
+        fail( statementLine, "end outside a scenario" );
+      }
+      if ( current.ic.size() != 6 )
+      {
+        fail( statementLine, "scenario " + current.name + " has no state" );
+      }
+
+      // Snap output epochs onto the grid Motion logs, epoch + k step
+      std::vector< double > outputs = current.outputs;
+      if ( currentEvery[0] > 0 )
+      {
+        double last = currentEvery[1] +
+                      1.E-9 * std::max( 1.0, std::abs( currentEvery[1] ) );
+        for ( int k = 0; current.epoch + k * currentEvery[0] <= last; ++k )
+        {
+          outputs.push_back( current.epoch + k * currentEvery[0] );
+        }
+      }
+      current.outputs.clear();
+      for ( double t: outputs )
+      {
+        double k = std::round( ( t - current.epoch ) / current.step );
+        double snapped = current.epoch + k * current.step;
+        if ( ( k < 0 ) ||
+             ( std::abs( snapped - t ) > 1.E-9 * std::max( 1.0,
+                                                           std::abs( t ) ) ) )
+        {
+          std::ostringstream message;
+          message << "output " << t << " of scenario " << current.name
+                  << " is not on its step grid";
+          fail( statementLine, message.str() );
+        }
+        current.outputs.push_back( snapped );
+      }
+      std::sort( current.outputs.begin(), current.outputs.end() );
+      current.outputs.erase( std::unique( current.outputs.begin(),
+                                          current.outputs.end() ),
+                             current.outputs.end() );
+      if ( current.outputs.empty() )
+      {
+        fail( statementLine, "scenario " + current.name + " has no outputs" );
+      }
+      if ( current.file.empty() )
+      {
+        current.file = current.name + ".bin";
+      }
+      m_scenarios.push_back( current );
+      open = false;
+      ++numRead;
+    }
+    else if ( keyword == "state" )
+    {
+      expect( 6 );
+      target.ic = numbers( 1 );
+    }
+    else if ( keyword == "epoch" )
+    {
+      expect( 1 );
+      target.epoch = numbers( 1 )[0];
+    }
+    else if ( keyword == "step" )
+    {
+      expect( 1 );
+      target.step = numbers( 1 )[0];
+      if ( target.step <= 0 )
+      {
+        fail( statementLine, "step must be positive" );
+      }
+    }
+    else if ( ( keyword == "gravity" ) || ( keyword == "atmosphere" ) ||
+              ( keyword == "maneuver" ) )
+    {
+      expect( ( keyword == "gravity" ) ? 4 : 6 );
+      ActionSpec spec = { keyword, statement[1], numbers( 2 ) };
+      target.actions.push_back( spec );
+    }
+    else if ( keyword == "agents" )
+    {
+      target.agents.assign( statement.begin() + 1, statement.end() );
+    }
+    else if ( keyword == "outputs" )
+    {
+      std::vector< double > outputs = numbers( 1 );
+      target.outputs.insert( target.outputs.end(), outputs.begin(),
+                             outputs.end() );
+    }
+    else if ( keyword == "outputs_every" )
+    {
+      expect( 2 );
+      std::vector< double > values = numbers( 1 );
+      if ( values[0] <= 0 )
+      {
+        fail( statementLine, "outputs_every needs a positive spacing" );
+      }
+      every[0] = values[0];
+      every[1] = values[1];
+    }
+    else if ( keyword == "file" )
+    {
+      expect( 1 );
+      target.file = statement[1];
+    }
+    else
+    {
+      fail( statementLine, "unknown keyword " + keyword );
+    }
+    statement.clear();
+  };
+
+  std::string line;
+  int lineNumber = 0;
+  while ( std::getline( in, line ) )
+  {
+    ++lineNumber;
+    std::istringstream tokens( line.substr( 0, line.find( '#' ) ) );
+    std::vector< std::string > words;
+    std::string word;
+    while ( tokens >> word )
+    {
+      words.push_back( word );
+    }
+    if ( words.empty() )
+    {
+      continue;
+    }
+
+    // A line starting with a number continues the statement before
+    double value;
+    if ( !statement.empty() && toNumber( words[0], value ) )
+    {
+      statement.insert( statement.end(), words.begin(), words.end() );
+      continue;
+    }
+    apply();
+    statement = words;
+    statementLine = lineNumber;
+  }
+  apply();
+  if ( open )
+  {
+    fail( lineNumber, "scenario " + current.name + " has no end" );
+  }
+  return numRead;
+}
+
+// Add a scenario directly
+void
+ScenarioRunner::
+addScenario( const Scenario &scenario )
+{
+  m_scenarios.push_back( scenario );
+}
+
+// Directory output files are relative to
+void
+ScenarioRunner::
+setOutputDirectory( const std::string &directory )
+{
+  m_directory = directory;
+}
+
+// Threads running scenarios
+void
+ScenarioRunner::
+setThreads( unsigned int numThreads )
+{
+  m_numThreads = numThreads;
+}
+
+// Run every scenario, one per thread at a time
+std::vector< ScenarioReport >
+ScenarioRunner::
+run() const
+{
+  std::vector< ScenarioReport > reports( m_scenarios.size() );
+  parallelFor( 0, m_scenarios.size(), m_numThreads, [&]( int k )
+  {
+    reports[k] = runScenario( m_scenarios[k] );
+  } );
+  return reports;
+}
+
+// Number of scenarios
+int
+ScenarioRunner::
+getNumScenarios() const
+{
+  return m_scenarios.size();
+}
+
+// Scenario k
+const Scenario&
+ScenarioRunner::
+getScenario( int k ) const
+{
+  return m_scenarios[k];
+}
+
+// Read an output file back
+int
+ScenarioRunner::
+readOutput(
+    const std::string &path,
+    std::vector< double > &times,
+    std::vector< double > &states,
+    std::vector< double > &partials )
+{
+  std::ifstream in( path.c_str(), std::ios::binary );
+  char header[ sizeof( magic ) ];
+  std::int32_t counts[3];
+  in.read( header, sizeof( header ) );
+  in.read( reinterpret_cast< char* >( counts ), sizeof( counts ) );
+  if ( !in || ( std::memcmp( header, magic, sizeof( magic ) ) != 0 ) ||
+       ( counts[1] != 6 ) )
+  {
+    std::cout << path << " is not a scenario output" << std::endl;
+    throw;
+  }
+
+  int numOutputs = counts[0];
+  int numAgents = counts[2];
+  times.resize( numOutputs );
+  states.resize( 6 * numOutputs );
+  partials.resize( numAgents * numAgents * numOutputs );
+  for ( int i = 0; i < numOutputs; ++i )
+  {
+    in.read( reinterpret_cast< char* >( &times[i] ), sizeof( double ) );
+    in.read( reinterpret_cast< char* >( &states[ 6 * i ] ),
+             6 * sizeof( double ) );
+    in.read( reinterpret_cast< char* >(
+               &partials[ numAgents * numAgents * i ] ),
+             numAgents * numAgents * sizeof( double ) );
+  }
+  if ( !in )
+  {
+    std::cout << path << " ends early" << std::endl;
+    throw;
+  }
+  return numAgents;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Propagate one scenario to its last output and write the outputs
+ScenarioReport
+ScenarioRunner::
+runScenario( const Scenario &scenario ) const
+{
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+
+  Motion motion( scenario.ic, scenario.step, scenario.epoch );
+  for ( const auto &spec: scenario.actions )
+  {
+    motion.addAction( makeAction( spec ) );
+  }
+  if ( !scenario.agents.empty() )
+  {
+    motion.activateAgents( scenario.agents );
+  }
+  motion.stepTo( scenario.outputs.back() );
+
+  std::string path = scenario.file;
+  if ( !m_directory.empty() && ( path[0] != '/' ) )
+  {
+    path = m_directory + "/" + path;
+  }
+  std::ofstream out( path.c_str(), std::ios::binary );
+  if ( !out )
+  {
+    std::cout << "Cannot write " << path << std::endl;
+    throw;
+  }
+  std::int32_t numAgents = std::sqrt(
+    motion.getStatePartials( scenario.outputs[0] ).size() );
+  std::int32_t counts[3] = { (std::int32_t) scenario.outputs.size(), 6,
+                             numAgents };
+  out.write( magic, sizeof( magic ) );
+  out.write( reinterpret_cast< const char* >( counts ), sizeof( counts ) );
+  for ( double t: scenario.outputs )
+  {
+    std::vector< double > state = motion.getState( t );
+    std::vector< double > partials = motion.getStatePartials( t );
+    out.write( reinterpret_cast< const char* >( &t ), sizeof( double ) );
+    out.write( reinterpret_cast< const char* >( state.data() ),
+               6 * sizeof( double ) );
+    out.write( reinterpret_cast< const char* >( partials.data() ),
+               partials.size() * sizeof( double ) );
+  }
+
+  ScenarioReport report;
+  report.name = scenario.name;
+  report.file = path;
+  report.outputs = scenario.outputs.size();
+  report.seconds = std::chrono::duration< double >(
+    std::chrono::steady_clock::now() - start ).count();
+  return report;
+}
+
+// Build an Action from its spec
+std::shared_ptr< Action >
+ScenarioRunner::
+makeAction( const ActionSpec &spec )
+{
+  const std::vector< double > &p = spec.parameters;
+  if ( spec.kind == "gravity" )
+  {
+    return std::shared_ptr< Action >(
+      new GravityAction( spec.name, p[0], p[1], p[2] ) );
+  }
+  else if ( spec.kind == "atmosphere" )
+  {
+    return std::shared_ptr< Action >(
+      new AtmosphereAction( spec.name, p[0], p[1], p[2], p[3], p[4] ) );
+  }
+  else if ( spec.kind == "maneuver" )
+  {
+    return std::shared_ptr< Action >( new ManeuverAction(
+      spec.name, p[0], p[1], std::vector< double >( p.begin() + 2,
+                                                    p.end() ) ) );
+  }
+  std::cout << "Unknown action kind " << spec.kind << std::endl;
+  throw;
+}
@@ -0,0 +1,143 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ScenarioRunner.hpp
+/// @brief   Batch propagation of scenarios read from a file.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_SCENARIORUNNER_HEADER_GUARD
+#define EKF_SCENARIORUNNER_HEADER_GUARD
+
+// C++ Standard Library
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+
+/// @brief An Action of a scenario: its kind ( "gravity", "atmosphere" or
+/// "maneuver" ), name and constructor arguments.
+///
+struct ActionSpec
+{
+  std::string kind;
+  std::string name;
+  std::vector< double > parameters;
+};
+
+/// @brief One propagation: initial state at epoch, output step, Actions,
+/// active agents and output epochs, written to file.
+///
+struct Scenario
+{
+  std::string name;
+  std::vector< double > ic;
+  double epoch;
+  double step;
+  std::vector< ActionSpec > actions;
+  std::vector< std::string > agents;
+  std::vector< double > outputs;
+  std::string file;
+};
+
+/// @brief Outcome of a scenario: the file written, the outputs in it and
+/// the wall time of the propagation.
+///
+struct ScenarioReport
+{
+  std::string name;
+  std::string file;
+  int outputs;
+  double seconds;
+};
+
+/// @brief Run many scenarios in one process.
+///
+/// Scenarios are read once from a text file, one keyword per line:
+///
+///     # LEO with drag
+///     scenario   leo_drag
+///     state      757700 5222607 4851500 2213.21 4678.34 -5371.30
+///     step       1
+///     gravity    Earth 6378136.3 3.986004415E+14 1.082626925638815E-3
+///     atmosphere Earth_Atmosphere 7078136.3 3.614E-13 88667.0
+///                7.29211585530066E-5 0.0030927835
+///     agents     mu J2 Cd X_1 Y_1 Z_1
+///     outputs    10 20 30
+///     end
+///
+/// Keywords ( a line may be continued by starting the next with a
+/// number ):
+///   - scenario name / end        open and close a scenario
+///   - state x y z dx dy dz       initial state, meters and seconds
+///   - epoch t0                   initial time ( default 0 )
+///   - step dt                    output step ( default 1 )
+///   - gravity name R mu J2
+///   - atmosphere name h0 rho0 H omega dragTerm
+///   - maneuver name start duration ax ay az
+///   - agents names...            active agents ( default the state )
+///   - outputs t...               output epochs
+///   - outputs_every dt t1        every dt from the epoch to t1
+///   - file path                  output file ( default name.bin )
+/// Lines before the first scenario set defaults for every scenario,
+/// Actions included. Output epochs must fall on the step grid from the
+/// epoch, where Motion logs states.
+///
+/// Each scenario builds its own Motion and Actions, so scenarios share
+/// nothing and run concurrently on a team of threads. The output is
+/// binary, native byte order:
+///   - "EKFSCN1" and a null byte
+///   - int32 outputs, int32 state size ( 6 ), int32 agents n
+///   - per output: double time, 6 doubles of state, n x n doubles of
+///     row major state partials
+/// readOutput() reads it back.
+///
+class ScenarioRunner
+{
+ public:
+  ScenarioRunner();
+ ~ScenarioRunner();
+
+  // Parse scenarios from a file or stream, adding them to the batch and
+  // returning how many were read
+  int readFile( const std::string &path );
+  int read( std::istream &in );
+  // Add a scenario directly
+  void addScenario( const Scenario &scenario );
+
+  // Directory output files are relative to ( default the current one )
+  void setOutputDirectory( const std::string &directory );
+  // Run scenarios on numThreads threads ( 0, the default, means one per
+  // core )
+  void setThreads( unsigned int numThreads );
+
+  // Run every scenario and write its output, returning reports in
+  // scenario order
+  std::vector< ScenarioReport > run() const;
+
+  // Scenarios, and their number
+  int getNumScenarios() const;
+  const Scenario& getScenario( int k ) const;
+
+  // Read an output file back: times, states ( 6 per time ) and partials
+  // ( n x n per time ), returning n
+  static int readOutput( const std::string &path,
+                         std::vector< double > &times,
+                         std::vector< double > &states,
+                         std::vector< double > &partials );
+
+ private:
+  std::vector< Scenario > m_scenarios;
+  std::string m_directory;
+  unsigned int m_numThreads;
+
+  ScenarioReport runScenario( const Scenario &scenario ) const;
+  static std::shared_ptr< Action > makeAction( const ActionSpec &spec );
+};
+
+#endif // EKF_SCENARIORUNNER_HEADER_GUARD
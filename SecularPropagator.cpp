@@ -0,0 +1,539 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    SecularPropagator.cpp
+/// @brief   Analytic mean element propagation of many objects under
+///          two-body, J2 secular and drag decay effects.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <cmath>
+#include <iostream>
+
+// boost Library
+#include <boost/math/special_functions/bessel.hpp>
+#include <boost/numeric/odeint.hpp>
+
+// ekf Library
+#include <OdeintHelper.hpp>
+#include <SecularPropagator.hpp>
+
+namespace
+{
+// exp( -x ) I_n( x ), which stays finite where I_n( x ) overflows
+double
+scaledBesselI(
+    int n,
+    double x )
+{
+  if ( x > 500 )
+  {
+    return 1.0 / sqrt( 2 * M_PI * x );
+  }
+  return exp( -x ) * boost::math::cyl_bessel_i( n, x );
+}
+
+// Cartesian state from Keplerian elements, solving Kepler's equation
+// by Newton iteration
+void
+keplerToState(
+    double mu,
+    double a,
+    double e,
+    double i,
+    double node,
+    double perigee,
+    double M,
+    double *state )
+{
+  double E = M + e * sin( M );
+  for ( int iter = 0; iter < 30; ++iter )
+  {
+    double delta = ( E - e * sin( E ) - M ) / ( 1 - e * cos( E ) );
+    E -= delta;
+    if ( std::abs( delta ) < 1.E-14 )
+    {
+      break;
+    }
+  }
+
+  double eta = sqrt( 1 - e * e );
+  double rate = sqrt( mu / a ) / ( 1 - e * cos( E ) );
+  double xP = a * ( cos( E ) - e );
+  double yP = a * eta * sin( E );
+  double dxP = -rate * sin( E );
+  double dyP = rate * eta * cos( E );
+
+  double P[3] = { cos( node ) * cos( perigee ) -
+                  sin( node ) * sin( perigee ) * cos( i ),
+                  sin( node ) * cos( perigee ) +
+                  cos( node ) * sin( perigee ) * cos( i ),
+                  sin( perigee ) * sin( i ) };
+  double Q[3] = { -cos( node ) * sin( perigee ) -
+                  sin( node ) * cos( perigee ) * cos( i ),
+                  -sin( node ) * sin( perigee ) +
+                  cos( node ) * cos( perigee ) * cos( i ),
+                  cos( perigee ) * sin( i ) };
+
+  for ( int c = 0; c < 3; ++c )
+  {
+    state[c] = xP * P[c] + yP * Q[c];
+    state[c + 3] = dxP * P[c] + dyP * Q[c];
+  }
+}
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+SecularPropagator::
+SecularPropagator()
+    : m_radius(),
+      m_mu(),
+      m_J2(),
+      m_gravity(),
+      m_atmosphere(),
+      m_epoch(),
+      m_a(),
+      m_e(),
+      m_i(),
+      m_node(),
+      m_perigee(),
+      m_anomaly(),
+      m_aRate(),
+      m_eRate(),
+      m_nodeRate(),
+      m_perigeeRate(),
+      m_anomalyRate()
+{
+}
+
+// Constructor from the gravity and ( possibly null ) atmosphere models
+SecularPropagator::
+SecularPropagator(
+    std::shared_ptr< GravityAction > gravity,
+    std::shared_ptr< AtmosphereAction > atmosphere )
+    : m_radius( gravity->getRadius() ),
+      m_mu( gravity->getMu() ),
+      m_J2( gravity->getJ2() ),
+      m_gravity( gravity ),
+      m_atmosphere( atmosphere ),
+      m_epoch(),
+      m_a(),
+      m_e(),
+      m_i(),
+      m_node(),
+      m_perigee(),
+      m_anomaly(),
+      m_aRate(),
+      m_eRate(),
+      m_nodeRate(),
+      m_perigeeRate(),
+      m_anomalyRate()
+{
+}
+
+// Default Destructor
+SecularPropagator::
+~SecularPropagator()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Add an object with the body drag term of the atmosphere model
+int
+SecularPropagator::
+addObject(
+    const std::vector< double > &state,
+    double epoch )
+{
+  double bodyDragTerm = m_atmosphere ? m_atmosphere->getBodyDragTerm() : 0.0;
+  return addObject( state, epoch, bodyDragTerm );
+}
+
+// Fit mean elements and secular rates to the Cartesian state, and add
+// them to the catalog
+int
+SecularPropagator::
+addObject(
+    const std::vector< double > &state,
+    double epoch,
+    double bodyDragTerm )
+{
+  Vector6d elements = fitMeanElements( state );
+  double a = elements( 0 );
+  double e = sqrt( elements( 1 ) * elements( 1 ) +
+                   elements( 2 ) * elements( 2 ) );
+  double i = elements( 3 );
+  double perigee = atan2( elements( 2 ), elements( 1 ) );
+
+  double nodeRate = 0.0;
+  double perigeeRate = 0.0;
+  double anomalyRate = 0.0;
+  secularRates( a, e, i, nodeRate, perigeeRate, anomalyRate );
+  double aRate = 0.0;
+  double eRate = 0.0;
+  dragRates( a, e, i, bodyDragTerm, aRate, eRate );
+
+  m_epoch.push_back( epoch );
+  m_a.push_back( a );
+  m_e.push_back( e );
+  m_i.push_back( i );
+  m_node.push_back( elements( 4 ) );
+  m_perigee.push_back( perigee );
+  m_anomaly.push_back( elements( 5 ) - perigee );
+  m_aRate.push_back( aRate );
+  m_eRate.push_back( eRate );
+  m_nodeRate.push_back( nodeRate );
+  m_perigeeRate.push_back( perigeeRate );
+  m_anomalyRate.push_back( anomalyRate );
+
+  return m_a.size() - 1;
+}
+
+// Number of objects added
+int
+SecularPropagator::
+getNumObjects() const
+{
+  return m_a.size();
+}
+
+// Evaluate the mean elements of every object at t and convert them to
+// Cartesian states, as whole array operations
+Eigen::ArrayXXd
+SecularPropagator::
+getStates( double t ) const
+{
+  typedef Eigen::Map< const Eigen::ArrayXd > ArrayMap;
+  int numObjects = m_a.size();
+
+  Eigen::ArrayXd dt = t - ArrayMap( m_epoch.data(), numObjects );
+  ArrayMap a0( m_a.data(), numObjects );
+  ArrayMap aRate( m_aRate.data(), numObjects );
+
+  // The decay in a feeds back into the mean anomaly through n( a )
+  Eigen::ArrayXd a = a0 + aRate * dt;
+  Eigen::ArrayXd e = ( ArrayMap( m_e.data(), numObjects ) +
+                       ArrayMap( m_eRate.data(), numObjects ) * dt ).max( 0 );
+  Eigen::ArrayXd i = ArrayMap( m_i.data(), numObjects );
+  Eigen::ArrayXd node = ArrayMap( m_node.data(), numObjects ) +
+                        ArrayMap( m_nodeRate.data(), numObjects ) * dt;
+  Eigen::ArrayXd perigee = ArrayMap( m_perigee.data(), numObjects ) +
+                           ArrayMap( m_perigeeRate.data(), numObjects ) * dt;
+  ArrayMap anomalyRate( m_anomalyRate.data(), numObjects );
+  Eigen::ArrayXd M = ArrayMap( m_anomaly.data(), numObjects ) +
+                     anomalyRate * dt -
+                     0.75 * anomalyRate / a0 * aRate * dt * dt;
+
+  // Kepler's equation by Newton iteration, all objects at once
+  Eigen::ArrayXd E = M + e * M.sin();
+  for ( int iter = 0; ( iter < 30 ) && ( numObjects > 0 ); ++iter )
+  {
+    Eigen::ArrayXd delta = ( E - e * E.sin() - M ) / ( 1 - e * E.cos() );
+    E -= delta;
+    if ( delta.abs().maxCoeff() < 1.E-14 )
+    {
+      break;
+    }
+  }
+
+  // Position and velocity in the perifocal frame
+  Eigen::ArrayXd cosE = E.cos();
+  Eigen::ArrayXd sinE = E.sin();
+  Eigen::ArrayXd eta = ( 1 - e * e ).sqrt();
+  Eigen::ArrayXd rate = ( m_mu / a ).sqrt() / ( 1 - e * cosE );
+  Eigen::ArrayXd xP = a * ( cosE - e );
+  Eigen::ArrayXd yP = a * eta * sinE;
+  Eigen::ArrayXd dxP = -rate * sinE;
+  Eigen::ArrayXd dyP = rate * eta * cosE;
+
+  // Rotate by perigee, inclination and node
+  Eigen::ArrayXd cosW = perigee.cos();
+  Eigen::ArrayXd sinW = perigee.sin();
+  Eigen::ArrayXd cosO = node.cos();
+  Eigen::ArrayXd sinO = node.sin();
+  Eigen::ArrayXd cosI = i.cos();
+  Eigen::ArrayXd sinI = i.sin();
+
+  Eigen::ArrayXXd P( numObjects, 3 );
+  Eigen::ArrayXXd Q( numObjects, 3 );
+  P.col( 0 ) = cosO * cosW - sinO * sinW * cosI;
+  P.col( 1 ) = sinO * cosW + cosO * sinW * cosI;
+  P.col( 2 ) = sinW * sinI;
+  Q.col( 0 ) = -cosO * sinW - sinO * cosW * cosI;
+  Q.col( 1 ) = -sinO * sinW + cosO * cosW * cosI;
+  Q.col( 2 ) = cosW * sinI;
+
+  Eigen::ArrayXXd states( numObjects, 6 );
+  for ( int c = 0; c < 3; ++c )
+  {
+    states.col( c ) = xP * P.col( c ) + yP * Q.col( c );
+    states.col( c + 3 ) = dxP * P.col( c ) + dyP * Q.col( c );
+  }
+  return states;
+}
+
+// Cartesian state of one object at time t
+std::vector< double >
+SecularPropagator::
+getState(
+    int object,
+    double t ) const
+{
+  double dt = t - m_epoch[object];
+  double M = m_anomaly[object] + m_anomalyRate[object] * dt -
+             0.75 * m_anomalyRate[object] / m_a[object] * m_aRate[object] *
+             dt * dt;
+
+  std::vector< double > state( 6 );
+  keplerToState( m_mu, m_a[object] + m_aRate[object] * dt,
+                 std::max( 0.0, m_e[object] + m_eRate[object] * dt ),
+                 m_i[object], m_node[object] + m_nodeRate[object] * dt,
+                 m_perigee[object] + m_perigeeRate[object] * dt, M,
+                 state.data() );
+  return state;
+}
+
+// Position error bound of every object at time t, from the accuracy
+// envelope in the class description
+Eigen::ArrayXd
+SecularPropagator::
+getEnvelope( double t ) const
+{
+  typedef Eigen::Map< const Eigen::ArrayXd > ArrayMap;
+  int numObjects = m_a.size();
+
+  Eigen::ArrayXd dt = ( t - ArrayMap( m_epoch.data(), numObjects ) ).abs();
+  ArrayMap a( m_a.data(), numObjects );
+  ArrayMap e( m_e.data(), numObjects );
+  Eigen::ArrayXd n = ( m_mu / a.cube() ).sqrt();
+  Eigen::ArrayXd p = a * ( 1 - e * e );
+  Eigen::ArrayXd k = m_J2 * m_radius * m_radius / p.square();
+
+  return 2 * k * a +
+         10 * k.square() * n * a * dt +
+         0.15 * ArrayMap( m_aRate.data(), numObjects ).abs() * n * dt * dt;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Mean elements ( a, e cos w, e sin w, i, node, w + M ). The mean a
+// comes from the energy, the rest from a least squares fit to one orbit
+// of the motion under the GravityAction alone, starting from the
+// osculating elements.
+SecularPropagator::Vector6d
+SecularPropagator::
+fitMeanElements( const std::vector< double > &state ) const
+{
+  using namespace boost::numeric::odeint;
+
+  Eigen::Vector3d r( state[0], state[1], state[2] );
+  Eigen::Vector3d v( state[3], state[4], state[5] );
+  double rNorm = r.norm();
+  double aOsc = 1.0 / ( 2.0 / rNorm - v.squaredNorm() / m_mu );
+  if ( aOsc <= 0 )
+  {
+    std::cout << "SecularPropagator requires elliptic orbits." << std::endl;
+    throw;
+  }
+
+  // Osculating elements, with the argument of latitude measured from
+  // the node ( or the X axis for equatorial orbits )
+  Eigen::Vector3d h = r.cross( v );
+  Eigen::Vector3d hHat = h.normalized();
+  double p = h.squaredNorm() / m_mu;
+  double eCos = p / rNorm - 1;
+  double eSin = r.dot( v ) * sqrt( p / m_mu ) / rNorm;
+  double e = sqrt( eCos * eCos + eSin * eSin );
+
+  Eigen::Vector3d nodeHat( -h( 1 ), h( 0 ), 0 );
+  if ( nodeHat.norm() < 1.E-12 * h.norm() )
+  {
+    nodeHat = Eigen::Vector3d( 1, 0, 0 );
+  }
+  nodeHat.normalize();
+  double u = atan2( hHat.cross( nodeHat ).dot( r ), nodeHat.dot( r ) );
+  double f = atan2( eSin, eCos );
+  double E = atan2( sqrt( 1 - e * e ) * sin( f ), e + cos( f ) );
+  double perigee = u - f;
+
+  // Mean semimajor axis. The energy is conserved, so 1 / a moves with
+  // the J2 potential, 2 J2 R^2 P2( sin lat ) / r^3; replace that by its
+  // orbit average.
+  double i = acos( std::max( -1.0, std::min( 1.0, hHat( 2 ) ) ) );
+  double sinI2 = sin( i ) * sin( i );
+  double P2 = 0.5 * ( 3 * sinI2 * sin( u ) * sin( u ) - 1 );
+  double P2Mean = ( 0.75 * sinI2 - 0.5 ) / pow( aOsc * ( 1 - e * e ), 1.5 ) /
+                  pow( aOsc, 1.5 );
+  double a = 1.0 / ( 1.0 / aOsc - 2 * m_J2 * m_radius * m_radius *
+                     ( P2 / pow( rNorm, 3 ) - P2Mean ) );
+
+  Vector6d elements;
+  elements << a, e * cos( perigee ), e * sin( perigee ),
+              i,
+              atan2( nodeHat( 1 ), nodeHat( 0 ) ),
+              perigee + E - e * sin( E );
+
+  // One orbit of osculating motion, state only
+  const int numSamples = 32;
+  double period = 2 * M_PI * sqrt( aOsc * aOsc * aOsc / m_mu );
+  std::vector< std::shared_ptr< Action > > actions( 1, m_gravity );
+  AgentGroup agents;
+  OdeintHelper helper( actions, agents );
+
+  Eigen::MatrixXd truth( 6, numSamples + 1 );
+  std::vector< double > x( state.begin(), state.begin() + 6 );
+  double dt = period / numSamples;
+  for ( int k = 0; k <= numSamples; ++k )
+  {
+    if ( k > 0 )
+    {
+      integrate_adaptive( make_controlled( 1.E-10, 1.E-10,
+                                           runge_kutta_dopri5<
+                                             std::vector< double > >() ),
+                          helper, x, ( k - 1 ) * period / numSamples,
+                          k * period / numSamples, dt );
+    }
+    truth.col( k ) = Eigen::Map< const Vector6d >( x.data() );
+  }
+
+  // Gauss-Newton on the position and ( scaled ) velocity residuals, with
+  // a minimum norm step where node and perigee are ill defined. The
+  // forward differences carry relative noise of about 1e-8, so weaker
+  // directions are dropped; on an equatorial orbit the node and the
+  // argument of latitude differ only by that noise, and fitting it
+  // diverges.
+  double n = 2 * M_PI / period;
+  Eigen::VectorXd scale( 6 );
+  scale << 1, 1, 1, 1 / n, 1 / n, 1 / n;
+  Vector6d delta;
+  delta << 1.E-7 * aOsc, 1.E-7, 1.E-7, 1.E-7, 1.E-7, 1.E-7;
+
+  Eigen::VectorXd residual( 6 * ( numSamples + 1 ) );
+  Eigen::MatrixXd jacobian( 6 * ( numSamples + 1 ), 5 );
+  for ( int iter = 0; iter < 10; ++iter )
+  {
+    for ( int k = 0; k <= numSamples; ++k )
+    {
+      double t = k * period / numSamples;
+      residual.segment( 6 * k, 6 ) = scale.cwiseProduct(
+        truth.col( k ) - meanState( elements, t ) );
+      for ( int j = 1; j < 6; ++j )
+      {
+        Vector6d perturbed = elements;
+        perturbed( j ) += delta( j );
+        jacobian.block( 6 * k, j - 1, 6, 1 ) = scale.cwiseProduct(
+          meanState( perturbed, t ) - meanState( elements, t ) ) / delta( j );
+      }
+    }
+
+    Eigen::JacobiSVD< Eigen::MatrixXd > svd(
+      jacobian, Eigen::ComputeThinU | Eigen::ComputeThinV );
+    svd.setThreshold( 1.E-6 );
+    Eigen::VectorXd correction = svd.solve( residual );
+    elements.tail( 5 ) += correction;
+    if ( ( jacobian * correction ).norm() <
+         1.E-4 * sqrt( numSamples + 1.0 ) )
+    {
+      break;
+    }
+  }
+
+  return elements;
+}
+
+// State at dt from mean elements ( a, e cos w, e sin w, i, node, w + M )
+// under the J2 secular rates alone
+SecularPropagator::Vector6d
+SecularPropagator::
+meanState(
+    const Vector6d &elements,
+    double dt ) const
+{
+  double a = elements( 0 );
+  double e = sqrt( elements( 1 ) * elements( 1 ) +
+                   elements( 2 ) * elements( 2 ) );
+  double i = elements( 3 );
+  double perigee = atan2( elements( 2 ), elements( 1 ) );
+
+  double nodeRate = 0.0;
+  double perigeeRate = 0.0;
+  double anomalyRate = 0.0;
+  secularRates( a, e, i, nodeRate, perigeeRate, anomalyRate );
+
+  Vector6d state;
+  keplerToState( m_mu, a, e, i, elements( 4 ) + nodeRate * dt,
+                 perigee + perigeeRate * dt,
+                 elements( 5 ) - perigee + anomalyRate * dt, state.data() );
+  return state;
+}
+
+// First order J2 secular rates of the node, perigee and mean anomaly
+void
+SecularPropagator::
+secularRates(
+    double a,
+    double e,
+    double i,
+    double &nodeRate,
+    double &perigeeRate,
+    double &anomalyRate ) const
+{
+  double n = sqrt( m_mu / ( a * a * a ) );
+  double eta = sqrt( 1 - e * e );
+  double p = a * eta * eta;
+  double k = m_J2 * m_radius * m_radius / ( p * p );
+  double cosI = cos( i );
+
+  nodeRate = -1.5 * n * k * cosI;
+  perigeeRate = 0.75 * n * k * ( 5 * cosI * cosI - 1 );
+  anomalyRate = n * ( 1 + 0.75 * k * eta * ( 3 * cosI * cosI - 1 ) );
+}
+
+// Orbit averaged decay of a and e in the exponential atmosphere
+// ( King-Hele ), with the density taken at perigee and the atmosphere
+// rotating with the body
+void
+SecularPropagator::
+dragRates(
+    double a,
+    double e,
+    double i,
+    double bodyDragTerm,
+    double &aRate,
+    double &eRate ) const
+{
+  aRate = 0.0;
+  eRate = 0.0;
+  if ( !m_atmosphere || bodyDragTerm == 0.0 )
+  {
+    return;
+  }
+
+  double H = m_atmosphere->getStepHeight();
+  double rPerigee = a * ( 1 - e );
+  double rhoPerigee = m_atmosphere->getRefDensity() *
+    exp( - ( rPerigee - m_atmosphere->getRefHeight() ) / H );
+  double vPerigee = sqrt( m_mu * ( 1 + e ) / rPerigee );
+  double F = pow( 1 - rPerigee * m_atmosphere->getRotation() * cos( i ) /
+                  vPerigee, 2 );
+  double delta = 2 * F * bodyDragTerm;
+
+  double x = a * e / H;
+  double I0 = scaledBesselI( 0, x );
+  double I1 = scaledBesselI( 1, x );
+  double I2 = scaledBesselI( 2, x );
+  aRate = -delta * sqrt( m_mu * a ) * rhoPerigee * ( I0 + 2 * e * I1 );
+  eRate = -delta * sqrt( m_mu / a ) * rhoPerigee *
+          ( I1 + 0.5 * e * ( I0 + I2 ) );
+}
@@ -0,0 +1,86 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ShadowEvent.cpp
+/// @brief   Event function for entering and leaving the shadow of a
+///          spherical body.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <cmath>
+
+// ekf Library
+#include <ShadowEvent.hpp>
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+ShadowEvent::
+ShadowEvent()
+    : m_radius(),
+      m_sunDirection( { 1.0, 0.0, 0.0 } ),
+      m_direction()
+{
+}
+
+// Constructor for the shadow of a body of radius radius, lit from
+// sunDirection ( normalized here ), reporting the sign changes in
+// direction
+ShadowEvent::
+ShadowEvent(
+    double radius,
+    const std::vector< double > &sunDirection,
+    int direction )
+    : m_radius( radius ),
+      m_sunDirection( sunDirection ),
+      m_direction( direction )
+{
+  double norm = sqrt( pow( m_sunDirection[0], 2 ) +
+                      pow( m_sunDirection[1], 2 ) +
+                      pow( m_sunDirection[2], 2 ) );
+  for ( int i = 0; i < 3; ++i )
+  {
+    m_sunDirection[i] /= norm;
+  }
+}
+
+// Default Destructor
+ShadowEvent::
+~ShadowEvent()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Distance outside the shadow cylinder, negative in eclipse
+double
+ShadowEvent::
+getValue(
+    const std::vector< double > &state,
+    double t ) const
+{
+  double sunward = state[0] * m_sunDirection[0] +
+                   state[1] * m_sunDirection[1] +
+                   state[2] * m_sunDirection[2];
+  double dist2 = pow( state[0], 2 ) + pow( state[1], 2 ) +
+                 pow( state[2], 2 );
+  if ( sunward >= 0 )
+  {
+    return sqrt( dist2 ) - m_radius;
+  }
+  return sqrt( dist2 - sunward * sunward ) - m_radius;
+}
+
+// Sign changes to report
+int
+ShadowEvent::
+getDirection() const
+{
+  return m_direction;
+}
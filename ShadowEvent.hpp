@@ -0,0 +1,53 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ShadowEvent.hpp
+/// @brief   Event function for entering and leaving the shadow of a
+///          spherical body.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_SHADOWEVENT_HEADER_GUARD
+#define EKF_SHADOWEVENT_HEADER_GUARD
+
+// C++ Standard Library
+#include <vector>
+
+// ekf Library
+#include <Event.hpp>
+
+/// @brief Event function for eclipse entry and exit.
+///
+/// Uses a cylindrical shadow behind a spherical body, with the sun
+/// direction fixed in the inertial frame ( it moves about a degree a day,
+/// so reset it for long arcs ). On the night side the value is the
+/// distance from the shadow axis less the body radius, and on the day
+/// side the distance from the body center less the radius; the two agree
+/// at the terminator plane, so the value is continuous. It falls at
+/// eclipse entry and rises at exit.
+///
+class ShadowEvent : public Event
+{
+ public:
+  ShadowEvent();
+  ShadowEvent( double radius, const std::vector< double > &sunDirection,
+               int direction );
+
+ ~ShadowEvent() override;
+
+  // Distance outside the shadow cylinder
+  double getValue( const std::vector< double > &state,
+                   double t ) const override;
+
+  // Sign changes to report
+  int getDirection() const override;
+
+ private:
+  double m_radius;
+  std::vector< double > m_sunDirection;
+  int m_direction;
+};
+
+#endif // EKF_SHADOWEVENT_HEADER_GUARD
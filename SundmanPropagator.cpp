@@ -0,0 +1,160 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    SundmanPropagator.cpp
+/// @brief   Cowell propagation regularized by a Sundman time transform.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <cmath>
+
+// boost Library
+#include <boost/numeric/odeint.hpp>
+
+// ekf Library
+#include <OdeintHelper.hpp>
+#include <SundmanPropagator.hpp>
+
+//=====================================================================
+//=====================================================================
+// This struct wraps OdeintHelper to integrate against fictitious time.
+struct sundman_system
+{
+  OdeintHelper* m_helper;
+  double m_r0;
+  double m_alpha;
+
+  // Constructor
+  sundman_system( OdeintHelper& helper, double r0, double alpha )
+      : m_helper( &helper ), m_r0( r0 ), m_alpha( alpha ) { }
+
+  // dt / ds for state y
+  double timeRate( const std::vector< double >& y ) const
+  {
+    double r = sqrt( y[0] * y[0] + y[1] * y[1] + y[2] * y[2] );
+    return pow( r / m_r0, m_alpha );
+  }
+
+  // The state and STM derivatives in time, scaled by dt / ds, with time
+  // itself as the last element of y.
+  void operator()( const std::vector< double >& y,
+                   std::vector< double >& dyds, double s )
+  {
+    ( *m_helper )( y, dyds, y.back() );
+    double rate = timeRate( y );
+    for ( size_t i = 0; i < y.size() - 1; ++i )
+    {
+      dyds[i] *= rate;
+    }
+    dyds.back() = rate;
+  }
+};
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+SundmanPropagator::
+SundmanPropagator()
+    : m_alpha( 1.5 ),
+      m_steps()
+{
+}
+
+// Constructor with the power of r in the time transform
+SundmanPropagator::
+SundmanPropagator( double alpha )
+    : m_alpha( alpha ),
+      m_steps()
+{
+}
+
+// Default Destructor
+SundmanPropagator::
+~SundmanPropagator()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Propagate the state and partials from t0 to t1 in fictitious time
+std::map< double, std::vector< double > >
+SundmanPropagator::
+propagate(
+    const std::vector< std::shared_ptr< Action > > &actions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0,
+    double t1,
+    double step )
+{
+  using namespace boost::numeric::odeint;
+
+  typedef runge_kutta_dopri5< std::vector< double > > rkStepper;
+
+  std::vector< std::shared_ptr< Action > > stepActions( actions );
+  AgentGroup agents( activeAgents );
+  OdeintHelper helper( stepActions, agents );
+
+  // Time rides along as the last element
+  std::vector< double > y( stateAndPartials );
+  y.push_back( t0 );
+  double r0 = sqrt( y[0] * y[0] + y[1] * y[1] + y[2] * y[2] );
+  sundman_system system( helper, r0, m_alpha );
+
+  std::map< double, std::vector< double > > pastStates;
+  pastStates.insert( std::make_pair( t0, stateAndPartials ) );
+
+  auto stepper = make_dense_output( 1.E-10, 1.E-9, rkStepper() );
+  stepper.initialize( y, 0.0, step );
+  m_steps = 0;
+
+  std::vector< double > times = outputTimes( t0, t1, step );
+  int numSteps = times.size() - 1;
+  std::vector< double > yi( y.size() );
+  for ( int i = 1; i <= numSteps; )
+  {
+    stepper.do_step( system );
+    ++m_steps;
+
+    // Find the fictitious time of every output time passed in this
+    // step by Newton iteration on the dense output, dt / ds > 0
+    const std::vector< double > &yEnd = stepper.current_state();
+    for ( ; ( i <= numSteps ) && ( times[i] <= yEnd.back() ); ++i )
+    {
+      double ti = times[i];
+      double sPrev = stepper.previous_time();
+      double sEnd = stepper.current_time();
+      double s = sPrev + ( sEnd - sPrev ) *
+        ( ti - stepper.previous_state().back() ) /
+        ( yEnd.back() - stepper.previous_state().back() );
+      for ( int n = 0; n < 20; ++n )
+      {
+        stepper.calc_state( s, yi );
+        double ds = ( ti - yi.back() ) / system.timeRate( yi );
+        s = std::min( sEnd, std::max( sPrev, s + ds ) );
+        if ( std::abs( ti - yi.back() ) <= 1.E-12 * std::abs( ti ) )
+        {
+          break;
+        }
+      }
+      pastStates.insert( std::make_pair(
+        ti, std::vector< double >( yi.begin(), yi.end() - 1 ) ) );
+    }
+  }
+
+  return pastStates;
+}
+
+// Integration steps taken by the last propagation
+int
+SundmanPropagator::
+getSteps() const
+{
+  return m_steps;
+}
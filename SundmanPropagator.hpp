@@ -0,0 +1,67 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    SundmanPropagator.hpp
+/// @brief   Cowell propagation regularized by a Sundman time transform.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_SUNDMANPROPAGATOR_HEADER_GUARD
+#define EKF_SUNDMANPROPAGATOR_HEADER_GUARD
+
+// C++ Standard Library
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <Propagator.hpp>
+
+/// @brief Cowell propagation regularized by a Sundman time transform.
+///
+/// Integrates the usual Cartesian state and STM equations against a
+/// fictitious time s, with dt / ds = ( r / r0 )^alpha and time carried
+/// as an extra state. Steps in s are spread more evenly over the orbit
+/// rather than bunched at perigee. alpha = 1 spaces steps like the
+/// eccentric anomaly, alpha = 2 like the true anomaly, and alpha = 0 is
+/// plain Cowell in physical time.
+///
+/// The gain on eccentric orbits is accuracy for the steps taken, not
+/// fewer steps: with the STM in the error norm the step count stays
+/// within about a tenth of Cowell's, and the position error over a day
+/// is several times smaller. The default alpha = 1.5 ( the intermediate
+/// anomaly ) did best over perigees of 300 km and apogees of 20000 to
+/// 200000 km; alpha = 1 loses to Cowell at the low end of that range.
+///
+/// The same Actions drive the accelerations through OdeintHelper.
+/// Output times are found on the dense output of the s integration,
+/// so the logged states and STMs are the ordinary time-based ones.
+///
+class SundmanPropagator : public Propagator
+{
+ public:
+  SundmanPropagator();
+  SundmanPropagator( double alpha );
+ ~SundmanPropagator() override;
+
+  // Propagate stateAndPartials from t0 to t1, logging every step in
+  // the returned map as Motion::stepTo would.
+  std::map< double, std::vector< double > > propagate(
+    const std::vector< std::shared_ptr< Action > > &actions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0, double t1, double step ) override;
+
+  // Integration steps taken by the last propagation
+  int getSteps() const;
+
+ private:
+  double m_alpha;
+  int m_steps;
+};
+
+#endif // EKF_SUNDMANPROPAGATOR_HEADER_GUARD
@@ -0,0 +1,194 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    SymplecticPropagator.cpp
+/// @brief   Fixed step symplectic integration by Yoshida composition of
+///          the leapfrog.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// ekf Library
+#include <OdeintHelper.hpp>
+#include <SymplecticPropagator.hpp>
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor, order 6 at 30 s steps, which in LEO is as
+// accurate as the default dopri5 integration
+SymplecticPropagator::
+SymplecticPropagator()
+    : m_order( 6 ),
+      m_step( 30.0 ),
+      m_weights(),
+      m_evaluations()
+{
+  composeWeights( m_order );
+}
+
+// Constructor with the order of the composition and the largest step
+SymplecticPropagator::
+SymplecticPropagator(
+    int order,
+    double step )
+    : m_order( order ),
+      m_step( step ),
+      m_weights(),
+      m_evaluations()
+{
+  if ( !( step > 0.0 ) )
+  {
+    std::cout << "SymplecticPropagator step must be positive." << std::endl;
+    throw;
+  }
+  composeWeights( order );
+}
+
+// Default Destructor
+SymplecticPropagator::
+~SymplecticPropagator()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Propagate the state and partials from t0 to t1 in equal steps no
+// longer than m_step between every pair of output times
+std::map< double, std::vector< double > >
+SymplecticPropagator::
+propagate(
+    const std::vector< std::shared_ptr< Action > > &actions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0,
+    double t1,
+    double step )
+{
+  std::vector< std::shared_ptr< Action > > stepActions( actions );
+  AgentGroup agents( activeAgents );
+  OdeintHelper helper( stepActions, agents );
+
+  int numAgents = ( stateAndPartials.size() > 6 ) ? activeAgents.size() : 0;
+  std::vector< double > x( stateAndPartials );
+  std::vector< double > dxdt( x.size() );
+
+  std::map< double, std::vector< double > > pastStates;
+  pastStates.insert( std::make_pair( t0, x ) );
+  m_evaluations = 0;
+
+  // Position rows of the STM move with the velocity rows, velocity rows
+  // with the acceleration partials times the STM
+  auto drift = [&]( double h )
+  {
+    for ( int i = 0; i < 3; ++i )
+    {
+      x[i] += h * x[i + 3];
+      for ( int j = 0; j < numAgents; ++j )
+      {
+        x[ 6 + i * numAgents + j ] += h * x[ 6 + ( i + 3 ) * numAgents + j ];
+      }
+    }
+  };
+  auto kick = [&]( double h, double t )
+  {
+    helper( x, dxdt, t );
+    ++m_evaluations;
+    for ( int i = 3; i < 6; ++i )
+    {
+      x[i] += h * dxdt[i];
+      for ( int j = 0; j < numAgents; ++j )
+      {
+        x[ 6 + i * numAgents + j ] += h * dxdt[ 6 + i * numAgents + j ];
+      }
+    }
+  };
+
+  std::vector< double > times = outputTimes( t0, t1, step );
+  int numSteps = times.size() - 1;
+  int numStages = m_weights.size();
+  for ( int i = 1; i <= numSteps; ++i )
+  {
+    double interval = times[i] - times[ i - 1 ];
+    int subSteps = std::max( 1, int( std::ceil( interval / m_step - 1.E-9 ) ) );
+    double h = interval / subSteps;
+    for ( int s = 0; s < subSteps; ++s )
+    {
+      // Drift-kick-drift stages, with the adjacent drifts merged
+      double t = times[ i - 1 ] + s * h;
+      drift( 0.5 * m_weights[0] * h );
+      t += 0.5 * m_weights[0] * h;
+      for ( int k = 0; k < numStages; ++k )
+      {
+        kick( m_weights[k] * h, t );
+        double w = ( k + 1 < numStages ) ?
+          0.5 * ( m_weights[k] + m_weights[k + 1] ) : 0.5 * m_weights[k];
+        drift( w * h );
+        t += w * h;
+      }
+    }
+    pastStates.insert( std::make_pair( times[i], x ) );
+  }
+
+  return pastStates;
+}
+
+// Force evaluations made by the last propagation
+int
+SymplecticPropagator::
+getEvaluations() const
+{
+  return m_evaluations;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Stage weights of the composition of order. The outer weights are
+// Yoshida's ( 1990 ) solution A at order 6 and solution D at order 8;
+// the middle weight makes them sum to one.
+void
+SymplecticPropagator::
+composeWeights( int order )
+{
+  std::vector< double > outer;
+  switch ( order )
+  {
+    case 2:
+      break;
+    case 4:
+      outer = { 1.0 / ( 2.0 - std::pow( 2.0, 1.0 / 3.0 ) ) };
+      break;
+    case 6:
+      outer = { -1.17767998417887, 0.235573213359357, 0.784513610477560 };
+      break;
+    case 8:
+      outer = { 0.102799849391985, -1.96061023297549, 1.93813913762276,
+                -0.158240635368243, -1.44485223686048, 0.253693336566229,
+                0.914844246229740 };
+      break;
+    default:
+      std::cout << "SymplecticPropagator order must be 2, 4, 6 or 8."
+                << std::endl;
+      throw;
+  }
+
+  // Symmetric sequence w_n ... w_1 w_0 w_1 ... w_n
+  double middle = 1.0;
+  for ( double w: outer )
+  {
+    middle -= 2 * w;
+  }
+  m_weights.assign( outer.rbegin(), outer.rend() );
+  m_weights.push_back( middle );
+  m_weights.insert( m_weights.end(), outer.begin(), outer.end() );
+}
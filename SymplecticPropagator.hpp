@@ -0,0 +1,71 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    SymplecticPropagator.hpp
+/// @brief   Fixed step symplectic integration by Yoshida composition of
+///          the leapfrog.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_SYMPLECTICPROPAGATOR_HEADER_GUARD
+#define EKF_SYMPLECTICPROPAGATOR_HEADER_GUARD
+
+// C++ Standard Library
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <Propagator.hpp>
+
+/// @brief Fixed step symplectic integration for conservative forces.
+///
+/// Each step is a symmetric composition of drift-kick-drift leapfrog
+/// stages with Yoshida's weights, giving a symplectic map of order 2,
+/// 4, 6 or 8. With only conservative Actions ( GravityAction ) the
+/// energy error stays bounded instead of drifting, so long arcs can be
+/// taken with large fixed steps and no error control. The default is
+/// order 6 at 30 s steps.
+///
+/// The STM follows the tangent map of the same stages: a drift adds
+/// h times the velocity rows to the position rows, and a kick adds h
+/// times the acceleration partials ( from the Actions, through
+/// OdeintHelper ) applied to the STM. The result is the exact
+/// derivative of the discrete map, and is itself symplectic.
+///
+/// Velocity dependent Actions ( AtmosphereAction ) are kicked with the
+/// velocity at the start of the kick. This is consistent to the order
+/// of the method but no longer symplectic.
+///
+class SymplecticPropagator : public Propagator
+{
+ public:
+  SymplecticPropagator();
+  SymplecticPropagator( int order, double step );
+ ~SymplecticPropagator() override;
+
+  // Propagate stateAndPartials from t0 to t1, logging every step in
+  // the returned map as Motion::stepTo would.
+  std::map< double, std::vector< double > > propagate(
+    const std::vector< std::shared_ptr< Action > > &actions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0, double t1, double step ) override;
+
+  // Force evaluations made by the last propagation
+  int getEvaluations() const;
+
+ private:
+  int m_order;
+  double m_step;
+  std::vector< double > m_weights;
+  int m_evaluations;
+
+  void composeWeights( int order );
+};
+
+#endif // EKF_SYMPLECTICPROPAGATOR_HEADER_GUARD
@@ -0,0 +1,324 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    TaylorJet.cpp
+/// @brief   Truncated Taylor series with first order sensitivities, for
+///          recursive automatic differentiation of equations of motion.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+
+// ekf Library
+#include <TaylorJet.hpp>
+
+//=====================================================================
+//=====================================================================
+// Value and gradient arithmetic on single coefficient rows, in place to
+// keep the inner loops free of temporaries.
+
+namespace
+{
+
+// c += s * a * b
+void
+accumulateProduct(
+    TaylorJet::Coefficients::RowXpr c,
+    TaylorJet::Coefficients::ConstRowXpr a,
+    TaylorJet::Coefficients::ConstRowXpr b,
+    double s )
+{
+  int n = c.size() - 1;
+  c( 0 ) += s * a( 0 ) * b( 0 );
+  c.tail( n ) += ( s * a( 0 ) ) * b.tail( n ) + ( s * b( 0 ) ) * a.tail( n );
+}
+
+// c = c / ( s * b )
+void
+divide(
+    TaylorJet::Coefficients::RowXpr c,
+    TaylorJet::Coefficients::ConstRowXpr b,
+    double s )
+{
+  int n = c.size() - 1;
+  double b0 = s * b( 0 );
+  double c0 = c( 0 ) / b0;
+  c.tail( n ) = ( c.tail( n ) - ( c0 * s ) * b.tail( n ) ) / b0;
+  c( 0 ) = c0;
+}
+
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+TaylorJet::
+TaylorJet()
+    : m_coeffs()
+{
+}
+
+// Constructor with series order and number of gradient seeds
+TaylorJet::
+TaylorJet(
+    int order,
+    int numSeeds )
+    : m_coeffs( Coefficients::Zero( order + 1, numSeeds + 1 ) )
+{
+}
+
+// Default Destructor
+TaylorJet::
+~TaylorJet()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Coefficient k as value followed by gradient
+TaylorJet::Coefficients::RowXpr
+TaylorJet::
+operator[]( int k )
+{
+  return m_coeffs.row( k );
+}
+
+TaylorJet::Coefficients::ConstRowXpr
+TaylorJet::
+operator[]( int k ) const
+{
+  return m_coeffs.row( k );
+}
+
+// Value of coefficient k
+double
+TaylorJet::
+value( int k ) const
+{
+  return m_coeffs( k, 0 );
+}
+
+// Highest coefficient held
+int
+TaylorJet::
+order() const
+{
+  return m_coeffs.rows() - 1;
+}
+
+// A constant only has a zeroth coefficient
+void
+TaylorJet::
+constant(
+    int k,
+    double c,
+    int seed )
+{
+  m_coeffs.row( k ).setZero();
+  if ( k == 0 )
+  {
+    m_coeffs( 0, 0 ) = c;
+    if ( seed >= 0 )
+    {
+      m_coeffs( 0, 1 + seed ) = 1;
+    }
+  }
+}
+
+void
+TaylorJet::
+sum(
+    int k,
+    const TaylorJet &a,
+    const TaylorJet &b )
+{
+  m_coeffs.row( k ) = a[k] + b[k];
+}
+
+void
+TaylorJet::
+difference(
+    int k,
+    const TaylorJet &a,
+    const TaylorJet &b )
+{
+  m_coeffs.row( k ) = a[k] - b[k];
+}
+
+void
+TaylorJet::
+scale(
+    int k,
+    double c,
+    const TaylorJet &a )
+{
+  m_coeffs.row( k ) = c * a[k];
+}
+
+// c_k = sum_{i=0..k} a_i b_{k-i}
+void
+TaylorJet::
+product(
+    int k,
+    const TaylorJet &a,
+    const TaylorJet &b )
+{
+  m_coeffs.row( k ).setZero();
+  for ( int i = 0; i <= k; ++i )
+  {
+    accumulateProduct( m_coeffs.row( k ), a[i], b[k - i], 1 );
+  }
+}
+
+// c_k = ( a_k - sum_{i=1..k} b_i c_{k-i} ) / b_0
+void
+TaylorJet::
+quotient(
+    int k,
+    const TaylorJet &a,
+    const TaylorJet &b )
+{
+  const Coefficients &c = m_coeffs;
+  m_coeffs.row( k ) = a[k];
+  for ( int i = 1; i <= k; ++i )
+  {
+    accumulateProduct( m_coeffs.row( k ), b[i], c.row( k - i ), -1 );
+  }
+  divide( m_coeffs.row( k ), b[0], 1 );
+}
+
+// c_k = ( a_k - sum_{i=1..k-1} c_i c_{k-i} ) / ( 2 c_0 )
+void
+TaylorJet::
+squareRoot(
+    int k,
+    const TaylorJet &a )
+{
+  if ( k == 0 )
+  {
+    double c0 = std::sqrt( a.value( 0 ) );
+    m_coeffs.row( 0 ) = a[0] / ( 2 * c0 );
+    m_coeffs( 0, 0 ) = c0;
+    return;
+  }
+
+  const Coefficients &c = m_coeffs;
+  m_coeffs.row( k ) = a[k];
+  for ( int i = 1; i < k; ++i )
+  {
+    accumulateProduct( m_coeffs.row( k ), c.row( i ), c.row( k - i ), -1 );
+  }
+  divide( m_coeffs.row( k ), c.row( 0 ), 2 );
+}
+
+// c_k = 1 / k sum_{i=1..k} i a_i c_{k-i}
+void
+TaylorJet::
+exponential(
+    int k,
+    const TaylorJet &a )
+{
+  if ( k == 0 )
+  {
+    double c0 = std::exp( a.value( 0 ) );
+    m_coeffs.row( 0 ) = c0 * a[0];
+    m_coeffs( 0, 0 ) = c0;
+    return;
+  }
+
+  const Coefficients &c = m_coeffs;
+  m_coeffs.row( k ).setZero();
+  for ( int i = 1; i <= k; ++i )
+  {
+    accumulateProduct( m_coeffs.row( k ), a[i], c.row( k - i ),
+                       double( i ) / k );
+  }
+}
+
+// Horner evaluation of the series and its gradient at offset h
+Eigen::RowVectorXd
+TaylorJet::
+evaluate( double h ) const
+{
+  int K = order();
+  Eigen::RowVectorXd x = m_coeffs.row( K );
+  for ( int k = K - 1; k >= 0; --k )
+  {
+    x = x * h + m_coeffs.row( k );
+  }
+  return x;
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+TaylorWorkspace::
+TaylorWorkspace()
+    : m_order(),
+      m_numSeeds(),
+      m_activeAgents(),
+      m_jets(),
+      m_next()
+{
+}
+
+// Constructor with series order and the agents seeding the gradients
+TaylorWorkspace::
+TaylorWorkspace(
+    int order,
+    int numSeeds,
+    const AgentGroup &activeAgents )
+    : m_order( order ),
+      m_numSeeds( numSeeds ),
+      m_activeAgents( activeAgents ),
+      m_jets(),
+      m_next( 0 )
+{
+}
+
+// Default Destructor
+TaylorWorkspace::
+~TaylorWorkspace()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Hand out scratch jets in order, growing the pool on first use. A
+// deque keeps earlier jets in place as it grows.
+TaylorJet&
+TaylorWorkspace::
+next()
+{
+  if ( m_next == m_jets.size() )
+  {
+    m_jets.push_back( TaylorJet( m_order, m_numSeeds ) );
+  }
+  return m_jets[ m_next++ ];
+}
+
+void
+TaylorWorkspace::
+rewind()
+{
+  m_next = 0;
+}
+
+// Seed column of an interned agent ID, or -1 if it is not active
+int
+TaylorWorkspace::
+seed( int id ) const
+{
+  return m_activeAgents.getRow( id );
+}
@@ -0,0 +1,105 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    TaylorJet.hpp
+/// @brief   Truncated Taylor series with first order sensitivities, for
+///          recursive automatic differentiation of equations of motion.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_TAYLORJET_HEADER_GUARD
+#define EKF_TAYLORJET_HEADER_GUARD
+
+// C++ Standard Library
+#include <deque>
+#include <string>
+#include <vector>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <AgentGroup.hpp>
+
+/// @brief Truncated Taylor series in time with first order sensitivities.
+///
+/// Row k of the coefficient matrix holds the k-th normalized Taylor
+/// coefficient x^(k) / k!. Column 0 is its value and the remaining
+/// columns its gradient wrt the seeded agents, so propagating a jet
+/// yields the STM alongside the state.
+///
+/// Every operation computes only coefficient k, given coefficients
+/// 0..k of its arguments and 0..k-1 of itself ( Jorba and Zou ).
+/// Calling the same sequence of operations for k = 0, 1, ... therefore
+/// builds the series in O(order^2).
+///
+class TaylorJet
+{
+ public:
+  typedef Eigen::Matrix< double, Eigen::Dynamic, Eigen::Dynamic,
+                         Eigen::RowMajor > Coefficients;
+
+  TaylorJet();
+  TaylorJet( int order, int numSeeds );
+ ~TaylorJet();
+
+  // Coefficient k as value followed by gradient
+  Coefficients::RowXpr operator[]( int k );
+  Coefficients::ConstRowXpr operator[]( int k ) const;
+  // Value of coefficient k
+  double value( int k ) const;
+  // Highest coefficient held
+  int order() const;
+
+  // Order k coefficient of constant c, with gradient seed if seed >= 0
+  void constant( int k, double c, int seed = -1 );
+  // Order k coefficient of a + b, a - b and c * a
+  void sum( int k, const TaylorJet &a, const TaylorJet &b );
+  void difference( int k, const TaylorJet &a, const TaylorJet &b );
+  void scale( int k, double c, const TaylorJet &a );
+  // Order k coefficient of a * b, a / b, sqrt( a ) and exp( a )
+  void product( int k, const TaylorJet &a, const TaylorJet &b );
+  void quotient( int k, const TaylorJet &a, const TaylorJet &b );
+  void squareRoot( int k, const TaylorJet &a );
+  void exponential( int k, const TaylorJet &a );
+
+  // Evaluate the series at time offset h, value followed by gradient
+  Eigen::RowVectorXd evaluate( double h ) const;
+
+ private:
+  Coefficients m_coeffs;
+};
+
+/// @brief Scratch jets for one evaluation of the equations of motion.
+///
+/// Intermediate results of an evaluation are taken in order with
+/// next(). Since every order k runs the same sequence of operations,
+/// the n-th jet handed out always holds the same intermediate, and the
+/// lower coefficients computed at earlier orders are found in it.
+///
+class TaylorWorkspace
+{
+ public:
+  TaylorWorkspace();
+  TaylorWorkspace( int order, int numSeeds,
+                   const AgentGroup &activeAgents );
+ ~TaylorWorkspace();
+
+  // Next scratch jet of this evaluation
+  TaylorJet& next();
+  // Start the next order over from the first scratch jet
+  void rewind();
+  // Seed column of an interned agent ID, or -1 if it is not active
+  int seed( int id ) const;
+
+ private:
+  int m_order;
+  int m_numSeeds;
+  AgentGroup m_activeAgents;
+  std::deque< TaylorJet > m_jets;
+  size_t m_next;
+};
+
+#endif // EKF_TAYLORJET_HEADER_GUARD
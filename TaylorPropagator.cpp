@@ -0,0 +1,213 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    TaylorPropagator.cpp
+/// @brief   High order Taylor series propagator for reference orbits.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+// ekf Library
+#include <TaylorPropagator.hpp>
+
+namespace
+{
+  // Series order for a relative local error tolerance in ( 0, 1 ), at
+  // least 2 so the step size has two coefficients to go on
+  int
+  orderFor( double tolerance )
+  {
+    if ( !( tolerance > 0.0 ) || !( tolerance < 1.0 ) )
+    {
+      std::cout << "Taylor tolerance " << tolerance
+                << " is not between 0 and 1" << std::endl;
+      throw;
+    }
+    return std::max( 2.0, std::ceil( 1 - 0.5 * std::log( tolerance ) ) );
+  }
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor, at a relative local error of 1e-12
+TaylorPropagator::
+TaylorPropagator()
+    : m_tolerance( 1.E-12 ),
+      m_order( orderFor( 1.E-12 ) ),
+      m_steps()
+{
+}
+
+// Constructor with relative local error tolerance
+TaylorPropagator::
+TaylorPropagator( double tolerance )
+    : m_tolerance( tolerance ),
+      m_order( orderFor( tolerance ) ),
+      m_steps()
+{
+}
+
+// Default Destructor
+TaylorPropagator::
+~TaylorPropagator()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Propagate the state and partials from t0 to t1 in Taylor steps
+std::map< double, std::vector< double > >
+TaylorPropagator::
+propagate(
+    const std::vector< std::shared_ptr< Action > > &actions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0,
+    double t1,
+    double step )
+{
+  int numAgents = activeAgents.size();
+  int K = m_order;
+  m_steps = 0;
+
+  std::vector< double > x( stateAndPartials );
+  std::vector< TaylorJet > state( 6, TaylorJet( K, numAgents ) );
+  std::vector< TaylorJet > accel( 3, TaylorJet( K, numAgents ) );
+  TaylorWorkspace workspace( K, numAgents, activeAgents );
+
+  std::map< double, std::vector< double > > pastStates;
+  pastStates.insert( std::make_pair( t0, x ) );
+
+  std::vector< double > times = outputTimes( t0, t1, step );
+  int numSteps = times.size() - 1;
+  int i = 1;
+  double t = t0;
+  while ( i <= numSteps )
+  {
+    // Zeroth coefficients: the state, with the STM rows as gradient
+    for ( int s = 0; s < 6; ++s )
+    {
+      state[s][0]( 0 ) = x[s];
+      for ( int j = 0; j < numAgents; ++j )
+      {
+        state[s][0]( 1 + j ) = x[ 6 + s * numAgents + j ];
+      }
+    }
+
+    // Build the series one order at a time
+    for ( int k = 0; k < K; ++k )
+    {
+      workspace.rewind();
+      for ( int s = 0; s < 3; ++s )
+      {
+        accel[s][k].setZero();
+      }
+      for ( auto ap: actions )
+      {
+        if ( !ap->getAccelerationJet( accel, state, k, workspace ) )
+        {
+          std::cout << "TaylorPropagator requires Taylor models for all "
+                    << "Actions." << std::endl;
+          throw;
+        }
+      }
+      for ( int s = 0; s < 3; ++s )
+      {
+        state[s][k + 1] = state[s + 3][k] / ( k + 1 );
+        state[s + 3][k + 1] = accel[s][k] / ( k + 1 );
+      }
+    }
+
+    // Evaluate every output time the step reaches, then advance
+    double h = stepSize( state );
+    double tNext = t + h;
+    for ( ; ( i <= numSteps ) && ( times[i] <= tNext ); ++i )
+    {
+      double ti = times[i];
+      std::vector< double > xi( x );
+      for ( int s = 0; s < 6; ++s )
+      {
+        Eigen::RowVectorXd y = state[s].evaluate( ti - t );
+        xi[s] = y( 0 );
+        for ( int j = 0; j < numAgents; ++j )
+        {
+          xi[ 6 + s * numAgents + j ] = y( 1 + j );
+        }
+      }
+      pastStates.insert( std::make_pair( ti, xi ) );
+    }
+
+    if ( i <= numSteps )
+    {
+      for ( int s = 0; s < 6; ++s )
+      {
+        Eigen::RowVectorXd y = state[s].evaluate( h );
+        x[s] = y( 0 );
+        for ( int j = 0; j < numAgents; ++j )
+        {
+          x[ 6 + s * numAgents + j ] = y( 1 + j );
+        }
+      }
+      t = tNext;
+    }
+    ++m_steps;
+  }
+
+  return pastStates;
+}
+
+// Series order in use
+int
+TaylorPropagator::
+getOrder() const
+{
+  return m_order;
+}
+
+// Taylor steps taken by the last propagation
+int
+TaylorPropagator::
+getSteps() const
+{
+  return m_steps;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Step size from the last two coefficients ( Jorba and Zou ), scaled
+// separately for position and velocity
+double
+TaylorPropagator::
+stepSize( const std::vector< TaylorJet > &state ) const
+{
+  int K = m_order;
+  double h = std::numeric_limits< double >::max();
+  for ( int part = 0; part < 2; ++part )
+  {
+    double norm0 = 0.0;
+    double normK1 = 0.0;
+    double normK = 0.0;
+    for ( int s = 3 * part; s < 3 * part + 3; ++s )
+    {
+      norm0 = std::max( norm0, std::abs( state[s].value( 0 ) ) );
+      normK1 = std::max( normK1, std::abs( state[s].value( K - 1 ) ) );
+      normK = std::max( normK, std::abs( state[s].value( K ) ) );
+    }
+    double rhoK1 = std::pow( norm0 / normK1, 1.0 / ( K - 1 ) );
+    double rhoK = std::pow( norm0 / normK, 1.0 / K );
+    h = std::min( h, std::min( rhoK1, rhoK ) );
+  }
+  return h / std::exp( 2.0 ) * std::exp( -0.7 / ( K - 1 ) );
+}
@@ -0,0 +1,70 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    TaylorPropagator.hpp
+/// @brief   High order Taylor series propagator for reference orbits.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_TAYLORPROPAGATOR_HEADER_GUARD
+#define EKF_TAYLORPROPAGATOR_HEADER_GUARD
+
+// C++ Standard Library
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <Propagator.hpp>
+#include <TaylorJet.hpp>
+
+/// @brief High order Taylor series propagator for reference orbits.
+///
+/// The Taylor coefficients of the equations of motion are generated
+/// by recursive automatic differentiation through each Action's
+/// getAccelerationJet. The jets carry gradients seeded by the current
+/// STM rows and by any active parameter agents, so the same series
+/// advance the STM.
+///
+/// The order is fixed from the tolerance as ceil( 1 - 0.5 ln tol )
+/// ( Jorba and Zou ), the tolerance strictly between 0 and 1 and 1e-12
+/// by default. Only the step adapts, from the decay of the last two
+/// coefficients; under a single relative tolerance the optimal order
+/// depends on the tolerance alone, so choosing it per step would not
+/// change it. Steps are typically many times longer than dopri5's at
+/// the same accuracy.
+/// States between steps are evaluated from the series.
+///
+class TaylorPropagator : public Propagator
+{
+ public:
+  TaylorPropagator();
+  TaylorPropagator( double tolerance );
+ ~TaylorPropagator() override;
+
+  // Propagate stateAndPartials from t0 to t1, logging every step in
+  // the returned map as Motion::stepTo would.
+  std::map< double, std::vector< double > > propagate(
+    const std::vector< std::shared_ptr< Action > > &actions,
+    const std::vector< double > &stateAndPartials,
+    const AgentGroup &activeAgents,
+    double t0, double t1, double step ) override;
+
+  // Series order in use
+  int getOrder() const;
+  // Taylor steps taken by the last propagation
+  int getSteps() const;
+
+ private:
+  double m_tolerance;
+  int m_order;
+  int m_steps;
+
+  double stepSize( const std::vector< TaylorJet > &state ) const;
+};
+
+#endif // EKF_TAYLORPROPAGATOR_HEADER_GUARD
@@ -0,0 +1,488 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    TrackingSimulator.cpp
+/// @brief   Synthetic station tracking measurements of many objects.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+// ekf Library
+#include <Motion.hpp>
+#include <Parallel.hpp>
+#include <TrackingSimulator.hpp>
+
+namespace
+{
+  const double pi = 3.14159265358979323846;
+  const char magic[ MeasurementFile::headerSize ] =
+    { 'E', 'K', 'F', 'M', 'E', 'A', '1', '\0' };
+
+  // Objects simulated between writes, per thread
+  const int objectsPerThread = 4;
+
+  // Acceleration of a state under actions at t
+  void
+  accelerationAt(
+      const std::vector< std::shared_ptr< Action > > &actions,
+      const std::vector< double > &state,
+      double t,
+      double acceleration[3] )
+  {
+    std::vector< double > sum( 3, 0.0 );
+    for ( const auto &action: actions )
+    {
+      action->getAccelerationAtTime( sum, state, t );
+    }
+    std::copy( sum.begin(), sum.end(), acceleration );
+  }
+}
+
+//=====================================================================
+//=====================================================================
+// MEASUREMENT FILE
+
+const std::size_t MeasurementFile::headerSize;
+
+// Write the magic
+void
+MeasurementFile::
+writeHeader( std::ostream &out )
+{
+  out.write( magic, sizeof( magic ) );
+}
+
+// Check the magic, and that whole records follow it
+std::size_t
+MeasurementFile::
+countRecords(
+    const char *data,
+    std::size_t size,
+    const std::string &path )
+{
+  if ( !data || ( size < sizeof( magic ) ) ||
+       ( std::memcmp( data, magic, sizeof( magic ) ) != 0 ) ||
+       ( ( size - sizeof( magic ) ) % sizeof( Measurement ) != 0 ) )
+  {
+    std::cout << path << " is not a measurement file" << std::endl;
+    throw;
+  }
+  return ( size - sizeof( magic ) ) / sizeof( Measurement );
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor, on a body of unit radius at rest
+TrackingSimulator::
+TrackingSimulator()
+    : m_radius( 1.0 ),
+      m_rotation( 0.0 ),
+      m_latitude(),
+      m_longitude(),
+      m_minElevation(),
+      m_rangeNoise(),
+      m_rangeRateNoise(),
+      m_angleNoise(),
+      m_rangeBias(),
+      m_rangeRateBias(),
+      m_azimuthBias(),
+      m_elevationBias(),
+      m_states(),
+      m_actions(),
+      m_cadence( 10.0 ),
+      m_step( 60.0 ),
+      m_seed( 0 ),
+      m_numThreads( 0 )
+{
+}
+
+// Constructor with the radius and rotation rate of the body the
+// stations sit on
+TrackingSimulator::
+TrackingSimulator(
+    double radius,
+    double rotation )
+    : m_radius( radius ),
+      m_rotation( rotation ),
+      m_latitude(),
+      m_longitude(),
+      m_minElevation(),
+      m_rangeNoise(),
+      m_rangeRateNoise(),
+      m_angleNoise(),
+      m_rangeBias(),
+      m_rangeRateBias(),
+      m_azimuthBias(),
+      m_elevationBias(),
+      m_states(),
+      m_actions(),
+      m_cadence( 10.0 ),
+      m_step( 60.0 ),
+      m_seed( 0 ),
+      m_numThreads( 0 )
+{
+}
+
+// Default Destructor
+TrackingSimulator::
+~TrackingSimulator()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Add a noiseless, unbiased station
+int
+TrackingSimulator::
+addStation(
+    double latitude,
+    double longitude,
+    double minElevation )
+{
+  m_latitude.push_back( latitude );
+  m_longitude.push_back( longitude );
+  m_minElevation.push_back( minElevation );
+  m_rangeNoise.push_back( 0.0 );
+  m_rangeRateNoise.push_back( 0.0 );
+  m_angleNoise.push_back( 0.0 );
+  m_rangeBias.push_back( 0.0 );
+  m_rangeRateBias.push_back( 0.0 );
+  m_azimuthBias.push_back( 0.0 );
+  m_elevationBias.push_back( 0.0 );
+  return m_latitude.size() - 1;
+}
+
+// Noise standard deviations of a station
+void
+TrackingSimulator::
+setNoise(
+    int station,
+    double range,
+    double rangeRate,
+    double angle )
+{
+  m_rangeNoise[ station ] = range;
+  m_rangeRateNoise[ station ] = rangeRate;
+  m_angleNoise[ station ] = angle;
+}
+
+// Biases of a station
+void
+TrackingSimulator::
+setBias(
+    int station,
+    double range,
+    double rangeRate,
+    double azimuth,
+    double elevation )
+{
+  m_rangeBias[ station ] = range;
+  m_rangeRateBias[ station ] = rangeRate;
+  m_azimuthBias[ station ] = azimuth;
+  m_elevationBias[ station ] = elevation;
+}
+
+// Add an object
+int
+TrackingSimulator::
+addObject(
+    const std::vector< double > &state,
+    const std::vector< std::shared_ptr< Action > > &actions )
+{
+  m_states.push_back( state );
+  m_actions.push_back( actions );
+  return m_states.size() - 1;
+}
+
+// Time between measurements
+void
+TrackingSimulator::
+setCadence( double interval )
+{
+  m_cadence = interval;
+}
+
+// Time between logged truth states
+void
+TrackingSimulator::
+setPropagationStep( double step )
+{
+  m_step = step;
+}
+
+// Seed of the noise
+void
+TrackingSimulator::
+setSeed( std::uint64_t seed )
+{
+  m_seed = seed;
+}
+
+// Threads simulating objects
+void
+TrackingSimulator::
+setThreads( unsigned int numThreads )
+{
+  m_numThreads = numThreads;
+}
+
+// Simulate every object into one list
+std::vector< Measurement >
+TrackingSimulator::
+simulate(
+    double t0,
+    double t1 ) const
+{
+  int numObjects = m_states.size();
+  std::vector< std::vector< Measurement > > byObject( numObjects );
+  parallelFor( 0, numObjects, m_numThreads, [&]( int object )
+  {
+    simulateObject( object, t0, t1, byObject[ object ] );
+  } );
+
+  std::vector< Measurement > measurements;
+  for ( const auto &some: byObject )
+  {
+    measurements.insert( measurements.end(), some.begin(), some.end() );
+  }
+  return measurements;
+}
+
+// Simulate objects a batch at a time, writing each batch in object
+// order, so memory stays bounded however many objects there are
+std::size_t
+TrackingSimulator::
+simulate(
+    double t0,
+    double t1,
+    const std::string &path ) const
+{
+  std::ofstream out( path.c_str(), std::ios::binary );
+  if ( !out )
+  {
+    std::cout << "Cannot write " << path << std::endl;
+    throw;
+  }
+  MeasurementFile::writeHeader( out );
+
+  int numObjects = m_states.size();
+  int batch = objectsPerThread * resolveThreads( m_numThreads );
+  std::vector< std::vector< Measurement > > byObject( batch );
+  std::size_t count = 0;
+  for ( int first = 0; first < numObjects; first += batch )
+  {
+    int last = std::min( first + batch, numObjects );
+    parallelFor( first, last, m_numThreads, [&]( int object )
+    {
+      byObject[ object - first ].clear();
+      simulateObject( object, t0, t1, byObject[ object - first ] );
+    } );
+    for ( int k = 0; k < last - first; ++k )
+    {
+      out.write( reinterpret_cast< const char* >( byObject[k].data() ),
+                 byObject[k].size() * sizeof( Measurement ) );
+      count += byObject[k].size();
+    }
+  }
+  if ( !out )
+  {
+    std::cout << "Failed writing " << path << std::endl;
+    throw;
+  }
+  return count;
+}
+
+// Read a measurement file
+std::vector< Measurement >
+TrackingSimulator::
+readMeasurements( const std::string &path )
+{
+  std::ifstream in( path.c_str(), std::ios::binary | std::ios::ate );
+  std::streamoff size = in.tellg();
+  char header[ MeasurementFile::headerSize ];
+  in.seekg( 0 );
+  in.read( header, sizeof( header ) );
+  std::vector< Measurement > measurements( MeasurementFile::countRecords(
+    in ? header : 0, ( size > 0 ) ? size : 0, path ) );
+  in.read( reinterpret_cast< char* >( measurements.data() ),
+           measurements.size() * sizeof( Measurement ) );
+  return measurements;
+}
+
+// Number of stations
+int
+TrackingSimulator::
+getNumStations() const
+{
+  return m_latitude.size();
+}
+
+// Number of objects
+int
+TrackingSimulator::
+getNumObjects() const
+{
+  return m_states.size();
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Propagate one object over [ t0, t1 ], then measure it from every
+// station at each measurement time
+void
+TrackingSimulator::
+simulateObject(
+    int object,
+    double t0,
+    double t1,
+    std::vector< Measurement > &measurements ) const
+{
+  const std::vector< std::shared_ptr< Action > > &actions =
+    m_actions[ object ];
+  Motion motion( m_states[ object ], m_step, t0 );
+  for ( const auto &action: actions )
+  {
+    motion.addAction( action );
+  }
+  int numSteps = std::ceil( ( t1 - t0 ) / m_step - 1.E-9 );
+  motion.stepTo( t0 + numSteps * m_step );
+
+  std::seed_seq seeds = { (std::uint32_t) m_seed,
+                          (std::uint32_t) ( m_seed >> 32 ),
+                          (std::uint32_t) object };
+  std::mt19937_64 generator( seeds );
+  std::normal_distribution< double > gaussian;
+
+  // Logged states at the ends of the current interval, and their
+  // accelerations
+  int node = -1;
+  std::vector< double > left;
+  std::vector< double > right;
+  double leftAcc[3];
+  double rightAcc[3];
+
+  int numStations = m_latitude.size();
+  int numTimes = std::floor( ( t1 - t0 ) / m_cadence + 1.E-9 ) + 1;
+  for ( int k = 0; k < numTimes; ++k )
+  {
+    double t = t0 + k * m_cadence;
+    int interval = std::min( (int) std::floor( ( t - t0 ) / m_step ),
+                             std::max( numSteps - 1, 0 ) );
+    if ( interval != node )
+    {
+      node = interval;
+      double ta = t0 + node * m_step;
+      left = motion.getState( ta );
+      accelerationAt( actions, left, ta, leftAcc );
+      if ( numSteps > 0 )
+      {
+        right = motion.getState( ta + m_step );
+        accelerationAt( actions, right, ta + m_step, rightAcc );
+      }
+    }
+
+    // Quintic Hermite on the interval, and its derivative
+    double h = m_step;
+    double s = ( numSteps > 0 ) ? ( t - t0 - node * h ) / h : 0.0;
+    double s2 = s * s;
+    double s3 = s2 * s;
+    double s4 = s3 * s;
+    double s5 = s4 * s;
+    double H[6] = { 1 - 10 * s3 + 15 * s4 - 6 * s5,
+                    h * ( s - 6 * s3 + 8 * s4 - 3 * s5 ),
+                    h * h * ( 0.5 * s2 - 1.5 * s3 + 1.5 * s4 - 0.5 * s5 ),
+                    10 * s3 - 15 * s4 + 6 * s5,
+                    h * ( -4 * s3 + 7 * s4 - 3 * s5 ),
+                    h * h * ( 0.5 * s3 - s4 + 0.5 * s5 ) };
+    double dH[6] = { ( -30 * s2 + 60 * s3 - 30 * s4 ) / h,
+                     1 - 18 * s2 + 32 * s3 - 15 * s4,
+                     h * ( s - 4.5 * s2 + 6 * s3 - 2.5 * s4 ),
+                     ( 30 * s2 - 60 * s3 + 30 * s4 ) / h,
+                     -12 * s2 + 28 * s3 - 15 * s4,
+                     h * ( 1.5 * s2 - 4 * s3 + 2.5 * s4 ) };
+    double position[3];
+    double velocity[3];
+    for ( int i = 0; i < 3; ++i )
+    {
+      if ( numSteps == 0 )
+      {
+        position[i] = left[i];
+        velocity[i] = left[ 3 + i ];
+        continue;
+      }
+      position[i] = H[0] * left[i] + H[1] * left[ 3 + i ] +
+                    H[2] * leftAcc[i] + H[3] * right[i] +
+                    H[4] * right[ 3 + i ] + H[5] * rightAcc[i];
+      velocity[i] = dH[0] * left[i] + dH[1] * left[ 3 + i ] +
+                    dH[2] * leftAcc[i] + dH[3] * right[i] +
+                    dH[4] * right[ 3 + i ] + dH[5] * rightAcc[i];
+    }
+
+    for ( int station = 0; station < numStations; ++station )
+    {
+      // Station position and velocity, and its local frame
+      double angle = m_longitude[ station ] + m_rotation * t;
+      double cosLat = std::cos( m_latitude[ station ] );
+      double sinLat = std::sin( m_latitude[ station ] );
+      double up[3] = { cosLat * std::cos( angle ), cosLat * std::sin( angle ),
+                       sinLat };
+      double east[3] = { -std::sin( angle ), std::cos( angle ), 0.0 };
+      double north[3] = { -sinLat * std::cos( angle ),
+                          -sinLat * std::sin( angle ), cosLat };
+
+      double range[3];
+      double rate[3];
+      for ( int i = 0; i < 3; ++i )
+      {
+        range[i] = position[i] - m_radius * up[i];
+      }
+      rate[0] = velocity[0] + m_rotation * m_radius * up[1];
+      rate[1] = velocity[1] - m_rotation * m_radius * up[0];
+      rate[2] = velocity[2];
+
+      double dist = std::sqrt( range[0] * range[0] + range[1] * range[1] +
+                               range[2] * range[2] );
+      double height = range[0] * up[0] + range[1] * up[1] +
+                      range[2] * up[2];
+      double elevation = std::asin( height / dist );
+      if ( elevation < m_minElevation[ station ] )
+      {
+        continue;
+      }
+      double azimuth = std::atan2(
+        range[0] * east[0] + range[1] * east[1] + range[2] * east[2],
+        range[0] * north[0] + range[1] * north[1] + range[2] * north[2] );
+
+      Measurement measurement;
+      measurement.object = object;
+      measurement.station = station;
+      measurement.time = t;
+      measurement.range = dist + m_rangeBias[ station ] +
+                          m_rangeNoise[ station ] * gaussian( generator );
+      measurement.rangeRate =
+        ( range[0] * rate[0] + range[1] * rate[1] + range[2] * rate[2] ) /
+        dist + m_rangeRateBias[ station ] +
+        m_rangeRateNoise[ station ] * gaussian( generator );
+      measurement.azimuth = std::fmod(
+        azimuth + m_azimuthBias[ station ] +
+        m_angleNoise[ station ] * gaussian( generator ) + 4 * pi, 2 * pi );
+      measurement.elevation = elevation + m_elevationBias[ station ] +
+        m_angleNoise[ station ] * gaussian( generator );
+      measurements.push_back( measurement );
+    }
+  }
+}
@@ -0,0 +1,158 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    TrackingSimulator.hpp
+/// @brief   Synthetic station tracking measurements of many objects.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_TRACKINGSIMULATOR_HEADER_GUARD
+#define EKF_TRACKINGSIMULATOR_HEADER_GUARD
+
+// C++ Standard Library
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+
+/// @brief A station measurement of an object: range ( m ), range rate
+/// ( m/s ), azimuth from north through east and elevation ( rad ).
+///
+/// Laid out as it is stored, 48 bytes, in measurement files.
+///
+struct Measurement
+{
+  std::int32_t object;
+  std::int32_t station;
+  double time;
+  double range;
+  double rangeRate;
+  double azimuth;
+  double elevation;
+};
+
+/// @brief The measurement file format, for every reader and writer.
+///
+/// Binary, native byte order: "EKFMEA1" and a null byte, then
+/// Measurement records to the end of the file.
+///
+struct MeasurementFile
+{
+  // Bytes before the first record
+  static const std::size_t headerSize = 8;
+
+  // Write the header to out
+  static void writeHeader( std::ostream &out );
+  // Number of records in the size bytes of path starting at data ( null
+  // if unread ), failing unless they are a measurement file
+  static std::size_t countRecords( const char *data, std::size_t size,
+                                   const std::string &path );
+};
+
+/// @brief Simulate tracking data to load the filter.
+///
+/// Truth trajectories are propagated by a Motion per object, under the
+/// Actions it was added with, and logged every propagation step. States
+/// at the measurement times in between come from quintic Hermite
+/// interpolation of the logged positions, velocities and accelerations
+/// ( about 1e-5 m at a 60 s step in LEO ), so the measurement cadence
+/// is free of the integration cost. With a ManeuverAction, use a
+/// propagation step equal to the cadence, so no burn edge falls between
+/// logged states.
+///
+/// Stations sit on a spherical body rotating about Z, at geocentric
+/// latitude and longitude measured from the inertial X axis at t = 0
+/// ( as for VisibilityEvent ). An object is measured by a station at
+/// each measurement time it is above the elevation mask, with Gaussian
+/// noise and a constant bias of its own for each measurement type.
+///
+/// Objects are simulated in parallel, each drawing its noise from a
+/// generator seeded by the simulator seed and the object index, so the
+/// output is the same for any number of threads. Measurements are
+/// ordered by object, time and station.
+///
+/// Measurements are written as a MeasurementFile, which
+/// readMeasurements() reads back.
+///
+class TrackingSimulator
+{
+ public:
+  TrackingSimulator();
+  TrackingSimulator( double radius, double rotation );
+ ~TrackingSimulator();
+
+  // Add a station with an elevation mask, returning its index
+  int addStation( double latitude, double longitude, double minElevation );
+  // Noise standard deviations of a station ( default none )
+  void setNoise( int station, double range, double rangeRate,
+                 double angle );
+  // Biases of a station ( default none )
+  void setBias( int station, double range, double rangeRate,
+                double azimuth, double elevation );
+
+  // Add an object by its state at the start of the simulation and the
+  // Actions moving it, returning its index
+  int addObject( const std::vector< double > &state,
+                 const std::vector< std::shared_ptr< Action > > &actions );
+
+  // Time between measurements ( default 10 s ) and between logged
+  // truth states ( default 60 s )
+  void setCadence( double interval );
+  void setPropagationStep( double step );
+  // Seed of the noise ( default 0 )
+  void setSeed( std::uint64_t seed );
+  // Simulate objects on numThreads threads ( 0, the default, means one
+  // per core )
+  void setThreads( unsigned int numThreads );
+
+  // Simulate from t0, where the object states are, to t1, returning the
+  // measurements or writing them to path and returning how many
+  std::vector< Measurement > simulate( double t0, double t1 ) const;
+  std::size_t simulate( double t0, double t1,
+                        const std::string &path ) const;
+
+  // Read a measurement file
+  static std::vector< Measurement > readMeasurements(
+    const std::string &path );
+
+  // Numbers of stations and objects
+  int getNumStations() const;
+  int getNumObjects() const;
+
+ private:
+  double m_radius;
+  double m_rotation;
+
+  // One entry per station
+  std::vector< double > m_latitude;
+  std::vector< double > m_longitude;
+  std::vector< double > m_minElevation;
+  std::vector< double > m_rangeNoise;
+  std::vector< double > m_rangeRateNoise;
+  std::vector< double > m_angleNoise;
+  std::vector< double > m_rangeBias;
+  std::vector< double > m_rangeRateBias;
+  std::vector< double > m_azimuthBias;
+  std::vector< double > m_elevationBias;
+
+  // One entry per object
+  std::vector< std::vector< double > > m_states;
+  std::vector< std::vector< std::shared_ptr< Action > > > m_actions;
+
+  double m_cadence;
+  double m_step;
+  std::uint64_t m_seed;
+  unsigned int m_numThreads;
+
+  void simulateObject( int object, double t0, double t1,
+                       std::vector< Measurement > &measurements ) const;
+};
+
+#endif // EKF_TRACKINGSIMULATOR_HEADER_GUARD
@@ -0,0 +1,91 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    VisibilityEvent.cpp
+/// @brief   Event function for rises and sets above the elevation mask
+///          of a ground station.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <cmath>
+
+// ekf Library
+#include <VisibilityEvent.hpp>
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+VisibilityEvent::
+VisibilityEvent()
+    : m_radius(),
+      m_rotation(),
+      m_latitude(),
+      m_longitude(),
+      m_minElevation(),
+      m_direction()
+{
+}
+
+// Constructor for a station at latitude, longitude ( radians ) on a body
+// of radius radius rotating at rotation ( rad/s ), with an elevation mask
+// minElevation ( radians ), reporting the sign changes in direction
+VisibilityEvent::
+VisibilityEvent(
+    double radius,
+    double rotation,
+    double latitude,
+    double longitude,
+    double minElevation,
+    int direction )
+    : m_radius( radius ),
+      m_rotation( rotation ),
+      m_latitude( latitude ),
+      m_longitude( longitude ),
+      m_minElevation( minElevation ),
+      m_direction( direction )
+{
+}
+
+// Default Destructor
+VisibilityEvent::
+~VisibilityEvent()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Sine of the elevation seen from the station less the sine of the mask
+double
+VisibilityEvent::
+getValue(
+    const std::vector< double > &state,
+    double t ) const
+{
+  double angle = m_longitude + m_rotation * t;
+  double up[3] = { cos( m_latitude ) * cos( angle ),
+                   cos( m_latitude ) * sin( angle ),
+                   sin( m_latitude ) };
+  double range[3];
+  for ( int i = 0; i < 3; ++i )
+  {
+    range[i] = state[i] - m_radius * up[i];
+  }
+  double dist = sqrt( pow( range[0], 2 ) + pow( range[1], 2 ) +
+                      pow( range[2], 2 ) );
+  double height = range[0] * up[0] + range[1] * up[1] + range[2] * up[2];
+  return height / dist - sin( m_minElevation );
+}
+
+// Sign changes to report
+int
+VisibilityEvent::
+getDirection() const
+{
+  return m_direction;
+}
@@ -0,0 +1,55 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    VisibilityEvent.hpp
+/// @brief   Event function for rises and sets above the elevation mask
+///          of a ground station.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_VISIBILITYEVENT_HEADER_GUARD
+#define EKF_VISIBILITYEVENT_HEADER_GUARD
+
+// C++ Standard Library
+#include <vector>
+
+// ekf Library
+#include <Event.hpp>
+
+/// @brief Event function for station rises and sets.
+///
+/// The station sits at a geocentric latitude and longitude on a
+/// spherical body rotating at a constant rate about Z, with longitude
+/// measured from the inertial X axis at t = 0. The value is the sine of
+/// the elevation of the agent seen from the station less the sine of
+/// the elevation mask, so it rises when the agent rises and falls when
+/// it sets.
+///
+class VisibilityEvent : public Event
+{
+ public:
+  VisibilityEvent();
+  VisibilityEvent( double radius, double rotation, double latitude,
+                   double longitude, double minElevation, int direction );
+
+ ~VisibilityEvent() override;
+
+  // Sine of the elevation less the sine of the mask
+  double getValue( const std::vector< double > &state,
+                   double t ) const override;
+
+  // Sign changes to report
+  int getDirection() const override;
+
+ private:
+  double m_radius;
+  double m_rotation;
+  double m_latitude;
+  double m_longitude;
+  double m_minElevation;
+  int m_direction;
+};
+
+#endif // EKF_VISIBILITYEVENT_HEADER_GUARD
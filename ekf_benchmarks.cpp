@@ -0,0 +1,593 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <Associator.hpp>
+#include <AtmosphereAction.hpp>
+#include <ChebyshevPicard.hpp>
+#include <ConjunctionScreen.hpp>
+#include <GaussianMixture.hpp>
+#include <GravityAction.hpp>
+#include <Motion.hpp>
+#include <ParameterSweep.hpp>
+#include <TrackingSimulator.hpp>
+#include <ekf_common.hpp>
+
+// Timings of the standard loads the documented figures come from. Run
+// with no arguments for all of them, or with the names of some.
+namespace
+{
+   const double pi = 3.14159265358979323846;
+
+   typedef std::chrono::steady_clock bench_clock;
+
+   double
+   secondsSince( bench_clock::time_point start )
+   {
+      return std::chrono::duration< double >( bench_clock::now() - start )
+         .count();
+   }
+
+   // Two body state at t of the orbit a, e, i, node, argument of perigee
+   // and mean anomaly at 0
+   void
+   keplerState( const double *elements, double t, double *state )
+   {
+      double a = elements[0];
+      double e = elements[1];
+      double M = elements[5] + std::sqrt( mu / ( a * a * a ) ) * t;
+      double E = M;
+      for ( int k = 0; k < 30; ++k )
+      {
+         E -= ( E - e * std::sin( E ) - M ) / ( 1 - e * std::cos( E ) );
+      }
+      double r = a * ( 1 - e * std::cos( E ) );
+      double x = a * ( std::cos( E ) - e );
+      double y = a * std::sqrt( 1 - e * e ) * std::sin( E );
+      double vx = -std::sqrt( mu * a ) / r * std::sin( E );
+      double vy = std::sqrt( mu * a * ( 1 - e * e ) ) / r * std::cos( E );
+
+      double cO = std::cos( elements[3] );
+      double sO = std::sin( elements[3] );
+      double ci = std::cos( elements[2] );
+      double si = std::sin( elements[2] );
+      double cw = std::cos( elements[4] );
+      double sw = std::sin( elements[4] );
+      double rotation[3][2] = { { cO * cw - sO * sw * ci,
+                                  -cO * sw - sO * cw * ci },
+                                { sO * cw + cO * sw * ci,
+                                  -sO * sw + cO * cw * ci },
+                                { sw * si, cw * si } };
+      for ( int c = 0; c < 3; ++c )
+      {
+         state[c] = rotation[c][0] * x + rotation[c][1] * y;
+         state[ c + 3 ] = rotation[c][0] * vx + rotation[c][1] * vy;
+      }
+   }
+
+   // A random LEO catalog of 10000 objects, 400 to 1200 km up, sampled
+   // every minute over 6000 s, screened at 5 km and 1 km
+   void
+   benchmarkScreen()
+   {
+      const int numObjects = 10000;
+      ConjunctionScreen screen( 0.0, 6000.0, 60.0, mu );
+      const std::vector< double > &times = screen.getTimes();
+      std::mt19937 generator( 7 );
+      std::uniform_real_distribution< double > uniform( 0.0, 1.0 );
+      for ( int object = 0; object < numObjects; ++object )
+      {
+         double a = radius + 400.E3 + 800.E3 * uniform( generator );
+         double elements[6] = { a, 0.02 * uniform( generator ),
+                                std::acos( 1 - 2 * uniform( generator ) ),
+                                2 * pi * uniform( generator ),
+                                2 * pi * uniform( generator ),
+                                2 * pi * uniform( generator ) };
+         std::vector< double > states( 6 * times.size() );
+         for ( std::size_t k = 0; k < times.size(); ++k )
+         {
+            keplerState( elements, times[k], &states[ 6 * k ] );
+         }
+         screen.addObject( states );
+      }
+
+      for ( double threshold: { 5.E3, 1.E3 } )
+      {
+         bench_clock::time_point start = bench_clock::now();
+         screen.screen( threshold, 0 );
+         double seconds = secondsSince( start );
+         ScreenReport report = screen.getReport();
+         std::cout << "screen: " << numObjects << " objects at "
+                   << threshold << " m in " << seconds << " s, pairs after "
+                   << "hashing " << report.hashPairs << ", apsides "
+                   << report.apsisPairs << ", orbit paths " << report.pathPairs
+                   << ", conjunctions " << report.conjunctions << std::endl;
+      }
+   }
+
+   // One day under J2 by ChebyshevPicard ( order 48, one thread ) and by
+   // dopri5, in LEO with 900 s segments and in a 6678 x 42164 km HEO
+   // with 600 s segments, then again by MCPI from 1 cm away, warm
+   // started from the first run
+   void
+   benchmarkPicard()
+   {
+      double perigee = 6678137.0;
+      double apogee = 42164000.0;
+      double speed = std::sqrt( mu * ( 2 / perigee -
+                                       2 / ( perigee + apogee ) ) );
+      const char *names[2] = { "LEO", "HEO" };
+      const std::vector< double > ics[2] = {
+         { 757700.0, 5222607.0, 4851500.0, 2213.21, 4678.34, -5371.30 },
+         { perigee, 0.0, 0.0, 0.0, speed * std::cos( 0.5 ),
+           speed * std::sin( 0.5 ) } };
+      const double segments[2] = { 900.0, 600.0 };
+      const double span = 86400.0;
+      std::vector< std::shared_ptr< Action > > actions = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 1.082626925638815E-3 ) ) };
+
+      for ( int k = 0; k < 2; ++k )
+      {
+         std::shared_ptr< ChebyshevPicard > picard(
+            new ChebyshevPicard( 48, segments[k], 1 ) );
+         std::shared_ptr< Motion > dopri5 = motionWith( ics[k], 60.0, actions );
+         std::shared_ptr< Motion > mcpi = motionWith( ics[k], 60.0, actions );
+         mcpi->setPropagator( picard );
+
+         bench_clock::time_point start = bench_clock::now();
+         dopri5->stepTo( span );
+         double dopri5Seconds = secondsSince( start );
+         start = bench_clock::now();
+         mcpi->stepTo( span );
+         double mcpiSeconds = secondsSince( start );
+         int iterations = picard->getIterations();
+         int evaluations = picard->getEvaluations();
+
+         double difference = 0.0;
+         for ( double t = 0.0; t <= span; t += 60.0 )
+         {
+            std::vector< double > x = dopri5->getState( t );
+            std::vector< double > y = mcpi->getState( t );
+            for ( int i = 0; i < 3; ++i )
+            {
+               difference = std::max( difference, std::abs( x[i] - y[i] ) );
+            }
+         }
+
+         std::vector< double > moved( ics[k] );
+         moved[0] += 0.01;
+         std::shared_ptr< Motion > warm = motionWith( moved, 60.0, actions );
+         warm->setPropagator( picard );
+         start = bench_clock::now();
+         warm->stepTo( span );
+         double warmSeconds = secondsSince( start );
+
+         double numSegments = std::ceil( span / segments[k] );
+         std::cout << "mcpi: " << names[k] << " day, dopri5 " << dopri5Seconds
+                   << " s, MCPI " << mcpiSeconds << " s at "
+                   << iterations / numSegments << " iterations a segment ( "
+                   << evaluations << " evaluations ), " << difference
+                   << " m apart; warm started " << warmSeconds << " s at "
+                   << picard->getIterations() / numSegments
+                   << " iterations a segment" << std::endl;
+      }
+   }
+
+   // A 2000 s LEO arc under J2 and drag with mu, J2, Cd and the
+   // coordinates of 0, 10 and 30 stations active ( 9, 39 and 99 agents ),
+   // with the partial patterns of the Actions and with dense partials
+   void
+   benchmarkPattern()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::vector< std::shared_ptr< Action > > sparse = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 1.082626925638815E-3 ) ),
+         std::shared_ptr< Action >(
+            new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                                  88667.0, 7.29211585530066E-5, 0.0031 ) ) };
+      std::vector< std::shared_ptr< Action > > dense;
+      for ( const auto &action: sparse )
+      {
+         dense.push_back(
+            std::shared_ptr< Action >( new dense_action( action ) ) );
+      }
+
+      for ( int numStations: { 0, 10, 30 } )
+      {
+         std::vector< std::string > agents = { "mu", "J2", "Cd" };
+         for ( int station = 1; station <= numStations; ++station )
+         {
+            for ( const char *c: { "X_", "Y_", "Z_" } )
+            {
+               agents.push_back( c + std::to_string( station ) );
+            }
+         }
+
+         double seconds[2];
+         std::vector< double > partials[2];
+         for ( int k = 0; k < 2; ++k )
+         {
+            std::shared_ptr< Motion > motion =
+               motionWith( ic, 10.0, k ? dense : sparse );
+            motion->activateAgents( agents );
+            bench_clock::time_point start = bench_clock::now();
+            motion->stepTo( 2000.0 );
+            seconds[k] = secondsSince( start );
+            partials[k] = motion->getStatePartials( 2000.0 );
+         }
+
+         double difference = 0.0;
+         for ( std::size_t i = 0; i < partials[0].size(); ++i )
+         {
+            difference = std::max( difference,
+                                   std::abs( partials[0][i] -
+                                             partials[1][i] ) );
+         }
+         std::cout << "pattern: " << 6 + agents.size() << " agents, dense "
+                   << 1.E3 * seconds[1] << " ms, patterns "
+                   << 1.E3 * seconds[0] << " ms, STMs " << difference
+                   << " apart" << std::endl;
+      }
+   }
+
+   // The J2 and drag Actions of the LEO loads
+   std::vector< std::shared_ptr< Action > >
+   leoActions()
+   {
+      return { std::shared_ptr< Action >(
+                  new GravityAction( "Earth", radius, mu,
+                                     1.082626925638815E-3 ) ),
+               std::shared_ptr< Action >(
+                  new AtmosphereAction( "Earth Atmosphere", 7078136.3,
+                                        3.614E-13, 88667.0, rotation,
+                                        0.0031 ) ) };
+   }
+
+   // A 6000 s LEO arc under J2 and drag with mu, J2, Cd and the
+   // coordinates of 30 stations active ( 99 agents ), with the STM in
+   // double and in float
+   void
+   benchmarkMixed()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::vector< std::string > agents = { "mu", "J2", "Cd" };
+      for ( int station = 1; station <= 30; ++station )
+      {
+         for ( const char *c: { "X_", "Y_", "Z_" } )
+         {
+            agents.push_back( c + std::to_string( station ) );
+         }
+      }
+
+      double seconds[2];
+      std::vector< double > partials[2];
+      for ( int k = 0; k < 2; ++k )
+      {
+         std::shared_ptr< Motion > motion = motionWith( ic, 10.0,
+                                                        leoActions() );
+         motion->activateAgents( agents );
+         motion->setMixedPrecision( k == 1 );
+         bench_clock::time_point start = bench_clock::now();
+         motion->stepTo( 6000.0 );
+         seconds[k] = secondsSince( start );
+         partials[k] = motion->getStatePartials( 6000.0 );
+      }
+
+      // Relative Frobenius difference of the 6x6 state blocks
+      int numAgents = 6 + agents.size();
+      double difference = 0.0;
+      double norm = 0.0;
+      for ( int i = 0; i < 6; ++i )
+      {
+         for ( int j = 0; j < 6; ++j )
+         {
+            double d = partials[0][ i * numAgents + j ];
+            double f = partials[1][ i * numAgents + j ];
+            difference += ( d - f ) * ( d - f );
+            norm += d * d;
+         }
+      }
+      std::cout << "mixed: " << numAgents << " agents over 6000 s, double "
+                << 1.E3 * seconds[0] << " ms, mixed " << 1.E3 * seconds[1]
+                << " ms, STMs " << std::sqrt( difference / norm )
+                << " apart ( relative )" << std::endl;
+   }
+
+   // 10000 position measurements, a fifth of them clutter, against 10000
+   // random LEO predictions with 50 m to 2 km covariances, by the k-d
+   // tree and pair by pair
+   void
+   benchmarkAssociate()
+   {
+      const int numObjects = 10000;
+      const int numMeasurements = 10000;
+      std::mt19937 generator( 3 );
+      std::normal_distribution< double > normal( 0.0, 1.0 );
+      std::uniform_real_distribution< double > uniform( 0.0, 1.0 );
+      std::vector< double > positions( 3 * numObjects );
+      std::vector< double > covariances( 9 * numObjects );
+      for ( int object = 0; object < numObjects; ++object )
+      {
+         Eigen::Vector3d direction( normal( generator ), normal( generator ),
+                                    normal( generator ) );
+         Eigen::Map< Eigen::Vector3d > position( &positions[ 3 * object ] );
+         position = direction.normalized() *
+                    ( radius + 400.E3 + 800.E3 * uniform( generator ) );
+         Eigen::Matrix3d A;
+         for ( int i = 0; i < 9; ++i )
+         {
+            A.data()[i] = normal( generator ) *
+                          ( 50.0 + 2000.0 * uniform( generator ) );
+         }
+         Eigen::Map< Eigen::Matrix3d > P( &covariances[ 9 * object ] );
+         P = A * A.transpose() + 100.0 * Eigen::Matrix3d::Identity();
+      }
+      Eigen::Matrix3d noise = 400.0 * Eigen::Matrix3d::Identity();
+      std::vector< Eigen::Vector3d > measurements( numMeasurements );
+      for ( int m = 0; m < numMeasurements; ++m )
+      {
+         Eigen::Vector3d offset( normal( generator ), normal( generator ),
+                                 normal( generator ) );
+         if ( m % 5 == 4 )
+         {
+            measurements[m] = offset.normalized() * ( radius + 600.E3 );
+            continue;
+         }
+         int object = generator() % numObjects;
+         Eigen::Matrix3d P =
+            Eigen::Map< Eigen::Matrix3d >( &covariances[ 9 * object ] );
+         measurements[m] =
+            Eigen::Map< Eigen::Vector3d >( &positions[ 3 * object ] ) +
+            ( P + noise ).llt().matrixL() * offset;
+      }
+
+      Associator associator;
+      bench_clock::time_point start = bench_clock::now();
+      associator.setPredictions( positions, covariances );
+      std::vector< Association > associations =
+         associator.associate( measurements, noise );
+      double treeSeconds = secondsSince( start );
+
+      // Every pair, as the tree would score it
+      start = bench_clock::now();
+      int mismatches = 0;
+      for ( int m = 0; m < numMeasurements; ++m )
+      {
+         int best = -1;
+         double bestScore = 0.0;
+         for ( int object = 0; object < numObjects; ++object )
+         {
+            Eigen::Vector3d r = measurements[m] -
+               Eigen::Map< Eigen::Vector3d >( &positions[ 3 * object ] );
+            Eigen::LLT< Eigen::Matrix3d > llt(
+               Eigen::Map< Eigen::Matrix3d >( &covariances[ 9 * object ] ) +
+               noise );
+            double distance = r.dot( llt.solve( r ) );
+            if ( distance > associator.getGate() )
+            {
+               continue;
+            }
+            Eigen::Vector3d diagonal = llt.matrixLLT().diagonal();
+            double score = distance + 3 * std::log( 2 * pi ) +
+                           2 * diagonal.array().log().sum();
+            if ( ( best < 0 ) || ( score < bestScore ) )
+            {
+               best = object;
+               bestScore = score;
+            }
+         }
+         mismatches += ( best != associations[m].object ) ? 1 : 0;
+      }
+      double pairSeconds = secondsSince( start );
+
+      std::cout << "associate: " << numMeasurements << " measurements "
+                << "against " << numObjects << " objects, k-d tree "
+                << 1.E3 * treeSeconds << " ms, pair by pair " << pairSeconds
+                << " s, " << mismatches << " associated differently"
+                << std::endl;
+   }
+
+   // Log likelihood of a position under the position marginal of a
+   // mixture
+   double
+   logLikelihood( const GaussianMixture &mixture, const Eigen::Vector3d &x )
+   {
+      double likelihood = 0.0;
+      for ( int k = 0; k < mixture.getNumComponents(); ++k )
+      {
+         const MixtureComponent &component = mixture.getComponent( k );
+         Eigen::LLT< Eigen::Matrix3d > llt(
+            component.covariance.topLeftCorner( 3, 3 ) );
+         Eigen::Vector3d r = x - component.mean.head( 3 );
+         Eigen::Vector3d diagonal = llt.matrixLLT().diagonal();
+         likelihood += component.weight *
+            std::exp( -0.5 * ( r.dot( llt.solve( r ) ) +
+                               3 * std::log( 2 * pi ) ) -
+                      diagonal.array().log().sum() );
+      }
+      return std::log( std::max( likelihood,
+                                 std::numeric_limits< double >::min() ) );
+   }
+
+   // A LEO state under J2 and drag, known to 1 km and 1 m/s, propagated
+   // a day as a mixture and as a single Gaussian, both scored on where
+   // 300 Monte Carlo samples of it end up
+   void
+   benchmarkMixture()
+   {
+      const int numSamples = 300;
+      const double span = 86400.0;
+      std::vector< std::shared_ptr< Action > > actions = leoActions();
+      Eigen::VectorXd mean( 6 );
+      mean << 757700.0, 5222607.0, 4851500.0, 2213.21, 4678.34, -5371.30;
+      Eigen::MatrixXd covariance = Eigen::MatrixXd::Zero( 6, 6 );
+      covariance.diagonal() << 1.E6, 1.E6, 1.E6, 1.0, 1.0, 1.0;
+
+      Eigen::MatrixXd L = covariance.llt().matrixL();
+      std::mt19937 generator( 1 );
+      std::normal_distribution< double > normal( 0.0, 1.0 );
+      std::vector< Eigen::Vector3d > samples;
+      for ( int s = 0; s < numSamples; ++s )
+      {
+         Eigen::VectorXd offset( 6 );
+         for ( int i = 0; i < 6; ++i )
+         {
+            offset[i] = normal( generator );
+         }
+         Eigen::VectorXd x = mean + L * offset;
+         std::shared_ptr< Motion > motion = motionWith(
+            std::vector< double >( x.data(), x.data() + 6 ), 60.0, actions );
+         motion->stepTo( span );
+         std::vector< double > state = motion->getState( span );
+         samples.push_back( Eigen::Vector3d( state[0], state[1], state[2] ) );
+      }
+
+      for ( double threshold: { 0.0, 0.005 } )
+      {
+         GaussianMixture mixture( actions, mean, covariance, 0.0, 60.0 );
+         mixture.setSplitting( threshold );
+         bench_clock::time_point start = bench_clock::now();
+         mixture.propagate( span );
+         double seconds = secondsSince( start );
+         double score = 0.0;
+         for ( const auto &sample: samples )
+         {
+            score += logLikelihood( mixture, sample ) / numSamples;
+         }
+         std::cout << "mixture: day in LEO from 1 km and 1 m/s, "
+                   << mixture.getNumComponents() << " components in "
+                   << seconds << " s, mean log likelihood of samples "
+                   << score << std::endl;
+      }
+   }
+
+   // 150 variants of Cd, rho_ref and the density step height over a day
+   // in LEO by the sweep, and by a Motion per variant ( which also
+   // carries the STM ). Cd and rho_ref scales with equal products share
+   // their dynamics.
+   void
+   benchmarkSweep()
+   {
+      const double span = 86400.0;
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::shared_ptr< GravityAction > gravity(
+         new GravityAction( "Earth", radius, mu, 1.082626925638815E-3 ) );
+      std::shared_ptr< AtmosphereAction > atmosphere(
+         new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                               88667.0, rotation, 0.0031 ) );
+      ParameterSweep sweep( gravity, atmosphere, ic, 60.0, 0.0 );
+      sweep.addScales( "Cd", { 0.5, 1.0, 1.5, 2.0, 3.0 } );
+      sweep.addScales( "rho_ref", { 0.5, 1.0, 1.5, 2.0, 4.0 } );
+      sweep.addScales( "step", { 0.8, 0.9, 1.0, 1.1, 1.2, 1.3 } );
+      bench_clock::time_point start = bench_clock::now();
+      sweep.stepTo( span );
+      double sweepSeconds = secondsSince( start );
+
+      double motionSeconds = 0.0;
+      double difference = 0.0;
+      for ( int v = 0; v < sweep.getNumVariants(); ++v )
+      {
+         std::vector< double > p = sweep.getParameters( v );
+         std::vector< std::shared_ptr< Action > > actions = {
+            std::shared_ptr< Action >(
+               new GravityAction( "Earth", p[0], p[1], p[2] ) ),
+            std::shared_ptr< Action >(
+               new AtmosphereAction( "Earth Atmosphere", p[3], p[4], p[5],
+                                     p[6], p[7] ) ) };
+         std::shared_ptr< Motion > motion = motionWith( ic, 60.0, actions );
+         start = bench_clock::now();
+         motion->stepTo( span );
+         motionSeconds += secondsSince( start );
+         std::vector< double > x = motion->getState( span );
+         std::vector< double > y = sweep.getState( v, span );
+         for ( int i = 0; i < 3; ++i )
+         {
+            difference = std::max( difference, std::abs( x[i] - y[i] ) );
+         }
+      }
+      std::cout << "sweep: " << sweep.getNumVariants() << " variants ( "
+                << sweep.getNumDistinct() << " distinct ) of a day, sweep "
+                << 1.E3 * sweepSeconds << " ms, a Motion each "
+                << motionSeconds << " s, " << difference << " m apart"
+                << std::endl;
+   }
+
+   // 200 LEO objects over 20 stations for a day at 10 s, on one thread
+   void
+   benchmarkSimulate()
+   {
+      TrackingSimulator simulator( radius, rotation );
+      std::mt19937 generator( 5 );
+      std::uniform_real_distribution< double > uniform( -1.0, 1.0 );
+      for ( int station = 0; station < 20; ++station )
+      {
+         int k = simulator.addStation( 1.2 * uniform( generator ),
+                                       pi * uniform( generator ), 0.1 );
+         simulator.setNoise( k, 5.0, 0.01, 1.E-4 );
+      }
+      std::vector< std::shared_ptr< Action > > actions = leoActions();
+      for ( int object = 0; object < 200; ++object )
+      {
+         std::vector< double > state = { 757700.0, 5222607.0, 4851500.0,
+                                         2213.21, 4678.34, -5371.30 };
+         for ( int i = 3; i < 6; ++i )
+         {
+            state[i] += 50.0 * uniform( generator );
+         }
+         simulator.addObject( state, actions );
+      }
+      simulator.setThreads( 1 );
+
+      bench_clock::time_point start = bench_clock::now();
+      std::vector< Measurement > measurements =
+         simulator.simulate( 0.0, 86400.0 );
+      double seconds = secondsSince( start );
+      std::cout << "simulate: 200 objects over 20 stations for a day, "
+                << measurements.size() << " measurements in " << seconds
+                << " s" << std::endl;
+   }
+
+   struct benchmark
+   {
+      const char *name;
+      void ( *run )();
+   };
+
+   const benchmark benchmarks[] = { { "screen", benchmarkScreen },
+                                    { "mcpi", benchmarkPicard },
+                                    { "pattern", benchmarkPattern },
+                                    { "mixed", benchmarkMixed },
+                                    { "associate", benchmarkAssociate },
+                                    { "mixture", benchmarkMixture },
+                                    { "sweep", benchmarkSweep },
+                                    { "simulate", benchmarkSimulate } };
+}
+
+int
+main( int argc, char *argv[] )
+{
+   for ( const benchmark &b: benchmarks )
+   {
+      bool wanted = ( argc < 2 );
+      for ( int k = 1; k < argc; ++k )
+      {
+         wanted = wanted || ( std::strcmp( argv[k], b.name ) == 0 );
+      }
+      if ( wanted )
+      {
+         b.run();
+      }
+   }
+   return 0;
+}
@@ -0,0 +1,1965 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <AltitudeEvent.hpp>
+#include <ApsisEvent.hpp>
+#include <Associator.hpp>
+#include <AtmosphereAction.hpp>
+#include <ChebyshevPicard.hpp>
+#include <ConjunctionScreen.hpp>
+#include <EnckePropagator.hpp>
+#include <GaussianMixture.hpp>
+#include <GravityAction.hpp>
+#include <Knowledge.hpp>
+#include <Motion.hpp>
+#include <ParameterSweep.hpp>
+#include <Parareal.hpp>
+#include <PropagationCache.hpp>
+#include <ReplayHarness.hpp>
+#include <ScalarPropagator.hpp>
+#include <ScenarioRunner.hpp>
+#include <SecularPropagator.hpp>
+#include <SundmanPropagator.hpp>
+#include <SymplecticPropagator.hpp>
+#include <TaylorPropagator.hpp>
+#include <TrackingSimulator.hpp>
+#include <ekf_common.hpp>
+
+// Numerical checks of the propagation against independent references.
+// Each prints its measured error and bound, and any failure fails the
+// run. Gravity is a point mass, so the checks isolate what they test.
+namespace
+{
+   int failures = 0;
+
+   void
+   report( const std::string &name, double error, double bound )
+   {
+      bool passed = ( error <= bound );
+      std::cout << ( passed ? "PASS " : "FAIL " ) << name << ": " << error
+                << " ( bound " << bound << " )" << std::endl;
+      failures += passed ? 0 : 1;
+   }
+
+   // Relative Frobenius difference of the 6x6 state blocks of two row
+   // major STMs over numAgents agents
+   double
+   blockError( const std::vector< double > &a, const std::vector< double > &b,
+               int numAgents )
+   {
+      double difference = 0.0;
+      double norm = 0.0;
+      for ( int i = 0; i < 6; ++i )
+      {
+         for ( int j = 0; j < 6; ++j )
+         {
+            double d = a[ i * numAgents + j ] - b[ i * numAgents + j ];
+            difference += d * d;
+            norm += b[ i * numAgents + j ] * b[ i * numAgents + j ];
+         }
+      }
+      return std::sqrt( difference / norm );
+   }
+
+   // Distance between the positions of two states
+   double
+   positionError( const std::vector< double > &a,
+                  const std::vector< double > &b )
+   {
+      return std::sqrt( ( a[0] - b[0] ) * ( a[0] - b[0] ) +
+                        ( a[1] - b[1] ) * ( a[1] - b[1] ) +
+                        ( a[2] - b[2] ) * ( a[2] - b[2] ) );
+   }
+
+   // Largest difference of two row major 6x6 STMs, relative to 1 + |b|
+   double
+   stmError( const std::vector< double > &a, const std::vector< double > &b )
+   {
+      double error = 0.0;
+      for ( int k = 0; k < 36; ++k )
+      {
+         error = std::max( error,
+                           std::abs( a[k] - b[k] ) / ( 1 + std::abs( b[k] ) ) );
+      }
+      return error;
+   }
+
+   // Apsis and altitude events over three two-body orbits against their
+   // times from Kepler's equation. The orbit starts at periapsis, so
+   // apsides fall on multiples of half the period, and the altitude
+   // threshold is crossed at the eccentric anomaly where r = a ( 1 - e
+   // cos E ), climbing and again, mirrored, descending.
+   void
+   checkEvents()
+   {
+      double perigee = 6700.E3;
+      double apogee = 7500.E3;
+      double a = 0.5 * ( perigee + apogee );
+      double e = ( apogee - perigee ) / ( apogee + perigee );
+      double n = std::sqrt( mu / ( a * a * a ) );
+      double period = 2 * M_PI / n;
+      double speed = std::sqrt( mu * ( 2 / perigee - 1 / a ) );
+      std::vector< double > ic = { perigee, 0.0, 0.0, 0.0,
+                                   speed * std::cos( 0.9 ),
+                                   speed * std::sin( 0.9 ) };
+      double threshold = 7100.E3;
+      double E = std::acos( ( 1 - threshold / a ) / e );
+      double climb = ( E - e * std::sin( E ) ) / n;
+
+      std::shared_ptr< Motion > motion = motionWith(
+         ic, 600.0, { std::shared_ptr< Action >(
+                         new GravityAction( "Earth", radius, mu, 0.0 ) ) } );
+      motion->addEvent( std::shared_ptr< Event >( new ApsisEvent( 0 ) ) );
+      motion->addEvent( std::shared_ptr< Event >(
+         new AltitudeEvent( radius, threshold - radius, 0 ) ) );
+      motion->stepTo( 3 * period - 60.0 );
+
+      std::vector< double > expected[2];
+      for ( int k = 0; k < 3; ++k )
+      {
+         expected[0].push_back( ( k + 0.5 ) * period );
+         expected[1].push_back( k * period + climb );
+         expected[1].push_back( ( k + 1 ) * period - climb );
+         if ( k > 0 )
+         {
+            expected[0].push_back( k * period );
+         }
+      }
+      std::vector< double > found[2];
+      for ( const EventRecord &record: motion->getEventRecords() )
+      {
+         if ( record.time > 1.0 )
+         {
+            found[ record.event ].push_back( record.time );
+         }
+      }
+
+      const char *names[2] = { "apsis", "altitude" };
+      for ( int k = 0; k < 2; ++k )
+      {
+         std::sort( expected[k].begin(), expected[k].end() );
+         report( std::string( names[k] ) + " events found vs expected",
+                 std::abs( (double) found[k].size() - expected[k].size() ),
+                 0.0 );
+         double error = 0.0;
+         for ( std::size_t i = 0;
+               i < std::min( found[k].size(), expected[k].size() ); ++i )
+         {
+            error = std::max( error,
+                              std::abs( found[k][i] - expected[k][i] ) );
+         }
+         report( std::string( names[k] ) + " event times vs Kepler, s",
+                 error, 1.E-3 );
+      }
+   }
+
+   // PropagationCache through Motion: a repeated arc is a hit and served
+   // bit for bit, a changed drag coefficient is a miss, and under a
+   // memory bound of two and a half arcs the least recently used arc is
+   // evicted while the others stay.
+   void
+   checkCache()
+   {
+      std::shared_ptr< Action > gravity(
+         new GravityAction( "Earth", radius, mu, 0.0 ) );
+      auto arc = [&]( std::shared_ptr< PropagationCache > cache, double x0,
+                      double Cd )
+      {
+         std::vector< double > ic = { x0, 5222607.0, 4851500.0,
+                                      2213.21, 4678.34, -5371.30 };
+         std::shared_ptr< Motion > motion = motionWith(
+            ic, 600.0, { gravity, std::shared_ptr< Action >(
+                                     new AtmosphereAction(
+                                        "Earth Atmosphere", 7078136.3,
+                                        3.614E-13, 88667.0, rotation,
+                                        Cd ) ) } );
+         if ( cache )
+         {
+            motion->setCache( cache );
+         }
+         motion->stepTo( 6000.0 );
+         return motion->getStatePartials( 6000.0 );
+      };
+
+      std::shared_ptr< PropagationCache > cache( new PropagationCache() );
+      std::vector< double > integrated = arc( nullptr, 757700.0, 0.0031 );
+      arc( cache, 757700.0, 0.0031 );
+      std::vector< double > served = arc( cache, 757700.0, 0.0031 );
+      arc( cache, 757700.0, 0.0032 );
+      double difference = 0.0;
+      for ( std::size_t k = 0; k < served.size(); ++k )
+      {
+         difference = std::max( difference,
+                                 std::abs( served[k] - integrated[k] ) );
+      }
+      report( "cache hits after a repeat", std::abs( cache->getHits() - 1 ),
+              0.0 );
+      report( "cache misses after a repeat and a new Cd",
+              std::abs( cache->getMisses() - 2 ), 0.0 );
+      report( "cached arc vs integrated", difference, 0.0 );
+
+      std::size_t arcBytes = cache->getBytes() / cache->getEntries();
+      std::shared_ptr< PropagationCache > bounded(
+         new PropagationCache( 5 * arcBytes / 2 ) );
+      for ( double x0: { 757700.0, 757800.0, 757900.0 } )
+      {
+         arc( bounded, x0, 0.0031 );
+      }
+      report( "bounded cache evictions after three arcs",
+              std::abs( bounded->getEvictions() - 1 ), 0.0 );
+      report( "bounded cache bytes over the bound",
+              (double) bounded->getBytes() / bounded->getMaxBytes(), 1.0 );
+      arc( bounded, 757900.0, 0.0031 );
+      arc( bounded, 757800.0, 0.0031 );
+      report( "bounded cache hits on the two kept arcs",
+              std::abs( bounded->getHits() - 2 ), 0.0 );
+      arc( bounded, 757700.0, 0.0031 );
+      report( "bounded cache misses with the evicted arc again",
+              std::abs( bounded->getMisses() - 4 ), 0.0 );
+   }
+
+   // A filter correction applied in place by Knowledge::update must reach
+   // the Actions bound to its agents: with Cd estimated, the corrected
+   // drag term is read by the bound AtmosphereAction, the bound but
+   // unestimated GM is kept, and the restarted arc is that of a Motion
+   // built with the corrected values, to the integration tolerance ( it
+   // steps from another epoch ).
+   void
+   checkKnowledgeUpdate()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::shared_ptr< GravityAction > gravity(
+         new GravityAction( "Earth", radius, mu, 0.0 ) );
+      std::shared_ptr< AtmosphereAction > drag(
+         new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                               88667.0, rotation, 0.0031 ) );
+      std::shared_ptr< Motion > motion =
+         motionWith( ic, 600.0, { gravity, drag } );
+      motion->activateAgents( { "Cd" } );
+      Knowledge knowledge( motion->getActiveAgents() );
+      gravity->bindParameters( knowledge.getAgents() );
+      drag->bindParameters( knowledge.getAgents() );
+      motion->stepTo( 3000.0 );
+
+      Eigen::VectorXd correction =
+         Eigen::VectorXd::Zero( knowledge.getNumEstimated() );
+      correction[ knowledge.getAgents().getRow(
+                     AgentGroup::intern( "Cd" ) ) ] = 0.001;
+      correction[0] = 10.0;
+      knowledge.setState( motion->getState( 3000.0 ) );
+      knowledge.update( correction );
+      motion->restart( knowledge.getState() );
+      motion->stepTo( 6000.0 );
+
+      // Rebuilt from the corrected state with the corrected drag term,
+      // and with the stale one, which must be visibly further off
+      auto rebuild = [&]( double Cd )
+      {
+         std::shared_ptr< Motion > rebuilt = motionWith(
+            knowledge.getState(), 600.0,
+            { std::shared_ptr< Action >(
+                 new GravityAction( "Earth", radius, mu, 0.0 ) ),
+              std::shared_ptr< Action >(
+                 new AtmosphereAction( "Earth Atmosphere", 7078136.3,
+                                       3.614E-13, 88667.0, rotation,
+                                       Cd ) ) } );
+         rebuilt->activateAgents( { "Cd" } );
+         rebuilt->stepTo( 3000.0 );
+         return positionError( motion->getState( 6000.0 ),
+                               rebuilt->getState( 3000.0 ) );
+      };
+
+      report( "bound Cd after an in place update",
+              std::abs( drag->getBodyDragTerm() - 0.0041 ), 1.E-15 );
+      report( "bound, unestimated GM after the update",
+              std::abs( gravity->getMu() - mu ), 0.0 );
+      double corrected = rebuild( drag->getBodyDragTerm() );
+      report( "arc after the update vs one built with the corrected Cd",
+              corrected, 1.E-6 );
+      report( "that over one built with the stale Cd",
+              corrected / rebuild( 0.0031 ), 1.E-3 );
+   }
+
+   // The STM from the partial patterns of the Actions against the one
+   // from their dense partials, over a 2000 s LEO arc under J2 and drag
+   // with mu, J2, Cd and the coordinates of ten stations active ( 39
+   // agents ). They differ only in the order of the sums.
+   void
+   checkPattern()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::vector< std::shared_ptr< Action > > sparse = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 1.082626925638815E-3 ) ),
+         std::shared_ptr< Action >(
+            new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                                  88667.0, rotation, 0.0031 ) ) };
+      std::vector< std::shared_ptr< Action > > dense;
+      for ( const auto &action: sparse )
+      {
+         dense.push_back(
+            std::shared_ptr< Action >( new dense_action( action ) ) );
+      }
+      std::vector< std::string > agents = { "mu", "J2", "Cd" };
+      for ( int station = 1; station <= 10; ++station )
+      {
+         for ( const char *c: { "X_", "Y_", "Z_" } )
+         {
+            agents.push_back( c + std::to_string( station ) );
+         }
+      }
+
+      std::vector< double > partials[2];
+      for ( int k = 0; k < 2; ++k )
+      {
+         std::shared_ptr< Motion > motion =
+            motionWith( ic, 10.0, k ? dense : sparse );
+         motion->activateAgents( agents );
+         motion->stepTo( 2000.0 );
+         partials[k] = motion->getStatePartials( 2000.0 );
+      }
+      double error = 0.0;
+      for ( std::size_t i = 0; i < partials[1].size(); ++i )
+      {
+         error = std::max( error, std::abs( partials[0][i] - partials[1][i] ) /
+                                     ( 1 + std::abs( partials[1][i] ) ) );
+      }
+      report( "pattern STM vs dense over 39 agents", error, 1.E-12 );
+   }
+
+   // Actions evaluated concurrently on a ThreadTeam must give the arc
+   // evaluated in turn bit for bit, on the pattern and the dense paths,
+   // since each Action's share is summed in the same order either way.
+   // So must ChebyshevPicard's node evaluations on its team.
+   void
+   checkThreadTeam()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::vector< std::shared_ptr< Action > > sparse = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 1.082626925638815E-3 ) ),
+         std::shared_ptr< Action >(
+            new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                                  88667.0, rotation, 0.0031 ) ) };
+      std::vector< std::shared_ptr< Action > > dense;
+      for ( const auto &action: sparse )
+      {
+         dense.push_back(
+            std::shared_ptr< Action >( new dense_action( action ) ) );
+      }
+
+      const char *names[2] = { "pattern", "dense" };
+      for ( int k = 0; k < 2; ++k )
+      {
+         std::vector< double > partials[2];
+         for ( unsigned int numThreads: { 1, 3 } )
+         {
+            std::shared_ptr< Motion > motion =
+               motionWith( ic, 60.0, k ? dense : sparse );
+            motion->activateAgents( { "mu", "J2", "Cd" } );
+            motion->setActionThreads( numThreads );
+            motion->stepTo( 3000.0 );
+            std::vector< double > &arc = partials[ numThreads > 1 ];
+            arc = motion->getState( 3000.0 );
+            std::vector< double > stm = motion->getStatePartials( 3000.0 );
+            arc.insert( arc.end(), stm.begin(), stm.end() );
+         }
+         int differing = 0;
+         for ( std::size_t i = 0; i < partials[0].size(); ++i )
+         {
+            differing += ( partials[0][i] != partials[1][i] ) ? 1 : 0;
+         }
+         report( std::string( "ThreadTeam " ) + names[k] +
+                 " state and STM components differing from serial",
+                 differing, 0.0 );
+      }
+
+      std::vector< double > arcs[2];
+      for ( unsigned int numThreads: { 1, 3 } )
+      {
+         std::shared_ptr< Motion > motion = motionWith( ic, 60.0, sparse );
+         motion->activateAgents( { "mu", "J2", "Cd" } );
+         motion->setPropagator( std::shared_ptr< Propagator >(
+            new ChebyshevPicard( 48, 900.0, numThreads ) ) );
+         motion->stepTo( 3000.0 );
+         std::vector< double > &arc = arcs[ numThreads > 1 ];
+         arc = motion->getState( 3000.0 );
+         std::vector< double > stm = motion->getStatePartials( 3000.0 );
+         arc.insert( arc.end(), stm.begin(), stm.end() );
+      }
+      int differing = 0;
+      for ( std::size_t i = 0; i < arcs[0].size(); ++i )
+      {
+         differing += ( arcs[0][i] != arcs[1][i] ) ? 1 : 0;
+      }
+      report( "ChebyshevPicard ThreadTeam state and STM components differing "
+              "from serial", differing, 0.0 );
+   }
+
+   // Associator's k-d tree gate against brute force over every pair,
+   // for 2000 objects of covariances spread over three decades and 500
+   // measurements, most near an object and the rest anywhere. The
+   // chosen object, the candidates in the gate and the score must all
+   // agree.
+   void
+   checkAssociation()
+   {
+      std::mt19937 generator( 7 );
+      std::uniform_real_distribution< double > uniform( -1.0, 1.0 );
+      std::normal_distribution< double > normal( 0.0, 1.0 );
+      int numObjects = 2000;
+      double extent = 1.E5;
+
+      std::vector< double > positions( 3 * numObjects );
+      std::vector< double > covariances( 9 * numObjects );
+      for ( int i = 0; i < numObjects; ++i )
+      {
+         Eigen::Matrix3d A;
+         double scale = std::pow( 10.0, 1.5 * uniform( generator ) + 2.0 );
+         for ( int k = 0; k < 9; ++k )
+         {
+            A( k / 3, k % 3 ) = scale * normal( generator );
+         }
+         Eigen::Matrix3d P = A * A.transpose() +
+                             scale * scale * Eigen::Matrix3d::Identity();
+         for ( int k = 0; k < 3; ++k )
+         {
+            positions[ 3 * i + k ] = extent * uniform( generator );
+         }
+         for ( int k = 0; k < 9; ++k )
+         {
+            covariances[ 9 * i + k ] = P( k / 3, k % 3 );
+         }
+      }
+      Eigen::Matrix3d noise = 100.0 * Eigen::Matrix3d::Identity();
+
+      std::vector< Eigen::Vector3d > measurements;
+      for ( int j = 0; j < 500; ++j )
+      {
+         Eigen::Vector3d z;
+         int near = j % 5 ? j * 3 % numObjects : -1;
+         for ( int k = 0; k < 3; ++k )
+         {
+            z[k] = ( near < 0 ) ? extent * uniform( generator ) :
+               positions[ 3 * near + k ] +
+               std::sqrt( covariances[ 9 * near + 4 * k ] ) *
+               normal( generator );
+         }
+         measurements.push_back( z );
+      }
+
+      Associator associator;
+      associator.setPredictions( positions, covariances );
+      std::vector< Association > associations =
+         associator.associate( measurements, noise );
+
+      int mismatches = 0;
+      int associated = 0;
+      double scoreError = 0.0;
+      for ( std::size_t j = 0; j < measurements.size(); ++j )
+      {
+         int best = -1;
+         double bestScore = 0.0;
+         int candidates = 0;
+         for ( int i = 0; i < numObjects; ++i )
+         {
+            Eigen::Matrix3d S = Eigen::Map< const Eigen::Matrix3d >(
+                                   &covariances[ 9 * i ] ) + noise;
+            Eigen::Vector3d r = measurements[j] -
+               Eigen::Map< const Eigen::Vector3d >( &positions[ 3 * i ] );
+            double d2 = r.dot( S.ldlt().solve( r ) );
+            if ( d2 > associator.getGate() )
+            {
+               continue;
+            }
+            ++candidates;
+            double score = d2 + std::log( ( 2 * M_PI * S ).determinant() );
+            if ( ( best < 0 ) || ( score < bestScore ) )
+            {
+               best = i;
+               bestScore = score;
+            }
+         }
+         const Association &found = associations[j];
+         mismatches += ( ( found.object != best ) ||
+                         ( found.candidates != candidates ) ) ? 1 : 0;
+         associated += ( best >= 0 ) ? 1 : 0;
+         if ( best >= 0 )
+         {
+            scoreError = std::max( scoreError,
+                                   std::abs( found.score - bestScore ) );
+         }
+      }
+      std::cout << "Association: " << associated << " of "
+                << measurements.size() << " measurements gated"
+                << std::endl;
+      report( "k-d tree associations differing from brute force",
+              mismatches, 0.0 );
+      report( "k-d tree scores vs brute force", scoreError, 1.E-9 );
+   }
+
+   // ConjunctionScreen over 6000 s of 150 near circular orbits in a
+   // 40 km shell at 700 km, with 12 close approaches planted from 0 to
+   // 8 km, against the local minima of the distance of every pair on
+   // the same Hermite cubics through the samples, found on a grid of 16
+   // points per bucket and refined by ternary search. The screen must
+   // miss none within 5 km and list none the brute force does not.
+   void
+   checkScreen()
+   {
+      std::mt19937 generator( 11 );
+      std::uniform_real_distribution< double > uniform( 0.0, 1.0 );
+      std::normal_distribution< double > normal( 0.0, 1.0 );
+      const int numRandom = 138;
+      const int numPlanted = 12;
+      const int numObjects = numRandom + numPlanted;
+      const double span = 6000.0;
+      const double threshold = 5.E3;
+      ConjunctionScreen screen( 0.0, span, 60.0, mu );
+      const std::vector< double > &times = screen.getTimes();
+      const int numTimes = times.size();
+
+      auto randomUnit = [&]() {
+         Eigen::Vector3d u( normal( generator ), normal( generator ),
+                            normal( generator ) );
+         return Eigen::Vector3d( u.normalized() );
+      };
+      std::vector< std::vector< double > > ics;
+      for ( int i = 0; i < numRandom; ++i )
+      {
+         double a = radius + 680.E3 + 40.E3 * uniform( generator );
+         Eigen::Vector3d r = a * randomUnit();
+         Eigen::Vector3d w = r.cross( randomUnit() ).normalized();
+         Eigen::Vector3d v = std::sqrt( mu / a ) *
+            ( 1 + 0.002 * ( uniform( generator ) - 0.5 ) ) * w;
+         ics.push_back( { r[0], r[1], r[2], v[0], v[1], v[2] } );
+      }
+
+      // Each planted object passes a random one at a random time, off
+      // by up to 8 km and crossing its velocity at 0.2 to 2 rad
+      for ( int j = 0; j < numPlanted; ++j )
+      {
+         int target = j * 11 % numRandom;
+         double tc = span * ( 0.05 + 0.9 * uniform( generator ) );
+         std::vector< double > at = EnckePropagator::kepler( ics[ target ],
+                                                             mu, tc );
+         Eigen::Vector3d r( at[0], at[1], at[2] );
+         Eigen::Vector3d v( at[3], at[4], at[5] );
+         r += 8.E3 * uniform( generator ) * randomUnit();
+         v = Eigen::AngleAxisd( 0.2 + 1.8 * uniform( generator ),
+                                r.normalized() ) * v;
+         ics.push_back( EnckePropagator::kepler(
+            { r[0], r[1], r[2], v[0], v[1], v[2] }, mu, -tc ) );
+      }
+
+      std::vector< std::vector< double > > samples;
+      for ( int i = 0; i < numObjects; ++i )
+      {
+         std::vector< double > states;
+         for ( double t: times )
+         {
+            std::vector< double > state =
+               EnckePropagator::kepler( ics[i], mu, t );
+            states.insert( states.end(), state.begin(), state.end() );
+         }
+         screen.addObject( states );
+         samples.push_back( states );
+      }
+      std::vector< Conjunction > found = screen.screen( threshold, 0 );
+
+      // Position of object i on its Hermite cubic at t
+      auto position = [&]( int i, double t, double *p ) {
+         int k = std::min( int( t / 60.0 ), numTimes - 2 );
+         double h = times[ k + 1 ] - times[k];
+         double s = ( t - times[k] ) / h;
+         const double *a = &samples[i][ 6 * k ];
+         const double *b = &samples[i][ 6 * ( k + 1 ) ];
+         double s2 = s * s;
+         double s3 = s2 * s;
+         for ( int c = 0; c < 3; ++c )
+         {
+            p[c] = ( 2 * s3 - 3 * s2 + 1 ) * a[c] +
+                   ( s3 - 2 * s2 + s ) * h * a[ c + 3 ] +
+                   ( -2 * s3 + 3 * s2 ) * b[c] +
+                   ( s3 - s2 ) * h * b[ c + 3 ];
+         }
+      };
+      auto distance = [&]( int i, int j, double t ) {
+         double p[3];
+         double q[3];
+         position( i, t, p );
+         position( j, t, q );
+         return std::sqrt( ( p[0] - q[0] ) * ( p[0] - q[0] ) +
+                           ( p[1] - q[1] ) * ( p[1] - q[1] ) +
+                           ( p[2] - q[2] ) * ( p[2] - q[2] ) );
+      };
+
+      const int numGrid = 16 * ( numTimes - 1 );
+      const double spacing = span / numGrid;
+      std::vector< Conjunction > brute;
+      std::vector< double > grid( numGrid + 1 );
+      for ( int i = 0; i < numObjects; ++i )
+      {
+         for ( int j = i + 1; j < numObjects; ++j )
+         {
+            for ( int n = 0; n <= numGrid; ++n )
+            {
+               grid[n] = distance( i, j, n * spacing );
+            }
+            for ( int n = 0; n <= numGrid; ++n )
+            {
+               bool falling = ( n == 0 ) || ( grid[n] < grid[ n - 1 ] );
+               bool rising = ( n == numGrid ) || ( grid[n] <= grid[ n + 1 ] );
+               if ( !falling || !rising )
+               {
+                  continue;
+               }
+               double from = std::max( 0.0, ( n - 1 ) * spacing );
+               double to = std::min( span, ( n + 1 ) * spacing );
+               double t = n * spacing;
+               if ( ( n > 0 ) && ( n < numGrid ) )
+               {
+                  for ( int m = 0; m < 100; ++m )
+                  {
+                     double t1 = from + ( to - from ) / 3;
+                     double t2 = to - ( to - from ) / 3;
+                     if ( distance( i, j, t1 ) < distance( i, j, t2 ) )
+                     {
+                        to = t2;
+                     }
+                     else
+                     {
+                        from = t1;
+                     }
+                  }
+                  t = 0.5 * ( from + to );
+               }
+               double d = distance( i, j, t );
+               if ( d <= threshold )
+               {
+                  Conjunction c = { i, j, t, d, 0.0 };
+                  brute.push_back( c );
+               }
+            }
+         }
+      }
+
+      // Matched by pair and time of closest approach
+      auto matches = [&]( const Conjunction &a, const Conjunction &b ) {
+         return ( a.first == b.first ) && ( a.second == b.second ) &&
+                ( std::abs( a.time - b.time ) < 0.01 );
+      };
+      int missed = 0;
+      int planted = 0;
+      double distanceError = 0.0;
+      for ( const Conjunction &b: brute )
+      {
+         bool listed = false;
+         for ( const Conjunction &c: found )
+         {
+            if ( matches( b, c ) )
+            {
+               listed = true;
+               distanceError = std::max( distanceError,
+                                         std::abs( c.distance - b.distance ) );
+            }
+         }
+         missed += listed ? 0 : 1;
+         planted += ( b.second >= numRandom ) ? 1 : 0;
+      }
+      int extra = 0;
+      for ( const Conjunction &c: found )
+      {
+         bool listed = false;
+         for ( const Conjunction &b: brute )
+         {
+            listed = listed || matches( b, c );
+         }
+         extra += listed ? 0 : 1;
+      }
+      std::cout << "Screen: " << found.size() << " conjunctions within "
+                << threshold << " m, brute force " << brute.size() << " ( "
+                << planted << " planted )" << std::endl;
+      report( "Screened conjunctions missed vs brute force", missed, 0.0 );
+      report( "Screened conjunctions extra vs brute force", extra, 0.0 );
+      report( "Screened miss distances vs brute force", distanceError,
+              1.E-3 );
+   }
+
+   // GaussianMixture in LEO under drag from 10 km and 10 m/s. Without
+   // splitting its one component must be the mean and STM mapped
+   // covariance of a Motion. With splitting, every component's Motion
+   // starts at its split mean, so mapping the components back through
+   // their STMs must give the moments of the initial Gaussian: splits
+   // preserve the mixture mean and covariance. The component and byte
+   // budgets must hold, and an update must leave the weights normalised
+   // and above the floor.
+   void
+   checkMixture()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::vector< std::shared_ptr< Action > > actions = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 0.0 ) ),
+         std::shared_ptr< Action >(
+            new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                                  88667.0, rotation, 0.0031 ) ) };
+      double span = 6000.0;
+      Eigen::VectorXd mean = Eigen::Map< const Eigen::VectorXd >(
+         ic.data(), 6 );
+      Eigen::MatrixXd covariance = Eigen::MatrixXd::Zero( 6, 6 );
+      covariance.diagonal() << 1.E8, 1.E8, 1.E8, 100.0, 100.0, 100.0;
+
+      GaussianMixture single( actions, mean, covariance, 0.0, 60.0 );
+      single.setSplitting( 0.0 );
+      single.propagate( span );
+      std::shared_ptr< Motion > motion = motionWith( ic, 60.0, actions );
+      motion->stepTo( span );
+      std::vector< double > state = motion->getState( span );
+      std::vector< double > partials = motion->getStatePartials( span );
+      Eigen::MatrixXd stm = Eigen::Map< const Eigen::Matrix< double, 6, 6,
+         Eigen::RowMajor > >( partials.data() );
+      Eigen::MatrixXd mapped = stm * covariance * stm.transpose();
+      const MixtureComponent &component = single.getComponent( 0 );
+      report( "Unsplit mixture components", single.getNumComponents(), 1.0 );
+      report( "Unsplit mixture mean vs Motion",
+              positionError( std::vector< double >( component.mean.data(),
+                                                    component.mean.data() + 6 ),
+                             state ), 0.0 );
+      report( "Unsplit mixture covariance vs the Motion STM mapped",
+              ( component.covariance - mapped ).norm() / mapped.norm(), 0.0 );
+
+      GaussianMixture mixture( actions, mean, covariance, 0.0, 60.0 );
+      mixture.setSplitting( 0.001 );
+      mixture.propagate( span );
+      Eigen::VectorXd startMean = Eigen::VectorXd::Zero( 6 );
+      Eigen::MatrixXd startCovariance = Eigen::MatrixXd::Zero( 6, 6 );
+      std::vector< Eigen::VectorXd > starts;
+      for ( int k = 0; k < mixture.getNumComponents(); ++k )
+      {
+         const MixtureComponent &c = mixture.getComponent( k );
+         std::vector< double > start = c.motion->getState( 0.0 );
+         std::vector< double > p = c.motion->getStatePartials( span );
+         Eigen::MatrixXd inverse = Eigen::Map< const Eigen::Matrix< double,
+            6, 6, Eigen::RowMajor > >( p.data() ).inverse();
+         starts.push_back( Eigen::Map< const Eigen::VectorXd >(
+            start.data(), 6 ) );
+         startMean += c.weight * starts.back();
+         startCovariance += c.weight *
+            ( inverse * c.covariance * inverse.transpose() +
+              starts.back() * starts.back().transpose() );
+      }
+      startCovariance -= startMean * startMean.transpose();
+      std::cout << "Mixture: " << mixture.getNumComponents()
+                << " components after " << span << " s" << std::endl;
+      report( "Split mixture components ( 1 if unsplit )",
+              ( mixture.getNumComponents() > 1 ) ? 0.0 : 1.0, 0.0 );
+      report( "Split mixture mean position at the start vs the Gaussian",
+              ( startMean - mean ).head( 3 ).norm(), 1.E-6 );
+      report( "Split mixture covariance at the start vs the Gaussian",
+              ( startCovariance - covariance ).norm() / covariance.norm(),
+              1.E-8 );
+
+      std::size_t bytesEach = component.motion->getLogBytes();
+      GaussianMixture counted( actions, mean, covariance, 0.0, 60.0 );
+      counted.setSplitting( 0.001 );
+      counted.setBudget( 5, std::size_t( 1 ) << 40 );
+      counted.propagate( span );
+      GaussianMixture sized( actions, mean, covariance, 0.0, 60.0 );
+      sized.setSplitting( 0.001 );
+      sized.setBudget( 16, 4 * bytesEach );
+      sized.propagate( span );
+      report( "Mixture components over a budget of 5",
+              counted.getNumComponents(), 5.0 );
+      report( "Mixture log bytes over a budget of 4 logs",
+              sized.getBytes() / double( bytesEach ), 4.0 );
+
+      mixture.setReduction( 1.E-3, 0.01 );
+      double worst = 0.0;
+      for ( int n = 0; n < 3; ++n )
+      {
+         std::vector< double > truth = motion->getState( span );
+         Eigen::Vector3d z( truth[0] + 1000.0 * n, truth[1], truth[2] );
+         mixture.update( z, 1.E4 * Eigen::Matrix3d::Identity() );
+         double total = 0.0;
+         for ( int k = 0; k < mixture.getNumComponents(); ++k )
+         {
+            total += mixture.getComponent( k ).weight;
+            worst = std::max( worst, ( mixture.getComponent( k ).weight <
+                                       1.E-3 ) ? 1.0 : 0.0 );
+         }
+         worst = std::max( worst, std::abs( total - 1 ) );
+      }
+      report( "Mixture weights after updates, |sum - 1| or 1 if under the "
+              "floor", worst, 1.E-12 );
+   }
+
+   // A scenario file parsed by ScenarioRunner: defaults before the
+   // first scenario, a continued line, outputs_every and the default
+   // file name. The scenarios are run and their output read back, which
+   // must be bit for bit the arcs of Motions built by hand.
+   void
+   checkScenarios()
+   {
+      std::istringstream text(
+         "# Defaults for every scenario\n"
+         "gravity    Earth 6378136.3 3.986004415E+14 1.082626925638815E-3\n"
+         "step       60\n"
+         "scenario   ekf_check_leo\n"
+         "state      757700 5222607 4851500 2213.21 4678.34 -5371.30\n"
+         "atmosphere Earth_Atmosphere 7078136.3 3.614E-13 88667.0\n"
+         "           7.29211585530066E-5 0.0031\n"
+         "agents     mu J2 Cd\n"
+         "outputs    600 1200 1800\n"
+         "end\n"
+         "scenario   ekf_check_later\n"
+         "state      757700 5222607 4851500 2213.21 4678.34 -5371.30\n"
+         "epoch      100\n"
+         "outputs_every 120 700\n"
+         "file       ekf_check_later.out\n"
+         "end\n" );
+      ScenarioRunner runner;
+      report( "scenarios parsed", std::abs( runner.read( text ) - 2 ), 0.0 );
+      const Scenario &leo = runner.getScenario( 0 );
+      const Scenario &later = runner.getScenario( 1 );
+      int wrong = 0;
+      wrong += ( leo.name != "ekf_check_leo" );
+      wrong += ( leo.file != "ekf_check_leo.bin" );
+      wrong += ( leo.step != 60.0 ) || ( leo.epoch != 0.0 );
+      wrong += ( leo.actions.size() != 2 );
+      wrong += ( leo.actions.size() > 1 ) &&
+               ( ( leo.actions[1].kind != "atmosphere" ) ||
+                 ( leo.actions[1].parameters.size() != 5 ) ||
+                 ( leo.actions[1].parameters[4] != 0.0031 ) );
+      wrong += ( leo.agents != std::vector< std::string >(
+                                  { "mu", "J2", "Cd" } ) );
+      wrong += ( leo.outputs != std::vector< double >( { 600, 1200, 1800 } ) );
+      wrong += ( later.epoch != 100.0 ) || ( later.actions.size() != 1 );
+      wrong += ( later.outputs !=
+                 std::vector< double >( { 100, 220, 340, 460, 580, 700 } ) );
+      wrong += ( later.file != "ekf_check_later.out" );
+      report( "scenario fields parsed wrongly", wrong, 0.0 );
+
+      std::vector< ScenarioReport > reports = runner.run();
+      int differing = 0;
+      for ( int k = 0; k < 2; ++k )
+      {
+         const Scenario &scenario = runner.getScenario( k );
+         std::shared_ptr< Motion > motion(
+            new Motion( scenario.ic, scenario.step, scenario.epoch ) );
+         motion->addAction( std::shared_ptr< Action >(
+            new GravityAction( "Earth", 6378136.3, 3.986004415E+14,
+                               1.082626925638815E-3 ) ) );
+         if ( k == 0 )
+         {
+            motion->addAction( std::shared_ptr< Action >(
+               new AtmosphereAction( "Earth_Atmosphere", 7078136.3,
+                                     3.614E-13, 88667.0,
+                                     7.29211585530066E-5, 0.0031 ) ) );
+            motion->activateAgents( scenario.agents );
+         }
+         motion->stepTo( scenario.outputs.back() );
+
+         std::vector< double > times;
+         std::vector< double > states;
+         std::vector< double > partials;
+         int numAgents = ScenarioRunner::readOutput( reports[k].file, times,
+                                                     states, partials );
+         std::remove( reports[k].file.c_str() );
+         differing += ( times != scenario.outputs );
+         for ( std::size_t i = 0; i < scenario.outputs.size(); ++i )
+         {
+            double t = scenario.outputs[i];
+            differing += !std::equal(
+               states.begin() + 6 * i, states.begin() + 6 * ( i + 1 ),
+               motion->getState( t ).begin() );
+            std::vector< double > expected = motion->getStatePartials( t );
+            differing += ( (int) expected.size() != numAgents * numAgents ) ||
+               !std::equal( expected.begin(), expected.end(),
+                            partials.begin() + expected.size() * i );
+         }
+      }
+      report( "scenario outputs read back differing from Motion", differing,
+              0.0 );
+   }
+
+   // ParameterSweep lanes against a Motion per variant, over 6000 s in
+   // LEO: two J2 values by four Cd scales by three density scales, 24
+   // variants in partly filled blocks, of which the equal Cd rho_ref
+   // products make 12 distinct. Each lane must land within the dopri5
+   // tolerance of its Motion, centimetres here: the sweep sizes steps by
+   // the state alone, and Motion by the STM as well, so they step
+   // differently. That is a millionth of the spread of the variants.
+   void
+   checkSweep()
+   {
+      double span = 6000.0;
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::shared_ptr< GravityAction > gravity(
+         new GravityAction( "Earth", radius, mu, 1.082626925638815E-3 ) );
+      std::shared_ptr< AtmosphereAction > atmosphere(
+         new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                               88667.0, rotation, 0.0031 ) );
+      ParameterSweep sweep( gravity, atmosphere, ic, 600.0, 0.0 );
+      sweep.addValues( "J2", { 0.0, 1.082626925638815E-3 } );
+      sweep.addScales( "Cd", { 0.5, 1.0, 2.0, 4.0 } );
+      sweep.addScales( "rho_ref", { 0.5, 1.0, 2.0 } );
+      sweep.stepTo( span );
+      report( "sweep variants",
+              std::abs( sweep.getNumVariants() - 24 ), 0.0 );
+      report( "sweep distinct dynamics",
+              std::abs( sweep.getNumDistinct() - 12 ), 0.0 );
+
+      double difference = 0.0;
+      double spread = 0.0;
+      std::vector< double > first = sweep.getState( 0, span );
+      for ( int v = 0; v < sweep.getNumVariants(); ++v )
+      {
+         std::vector< double > p = sweep.getParameters( v );
+         std::shared_ptr< Motion > motion = motionWith(
+            ic, 600.0,
+            { std::shared_ptr< Action >(
+                 new GravityAction( "Earth", p[0], p[1], p[2] ) ),
+              std::shared_ptr< Action >(
+                 new AtmosphereAction( "Earth Atmosphere", p[3], p[4],
+                                       p[5], p[6], p[7] ) ) } );
+         motion->stepTo( span );
+         std::vector< double > state = sweep.getState( v, span );
+         difference = std::max(
+            difference, positionError( state, motion->getState( span ) ) );
+         spread = std::max( spread, positionError( state, first ) );
+      }
+      std::cout << "Sweep variants up to " << spread << " m apart"
+                << std::endl;
+      report( "sweep lanes vs a Motion per variant", difference, 0.05 );
+      report( "that over the spread of the variants", difference / spread,
+              1.E-6 );
+   }
+
+   // TrackingSimulator measurements written to a file and read back must
+   // be the measurements simulated in memory, record for record, for
+   // any number of threads. Without noise, the ranges at logged truth
+   // states must be the distances from the stations.
+   void
+   checkMeasurementFile()
+   {
+      std::vector< std::shared_ptr< Action > > actions = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 1.082626925638815E-3 ) ) };
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::vector< double > other( ic );
+      other[3] += 20.0;
+      const double stations[4][2] = { { 0.6, 1.4 }, { -0.4, 2.5 },
+                                      { 0.9, -2.0 }, { 0.1, 0.3 } };
+      double span = 6000.0;
+
+      auto simulator = [&]( bool noisy )
+      {
+         TrackingSimulator simulator( radius, rotation );
+         for ( const auto &station: stations )
+         {
+            int k = simulator.addStation( station[0], station[1], 0.1 );
+            if ( noisy )
+            {
+               simulator.setNoise( k, 5.0, 0.01, 1.E-4 );
+            }
+         }
+         simulator.addObject( ic, actions );
+         simulator.addObject( other, actions );
+         return simulator;
+      };
+
+      TrackingSimulator noisy = simulator( true );
+      noisy.setThreads( 1 );
+      std::vector< Measurement > simulated = noisy.simulate( 0.0, span );
+      noisy.setThreads( 3 );
+      std::string path = "ekf_check_measurements.bin";
+      std::size_t count = noisy.simulate( 0.0, span, path );
+      std::vector< Measurement > read =
+         TrackingSimulator::readMeasurements( path );
+      std::remove( path.c_str() );
+      std::cout << "Measurement file: " << count << " measurements"
+                << std::endl;
+      report( "measurements written vs simulated",
+              std::abs( (double) count - simulated.size() ) +
+              ( simulated.empty() ? 1 : 0 ), 0.0 );
+      int differing = std::abs( (double) read.size() - simulated.size() );
+      for ( std::size_t i = 0; i < std::min( read.size(), simulated.size() );
+            ++i )
+      {
+         differing += std::memcmp( &read[i], &simulated[i],
+                                   sizeof( Measurement ) ) ? 1 : 0;
+      }
+      report( "measurements read back differing from simulated",
+              differing, 0.0 );
+
+      std::vector< Measurement > exact = simulator( false ).simulate( 0.0,
+                                                                      span );
+      std::shared_ptr< Motion > truth[2] = {
+         motionWith( ic, 60.0, actions ), motionWith( other, 60.0, actions ) };
+      for ( std::shared_ptr< Motion > motion: truth )
+      {
+         motion->stepTo( span );
+      }
+      double error = 0.0;
+      int compared = 0;
+      for ( const Measurement &measurement: exact )
+      {
+         if ( std::fmod( measurement.time, 60.0 ) != 0.0 )
+         {
+            continue;
+         }
+         ++compared;
+         std::vector< double > state =
+            truth[ measurement.object ]->getState( measurement.time );
+         const double *station = stations[ measurement.station ];
+         double angle = station[1] + rotation * measurement.time;
+         double distance = 0.0;
+         for ( int k = 0; k < 3; ++k )
+         {
+            double up = ( k == 2 ) ? std::sin( station[0] ) :
+               std::cos( station[0] ) *
+               ( k ? std::sin( angle ) : std::cos( angle ) );
+            distance += std::pow( state[k] - radius * up, 2 );
+         }
+         error = std::max( error, std::abs( measurement.range -
+                                            std::sqrt( distance ) ) );
+      }
+      report( "noiseless ranges at logged states vs distance",
+              compared ? error : 1.0, 1.E-6 );
+   }
+
+   // A recorded measurement file replayed through ReplayHarness: every
+   // record must be processed, and the filter, started 100 m off, must
+   // pull each object's state toward the truth at its last measurement.
+   // Drag is included because it supplies the kinematic partials of the
+   // STM, which gravity alone leaves out. Two objects are visible from
+   // the first station at the start, so the epoch is measured too.
+   void
+   checkReplay()
+   {
+      std::vector< std::shared_ptr< Action > > actions = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 1.082626925638815E-3 ) ),
+         std::shared_ptr< Action >(
+            new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                                  88667.0, rotation, 0.0031 ) ) };
+      std::vector< double > ics[2] = {
+         { 757700.0, 5222607.0, 4851500.0, 2213.21, 4678.34, -5371.30 },
+         { 757700.0, 5222607.0, 4851500.0, 2233.21, 4678.34, -5371.30 } };
+      const double stations[4][2] = { { 0.6, 1.4 }, { -0.4, 2.5 },
+                                      { 0.9, -2.0 }, { 0.1, 0.3 } };
+      std::string path = "ekf_check_replay.bin";
+
+      TrackingSimulator simulator( radius, rotation );
+      ReplayHarness harness( radius, rotation );
+      for ( const auto &station: stations )
+      {
+         int k = simulator.addStation( station[0], station[1], 0.1 );
+         simulator.setNoise( k, 5.0, 0.01, 1.E-4 );
+         k = harness.addStation( station[0], station[1] );
+         harness.setNoise( k, 5.0, 0.01, 1.E-4 );
+      }
+      Eigen::MatrixXd covariance = Eigen::MatrixXd::Zero( 6, 6 );
+      covariance.diagonal() << 1.E4, 1.E4, 1.E4, 1.E-2, 1.E-2, 1.E-2;
+      std::shared_ptr< Motion > motions[2];
+      for ( int object = 0; object < 2; ++object )
+      {
+         simulator.addObject( ics[ object ], actions );
+         std::vector< double > state( ics[ object ] );
+         state[0] += 100.0;
+         motions[ object ] = motionWith( state, 10.0, actions );
+         std::shared_ptr< Knowledge > knowledge(
+            new Knowledge( motions[ object ]->getActiveAgents() ) );
+         knowledge->setCovariance( covariance );
+         harness.addObject( motions[ object ], knowledge );
+      }
+      std::size_t count = simulator.simulate( 0.0, 6000.0, path );
+      ReplayReport replayed = harness.replay( path );
+      std::remove( path.c_str() );
+      report( "replayed measurements vs recorded",
+              std::abs( (double) replayed.measurements - count ), 0.0 );
+
+      double error = 0.0;
+      for ( int object = 0; object < 2; ++object )
+      {
+         double t = motions[ object ]->getTime();
+         std::shared_ptr< Motion > truth =
+            motionWith( ics[ object ], 10.0, actions );
+         truth->stepTo( t );
+         error = std::max( error,
+                           positionError( motions[ object ]->getState( t ),
+                                          truth->getState( t ) ) );
+      }
+      std::cout << "Replay: " << replayed.measurements
+                << " measurements, position error " << error << " m"
+                << std::endl;
+      report( "replayed position error over the initial 100 m", error / 100.0,
+              0.1 );
+   }
+
+   // The STM across a drag ceiling ( AtmosphereAction::setCeiling ), with
+   // the saltation matrix, against central differences of the final
+   // state. Stepping straight through the switch, without it, must be
+   // visibly worse.
+   void
+   checkSaltation()
+   {
+      double perigee = 6700.E3;
+      double apogee = 7500.E3;
+      double speed = std::sqrt( mu * ( 2 / perigee -
+                                       2 / ( perigee + apogee ) ) );
+      std::vector< double > ic = { perigee, 0.0, 0.0, 0.0,
+                                   speed * std::cos( 0.9 ),
+                                   speed * std::sin( 0.9 ) };
+      double span = 3000.0;
+
+      std::shared_ptr< AtmosphereAction > drag(
+         new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                               88667.0, rotation, 1.0 ) );
+      drag->setCeiling( 7000.E3 );
+      std::vector< std::shared_ptr< Action > > actions = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 0.0 ) ),
+         drag };
+
+      auto finalState = [&]( const std::vector< double > &x0 )
+      {
+         std::shared_ptr< Motion > motion = motionWith( x0, span, actions );
+         motion->stepTo( span );
+         return motion->getState( span );
+      };
+
+      std::vector< double > differences( 36 );
+      for ( int j = 0; j < 6; ++j )
+      {
+         double delta = ( j < 3 ) ? 100.0 : 0.1;
+         std::vector< double > plus( ic );
+         std::vector< double > minus( ic );
+         plus[j] += delta;
+         minus[j] -= delta;
+         std::vector< double > xPlus = finalState( plus );
+         std::vector< double > xMinus = finalState( minus );
+         for ( int i = 0; i < 6; ++i )
+         {
+            differences[ 6 * i + j ] = ( xPlus[i] - xMinus[i] ) / ( 2 * delta );
+         }
+      }
+
+      std::shared_ptr< Motion > switched = motionWith( ic, span, actions );
+      switched->stepTo( span );
+      std::shared_ptr< Motion > through = motionWith( ic, span, actions );
+      through->setSegmenting( false );
+      through->stepTo( span );
+
+      double withSaltation =
+         stmError( switched->getStatePartials( span ), differences );
+      double without =
+         stmError( through->getStatePartials( span ), differences );
+      report( "saltation STM across a drag ceiling vs differences",
+              withSaltation, 1.E-3 );
+      report( "saltation improvement over stepping through the switch",
+              withSaltation / without, 0.1 );
+   }
+
+   // The float STM of Motion::setMixedPrecision against the all double
+   // one, in LEO under drag with Cd estimated, at 10 s output. The 6x6
+   // block stays within single precision roundoff grown over the span,
+   // and the state within the dopri5 tolerance.
+   void
+   checkMixedPrecision()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::vector< std::shared_ptr< Action > > actions = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 0.0 ) ),
+         std::shared_ptr< Action >(
+            new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                                  88667.0, rotation, 0.0031 ) ) };
+
+      std::shared_ptr< Motion > single = motionWith( ic, 10.0, actions );
+      std::shared_ptr< Motion > reference = motionWith( ic, 10.0, actions );
+      for ( std::shared_ptr< Motion > motion: { single, reference } )
+      {
+         motion->activateAgents( { "mu", "Cd" } );
+      }
+      single->setMixedPrecision( true );
+      reference->setMixedPrecision( false );
+      single->stepTo( 6000.0 );
+      reference->stepTo( 6000.0 );
+
+      const double spans[2] = { 2000.0, 6000.0 };
+      const double blockBounds[2] = { 1.E-6, 1.E-5 };
+      for ( int k = 0; k < 2; ++k )
+      {
+         double t = spans[k];
+         double position = positionError( single->getState( t ),
+                                          reference->getState( t ) );
+         std::string at = " after " + std::to_string( (int) t ) + " s";
+         report( "mixed precision 6x6 STM block" + at,
+                 blockError( single->getStatePartials( t ),
+                             reference->getStatePartials( t ), 8 ),
+                 blockBounds[k] );
+         report( "mixed precision position" + at, position, 0.05 );
+      }
+   }
+
+   // Cd activated at 2000 s of a 6000 s LEO arc under drag, against Cd
+   // active from the start. Activation must keep the 6x6 block already
+   // tracked, so the default integration ends with the same STM either
+   // way ( its Cd column is zero, as the Actions give no partials wrt
+   // their constants ). TaylorPropagator differentiates wrt Cd, and its
+   // new column, the sensitivity to Cd from 2000 s, must chain into the
+   // one from the start: start( t ) = mid( t ) + Phi( t ) Phi( ta )^-1
+   // start( ta ).
+   void
+   checkMidArcActivation()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::vector< std::shared_ptr< Action > > actions = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 0.0 ) ),
+         std::shared_ptr< Action >(
+            new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                                  88667.0, rotation, 0.0031 ) ) };
+      double ta = 2000.0;
+      double span = 6000.0;
+
+      typedef Eigen::Matrix< double, 7, 7, Eigen::RowMajor > Matrix7;
+      typedef Eigen::Matrix< double, 6, 6, Eigen::RowMajor > Matrix6;
+      for ( int taylor = 0; taylor < 2; ++taylor )
+      {
+         std::shared_ptr< Motion > start = motionWith( ic, 10.0, actions );
+         std::shared_ptr< Motion > mid = motionWith( ic, 10.0, actions );
+         if ( taylor )
+         {
+            start->setPropagator(
+               std::shared_ptr< Propagator >( new TaylorPropagator() ) );
+            mid->setPropagator(
+               std::shared_ptr< Propagator >( new TaylorPropagator() ) );
+         }
+         start->activateAgents( { "Cd" } );
+         start->stepTo( span );
+         mid->stepTo( ta );
+         std::vector< double > before = mid->getStatePartials( ta );
+         mid->activateAgents( { "Cd" } );
+         mid->stepTo( span );
+
+         std::vector< double > startEnd = start->getStatePartials( span );
+         std::vector< double > startTa = start->getStatePartials( ta );
+         std::vector< double > midEnd = mid->getStatePartials( span );
+         Matrix7 fromStart = Eigen::Map< const Matrix7 >( startEnd.data() );
+         Matrix7 fromTa = Eigen::Map< const Matrix7 >( midEnd.data() );
+         if ( !taylor )
+         {
+            report( "STM after activation at 2000 s vs from the start",
+                    ( fromTa - fromStart ).norm() / fromStart.norm(),
+                    1.E-12 );
+            continue;
+         }
+
+         Matrix7 atTa = Eigen::Map< const Matrix7 >( startTa.data() );
+         Matrix6 phiTa = Eigen::Map< const Matrix6 >( before.data() );
+         Eigen::Matrix< double, 6, 1 > chained =
+            fromTa.block< 6, 1 >( 0, 6 ) + fromTa.block< 6, 6 >( 0, 0 ) *
+            phiTa.inverse() * atTa.block< 6, 1 >( 0, 6 );
+         Eigen::Matrix< double, 6, 1 > column =
+            fromStart.block< 6, 1 >( 0, 6 );
+         report( "Taylor 6x6 block after activation at 2000 s vs from the "
+                 "start", blockError( midEnd, startEnd, 7 ), 1.E-10 );
+         report( "Taylor Cd column activated at 2000 s chained vs from the "
+                 "start", ( chained - column ).norm() / column.norm(),
+                 1.E-9 );
+      }
+   }
+
+   // AtmosphereAction built from a shared AtmosphereModel and the rows
+   // of an ObjectTable against the legacy constructor with the same
+   // body drag term, over 6000 s in LEO with Cd active. Both run the
+   // same arithmetic, so the acceleration along the arc, the state and
+   // the STM must agree exactly. Changing one row of the table must
+   // move that object alone, onto the arc of its new term.
+   void
+   checkAtmosphereTable()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      double span = 6000.0;
+      std::shared_ptr< Action > gravity(
+         new GravityAction( "Earth", radius, mu, 0.0 ) );
+      std::shared_ptr< const AtmosphereModel > atmosphere(
+         new AtmosphereModel( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                              88667.0, rotation ) );
+      std::shared_ptr< ObjectTable > objects( new ObjectTable() );
+      std::vector< double > terms = { 0.0031, 0.005, 0.002 };
+      for ( double term: terms )
+      {
+         objects->addObject( term );
+      }
+
+      auto legacy = [&]( double term ) {
+         return std::shared_ptr< Action >(
+            new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                                  88667.0, rotation, term ) );
+      };
+      auto tableRow = [&]( int object ) {
+         return std::shared_ptr< Action >(
+            new AtmosphereAction( atmosphere, objects, object ) );
+      };
+      auto arc = [&]( std::shared_ptr< Action > drag ) {
+         std::shared_ptr< Motion > motion =
+            motionWith( ic, 10.0, { gravity, drag } );
+         motion->activateAgents( { "Cd" } );
+         motion->stepTo( span );
+         return motion->getStatePartials( span );
+      };
+      auto difference = [&]( const std::vector< double > &a,
+                             const std::vector< double > &b ) {
+         double largest = 0.0;
+         for ( size_t k = 0; k < a.size(); ++k )
+         {
+            largest = std::max( largest, std::abs( a[k] - b[k] ) );
+         }
+         return largest;
+      };
+
+      double accelerationDifference = 0.0;
+      double arcDifference = 0.0;
+      std::vector< std::vector< double > > before;
+      for ( size_t object = 0; object < terms.size(); ++object )
+      {
+         std::shared_ptr< Action > fromTable = tableRow( object );
+         std::shared_ptr< Action > fromConstants = legacy( terms[ object ] );
+         std::shared_ptr< Motion > motion =
+            motionWith( ic, 10.0, { gravity, fromConstants } );
+         motion->stepTo( span );
+         for ( double t = 0.0; t <= span; t += 600.0 )
+         {
+            std::vector< double > state = motion->getState( t );
+            std::vector< double > a( 3, 0.0 );
+            std::vector< double > b( 3, 0.0 );
+            fromTable->getAcceleration( a, state );
+            fromConstants->getAcceleration( b, state );
+            accelerationDifference =
+               std::max( accelerationDifference, difference( a, b ) );
+         }
+         before.push_back( arc( fromTable ) );
+         arcDifference = std::max(
+            arcDifference, difference( before.back(), arc( fromConstants ) ) );
+      }
+      report( "Table backed drag acceleration over 6000 s vs the legacy "
+              "constructor", accelerationDifference, 0.0 );
+      report( "Table backed drag state and STM after 6000 s vs the legacy "
+              "constructor", arcDifference, 0.0 );
+
+      double changed = 0.004;
+      objects->setBodyDragTerm( 1, changed );
+      double othersDifference = 0.0;
+      for ( size_t object = 0; object < terms.size(); object += 2 )
+      {
+         othersDifference = std::max(
+            othersDifference, difference( arc( tableRow( object ) ),
+                                          before[ object ] ) );
+      }
+      std::vector< double > moved = arc( tableRow( 1 ) );
+      report( "Other objects after changing row 1 of the table",
+              othersDifference, 0.0 );
+      report( "Changed object vs the legacy constructor with its new term",
+              difference( moved, arc( legacy( changed ) ) ), 0.0 );
+      report( "Changed object still on its old arc ( 1 if so )",
+              difference( moved, before[1] ) > 0.0 ? 0.0 : 1.0, 0.0 );
+   }
+
+   // Motion::stepTo to epochs off its 60 s grid, in LEO under drag, with
+   // and without the float STM, against the same Motion on a 30 s grid
+   // through them. The state logged at an off grid epoch must be the
+   // state there, not at the grid time before it, some 200 km away, and
+   // stepping on from it must not drift.
+   void
+   checkStepToEpoch()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::vector< std::shared_ptr< Action > > actions = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 0.0 ) ),
+         std::shared_ptr< Action >(
+            new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                                  88667.0, rotation, 0.0031 ) ) };
+
+      for ( bool mixed: { false, true } )
+      {
+         std::shared_ptr< Motion > motion = motionWith( ic, 60.0, actions );
+         std::shared_ptr< Motion > reference =
+            motionWith( ic, 30.0, actions );
+         motion->setMixedPrecision( mixed );
+         reference->setMixedPrecision( mixed );
+         for ( double t: { 630.0, 1230.0 } )
+         {
+            motion->stepTo( t );
+            reference->stepTo( t );
+            report( std::string( mixed ? "mixed precision " : "" ) +
+                    "stepTo " + std::to_string( (int) t ) +
+                    " s off a 60 s grid vs on a 30 s one",
+                    positionError( motion->getState( t ),
+                                   reference->getState( t ) ),
+                    0.01 );
+         }
+      }
+   }
+
+   // ScalarPropagator in float, double and long double against a long
+   // double reference at 1e-15, in LEO under drag. The double one must
+   // be bit for bit the default integration, and each must be as good
+   // as its precision.
+   void
+   checkScalarPrecision()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::vector< std::shared_ptr< Action > > actions = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 0.0 ) ),
+         std::shared_ptr< Action >(
+            new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                                  88667.0, rotation, 0.0031 ) ) };
+      double span = 6000.0;
+
+      const char *names[4] = { "default", "double", "float", "long double" };
+      std::shared_ptr< Propagator > propagators[4] = {
+         std::shared_ptr< Propagator >(),
+         std::shared_ptr< Propagator >( new ScalarPropagator< double >() ),
+         std::shared_ptr< Propagator >( new ScalarPropagator< float >() ),
+         std::shared_ptr< Propagator >(
+            new ScalarPropagator< long double >() ) };
+      const double positionBounds[4] = { 1.E-4, 1.E-4, 200.0, 2.E-6 };
+      const double stmBounds[4] = { 1.E-10, 1.E-10, 1.E-4, 1.E-12 };
+
+      std::shared_ptr< Motion > reference = motionWith( ic, 10.0, actions );
+      reference->setPropagator( std::shared_ptr< Propagator >(
+         new ScalarPropagator< long double >( 1.E-16, 1.E-15 ) ) );
+      reference->stepTo( span );
+      std::vector< double > x = reference->getState( span );
+      std::vector< double > stm = reference->getStatePartials( span );
+
+      std::vector< double > states[4];
+      std::vector< double > partials[4];
+      for ( int k = 0; k < 4; ++k )
+      {
+         std::shared_ptr< Motion > motion = motionWith( ic, 10.0, actions );
+         if ( propagators[k] )
+         {
+            motion->setPropagator( propagators[k] );
+         }
+         motion->stepTo( span );
+         states[k] = motion->getState( span );
+         partials[k] = motion->getStatePartials( span );
+         std::string name = std::string( names[k] ) + " after 6000 s";
+         report( name + " position vs long double reference",
+                 positionError( states[k], x ), positionBounds[k] );
+         report( name + " STM vs long double reference",
+                 blockError( partials[k], stm, 6 ), stmBounds[k] );
+      }
+
+      // Any difference at all fails
+      double identical = 0.0;
+      for ( int i = 0; i < 6; ++i )
+      {
+         identical += ( states[1][i] != states[0][i] ) ? 1.0 : 0.0;
+      }
+      for ( int i = 0; i < 36; ++i )
+      {
+         identical += ( partials[1][i] != partials[0][i] ) ? 1.0 : 0.0;
+      }
+      report( "ScalarPropagator< double > components differing from the "
+              "default integration", identical, 0.0 );
+   }
+
+   // Parareal over a day in LEO under drag ( 8 slices on 4 threads,
+   // coarse point mass gravity at 300 s ) must match serial propagation
+   // to tolerance: against a long double reference its position error
+   // is held to that of the default integration plus a metre, and its
+   // STM error to ten times the serial one. Its fine sweeps control
+   // their steps on the state alone, so the slice boundaries differ from
+   // the serial run by about the integration error.
+   void
+   checkParareal()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::shared_ptr< Action > gravity(
+         new GravityAction( "Earth", radius, mu, 0.0 ) );
+      std::vector< std::shared_ptr< Action > > actions = {
+         gravity,
+         std::shared_ptr< Action >(
+            new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                                  88667.0, rotation, 0.0031 ) ) };
+      double span = 86400.0;
+
+      std::shared_ptr< Motion > reference = motionWith( ic, 60.0, actions );
+      reference->setPropagator( std::shared_ptr< Propagator >(
+         new ScalarPropagator< long double >( 1.E-16, 1.E-15 ) ) );
+      reference->stepTo( span );
+      std::shared_ptr< Motion > serial = motionWith( ic, 60.0, actions );
+      serial->stepTo( span );
+      std::shared_ptr< Motion > parallel = motionWith( ic, 60.0, actions );
+      parallel->setPropagator( std::shared_ptr< Propagator >(
+         new Parareal( gravity, 300.0, 8, 4 ) ) );
+      parallel->stepTo( span );
+
+      double serialError = 0.0;
+      double parallelError = 0.0;
+      double serialStm = 0.0;
+      double parallelStm = 0.0;
+      for ( double t = 0.0; t <= span; t += 3600.0 )
+      {
+         std::vector< double > x = reference->getState( t );
+         std::vector< double > stm = reference->getStatePartials( t );
+         serialError = std::max( serialError,
+                                 positionError( serial->getState( t ), x ) );
+         parallelError =
+            std::max( parallelError,
+                      positionError( parallel->getState( t ), x ) );
+         serialStm = std::max(
+            serialStm, blockError( serial->getStatePartials( t ), stm, 6 ) );
+         parallelStm = std::max(
+            parallelStm,
+            blockError( parallel->getStatePartials( t ), stm, 6 ) );
+      }
+      std::cout << "Serial errors over a day: position " << serialError
+                << ", STM " << serialStm << std::endl;
+      report( "Parareal position error over a day vs long double reference",
+              parallelError, serialError + 1.0 );
+      report( "Parareal STM error over a day vs long double reference",
+              parallelStm, 10 * serialStm );
+   }
+
+   // Specific orbital energy
+   double
+   energy( const std::vector< double > &x )
+   {
+      return 0.5 * ( x[3] * x[3] + x[4] * x[4] + x[5] * x[5] ) -
+             mu / std::sqrt( x[0] * x[0] + x[1] * x[1] + x[2] * x[2] );
+   }
+
+   // The default SymplecticPropagator over about 100 LEO orbits against
+   // dopri5, under point mass gravity, which conserves energy. The
+   // relative energy error of dopri5 grows with every orbit; that of the
+   // symplectic map must stay at roundoff, no larger on the last day than
+   // on the first, and a thousandth of the dopri5 drift at the end.
+   void
+   checkSymplecticEnergy()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::vector< std::shared_ptr< Action > > actions = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 0.0 ) ) };
+      double day = 86400.0;
+      double span = 576000.0;
+
+      std::shared_ptr< Motion > dopri = motionWith( ic, 600.0, actions );
+      dopri->stepTo( span );
+      std::shared_ptr< Motion > symplectic = motionWith( ic, 600.0, actions );
+      symplectic->setPropagator(
+         std::shared_ptr< Propagator >( new SymplecticPropagator() ) );
+      symplectic->stepTo( span );
+
+      double e0 = energy( ic );
+      double firstDay = 0.0;
+      double lastDay = 0.0;
+      double largest = 0.0;
+      for ( double t = 600.0; t <= span; t += 600.0 )
+      {
+         double error =
+            std::abs( energy( symplectic->getState( t ) ) - e0 ) / -e0;
+         largest = std::max( largest, error );
+         firstDay = ( t <= day ) ? std::max( firstDay, error ) : firstDay;
+         lastDay = ( t > span - day ) ? std::max( lastDay, error ) : lastDay;
+      }
+      double drift = std::abs( energy( dopri->getState( span ) ) - e0 ) / -e0;
+      std::cout << "Relative energy error over 100 orbits: dopri5 " << drift
+                << ", symplectic " << largest << std::endl;
+      report( "symplectic energy error last day over first day",
+              lastDay / firstDay, 4.0 );
+      report( "symplectic energy error over 100 orbits vs dopri5 drift",
+              largest / drift, 1.E-3 );
+   }
+
+   // TaylorPropagator in LEO under J2 and drag, over 6000 s in one
+   // output step. The order must be ceil( 1 - 0.5 ln tol ), the state
+   // must beat dopri5 against a long double reference and follow the
+   // tolerance, the steps must be long, and the STM must match central
+   // differences ( the default STM lacks the J2 partials ).
+   void
+   checkTaylor()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::vector< std::shared_ptr< Action > > actions = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 1.082626925638815E-3 ) ),
+         std::shared_ptr< Action >(
+            new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                                  88667.0, rotation, 0.0031 ) ) };
+      double span = 6000.0;
+
+      auto finalMotion = [&]( const std::vector< double > &x0,
+                              std::shared_ptr< Propagator > propagator )
+      {
+         std::shared_ptr< Motion > motion = motionWith( x0, span, actions );
+         if ( propagator )
+         {
+            motion->setPropagator( propagator );
+         }
+         motion->stepTo( span );
+         return motion;
+      };
+
+      std::vector< double > reference = finalMotion(
+         ic, std::shared_ptr< Propagator >(
+                new ScalarPropagator< long double >( 1.E-16, 1.E-15 ) ) )
+         ->getState( span );
+      double dopri = positionError(
+         finalMotion( ic, nullptr )->getState( span ), reference );
+
+      std::shared_ptr< TaylorPropagator > loose(
+         new TaylorPropagator( 1.E-8 ) );
+      std::shared_ptr< TaylorPropagator > taylor( new TaylorPropagator() );
+      double looseError = positionError(
+         finalMotion( ic, loose )->getState( span ), reference );
+      std::shared_ptr< Motion > motion = finalMotion( ic, taylor );
+      double error = positionError( motion->getState( span ), reference );
+      std::cout << "Position error after 6000 s: dopri5 " << dopri
+                << ", Taylor 1e-8 " << looseError << ", Taylor 1e-12 "
+                << error << " in " << taylor->getSteps() << " steps"
+                << std::endl;
+
+      auto order = []( double tol )
+      {
+         return std::ceil( 1 - 0.5 * std::log( tol ) );
+      };
+      report( "Taylor order at 1e-8",
+              std::abs( loose->getOrder() - order( 1.E-8 ) ), 0.0 );
+      report( "Taylor order at 1e-12",
+              std::abs( taylor->getOrder() - order( 1.E-12 ) ), 0.0 );
+      report( "Taylor position vs long double over dopri5's", error / dopri,
+              0.01 );
+      report( "Taylor position at 1e-12 over at 1e-8", error / looseError,
+              0.01 );
+      report( "Taylor steps over 6000 s", taylor->getSteps(), 20.0 );
+
+      std::vector< double > differences( 36 );
+      for ( int j = 0; j < 6; ++j )
+      {
+         double delta = ( j < 3 ) ? 10.0 : 0.01;
+         std::vector< double > plus( ic );
+         std::vector< double > minus( ic );
+         plus[j] += delta;
+         minus[j] -= delta;
+         std::vector< double > xPlus =
+            finalMotion( plus, std::shared_ptr< Propagator >(
+                                  new TaylorPropagator() ) )->getState( span );
+         std::vector< double > xMinus =
+            finalMotion( minus, std::shared_ptr< Propagator >(
+                                   new TaylorPropagator() ) )->getState( span );
+         for ( int i = 0; i < 6; ++i )
+         {
+            differences[ 6 * i + j ] = ( xPlus[i] - xMinus[i] ) / ( 2 * delta );
+         }
+      }
+      report( "Taylor STM vs differences",
+              stmError( motion->getStatePartials( span ), differences ),
+              1.E-6 );
+   }
+
+   // SundmanPropagator over a day from a 300 km by 42164 km orbit under
+   // J2 and drag, against dopri5 at 1e-14, with plain Cowell ( alpha = 0
+   // on the same stepper and tolerances ) to compare. Its position error
+   // over the arc must be well under Cowell's in no more steps, and its
+   // STM, mapped back from fictitious time, within tolerance.
+   void
+   checkSundman()
+   {
+      double perigee = 6678137.0;
+      double apogee = 42164000.0;
+      double speed = std::sqrt( mu * ( 2 / perigee -
+                                       2 / ( perigee + apogee ) ) );
+      std::vector< double > ic = { perigee, 0.0, 0.0, 0.0,
+                                   speed * std::cos( 0.5 ),
+                                   speed * std::sin( 0.5 ) };
+      std::vector< std::shared_ptr< Action > > actions = {
+         std::shared_ptr< Action >(
+            new GravityAction( "Earth", radius, mu, 1.082626925638815E-3 ) ),
+         std::shared_ptr< Action >(
+            new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                                  88667.0, rotation, 0.0031 ) ) };
+      double span = 86400.0;
+
+      std::shared_ptr< Motion > reference = motionWith( ic, 600.0, actions );
+      reference->setPropagator( std::shared_ptr< Propagator >(
+         new ScalarPropagator< double >( 1.E-15, 1.E-14 ) ) );
+      reference->stepTo( span );
+
+      std::shared_ptr< SundmanPropagator > sundmans[2] = {
+         std::shared_ptr< SundmanPropagator >( new SundmanPropagator() ),
+         std::shared_ptr< SundmanPropagator >( new SundmanPropagator( 0 ) ) };
+      double errors[2] = { 0.0, 0.0 };
+      std::shared_ptr< Motion > motions[2];
+      for ( int k = 0; k < 2; ++k )
+      {
+         motions[k] = motionWith( ic, 600.0, actions );
+         motions[k]->setPropagator( sundmans[k] );
+         motions[k]->stepTo( span );
+         for ( double t = 0.0; t <= span; t += 600.0 )
+         {
+            errors[k] = std::max( errors[k],
+                                  positionError( motions[k]->getState( t ),
+                                                 reference->getState( t ) ) );
+         }
+      }
+      std::cout << "HEO day: Sundman " << sundmans[0]->getSteps()
+                << " steps, " << errors[0] << " m; Cowell "
+                << sundmans[1]->getSteps() << " steps, " << errors[1]
+                << " m" << std::endl;
+      report( "Sundman position error over a HEO day vs dopri5 at 1e-14",
+              errors[0], 0.1 );
+      report( "Sundman position error over Cowell's", errors[0] / errors[1],
+              0.25 );
+      report( "Sundman steps over Cowell's",
+              double( sundmans[0]->getSteps() ) / sundmans[1]->getSteps(),
+              1.0 );
+      report( "Sundman STM over a HEO day vs dopri5 at 1e-14",
+              stmError( motions[0]->getStatePartials( span ),
+                        reference->getStatePartials( span ) ), 1.E-6 );
+   }
+
+   // EnckePropagator against an exact reference on every platform: the
+   // reference gravity plus a second point mass of a small fraction of
+   // its GM at the same centre is a two-body orbit in the summed GM. A
+   // day in LEO at 1e-13 with a 1e-5 fraction, where the reference
+   // stays put, and with a 1e-3 fraction, which rectifies it about
+   // every orbit, and a hyperbolic flyby with a 1e-3 fraction at the
+   // default tolerance. The error follows the tolerance, as the scaled
+   // deviation's truncation error sets it, and at 1e-13 is well under
+   // Cowell's.
+   void
+   checkEncke()
+   {
+      double perigee = 7000.E3;
+      double speed = 1.2 * std::sqrt( 2 * mu / perigee );
+      std::vector< double > leo = { 757700.0, 5222607.0, 4851500.0,
+                                    2213.21, 4678.34, -5371.30 };
+      std::vector< double > flyby = { perigee, 0.0, 0.0, 0.0,
+                                      speed * std::cos( 0.5 ),
+                                      speed * std::sin( 0.5 ) };
+
+      const char *names[3] = { "a day in LEO at 1e-13",
+                               "a rectifying day in LEO at 1e-13",
+                               "a hyperbolic flyby" };
+      const std::vector< double > ics[3] = { leo, leo, flyby };
+      const double fractions[3] = { 1.E-5, 1.E-3, 1.E-3 };
+      const double spans[3] = { 86400.0, 86400.0, 20000.0 };
+      const double tolerances[3] = { 1.E-13, 1.E-13, 1.E-9 };
+      const double bounds[3] = { 1.E-4, 2.E-3, 0.1 };
+      double errors[3];
+      for ( int k = 0; k < 3; ++k )
+      {
+         std::vector< std::shared_ptr< Action > > actions = {
+            std::shared_ptr< Action >(
+               new GravityAction( "Earth", radius, mu, 0.0 ) ),
+            std::shared_ptr< Action >(
+               new GravityAction( "Extra", radius, fractions[k] * mu,
+                                  0.0 ) ) };
+         std::vector< double > exact = EnckePropagator::kepler(
+            ics[k], ( 1 + fractions[k] ) * mu, spans[k] );
+         std::shared_ptr< EnckePropagator > encke(
+            new EnckePropagator( 1.E-2, tolerances[k] ) );
+         std::shared_ptr< Motion > motion =
+            motionWith( ics[k], 600.0, actions );
+         motion->setPropagator( encke );
+         motion->stepTo( spans[k] );
+         errors[k] = positionError( motion->getState( spans[k] ), exact );
+         std::cout << "Encke over " << names[k] << ": " << encke->getSteps()
+                   << " steps, " << encke->getRectifications()
+                   << " rectifications" << std::endl;
+         report( std::string( "Encke position over " ) + names[k] +
+                 " vs two-body in the summed GM", errors[k], bounds[k] );
+
+         if ( k == 0 )
+         {
+            std::shared_ptr< Propagator > others[2] = {
+               std::shared_ptr< Propagator >(
+                  new EnckePropagator( 1.E-2, 1.E-12 ) ),
+               std::shared_ptr< Propagator >(
+                  new ScalarPropagator< double >( 1.E-13, 1.E-13 ) ) };
+            const char *otherNames[2] = { "Encke at 1e-12", "Cowell" };
+            for ( int j = 0; j < 2; ++j )
+            {
+               std::shared_ptr< Motion > other =
+                  motionWith( ics[k], 600.0, actions );
+               other->setPropagator( others[j] );
+               other->stepTo( spans[k] );
+               report( std::string( "Encke error at 1e-13 over " ) +
+                       otherNames[j] + "'s",
+                       errors[k] / positionError( other->getState( spans[k] ),
+                                                  exact ), 0.2 );
+            }
+         }
+      }
+   }
+
+   // SecularPropagator against Motion with the same Actions over five
+   // days, every minute, for LEO, a 300 km by 5000 km orbit decaying
+   // under drag and GEO. Screening drops candidates by getEnvelope(), so
+   // the secular position must stay within it throughout.
+   void
+   checkSecularEnvelope()
+   {
+      std::shared_ptr< GravityAction > gravity(
+         new GravityAction( "Earth", radius, mu, 1.082626925638815E-3 ) );
+      std::shared_ptr< AtmosphereAction > atmosphere(
+         new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                               88667.0, rotation, 0.0031 ) );
+      double perigee = radius + 300.E3;
+      double apogee = radius + 5000.E3;
+      double speed = std::sqrt( mu * ( 2 / perigee -
+                                       2 / ( perigee + apogee ) ) );
+      double geo = 42164.E3;
+
+      const char *names[3] = { "LEO", "an eccentric orbit under drag",
+                               "GEO" };
+      const std::vector< double > ics[3] = {
+         { 757700.0, 5222607.0, 4851500.0, 2213.21, 4678.34, -5371.30 },
+         { perigee * std::cos( 0.3 ), perigee * std::sin( 0.3 ), 0.0,
+           -speed * std::sin( 0.3 ) * std::cos( 0.9 ),
+           speed * std::cos( 0.3 ) * std::cos( 0.9 ),
+           speed * std::sin( 0.9 ) },
+         { geo, 0.0, 0.0, 0.0, std::sqrt( mu / geo ), 0.0 } };
+      double span = 5 * 86400.0;
+
+      SecularPropagator catalog( gravity, atmosphere );
+      for ( int k = 0; k < 3; ++k )
+      {
+         catalog.addObject( ics[k], 0.0 );
+      }
+      for ( int k = 0; k < 3; ++k )
+      {
+         std::shared_ptr< Motion > motion =
+            motionWith( ics[k], 60.0, { gravity, atmosphere } );
+         motion->stepTo( span );
+         double worst = 0.0;
+         for ( double t = 0.0; t <= span; t += 60.0 )
+         {
+            worst = std::max( worst,
+                              positionError( catalog.getState( k, t ),
+                                             motion->getState( t ) ) /
+                              catalog.getEnvelope( t )( k ) );
+         }
+         report( std::string( "secular error over its envelope in " ) +
+                 names[k] + " over five days", worst, 1.0 );
+      }
+   }
+
+   // Every Propagator stepped to epochs off its 60 s grid, in LEO under
+   // J2 and drag, against the default integration. The state logged at
+   // the epoch must be the state there, not at the grid time before or
+   // after it, which is hundreds of kilometres away.
+   void
+   checkOffGrid()
+   {
+      std::vector< double > ic = { 757700.0, 5222607.0, 4851500.0,
+                                   2213.21, 4678.34, -5371.30 };
+      std::shared_ptr< Action > gravity(
+         new GravityAction( "Earth", radius, mu, 1.082626925638815E-3 ) );
+      std::vector< std::shared_ptr< Action > > actions = {
+         gravity,
+         std::shared_ptr< Action >(
+            new AtmosphereAction( "Earth Atmosphere", 7078136.3, 3.614E-13,
+                                  88667.0, rotation, 0.0031 ) ) };
+
+      const char *names[7] = { "Parareal", "ChebyshevPicard",
+                               "TaylorPropagator", "SundmanPropagator",
+                               "EnckePropagator", "SymplecticPropagator",
+                               "ScalarPropagator< double >" };
+      for ( double t: { 630.0, 650.0 } )
+      {
+         std::shared_ptr< Motion > reference = motionWith( ic, 60.0, actions );
+         reference->stepTo( t );
+         std::shared_ptr< Propagator > propagators[7] = {
+            std::shared_ptr< Propagator >( new Parareal( gravity, 300.0, 4,
+                                                         2 ) ),
+            std::shared_ptr< Propagator >( new ChebyshevPicard() ),
+            std::shared_ptr< Propagator >( new TaylorPropagator() ),
+            std::shared_ptr< Propagator >( new SundmanPropagator() ),
+            std::shared_ptr< Propagator >( new EnckePropagator() ),
+            std::shared_ptr< Propagator >( new SymplecticPropagator() ),
+            std::shared_ptr< Propagator >( new ScalarPropagator< double >() ) };
+         for ( int k = 0; k < 7; ++k )
+         {
+            std::shared_ptr< Motion > motion = motionWith( ic, 60.0, actions );
+            motion->setPropagator( propagators[k] );
+            motion->stepTo( t );
+            report( std::string( names[k] ) + " stepped to " +
+                    std::to_string( (int) t ) + " s vs the default",
+                    positionError( motion->getState( t ),
+                                   reference->getState( t ) ),
+                    0.01 );
+         }
+      }
+   }
+}
+
+int
+main( int argc, char *argv[] )
+{
+   checkSaltation();
+   checkEvents();
+   checkCache();
+   checkKnowledgeUpdate();
+   checkPattern();
+   checkThreadTeam();
+   checkAssociation();
+   checkScreen();
+   checkMixture();
+   checkScenarios();
+   checkSweep();
+   checkMeasurementFile();
+   checkReplay();
+   checkMixedPrecision();
+   checkStepToEpoch();
+   checkMidArcActivation();
+   checkAtmosphereTable();
+   checkScalarPrecision();
+   checkParareal();
+   checkSymplecticEnergy();
+   checkTaylor();
+   checkSundman();
+   checkEncke();
+   checkSecularEnvelope();
+   checkOffGrid();
+
+   std::cout << ( failures ? "FAILED " : "All checks passed" );
+   if ( failures )
+   {
+      std::cout << failures << " checks";
+   }
+   std::cout << std::endl;
+   return failures ? 1 : 0;
+}
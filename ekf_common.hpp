@@ -0,0 +1,69 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ekf_common.hpp
+/// @brief   Constants and helpers shared by the check and benchmark
+///          programs.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_COMMON_HEADER_GUARD
+#define EKF_COMMON_HEADER_GUARD
+
+// C++ Standard Library
+#include <memory>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <AgentGroup.hpp>
+#include <Motion.hpp>
+
+// Earth radius, GM and rotation rate
+const double radius = 6378136.3;
+const double mu = 3.986004415E+14;
+const double rotation = 7.29211585530066E-5;
+
+// A Motion under actions
+inline std::shared_ptr< Motion >
+motionWith( const std::vector< double > &ic, double step,
+            const std::vector< std::shared_ptr< Action > > &actions )
+{
+  std::shared_ptr< Motion > motion( new Motion( ic, step ) );
+  for ( const auto &action: actions )
+  {
+    motion->addAction( action );
+  }
+  return motion;
+}
+
+// An Action hiding the partial pattern of another, so the helper
+// falls back to its dense partials
+class dense_action : public Action
+{
+ public:
+  dense_action( std::shared_ptr< Action > action )
+    : m_action( action )
+  {
+  };
+
+  void getAcceleration( std::vector< double > &acceleration,
+                        const std::vector< double > &state ) const override
+  {
+    m_action->getAcceleration( acceleration, state );
+  };
+
+  void getPartials( std::vector< double > &partials,
+                    const std::vector< double > &state,
+                    const AgentGroup &activeAgents ) override
+  {
+    m_action->getPartials( partials, state, activeAgents );
+  };
+
+ private:
+  std::shared_ptr< Action > m_action;
+};
+
+#endif // EKF_COMMON_HEADER_GUARD
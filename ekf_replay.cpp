@@ -0,0 +1,127 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <AtmosphereAction.hpp>
+#include <GravityAction.hpp>
+#include <ReplayHarness.hpp>
+#include <TrackingSimulator.hpp>
+
+// The standard load: objects near one LEO orbit, tracked by stations
+// spread over the Earth for six hours at a 10 s cadence
+namespace
+{
+   const double radius = 6378136.3;
+   const double rotation = 7.29211585530066E-5;
+   const double span = 21600.0;
+   const double cadence = 10.0;
+   const int numObjects = 20;
+   const double stations[8][2] = { { 0.70, -1.36 }, { 0.61, 2.43 },
+                                   { -0.55, 2.59 }, { 0.89, 0.05 },
+                                   { -0.45, -1.23 }, { 0.12, 0.64 },
+                                   { 0.36, 2.33 }, { -0.33, 0.32 } };
+   const double noise[3] = { 5.0, 0.01, 1.E-4 };
+
+   std::vector< std::shared_ptr< Action > >
+   standardActions()
+   {
+      return { std::shared_ptr< Action >(
+                  new GravityAction( "Earth", radius, 3.986004415E+14,
+                                     1.082626925638815E-3 ) ),
+               std::shared_ptr< Action >(
+                  new AtmosphereAction( "Earth Atmosphere", 7078136.3,
+                                        3.614E-13, 88667.0, rotation,
+                                        0.0031 ) ) };
+   }
+
+   std::vector< double >
+   standardState( int object )
+   {
+      std::vector< double > state = { 757700.0, 5222607.0, 4851500.0,
+                                      2213.21, 4678.34, -5371.30 };
+      state[3] += 5.0 * ( object - numObjects / 2 );
+      state[5] += 3.0 * ( object % 7 );
+      return state;
+   }
+}
+
+int
+main( int argc, char *argv[] )
+{
+   if ( argc < 2 )
+   {
+      std::cout << "Usage: " << argv[0]
+                << " measurement_file [speed] [min_rate]" << std::endl;
+      return 1;
+   }
+   std::vector< std::shared_ptr< Action > > actions = standardActions();
+
+   // Record the standard load once
+   if ( !std::ifstream( argv[1] ) )
+   {
+      TrackingSimulator simulator( radius, rotation );
+      for ( const auto &station: stations )
+      {
+         int k = simulator.addStation( station[0], station[1], 0.1 );
+         simulator.setNoise( k, noise[0], noise[1], noise[2] );
+      }
+      for ( int object = 0; object < numObjects; ++object )
+      {
+         simulator.addObject( standardState( object ), actions );
+      }
+      simulator.setCadence( cadence );
+      std::size_t count = simulator.simulate( 0.0, span, argv[1] );
+      std::cout << "Recorded " << count << " measurements to " << argv[1]
+                << std::endl;
+   }
+
+   // Estimate every object from 100 m off, 100 m and 0.1 m/s sigma
+   ReplayHarness harness( radius, rotation );
+   for ( const auto &station: stations )
+   {
+      int k = harness.addStation( station[0], station[1] );
+      harness.setNoise( k, noise[0], noise[1], noise[2] );
+   }
+   Eigen::MatrixXd covariance = Eigen::MatrixXd::Zero( 6, 6 );
+   covariance.diagonal() << 1.E4, 1.E4, 1.E4, 1.E-2, 1.E-2, 1.E-2;
+   for ( int object = 0; object < numObjects; ++object )
+   {
+      std::vector< double > state = standardState( object );
+      state[0] += 100.0;
+      std::shared_ptr< Motion > motion( new Motion( state, cadence ) );
+      for ( const auto &action: actions )
+      {
+         motion->addAction( action );
+      }
+      std::shared_ptr< Knowledge > knowledge(
+         new Knowledge( motion->getActiveAgents() ) );
+      knowledge->setCovariance( covariance );
+      harness.addObject( motion, knowledge );
+   }
+   if ( argc > 2 )
+   {
+      harness.setSpeed( std::atof( argv[2] ) );
+   }
+
+   ReplayReport report = harness.replay( argv[1] );
+   std::cout << report.measurements << " measurements in " << report.seconds
+             << " s, " << report.rate << " per second" << std::endl;
+   std::cout << "Update latency p50 " << 1.E6 * report.p50 << " us, p99 "
+             << 1.E6 * report.p99 << " us, p999 " << 1.E6 * report.p999
+             << " us, worst " << 1.E6 * report.worst << " us" << std::endl;
+   if ( report.lag > 0.0 )
+   {
+      std::cout << "Largest lag behind schedule " << report.lag << " s"
+                << std::endl;
+   }
+
+   // Fail the gate below the required rate
+   if ( ( argc > 3 ) && ( report.rate < std::atof( argv[3] ) ) )
+   {
+      std::cout << "Below " << argv[3] << " measurements per second"
+                << std::endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,41 @@
+#include <cstdlib>
+#include <iostream>
+#include <ScenarioRunner.hpp>
+
+int
+main( int argc, char *argv[] )
+{
+   if ( argc < 2 )
+   {
+      std::cout << "Usage: " << argv[0]
+                << " scenario_file [threads] [output_directory]" << std::endl;
+      return 1;
+   }
+
+   // Parse every scenario up front
+   ScenarioRunner runner;
+   runner.readFile( argv[1] );
+   if ( argc > 2 )
+   {
+      runner.setThreads( std::atoi( argv[2] ) );
+   }
+   if ( argc > 3 )
+   {
+      runner.setOutputDirectory( argv[3] );
+   }
+
+   // Run them across the thread team and summarize
+   std::vector< ScenarioReport > reports = runner.run();
+   double seconds = 0.0;
+   for ( const ScenarioReport &report: reports )
+   {
+      std::cout << report.name << ": " << report.outputs << " outputs to "
+                << report.file << " in " << report.seconds << " s"
+                << std::endl;
+      seconds += report.seconds;
+   }
+   std::cout << reports.size() << " scenarios, " << seconds
+             << " s of propagation" << std::endl;
+
+   return 0;
+}